@@ -0,0 +1,172 @@
+
+#include "agg/bars.h"
+
+#include <new>
+#include <string.h>
+
+/**
+ * Grows array *a* from *size* to *capacity* elements. New elements are
+ * zeroed.
+ */
+template <typename T>
+static int _grow(T **a, unsigned int size, unsigned int capacity)
+{
+  T *n = new (std::nothrow) T[capacity];
+  if(NULL == n) {
+    return -1;
+  }
+  if(NULL != *a) {
+    memcpy(n, *a, size * sizeof(T));
+  }
+  memset(&n[size], 0, (capacity - size) * sizeof(T));
+  delete [] *a;
+  *a = n;
+  return 0;
+}
+
+/**
+ * Makes sure the accumulators can hold symbol *id*.
+ */
+static int _reserve(bars *b, unsigned int id)
+{
+  if(id < b->capacity) {
+    return 0;
+  }
+
+  unsigned int capacity = 0 < b->capacity ? b->capacity : 1;
+  while(capacity <= id) {
+    capacity <<= 1;
+  }
+
+  unsigned int size = b->capacity;
+  if(0 > _grow(&b->open, size, capacity)
+     || 0 > _grow(&b->high, size, capacity)
+     || 0 > _grow(&b->low, size, capacity)
+     || 0 > _grow(&b->close, size, capacity)
+     || 0 > _grow(&b->volume, size, capacity)
+     || 0 > _grow(&b->notional, size, capacity)
+     || 0 > _grow(&b->trades, size, capacity)
+     || 0 > _grow(&b->price_type, size, capacity)
+     || 0 > _grow(&b->touched, size, capacity)) {
+    // Arrays grown so far are larger than capacity, harmless
+    return -1;
+  }
+  b->capacity = capacity;
+  return 0;
+}
+
+bars* bars_init(unsigned int capacity, unsigned int interval)
+{
+  bars *b = new bars;
+  memset(b, 0, sizeof(bars));
+  b->interval = 0 < interval ? interval : 1;
+
+  if(0 > _reserve(b, 0 < capacity ? capacity - 1 : 0)) {
+    bars_destroy(b);
+    return NULL;
+  }
+  return b;
+}
+
+void bars_destroy(bars *b)
+{
+  delete [] b->open;
+  delete [] b->high;
+  delete [] b->low;
+  delete [] b->close;
+  delete [] b->volume;
+  delete [] b->notional;
+  delete [] b->trades;
+  delete [] b->price_type;
+  delete [] b->touched;
+  delete b;
+}
+
+/**
+ * Completes the bar of symbol *id*, invoking *fn*, and clears its
+ * accumulators for the next one.
+ */
+static void _emit(bars *b, unsigned int id, bars_emitFn fn, void *obj)
+{
+  bar r;
+  r.start = b->bucket * b->interval;
+  r.interval = b->interval;
+  r.open = b->open[id];
+  r.high = b->high[id];
+  r.low = b->low[id];
+  r.close = b->close[id];
+  r.volume = b->volume[id];
+  r.vwap = 0 < r.volume ? b->notional[id] / r.volume : r.close;
+  r.trades = b->trades[id];
+  r.price_type = b->price_type[id];
+  fn(id, &r, obj);
+
+  b->volume[id] = 0;
+  b->notional[id] = 0;
+  b->trades[id] = 0;
+}
+
+/**
+ * Opens the bar of symbol *id* with a trade at *price*.
+ */
+static inline void _open(bars *b, unsigned int id, int price)
+{
+  b->open[id] = price;
+  b->high[id] = price;
+  b->low[id] = price;
+}
+
+int bars_roll(bars *b, unsigned int ms_of_day, bars_emitFn fn, void *obj)
+{
+  unsigned int bucket = ms_of_day / b->interval;
+  if(bucket == b->bucket) {
+    return 0;
+  }
+
+  int n = b->touched_size;
+  for(int i = 0; i < n; i++) {
+    _emit(b, b->touched[i], fn, obj);
+  }
+
+  b->touched_size = 0;
+  b->bucket = bucket;
+  return n;
+}
+
+int bars_add(bars *b,
+             unsigned int id,
+             int price,
+             unsigned int size,
+             unsigned char price_type,
+             bars_emitFn fn,
+             void *obj)
+{
+  if(0 > _reserve(b, id)) {
+    return -1;
+  }
+
+  if(0 == b->trades[id]) {
+    b->touched[b->touched_size++] = id;
+    _open(b, id, price);
+  } else if(price_type != b->price_type[id]) {
+    // Prices of different types don't compare. The bar so far is
+    // completed early and the symbol, already touched, opens another
+    // one in the same interval.
+    _emit(b, id, fn, obj);
+    _open(b, id, price);
+  } else {
+    if(price > b->high[id]) {
+      b->high[id] = price;
+    }
+    if(price < b->low[id]) {
+      b->low[id] = price;
+    }
+  }
+
+  b->close[id] = price;
+  b->volume[id] += size;
+  b->notional[id] += (double)price * size;
+  b->trades[id]++;
+  b->price_type[id] = price_type;
+  return 0;
+}
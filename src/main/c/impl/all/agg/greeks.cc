@@ -0,0 +1,365 @@
+#include "agg/greeks.h"
+
+#include <math.h>
+#include <new>
+#include <pthread.h>
+#include <string.h>
+
+// Arrays are padded to the widest kernel's lanes
+#define GREEKS_PAD 8
+
+#define GREEKS_ALWAYS_INLINE inline __attribute__((always_inline))
+
+// Vectors are returned by functions always inlined into a kernel of
+// their instruction set, the calling convention doesn't matter.
+// Arguments are passed by reference for the same reason.
+#pragma GCC diagnostic ignored "-Wpsabi"
+
+/*
+  The kernel is written once with GCC vector extensions and inlined
+  into one function per instruction set, each compiled with the
+  target's attributes. Lanes are 64 bit, the scalar kernel has one.
+  Nothing but plain arithmetic, comparisons and selects, no libm, so
+  that everything stays in vector registers.
+*/
+
+/**
+ * \struct
+ *
+ * The vector types of a kernel of *N* lanes.
+ */
+template <int N>
+struct _lanes
+{
+  typedef double d __attribute__((vector_size(8 * N)));
+  typedef long long l __attribute__((vector_size(8 * N)));
+};
+
+// 1.5 * 2^52, adding it rounds to an integer held in the low bits
+static const double g_magic = 6755399441055744.0;
+
+template <int N>
+static GREEKS_ALWAYS_INLINE typename _lanes<N>::d _splat(double x)
+{
+  typename _lanes<N>::d v;
+  for(int i = 0; i < N; i++) {
+    v[i] = x;
+  }
+  return v;
+}
+
+template <int N>
+static GREEKS_ALWAYS_INLINE typename _lanes<N>::d
+_load(const double *a)
+{
+  typename _lanes<N>::d v;
+  memcpy(&v, a, sizeof(v));
+  return v;
+}
+
+template <int N>
+static GREEKS_ALWAYS_INLINE void _store(double *a,
+                                        const typename _lanes<N>::d &v)
+{
+  memcpy(a, &v, sizeof(v));
+}
+
+template <int N>
+static GREEKS_ALWAYS_INLINE typename _lanes<N>::d
+_max(const typename _lanes<N>::d &a, const typename _lanes<N>::d &b)
+{
+  return a > b ? a : b;
+}
+
+template <int N>
+static GREEKS_ALWAYS_INLINE typename _lanes<N>::d
+_min(const typename _lanes<N>::d &a, const typename _lanes<N>::d &b)
+{
+  return a < b ? a : b;
+}
+
+template <int N>
+static GREEKS_ALWAYS_INLINE typename _lanes<N>::d
+_abs(const typename _lanes<N>::d &x)
+{
+  return x < 0 ? -x : x;
+}
+
+/**
+ * \return e^x, relative error below 1e-14 for |x| < 708
+ */
+template <int N>
+static GREEKS_ALWAYS_INLINE typename _lanes<N>::d
+_exp(const typename _lanes<N>::d &x)
+{
+  typedef typename _lanes<N>::d d;
+  typedef typename _lanes<N>::l l;
+
+  d c = _min<N>(_max<N>(x, _splat<N>(-708.0)), _splat<N>(708.0));
+
+  // x = k ln2 + r, |r| <= ln2 / 2
+  d t = c * 1.4426950408889634 + g_magic;
+  d k = t - g_magic;
+  d r = c - k * 6.93145751953125e-1 - k * 1.42860682030941723212e-6;
+
+  // Taylor series to r^11 / 11!
+  d p = _splat<N>(1.0 / 39916800);
+  p = p * r + 1.0 / 3628800;
+  p = p * r + 1.0 / 362880;
+  p = p * r + 1.0 / 40320;
+  p = p * r + 1.0 / 5040;
+  p = p * r + 1.0 / 720;
+  p = p * r + 1.0 / 120;
+  p = p * r + 1.0 / 24;
+  p = p * r + 1.0 / 6;
+  p = p * r + 0.5;
+  p = p * r + 1.0;
+  p = p * r + 1.0;
+
+  // Adds k to the exponent of p
+  l ki = (l)t - (l)_splat<N>(g_magic);
+  return (d)((l)p + (ki << 52));
+}
+
+/**
+ * \return The natural logarithm of x > 0, relative error below 1e-13
+ */
+template <int N>
+static GREEKS_ALWAYS_INLINE typename _lanes<N>::d
+_log(const typename _lanes<N>::d &x)
+{
+  typedef typename _lanes<N>::d d;
+  typedef typename _lanes<N>::l l;
+
+  // x = 2^e m, 1 <= m < 2
+  l bits = (l)x;
+  l e = (bits >> 52) - 1023;
+  d m = (d)((bits & 0x000fffffffffffffLL) | 0x3ff0000000000000LL);
+
+  // sqrt(2) / 2 < m <= sqrt(2)
+  l big = m > 1.4142135623730951;
+  m = big ? m * 0.5 : m;
+  e = e - big;                  // masks are -1
+
+  d ed = (d)(e + (l)_splat<N>(g_magic)) - g_magic;
+
+  // log(m) = 2 atanh(f), |f| < 0.172
+  d f = (m - 1.0) / (m + 1.0);
+  d s = f * f;
+  d p = _splat<N>(2.0 / 19);
+  p = p * s + 2.0 / 17;
+  p = p * s + 2.0 / 15;
+  p = p * s + 2.0 / 13;
+  p = p * s + 2.0 / 11;
+  p = p * s + 2.0 / 9;
+  p = p * s + 2.0 / 7;
+  p = p * s + 2.0 / 5;
+  p = p * s + 2.0 / 3;
+  p = p * s + 2.0;
+  return ed * 0.6931471805599453 + f * p;
+}
+
+template <int N>
+static GREEKS_ALWAYS_INLINE typename _lanes<N>::d
+_sqrt(const typename _lanes<N>::d &x)
+{
+  return _exp<N>(_log<N>(x) * 0.5);
+}
+
+/**
+ * \return The standard normal density
+ */
+template <int N>
+static GREEKS_ALWAYS_INLINE typename _lanes<N>::d
+_npdf(const typename _lanes<N>::d &x)
+{
+  return _exp<N>(x * x * -0.5) * 0.3989422804014327;
+}
+
+/**
+ * \return The standard normal distribution, absolute error below
+ *         7.5e-8 (Abramowitz and Stegun 26.2.17)
+ */
+template <int N>
+static GREEKS_ALWAYS_INLINE typename _lanes<N>::d
+_ncdf(const typename _lanes<N>::d &x)
+{
+  typedef typename _lanes<N>::d d;
+
+  d a = _abs<N>(x);
+  d t = 1.0 / (a * 0.2316419 + 1.0);
+  d p = _splat<N>(1.330274429);
+  p = p * t - 1.821255978;
+  p = p * t + 1.781477937;
+  p = p * t - 0.356563782;
+  p = p * t + 0.319381530;
+  d c = 1.0 - _npdf<N>(a) * p * t;
+  return x < 0 ? 1.0 - c : c;
+}
+
+/**
+ * Computes the results of *N* quotes starting at *i*.
+ */
+template <int N>
+static GREEKS_ALWAYS_INLINE void _lane(greeks *g, size_t i)
+{
+  typedef typename _lanes<N>::d d;
+  typedef typename _lanes<N>::l l;
+
+  d s = _load<N>(&g->spot[i]);
+  d k = _load<N>(&g->strike[i]);
+  d t = _load<N>(&g->years[i]);
+  d p = _load<N>(&g->price[i]);
+  d w = _load<N>(&g->sign[i]);
+
+  // Invalid lanes compute harmless values and are NaN in the end
+  l valid = (s > 0) & (k > 0) & (t > 0) & (p > 0);
+  s = valid ? s : 1.0;
+  k = valid ? k : 1.0;
+  t = valid ? t : 1.0;
+
+  d disc = _exp<N>(t * -g->rate);
+  d kd = k * disc;
+  d lower = _max<N>(w * (s - kd), _splat<N>(0.0));
+  d upper = w > 0 ? s : kd;
+  valid &= (p > lower) & (p < upper);
+
+  d sqrt_t = _sqrt<N>(t);
+  d x = _log<N>(s / kd);
+
+  // The inflection point of the price in the volatility
+  d sigma = _max<N>(_sqrt<N>(_abs<N>(x) * 2.0 / t + 1e-300),
+                    _splat<N>(0.01));
+  d d1;
+  d pdf;
+  for(int n = 0; n < GREEKS_ITERATIONS; n++) {
+    d vt = sigma * sqrt_t;
+    d1 = x / vt + vt * 0.5;
+    d price = w * (s * _ncdf<N>(w * d1) - kd * _ncdf<N>(w * (d1 - vt)));
+    pdf = _npdf<N>(d1);
+    d vega = _max<N>(s * pdf * sqrt_t, _splat<N>(1e-300));
+    sigma = sigma - (price - p) / vega;
+    sigma = _min<N>(_max<N>(sigma, _splat<N>(1e-4)), _splat<N>(10.0));
+  }
+
+  d vt = sigma * sqrt_t;
+  d1 = x / vt + vt * 0.5;
+  pdf = _npdf<N>(d1);
+  d price = w * (s * _ncdf<N>(w * d1) - kd * _ncdf<N>(w * (d1 - vt)));
+  valid &= _abs<N>(price - p) <= s * 1e-6;
+
+  d nan = _splat<N>(NAN);
+  _store<N>(&g->iv[i], valid ? sigma : nan);
+  _store<N>(&g->delta[i], valid ? w * _ncdf<N>(w * d1) : nan);
+  _store<N>(&g->gamma[i], valid ? pdf / (s * vt) : nan);
+  _store<N>(&g->vega[i], valid ? s * pdf * sqrt_t : nan);
+}
+
+template <int N>
+static GREEKS_ALWAYS_INLINE void _compute(greeks *g)
+{
+  // The padding is computed along, results are ignored
+  for(size_t i = 0; i < g->size; i += N) {
+    _lane<N>(g, i);
+  }
+}
+
+__attribute__((target("avx512f")))
+static void _compute_avx512(greeks *g)
+{
+  _compute<8>(g);
+}
+
+__attribute__((target("avx2,fma")))
+static void _compute_avx2(greeks *g)
+{
+  _compute<4>(g);
+}
+
+static void _compute_scalar(greeks *g)
+{
+  _compute<1>(g);
+}
+
+static pthread_once_t g_isa_once = PTHREAD_ONCE_INIT;
+static int g_isa;
+static void (*g_compute) (greeks *g);
+
+/**
+ * Chooses the widest kernel the CPU supports.
+ */
+static void _isa_init()
+{
+  __builtin_cpu_init();
+  if(__builtin_cpu_supports("avx512f")) {
+    g_isa = GREEKS_ISA_AVX512;
+    g_compute = _compute_avx512;
+  } else if(__builtin_cpu_supports("avx2")
+            && __builtin_cpu_supports("fma")) {
+    g_isa = GREEKS_ISA_AVX2;
+    g_compute = _compute_avx2;
+  } else {
+    g_isa = GREEKS_ISA_SCALAR;
+    g_compute = _compute_scalar;
+  }
+}
+
+greeks* greeks_init(size_t capacity, double rate)
+{
+  greeks *g = new (std::nothrow) greeks;
+  if(NULL == g) {
+    return NULL;
+  }
+  memset(g, 0, sizeof(greeks));
+  g->capacity = capacity;
+  g->rate = rate;
+
+  // One block, nine arrays of the padded capacity
+  size_t padded = (capacity + GREEKS_PAD - 1) / GREEKS_PAD * GREEKS_PAD;
+  double *a = new (std::nothrow) double[9 * padded];
+  if(NULL == a) {
+    delete g;
+    return NULL;
+  }
+  memset(a, 0, 9 * padded * sizeof(double));
+  double **arrays[] = {
+    &g->spot, &g->strike, &g->years, &g->price, &g->sign,
+    &g->iv, &g->delta, &g->gamma, &g->vega
+  };
+  for(size_t i = 0; i < sizeof(arrays) / sizeof(double**); i++) {
+    *arrays[i] = &a[i * padded];
+  }
+  return g;
+}
+
+void greeks_destroy(greeks *g)
+{
+  delete [] g->spot;
+  delete g;
+}
+
+int greeks_isa()
+{
+  pthread_once(&g_isa_once, _isa_init);
+  return g_isa;
+}
+
+void greeks_compute(greeks *g)
+{
+  pthread_once(&g_isa_once, _isa_init);
+  g_compute(g);
+}
+
+int greeks_compute_isa(greeks *g, int isa)
+{
+  if(isa > greeks_isa()) {
+    return -1;
+  }
+  switch(isa)
+    {
+    case GREEKS_ISA_AVX512: _compute_avx512(g); break;
+    case GREEKS_ISA_AVX2:   _compute_avx2(g); break;
+    default:                _compute_scalar(g); break;
+    }
+  return 0;
+}
@@ -0,0 +1,311 @@
+#include "agg/nbbo.h"
+#include "log/logging.h"
+
+#include <limits.h>
+#include <new>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/**
+ * Grows array *a* from *size* to *capacity* elements. New elements are
+ * zeroed.
+ */
+template <typename T>
+static int _grow(T **a, unsigned int size, unsigned int capacity)
+{
+  T *n = new (std::nothrow) T[capacity];
+  if(NULL == n) {
+    return -1;
+  }
+  if(NULL != *a) {
+    memcpy(n, *a, size * sizeof(T));
+  }
+  memset(&n[size], 0, (capacity - size) * sizeof(T));
+  delete [] *a;
+  *a = n;
+  return 0;
+}
+
+/**
+ * Makes sure the tables can hold symbol *id*.
+ */
+static int _reserve(nbbo *n, unsigned int id)
+{
+  if(id < n->capacity) {
+    return 0;
+  }
+
+  unsigned int capacity = 0 < n->capacity ? n->capacity : 1;
+  while(capacity <= id) {
+    capacity <<= 1;
+  }
+
+  if(0 > _grow(&n->books, n->capacity, capacity)
+     || 0 > _grow(&n->best, n->capacity, capacity)) {
+    // Arrays grown so far are larger than capacity, harmless
+    return -1;
+  }
+  n->capacity = capacity;
+  return 0;
+}
+
+/**
+ * Removes the quotes of all venues of *k*.
+ */
+static void _book_clear(nbbo_book *k)
+{
+  for(int i = 0; i < NBBO_VENUES; i++) {
+    k->bid[i] = INT_MIN;
+    k->ask[i] = INT_MAX;
+  }
+  memset(k->bid_size, 0, sizeof(k->bid_size));
+  memset(k->ask_size, 0, sizeof(k->ask_size));
+}
+
+/**
+ * \return The price of a lane without quote, the worst of the side
+ */
+template <bool BID>
+static inline int _none()
+{
+  return BID ? INT_MIN : INT_MAX;
+}
+
+/**
+ * \return 1 if price *a* is better than *b*
+ */
+template <bool BID>
+static inline int _better(int a, int b)
+{
+  return BID ? a > b : a < b;
+}
+
+#ifdef __SSE2__
+/**
+ * \return A mask of the lanes of *a* better than those of *b*
+ */
+template <bool BID>
+static inline __m128i _better4(__m128i a, __m128i b)
+{
+  return BID ? _mm_cmpgt_epi32(a, b) : _mm_cmplt_epi32(a, b);
+}
+
+/**
+ * \return The lanes of *a* better than those of *b*, those of *b*
+ *         otherwise. There's no signed max/min before SSE4.1.
+ */
+template <bool BID>
+static inline __m128i _best4(__m128i a, __m128i b)
+{
+  __m128i m = _better4<BID>(a, b);
+  return _mm_or_si128(_mm_and_si128(m, a), _mm_andnot_si128(m, b));
+}
+#endif
+
+/**
+ * Lowers *exg* to the venue of lane *lane* if that is lower.
+ */
+static inline void _lowest(const unsigned short *venues, int lane, int *exg)
+{
+  if(0 > *exg || venues[lane] < *exg) {
+    *exg = venues[lane];
+  }
+}
+
+/**
+ * Recomputes the best price of one side of a book over all lanes, the
+ * sum of the sizes quoted at it and the lowest venue quoting it.
+ */
+template <bool BID>
+static void _scan(const int *prices,
+                  const unsigned int *sizes,
+                  const unsigned short *venues,
+                  int *best,
+                  unsigned int *best_size,
+                  unsigned short *best_exg)
+{
+#ifdef __SSE2__
+  __m128i acc = _mm_set1_epi32(_none<BID>());
+  for(int i = 0; i < NBBO_VENUES; i += 4) {
+    __m128i p = _mm_loadu_si128((const __m128i*)&prices[i]);
+    acc = _best4<BID>(p, acc);
+  }
+  // Broadcasts the best of the four lanes to all of them
+  acc = _best4<BID>(_mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)), acc);
+  acc = _best4<BID>(_mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1)), acc);
+  int price = _mm_cvtsi128_si32(acc);
+#else
+  int price = _none<BID>();
+  for(int i = 0; i < NBBO_VENUES; i++) {
+    if(_better<BID>(prices[i], price)) {
+      price = prices[i];
+    }
+  }
+#endif
+
+  if(_none<BID>() == price) {
+    *best = 0;
+    *best_size = 0;
+    *best_exg = 0;
+    return;
+  }
+
+  int exg = -1;
+#ifdef __SSE2__
+  __m128i sum = _mm_setzero_si128();
+  for(int i = 0; i < NBBO_VENUES; i += 4) {
+    __m128i p = _mm_loadu_si128((const __m128i*)&prices[i]);
+    __m128i s = _mm_loadu_si128((const __m128i*)&sizes[i]);
+    __m128i eq = _mm_cmpeq_epi32(p, acc);
+    sum = _mm_add_epi32(sum, _mm_and_si128(eq, s));
+    int mask = _mm_movemask_ps(_mm_castsi128_ps(eq));
+    while(0 != mask) {
+      _lowest(venues, i + __builtin_ctz(mask), &exg);
+      mask &= mask - 1;
+    }
+  }
+  sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+  sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+  unsigned int size = (unsigned int)_mm_cvtsi128_si32(sum);
+#else
+  unsigned int size = 0;
+  for(int i = 0; i < NBBO_VENUES; i++) {
+    if(price == prices[i]) {
+      size += sizes[i];
+      _lowest(venues, i, &exg);
+    }
+  }
+#endif
+
+  *best = price;
+  *best_size = size;
+  *best_exg = exg;
+}
+
+/**
+ * Replaces lane *lane* of venue *exg* of one side of a book and updates
+ * the side's best, rescanning the lanes only if the lane was or is at
+ * the best price without improving on it.
+ */
+template <bool BID>
+static void _side(int *prices,
+                  unsigned int *sizes,
+                  const unsigned short *venues,
+                  unsigned int lane,
+                  unsigned int exg,
+                  int price,
+                  unsigned int size,
+                  int *best,
+                  unsigned int *best_size,
+                  unsigned short *best_exg)
+{
+  if(0 == price || 0 == size) {
+    price = _none<BID>();
+    size = 0;
+  }
+  int was = prices[lane];
+  prices[lane] = price;
+  sizes[lane] = size;
+
+  // Sides without quotes have size 0
+  int current = 0 < *best_size ? *best : _none<BID>();
+  if(_better<BID>(price, current)) {
+    *best = price;
+    *best_size = size;
+    *best_exg = exg;
+    return;
+  }
+  if(_better<BID>(current, was) && _better<BID>(current, price)) {
+    return;
+  }
+  _scan<BID>(prices, sizes, venues, best, best_size, best_exg);
+}
+
+nbbo* nbbo_init(unsigned int capacity)
+{
+  nbbo *n = new nbbo;
+  memset(n, 0, sizeof(nbbo));
+
+  if(0 > _reserve(n, 0 < capacity ? capacity - 1 : 0)) {
+    nbbo_destroy(n);
+    return NULL;
+  }
+  return n;
+}
+
+void nbbo_destroy(nbbo *n)
+{
+  for(unsigned int i = 0; i < n->capacity; i++) {
+    delete n->books[i];
+  }
+  delete [] n->books;
+  delete [] n->best;
+  delete n;
+}
+
+void nbbo_clear(nbbo *n)
+{
+  for(unsigned int i = 0; i < n->capacity; i++) {
+    if(NULL != n->books[i]) {
+      _book_clear(n->books[i]);
+    }
+  }
+  memset(n->best, 0, n->capacity * sizeof(nbbo_quote));
+}
+
+int nbbo_update(nbbo *n,
+                unsigned int id,
+                unsigned int exg,
+                int bid,
+                unsigned int bid_size,
+                int ask,
+                unsigned int ask_size,
+                unsigned char price_type)
+{
+  unsigned int lane = NBBO_EXCHANGES > exg ? n->lanes[exg] : 0;
+  if(0 == lane) {
+    if(NBBO_EXCHANGES <= exg || NBBO_VENUES <= n->venue_count) {
+      if(1 == ++n->dropped) {
+        log(LOG_WARN, "No NBBO lane for exchange %u, dropping its quotes",
+            exg);
+      }
+      return 0;
+    }
+    n->venues[n->venue_count] = exg;
+    lane = ++n->venue_count;
+    n->lanes[exg] = lane;
+  }
+  lane--;
+
+  if(0 > _reserve(n, id)) {
+    return -1;
+  }
+
+  nbbo_book *k = n->books[id];
+  if(NULL == k) {
+    k = new (std::nothrow) nbbo_book;
+    if(NULL == k) {
+      return -1;
+    }
+    _book_clear(k);
+    n->books[id] = k;
+  }
+
+  nbbo_quote *q = &n->best[id];
+  nbbo_quote old = *q;
+  _side<true>(k->bid, k->bid_size, n->venues, lane, exg, bid, bid_size,
+              &q->bid, &q->bid_size, &q->bid_exg);
+  _side<false>(k->ask, k->ask_size, n->venues, lane, exg, ask, ask_size,
+               &q->ask, &q->ask_size, &q->ask_exg);
+  q->price_type = price_type;
+
+  return old.bid != q->bid
+    || old.ask != q->ask
+    || old.bid_size != q->bid_size
+    || old.ask_size != q->ask_size
+    || old.bid_exg != q->bid_exg
+    || old.ask_exg != q->ask_exg ? 1 : 0;
+}
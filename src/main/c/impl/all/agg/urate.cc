@@ -0,0 +1,110 @@
+
+#include "agg/urate.h"
+
+#include <new>
+#include <string.h>
+
+/**
+ * Grows array *a* from *size* to *capacity* elements. New elements are
+ * zeroed.
+ */
+template <typename T>
+static int _grow(T **a, unsigned int size, unsigned int capacity)
+{
+  T *n = new (std::nothrow) T[capacity];
+  if(NULL == n) {
+    return -1;
+  }
+  if(NULL != *a) {
+    memcpy(n, *a, size * sizeof(T));
+  }
+  memset(&n[size], 0, (capacity - size) * sizeof(T));
+  delete [] *a;
+  *a = n;
+  return 0;
+}
+
+/**
+ * Makes sure the counters can hold underlying *id*.
+ */
+static int _reserve(urate *r, unsigned int id)
+{
+  if(id < r->capacity) {
+    return 0;
+  }
+
+  unsigned int capacity = 0 < r->capacity ? r->capacity : 1;
+  while(capacity <= id) {
+    capacity <<= 1;
+  }
+
+  unsigned int size = r->capacity;
+  if(0 > _grow(&r->messages, size, capacity)
+     || 0 > _grow(&r->total, size, capacity)
+     || 0 > _grow(&r->names, size, capacity)
+     || 0 > _grow(&r->touched, size, capacity)) {
+    // Arrays grown so far are larger than capacity, harmless
+    return -1;
+  }
+  r->capacity = capacity;
+  return 0;
+}
+
+urate* urate_init(unsigned int capacity, unsigned int interval)
+{
+  urate *r = new urate;
+  memset(r, 0, sizeof(urate));
+  r->interval = 0 < interval ? interval : 1;
+
+  if(0 > _reserve(r, 0 < capacity ? capacity - 1 : 0)) {
+    urate_destroy(r);
+    return NULL;
+  }
+  return r;
+}
+
+void urate_destroy(urate *r)
+{
+  delete [] r->messages;
+  delete [] r->total;
+  delete [] r->names;
+  delete [] r->touched;
+  delete r;
+}
+
+int urate_add(urate *r, unsigned int id, const char *name)
+{
+  if(0 > _reserve(r, id)) {
+    return -1;
+  }
+
+  if(0 == r->total[id]) {
+    strncpy(r->names[id], name, SYMTAB_NAME_SIZE - 1);
+  }
+  if(0 == r->messages[id]) {
+    r->touched[r->touched_size++] = id;
+  }
+  r->messages[id]++;
+  r->total[id]++;
+  return 0;
+}
+
+int urate_roll(urate *r, unsigned int ms_of_day, urate_emitFn fn, void *obj)
+{
+  unsigned int bucket = ms_of_day / r->interval;
+  if(bucket == r->bucket) {
+    return 0;
+  }
+
+  unsigned int start = r->bucket * r->interval;
+  int n = r->touched_size;
+  for(int i = 0; i < n; i++) {
+    unsigned int id = r->touched[i];
+    fn(id, r->names[id], start, r->messages[id], r->total[id], obj);
+    r->messages[id] = 0;
+  }
+
+  r->touched_size = 0;
+  r->bucket = bucket;
+  return n;
+}
@@ -0,0 +1,170 @@
+
+#include "codec/lz4batch.h"
+#include "codec/varint.h"
+
+#include <lz4.h>
+#include <new>
+#include <string.h>
+#include <time.h>
+
+lz4batch* lz4batch_init(size_t capacity)
+{
+  lz4batch *b = new lz4batch;
+  b->data = new char[capacity];
+  b->size = 0;
+  b->capacity = capacity;
+  return b;
+}
+
+void lz4batch_destroy(lz4batch *b)
+{
+  delete [] b->data;
+  delete b;
+}
+
+int lz4batch_append(lz4batch *b, const void *frame, size_t size)
+{
+  if(b->size + VARINT_MAX_SIZE + size > b->capacity) {
+    return -1;
+  }
+
+  char *p = varint_put(&b->data[b->size], (unsigned int)size);
+  memcpy(p, frame, size);
+  b->size = (p - b->data) + size;
+  return 0;
+}
+
+char* lz4batch_take(lz4batch *b, size_t *size)
+{
+  if(0 == b->size) {
+    return NULL;
+  }
+
+  char *data = b->data;
+  *size = b->size;
+  b->data = new char[b->capacity];
+  b->size = 0;
+  return data;
+}
+
+int lz4batch_next(const char *batch,
+                  size_t batch_size,
+                  size_t *pos,
+                  const char **frame,
+                  size_t *size)
+{
+  const char *end = batch + batch_size;
+  unsigned int s;
+
+  if(*pos >= batch_size) {
+    return 0;
+  }
+
+  const char *p = varint_get(batch + *pos, end, &s);
+  if(NULL == p || s > (size_t)(end - p)) {
+    return -1;
+  }
+
+  *frame = p;
+  *size = s;
+  *pos = (p - batch) + s;
+  return 1;
+}
+
+lz4comp* lz4comp_init(const char *dict, size_t dict_size)
+{
+  // LZ4 only ever looks 64KB back
+  if(LZ4BATCH_MAX_DICT_SIZE < dict_size) {
+    dict += dict_size - LZ4BATCH_MAX_DICT_SIZE;
+    dict_size = LZ4BATCH_MAX_DICT_SIZE;
+  }
+
+  lz4comp *c = new lz4comp;
+  c->stream = LZ4_createStream();
+  if(NULL == c->stream) {
+    delete c;
+    return NULL;
+  }
+
+  c->dict_size = NULL == dict ? 0 : (int)dict_size;
+  c->dict = new char[c->dict_size + 1];
+  if(0 < c->dict_size) {
+    memcpy(c->dict, dict, c->dict_size);
+  }
+
+  memset(&c->stats, 0, sizeof(lz4comp_stats));
+  return c;
+}
+
+void lz4comp_destroy(lz4comp *c)
+{
+  LZ4_freeStream((LZ4_stream_t*)c->stream);
+  delete [] c->dict;
+  delete c;
+}
+
+size_t lz4comp_bound(size_t size)
+{
+  return VARINT_MAX_SIZE + LZ4_compressBound((int)size);
+}
+
+static inline unsigned long _cpu_ns()
+{
+  timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return ts.tv_sec * 1000000000ul + ts.tv_nsec;
+}
+
+int lz4comp_compress(lz4comp *c,
+                     const char *src,
+                     size_t size,
+                     char *dst,
+                     size_t dst_size)
+{
+  LZ4_stream_t *stream = (LZ4_stream_t*)c->stream;
+  unsigned long start = _cpu_ns();
+
+  char *p = varint_put(dst, (unsigned int)size);
+
+  // Each batch is compressed independently so that consumers may join
+  // at any time. Only the dictionary is shared.
+  LZ4_resetStream_fast(stream);
+  LZ4_loadDict(stream, c->dict, c->dict_size);
+  int n = LZ4_compress_fast_continue(stream,
+                                     src,
+                                     p,
+                                     (int)size,
+                                     (int)(dst_size - (p - dst)),
+                                     1);
+  if(0 >= n) {
+    return -1;
+  }
+  n += p - dst;
+
+  c->stats.batches++;
+  c->stats.bytes_in += size;
+  c->stats.bytes_out += n;
+  c->stats.cpu_ns += _cpu_ns() - start;
+  return n;
+}
+
+int lz4comp_decompress(const lz4comp *c,
+                       const char *src,
+                       size_t size,
+                       char *dst,
+                       size_t dst_size)
+{
+  unsigned int raw;
+  const char *p = varint_get(src, src + size, &raw);
+  if(NULL == p || raw > dst_size) {
+    return -1;
+  }
+
+  int n = LZ4_decompress_safe_usingDict(p,
+                                        dst,
+                                        (int)(size - (p - src)),
+                                        (int)raw,
+                                        c->dict,
+                                        c->dict_size);
+  return n == (int)raw ? n : -1;
+}
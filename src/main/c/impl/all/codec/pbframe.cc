@@ -0,0 +1,97 @@
+
+#include "codec/pbframe.h"
+
+#include <google/protobuf/descriptor.h>
+#include <vector>
+
+using google::protobuf::FieldDescriptor;
+using google::protobuf::Message;
+using google::protobuf::Reflection;
+
+/**
+ * \return 1 if *fd* is encoded as a single varint
+ */
+static int _is_varint(const FieldDescriptor *fd)
+{
+  if(fd->is_repeated()) {
+    return 0;
+  }
+  switch(fd->type())
+    {
+    case FieldDescriptor::TYPE_INT32:
+    case FieldDescriptor::TYPE_INT64:
+    case FieldDescriptor::TYPE_UINT32:
+    case FieldDescriptor::TYPE_UINT64:
+    case FieldDescriptor::TYPE_BOOL:
+    case FieldDescriptor::TYPE_ENUM:
+      return 1;
+    default:
+      return 0;
+    }
+}
+
+/**
+ * Serializes the fields of *m* numbered in [from, to] to *out*.
+ *
+ * \return The number of bytes written or -1 if *size* is exceeded
+ */
+static int _serialize(const Message &m, int from, int to,
+                      char *out, size_t size)
+{
+  Message *part = m.New();
+  part->CopyFrom(m);
+
+  const Reflection *r = part->GetReflection();
+  std::vector<const FieldDescriptor*> fields;
+  r->ListFields(*part, &fields);
+  for(size_t i = 0; i < fields.size(); i++) {
+    if(fields[i]->number() < from || fields[i]->number() > to) {
+      r->ClearField(part, fields[i]);
+    }
+  }
+
+  // Required fields may be missing from either part
+  int n = part->ByteSize();
+  if((size_t)n > size) {
+    n = -1;
+  } else {
+    part->SerializePartialToArray(out, n);
+  }
+  delete part;
+  return n;
+}
+
+int pbframe_init(pbframe *f, const Message &m, int field)
+{
+  f->field = field;
+  if(PBFRAME_NONE == field) {
+    int n = _serialize(m, 0, FieldDescriptor::kMaxNumber, f->data,
+                       PBFRAME_MAX_SIZE);
+    if(0 > n) {
+      return -1;
+    }
+    f->head = f->size = n;
+    return 0;
+  }
+
+  const FieldDescriptor *fd = m.GetDescriptor()->FindFieldByNumber(field);
+  if(NULL == fd || !_is_varint(fd)) {
+    return -1;
+  }
+
+  int head = _serialize(m, 0, field - 1, f->data, PBFRAME_MAX_SIZE);
+  if(0 > head || head + VARINT_MAX_SIZE > PBFRAME_MAX_SIZE) {
+    return -1;
+  }
+  // Tag of the field, wire type 0 (varint)
+  char *p = varint_put(&f->data[head], (unsigned int)field << 3);
+  f->head = p - f->data;
+
+  int tail = _serialize(m, field + 1, FieldDescriptor::kMaxNumber, p,
+                        PBFRAME_MAX_SIZE - f->head);
+  if(0 > tail) {
+    return -1;
+  }
+  f->size = f->head + tail;
+  return 0;
+}
@@ -0,0 +1,179 @@
+
+#include "codec/qdelta.h"
+#include "codec/varint.h"
+
+#include <new>
+#include <string.h>
+
+/**
+ * Makes sure the state can hold symbol *id*.
+ */
+static int _reserve(qdelta *c, unsigned int id)
+{
+  if(id < c->capacity) {
+    return 0;
+  }
+
+  unsigned int capacity = c->capacity;
+  while(capacity <= id) {
+    capacity <<= 1;
+  }
+
+  qdelta_sym *syms = new (std::nothrow) qdelta_sym[capacity];
+  if(NULL == syms) {
+    return -1;
+  }
+  memcpy(syms, c->syms, c->capacity * sizeof(qdelta_sym));
+  memset(&syms[c->capacity], 0,
+         (capacity - c->capacity) * sizeof(qdelta_sym));
+
+  delete [] c->syms;
+  c->syms = syms;
+  c->capacity = capacity;
+  return 0;
+}
+
+qdelta* qdelta_init(unsigned int capacity, unsigned int refresh)
+{
+  qdelta *c = new qdelta;
+  c->capacity = 0 < capacity ? capacity : 1;
+  c->refresh = refresh;
+  c->syms = new (std::nothrow) qdelta_sym[c->capacity];
+  if(NULL == c->syms) {
+    delete c;
+    return NULL;
+  }
+  memset(c->syms, 0, c->capacity * sizeof(qdelta_sym));
+  return c;
+}
+
+void qdelta_destroy(qdelta *c)
+{
+  delete [] c->syms;
+  delete c;
+}
+
+void qdelta_reset(qdelta *c, unsigned int id)
+{
+  if(id < c->capacity) {
+    c->syms[id].valid = 0;
+  }
+}
+
+int qdelta_encode(qdelta *c,
+                  unsigned int id,
+                  const qdelta_quote *q,
+                  char *buf)
+{
+  if(0 > _reserve(c, id)) {
+    return -1;
+  }
+
+  qdelta_sym *s = &c->syms[id];
+  const qdelta_quote *l = &s->last;
+  int full = !s->valid || 0 == s->countdown;
+  char *p = buf;
+
+  *p++ = (char)(QDELTA_FRAME_MARKER | (full ? QDELTA_FLAG_FULL : 0));
+  p = varint_put(p, id);
+  *p++ = (char)(++s->seq & 0xff);
+
+  if(full) {
+    *p++ = (char)QDELTA_FIELD_ALL;
+    p = varint_put(p, varint_zigzag(q->timestamp));
+    p = varint_put(p, varint_zigzag(q->bid_price));
+    p = varint_put(p, varint_zigzag(q->ask_price));
+    p = varint_put(p, varint_zigzag(q->bid_size));
+    p = varint_put(p, varint_zigzag(q->ask_size));
+    p = varint_put(p, varint_zigzag(q->exg));
+    p = varint_put(p, varint_zigzag(q->price_type));
+    s->countdown = c->refresh;
+    s->valid = 1;
+  } else {
+    char *mask = p++;
+    *mask = 0;
+
+    // Unchanged fields are omitted altogether
+#define _QDELTA_PUT(field, bit)                                         \
+    if(q->field != l->field) {                                          \
+      *mask |= bit;                                                     \
+      p = varint_put(p, varint_zigzag((int)((unsigned int)q->field      \
+                                          - (unsigned int)l->field)));  \
+    }
+    _QDELTA_PUT(timestamp, QDELTA_FIELD_TIMESTAMP);
+    _QDELTA_PUT(bid_price, QDELTA_FIELD_BID_PRICE);
+    _QDELTA_PUT(ask_price, QDELTA_FIELD_ASK_PRICE);
+    _QDELTA_PUT(bid_size, QDELTA_FIELD_BID_SIZE);
+    _QDELTA_PUT(ask_size, QDELTA_FIELD_ASK_SIZE);
+    _QDELTA_PUT(exg, QDELTA_FIELD_EXG);
+    _QDELTA_PUT(price_type, QDELTA_FIELD_PRICE_TYPE);
+#undef _QDELTA_PUT
+  }
+
+  if(0 < s->countdown) {
+    s->countdown--;
+  }
+  s->last = *q;
+  return p - buf;
+}
+
+int qdelta_decode(qdelta *c,
+                  const char *buf,
+                  size_t size,
+                  unsigned int *id,
+                  qdelta_quote *q)
+{
+  const char *p = buf;
+  const char *end = buf + size;
+
+  if(size < 4 || !qdelta_is_frame(buf, size)) {
+    return QDELTA_DECODE_ERR;
+  }
+
+  int full = *p++ & QDELTA_FLAG_FULL;
+  if(NULL == (p = varint_get(p, end, id))
+     || end - p < 2
+     || 0 > _reserve(c, *id)) {
+    return QDELTA_DECODE_ERR;
+  }
+
+  qdelta_sym *s = &c->syms[*id];
+  unsigned char seq = (unsigned char)*p++;
+  unsigned char mask = (unsigned char)*p++;
+
+  // A missing frame invalidates the state until the next full frame
+  if(!full && (!s->valid || seq != (unsigned char)(s->seq + 1))) {
+    s->valid = 0;
+    s->seq = seq;
+    return QDELTA_DECODE_GAP;
+  }
+
+  qdelta_quote n = s->last;
+  if(full) {
+    memset(&n, 0, sizeof(n));
+  }
+
+  unsigned int v;
+#define _QDELTA_GET(field, bit)                                         \
+  if(mask & bit) {                                                      \
+    if(NULL == (p = varint_get(p, end, &v))) {                          \
+      return QDELTA_DECODE_ERR;                                         \
+    }                                                                   \
+    n.field = full ? varint_unzigzag(v) :                               \
+      (int)((unsigned int)n.field + (unsigned int)varint_unzigzag(v));  \
+  }
+  _QDELTA_GET(timestamp, QDELTA_FIELD_TIMESTAMP);
+  _QDELTA_GET(bid_price, QDELTA_FIELD_BID_PRICE);
+  _QDELTA_GET(ask_price, QDELTA_FIELD_ASK_PRICE);
+  _QDELTA_GET(bid_size, QDELTA_FIELD_BID_SIZE);
+  _QDELTA_GET(ask_size, QDELTA_FIELD_ASK_SIZE);
+  _QDELTA_GET(exg, QDELTA_FIELD_EXG);
+  _QDELTA_GET(price_type, QDELTA_FIELD_PRICE_TYPE);
+#undef _QDELTA_GET
+
+  s->last = n;
+  s->seq = seq;
+  s->valid = 1;
+  *q = n;
+  return QDELTA_DECODE_OK;
+}
@@ -0,0 +1,65 @@
+
+#include "conc/credit.h"
+
+credit* credit_init()
+{
+  credit *c = new credit;
+  c->available = 0;
+  c->closed = 1;
+  c->waiting = 0;
+  pthread_mutex_init(&c->mutex, NULL);
+  pthread_cond_init(&c->cond, NULL);
+  return c;
+}
+
+void credit_destroy(credit *c)
+{
+  pthread_cond_destroy(&c->cond);
+  pthread_mutex_destroy(&c->mutex);
+  delete c;
+}
+
+void credit_open(credit *c, unsigned long long n)
+{
+  pthread_mutex_lock(&c->mutex);
+  __atomic_store_n(&c->available, (long long)n, __ATOMIC_SEQ_CST);
+  __atomic_store_n(&c->closed, 0, __ATOMIC_SEQ_CST);
+  pthread_mutex_unlock(&c->mutex);
+}
+
+void credit_close(credit *c)
+{
+  __atomic_store_n(&c->closed, 1, __ATOMIC_SEQ_CST);
+  pthread_mutex_lock(&c->mutex);
+  pthread_cond_broadcast(&c->cond);
+  pthread_mutex_unlock(&c->mutex);
+}
+
+void credit_grant(credit *c, unsigned long long n)
+{
+  __atomic_add_fetch(&c->available, (long long)n, __ATOMIC_SEQ_CST);
+
+  // Either the producer sees the credits before it blocks or we see
+  // it waiting. It holds the mutex until it sleeps, the signal can't
+  // get lost.
+  if(__atomic_load_n(&c->waiting, __ATOMIC_SEQ_CST)) {
+    pthread_mutex_lock(&c->mutex);
+    pthread_cond_signal(&c->cond);
+    pthread_mutex_unlock(&c->mutex);
+  }
+}
+
+int credit_wait(credit *c)
+{
+  int rc;
+
+  pthread_mutex_lock(&c->mutex);
+  __atomic_store_n(&c->waiting, 1, __ATOMIC_SEQ_CST);
+  while(CREDIT_EMPTY == (rc = credit_take(c))) {
+    pthread_cond_wait(&c->cond, &c->mutex);
+  }
+  __atomic_store_n(&c->waiting, 0, __ATOMIC_SEQ_CST);
+  pthread_mutex_unlock(&c->mutex);
+
+  return rc;
+}
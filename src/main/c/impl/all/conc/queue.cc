@@ -0,0 +1,81 @@
+
+#include "conc/queue.h"
+
+#include <new>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * \return *n* rounded up to the next power of two, at least 2
+ */
+static size_t _pow2(size_t n)
+{
+  size_t p = 2;
+  while(p < n) {
+    p <<= 1;
+  }
+  return p;
+}
+
+/**
+ * Allocates *size* zeroed bytes aligned to a cache line. *new* only
+ * guarantees the alignment of fundamental types.
+ */
+static void* _aligned(size_t size)
+{
+  void *p;
+  if(0 != posix_memalign(&p, CACHE_LINE_SIZE, size)) {
+    return NULL;
+  }
+  memset(p, 0, size);
+  return p;
+}
+
+spscq* spscq_init(size_t capacity)
+{
+  spscq *q = (spscq*)_aligned(sizeof(spscq));
+  if(NULL == q) {
+    return NULL;
+  }
+
+  size_t size = _pow2(capacity);
+  q->ring = new (std::nothrow) void*[size];
+  if(NULL == q->ring) {
+    free(q);
+    return NULL;
+  }
+  q->mask = size - 1;
+  return q;
+}
+
+void spscq_destroy(spscq *q)
+{
+  delete [] q->ring;
+  free(q);
+}
+
+mpmcq* mpmcq_init(size_t capacity)
+{
+  mpmcq *q = (mpmcq*)_aligned(sizeof(mpmcq));
+  if(NULL == q) {
+    return NULL;
+  }
+
+  size_t size = _pow2(capacity);
+  q->cells = (mpmcq_cell*)_aligned(size * sizeof(mpmcq_cell));
+  if(NULL == q->cells) {
+    free(q);
+    return NULL;
+  }
+  for(size_t i = 0; i < size; i++) {
+    q->cells[i].seq = i;
+  }
+  q->mask = size - 1;
+  return q;
+}
+
+void mpmcq_destroy(mpmcq *q)
+{
+  free(q->cells);
+  free(q);
+}
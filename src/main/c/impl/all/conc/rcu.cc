@@ -0,0 +1,51 @@
+
+#include "conc/rcu.h"
+
+#include <sched.h>
+#include <string.h>
+
+void rcu_init(rcu *r, void *ptr)
+{
+  memset(r, 0, sizeof(rcu));
+  r->ptr = ptr;
+  // Epochs of online readers are never RCU_OFFLINE
+  r->epoch = RCU_OFFLINE + 1;
+}
+
+int rcu_register(rcu *r)
+{
+  int slot = __atomic_fetch_add(&r->readers_size, 1, __ATOMIC_SEQ_CST);
+  if(RCU_MAX_READERS <= slot) {
+    __atomic_fetch_sub(&r->readers_size, 1, __ATOMIC_SEQ_CST);
+    return -1;
+  }
+  rcu_online(r, slot);
+  return slot;
+}
+
+void* rcu_publish(rcu *r, void *ptr)
+{
+  return __atomic_exchange_n(&r->ptr, ptr, __ATOMIC_SEQ_CST);
+}
+
+void rcu_synchronize(rcu *r)
+{
+  // Readers announcing this epoch or a later one loaded the pointer
+  // published before
+  unsigned long epoch = __atomic_add_fetch(&r->epoch, 1, __ATOMIC_SEQ_CST);
+
+  int size = __atomic_load_n(&r->readers_size, __ATOMIC_SEQ_CST);
+  if(RCU_MAX_READERS < size) {
+    size = RCU_MAX_READERS;
+  }
+  for(int i = 0; i < size; i++) {
+    for(;;) {
+      unsigned long e = __atomic_load_n(&r->readers[i].epoch,
+                                        __ATOMIC_ACQUIRE);
+      if(RCU_OFFLINE == e || epoch <= e) {
+        break;
+      }
+      sched_yield();
+    }
+  }
+}
@@ -0,0 +1,240 @@
+
+#include "core/batch.h"
+#include "core/reply.h"
+
+#include "log/logging.h"
+#include "nx/nxinf.h"
+#include "nx/nxtape.h"
+
+#include "gen/WineingCtrlProto.pb.h"
+
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+// Set while a batch is running, see *batch_start*
+static int volatile g_running;
+
+// Set by *batch_stop*, no further tapes are claimed
+static int volatile g_stop;
+
+// The thread of the last batch started, joined by the next
+// *batch_start* or *batch_stop*. Both are invoked by one thread at a
+// time.
+static pthread_t g_thread;
+static int g_joinable;
+
+w_batch* batch_init(long request_id, const char *journal_dir, int workers)
+{
+  w_batch *b = new w_batch;
+  memset(b, 0, sizeof(w_batch));
+  b->request_id = request_id;
+  b->journal_dir = strdup(journal_dir);
+  b->workers = workers < 1 ? 1 :
+    (workers > WINEING_BATCH_MAX_WORKERS ? WINEING_BATCH_MAX_WORKERS : workers);
+  return b;
+}
+
+void batch_destroy(w_batch *b)
+{
+  for(int i = 0; i < b->size; i++) {
+    free(b->tapes[i]);
+  }
+  delete [] b->tapes;
+  free(b->journal_dir);
+  delete b;
+}
+
+void batch_add(const char *path, void *_b)
+{
+  w_batch *b = (w_batch*)_b;
+
+  if(b->size == b->capacity) {
+    int capacity = 0 < b->capacity ? b->capacity << 1 : 16;
+    char **tapes = new (std::nothrow) char*[capacity];
+    if(NULL == tapes) {
+      log(LOG_ERROR, "Failed adding tape '%s' to batch", path);
+      return;
+    }
+    if(NULL != b->tapes) {
+      memcpy(tapes, b->tapes, b->size * sizeof(char*));
+    }
+    delete [] b->tapes;
+    b->tapes = tapes;
+    b->capacity = capacity;
+  }
+  b->tapes[b->size++] = strdup(path);
+}
+
+int batch_next(w_batch *b)
+{
+  if(g_stop) {
+    return -1;
+  }
+  int i = __sync_fetch_and_add(&b->next, 1);
+  return i < b->size ? i : -1;
+}
+
+int batch_journal_path(const w_batch *b, int i, char *out, size_t size)
+{
+  // File name of the tape, either path separator
+  const char *tape = b->tapes[i];
+  const char *name = tape;
+  for(const char *p = tape; '\0' != *p; p++) {
+    if('\\' == *p || '/' == *p) {
+      name = p + 1;
+    }
+  }
+
+  size_t dir_len = strlen(b->journal_dir);
+  size_t name_len = strlen(name);
+  size_t suffix_len = strlen(DEFAULTS_JOURNAL_SUFFIX);
+  if(dir_len + name_len + suffix_len + 1 > size) {
+    return -1;
+  }
+
+  memcpy(out, b->journal_dir, dir_len);
+  memcpy(&out[dir_len], name, name_len);
+  memcpy(&out[dir_len + name_len], DEFAULTS_JOURNAL_SUFFIX, suffix_len + 1);
+  return 0;
+}
+
+/**
+ * Sends *res* to the client through *cchan_out_thread*.
+ */
+static void _send(const WineingCtrlProto::Response &res)
+{
+  if(0 > reply_send(res)) {
+    log(LOG_WARN, "Dropped batch response [id: %li], too many pending",
+        res.requestid());
+  }
+}
+
+/**
+ * Worker replaying tapes of the batch until all are claimed.
+ */
+static void* _worker_thread(void *_b)
+{
+  using namespace WineingCtrlProto;
+
+  w_batch *b = (w_batch*)_b;
+  char journal[1024];
+  Response res;
+  int i;
+
+  while(0 <= (i = batch_next(b))) {
+    // The tape claimed once this one is replayed, read from the page
+    // cache rather than the disk when its replay starts
+    if(i + b->workers < b->size) {
+      wininf_file_prefetch(b->tapes[i + b->workers]);
+    }
+
+    long n = -1;
+    if(0 == batch_journal_path(b, i, journal, sizeof(journal))) {
+      log(LOG_DEBUG, "Replaying '%s' to '%s'", b->tapes[i], journal);
+      n = nxtape_replay(b->tapes[i], journal);
+    }
+
+    res.Clear();
+    res.set_requestid(b->request_id);
+    res.set_type(Response::BATCH_PROGRESS);
+    res.set_tape_file(b->tapes[i]);
+    res.set_tapes_total(b->size);
+    if(0 > n) {
+      __sync_fetch_and_add(&b->failed, 1);
+      res.set_err_text("Failed replaying tape.");
+    } else {
+      res.set_messages(n);
+    }
+    res.set_tapes_done(__sync_add_and_fetch(&b->done, 1));
+    _send(res);
+  }
+  return NULL;
+}
+
+/**
+ * Runs the workers of a batch, reports completion and frees the batch.
+ */
+static void* _batch_thread(void *_b)
+{
+  using namespace WineingCtrlProto;
+
+  w_batch *b = (w_batch*)_b;
+  pthread_t workers[WINEING_BATCH_MAX_WORKERS];
+  int n = b->workers < b->size ? b->workers : b->size;
+
+  log(LOG_INFO, "Replaying %d tapes with %d workers", b->size, n);
+
+  // The workers started claim all tapes, if fewer than asked for
+  int started = 0;
+  while(started < n
+        && 0 == pthread_create(&workers[started], NULL, _worker_thread, b)) {
+    started++;
+  }
+  if(started < n) {
+    log(LOG_ERROR, "Failed starting batch workers, %d of %d running",
+        started,
+        n);
+  }
+  for(int i = 0; i < started; i++) {
+    pthread_join(workers[i], NULL);
+  }
+
+  Response res;
+  res.set_requestid(b->request_id);
+  res.set_type(Response::BATCH_DONE);
+  res.set_tapes_done(b->done);
+  res.set_tapes_total(b->size);
+  if(0 == started) {
+    res.set_err_text("Failed starting workers.");
+  } else if(0 < b->failed) {
+    res.set_err_text("Failed replaying some tapes.");
+  } else if(started < n) {
+    char err[64];
+    snprintf(err, sizeof(err), "Started only %d of %d workers.", started, n);
+    res.set_err_text(err);
+  }
+  _send(res);
+
+  log(LOG_INFO, "Batch done, %d of %d tapes failed", b->failed, b->size);
+
+  batch_destroy(b);
+  __sync_lock_release(&g_running);
+  return NULL;
+}
+
+/**
+ * Waits for the thread of the last batch started to finish.
+ */
+static void _join()
+{
+  if(g_joinable) {
+    pthread_join(g_thread, NULL);
+    g_joinable = 0;
+  }
+}
+
+int batch_start(w_batch *b)
+{
+  if(!__sync_bool_compare_and_swap(&g_running, 0, 1)) {
+    return -1;
+  }
+
+  // The previous batch is done, its thread about to return
+  _join();
+  g_stop = 0;
+  if(0 != pthread_create(&g_thread, NULL, _batch_thread, b)) {
+    __sync_lock_release(&g_running);
+    return -1;
+  }
+  g_joinable = 1;
+  return 0;
+}
+
+void batch_stop()
+{
+  g_stop = 1;
+  _join();
+}
@@ -0,0 +1,328 @@
+#include "core/checkpoint.h"
+
+#include "log/logging.h"
+
+#include <fcntl.h>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * Writes the path of the manifest to *out*.
+ */
+static int _manifest_path(const checkpoint *c, char *out, size_t size)
+{
+  if(size <= (size_t)snprintf(out, size, "%s%s.ckpt", c->dir, c->name)) {
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * Reads and checks the header at the start of *f*.
+ */
+static int _read_header(FILE *f, checkpoint_header *h)
+{
+  if(1 != fread(h, sizeof(checkpoint_header), 1, f)
+     || CHECKPOINT_MAGIC != h->magic
+     || CHECKPOINT_VERSION != h->version
+     || CHECKPOINT_SLOTS <= h->slot) {
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * Reads the header of the manifest.
+ */
+static int _read_manifest(const checkpoint *c, checkpoint_header *h)
+{
+  char path[CHECKPOINT_PATH_SIZE];
+  if(0 > _manifest_path(c, path, sizeof(path))) {
+    return -1;
+  }
+  FILE *f = fopen(path, "rb");
+  if(NULL == f) {
+    return -1;
+  }
+  int rc = _read_header(f, h);
+  fclose(f);
+  return rc;
+}
+
+/**
+ * Flushes *f* to disk and closes it.
+ */
+static int _sync_close(FILE *f)
+{
+  int rc = 0 == fflush(f) && 0 == fsync(fileno(f)) ? 0 : -1;
+  return 0 == fclose(f) ? rc : -1;
+}
+
+/**
+ * Flushes the file at *path* written by someone else to disk.
+ */
+static int _sync_path(const char *path)
+{
+  int fd = open(path, O_RDONLY);
+  if(0 > fd) {
+    return -1;
+  }
+  int rc = fsync(fd);
+  close(fd);
+  return rc;
+}
+
+/**
+ * Writes the checkpoint handed over by *checkpoint_submit*. NxCore's
+ * state and the symbol directory are synced before the manifest is
+ * replaced, *c->dir* after.
+ */
+static int _write(checkpoint *c)
+{
+  char path[CHECKPOINT_PATH_SIZE], tmp[CHECKPOINT_PATH_SIZE];
+
+  checkpoint_header h;
+  memset(&h, 0, sizeof(h));
+  h.magic = CHECKPOINT_MAGIC;
+  h.version = CHECKPOINT_VERSION;
+  h.slot = c->job_slot;
+  h.clock = c->job_clock;
+  h.created = time(NULL);
+  h.symbols = c->size;
+  h.seq = c->job_seq;
+
+  if(0 > checkpoint_path(c, c->job_slot, CHECKPOINT_NXCORE_SUFFIX, path, sizeof(path))
+     || 0 > _sync_path(path)) {
+    log(LOG_ERROR, "Failed syncing NxCore state '%s'", path);
+    return -1;
+  }
+
+  if(0 > checkpoint_path(c, c->job_slot, CHECKPOINT_SYMS_SUFFIX, path, sizeof(path))) {
+    return -1;
+  }
+  FILE *f = fopen(path, "wb");
+  if(NULL == f) {
+    log(LOG_ERROR, "Failed opening '%s'", path);
+    return -1;
+  }
+  int rc = 1 == fwrite(&h, sizeof(h), 1, f) ? 0 : -1;
+  if(0 == rc && 0 < c->size
+     && c->size != fwrite(c->entries, sizeof(symtab_entry), c->size, f)) {
+    rc = -1;
+  }
+  if(0 > _sync_close(f) || 0 > rc) {
+    log(LOG_ERROR, "Failed writing directory '%s'", path);
+    return -1;
+  }
+
+  // Replace the manifest, a crash leaves either the old or new one
+  if(0 > _manifest_path(c, path, sizeof(path))
+     || (int)sizeof(tmp) <= snprintf(tmp, sizeof(tmp), "%s.tmp", path)) {
+    return -1;
+  }
+  f = fopen(tmp, "wb");
+  if(NULL == f) {
+    log(LOG_ERROR, "Failed opening '%s'", tmp);
+    return -1;
+  }
+  rc = 1 == fwrite(&h, sizeof(h), 1, f) ? 0 : -1;
+  if(0 > _sync_close(f) || 0 > rc || 0 != rename(tmp, path)) {
+    log(LOG_ERROR, "Failed writing manifest '%s'", path);
+    unlink(tmp);
+    return -1;
+  }
+
+  // The rename and the files created are durable once their directory
+  // is. The manifest names the new slot either way, it's the current
+  // one and must not be reused.
+  if(0 > _sync_path('\0' != c->dir[0] ? c->dir : ".")) {
+    log(LOG_ERROR, "Failed syncing checkpoint directory '%s'", c->dir);
+  }
+  return 0;
+}
+
+/**
+ * Writes the checkpoints submitted until *checkpoint_destroy*.
+ */
+static void* _checkpoint_thread(void *arg)
+{
+  checkpoint *c = (checkpoint*)arg;
+
+  pthread_mutex_lock(&c->mutex);
+  for(;;) {
+    while(!c->pending && !c->stop) {
+      pthread_cond_wait(&c->cond, &c->mutex);
+    }
+    if(!c->pending) {
+      break;
+    }
+
+    // *checkpoint_begin* hands out no slot while pending, the job is ours
+    pthread_mutex_unlock(&c->mutex);
+    int rc = _write(c);
+    pthread_mutex_lock(&c->mutex);
+
+    if(0 == rc) {
+      c->slot = c->job_slot;
+      log(LOG_DEBUG, "Checkpoint %d written, %u symbols", c->slot, c->size);
+    }
+    c->pending = 0;
+  }
+  pthread_mutex_unlock(&c->mutex);
+  return NULL;
+}
+
+checkpoint* checkpoint_init(const char *dir, const char *name)
+{
+  checkpoint *c = new checkpoint;
+  memset(c, 0, sizeof(checkpoint));
+  c->dir = strdup(dir);
+  c->name = strdup(name);
+
+  checkpoint_header h;
+  c->slot = 0 == _read_manifest(c, &h) ? (int)h.slot : -1;
+
+  pthread_mutex_init(&c->mutex, NULL);
+  pthread_cond_init(&c->cond, NULL);
+  if(0 != pthread_create(&c->thread, NULL, _checkpoint_thread, c)) {
+    pthread_cond_destroy(&c->cond);
+    pthread_mutex_destroy(&c->mutex);
+    free(c->dir);
+    free(c->name);
+    delete c;
+    return NULL;
+  }
+  return c;
+}
+
+void checkpoint_destroy(checkpoint *c)
+{
+  pthread_mutex_lock(&c->mutex);
+  c->stop = 1;
+  pthread_cond_signal(&c->cond);
+  pthread_mutex_unlock(&c->mutex);
+  pthread_join(c->thread, NULL);
+
+  pthread_cond_destroy(&c->cond);
+  pthread_mutex_destroy(&c->mutex);
+  delete [] c->entries;
+  free(c->dir);
+  free(c->name);
+  delete c;
+}
+
+int checkpoint_path(const checkpoint *c,
+                    int slot,
+                    const char *suffix,
+                    char *out,
+                    size_t size)
+{
+  if(size <= (size_t)snprintf(out, size, "%s%s.%d%s", c->dir, c->name, slot, suffix)) {
+    return -1;
+  }
+  return 0;
+}
+
+int checkpoint_begin(checkpoint *c)
+{
+  pthread_mutex_lock(&c->mutex);
+  int slot = c->pending ? -1 : (c->slot + 1) % CHECKPOINT_SLOTS;
+  pthread_mutex_unlock(&c->mutex);
+  return slot;
+}
+
+int checkpoint_submit(checkpoint *c,
+                      int slot,
+                      const symtab *syms,
+                      uint32_t clock,
+                      uint64_t seq)
+{
+  // Not pending, the thread doesn't touch the job
+  if(syms->size > c->capacity) {
+    unsigned int capacity = 0 < c->capacity ? c->capacity : 1024;
+    while(capacity < syms->size) {
+      capacity <<= 1;
+    }
+    symtab_entry *entries = new (std::nothrow) symtab_entry[capacity];
+    if(NULL == entries) {
+      return -1;
+    }
+    delete [] c->entries;
+    c->entries = entries;
+    c->capacity = capacity;
+  }
+  if(0 < syms->size) {
+    memcpy(c->entries, syms->entries, syms->size * sizeof(symtab_entry));
+  }
+  c->size = syms->size;
+  c->job_slot = slot;
+  c->job_clock = clock;
+  c->job_seq = seq;
+
+  pthread_mutex_lock(&c->mutex);
+  c->pending = 1;
+  pthread_cond_signal(&c->cond);
+  pthread_mutex_unlock(&c->mutex);
+  return 0;
+}
+
+int checkpoint_latest(checkpoint *c, time_t now)
+{
+  checkpoint_header h;
+  if(0 > _read_manifest(c, &h)) {
+    return -1;
+  }
+
+  // NxCore's state is that of a tape, tapes are per day
+  struct tm created, today;
+  time_t t = (time_t)h.created;
+  localtime_r(&t, &created);
+  localtime_r(&now, &today);
+  if(created.tm_year != today.tm_year || created.tm_yday != today.tm_yday) {
+    return -1;
+  }
+  return h.slot;
+}
+
+long checkpoint_restore(const checkpoint *c,
+                        int slot,
+                        symtab *syms,
+                        uint64_t *seq)
+{
+  char path[CHECKPOINT_PATH_SIZE];
+  if(0 != syms->size
+     || 0 > checkpoint_path(c, slot, CHECKPOINT_SYMS_SUFFIX, path, sizeof(path))) {
+    return -1;
+  }
+  FILE *f = fopen(path, "rb");
+  if(NULL == f) {
+    return -1;
+  }
+
+  checkpoint_header h;
+  long rc = 0 == _read_header(f, &h) && (uint32_t)slot == h.slot ?
+    (long)h.clock : -1;
+  for(uint32_t i = 0; 0 <= rc && i < h.symbols; i++) {
+    symtab_entry e;
+    if(1 != fread(&e, sizeof(e), 1, f)) {
+      rc = -1;
+      break;
+    }
+    e.name[SYMTAB_NAME_SIZE - 1] = '\0';
+
+    // Interned in order the ids come out the same. Deleted symbols are
+    // removed right away, a later one of the same name gets a new id.
+    if(i != symtab_intern(syms, e.name, e.exg)
+       || ((SYMTAB_FLAG_DELETED & e.flags) && 0 > symtab_remove(syms, i))) {
+      rc = -1;
+    }
+  }
+  fclose(f);
+  if(0 <= rc) {
+    *seq = h.seq;
+  }
+  return rc;
+}
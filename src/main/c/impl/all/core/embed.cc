@@ -0,0 +1,207 @@
+#include "core/embed.h"
+
+#include "conc/conc.h"
+#include "core/wineing.h"
+#include "log/logging.h"
+#include "nx/nxinf.h"
+#include "nx/nxtape.h"
+
+#include <new>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+
+// Events dispatched per batch popped by *embed_poll*
+#define EMBED_POLL_BATCH 64
+
+static pthread_once_t g_load_once = PTHREAD_ONCE_INIT;
+static int g_loaded;
+
+embed* embed_init(const embed_handlers *handlers, int mode, size_t capacity)
+{
+  embed *e = new (std::nothrow) embed;
+  if(NULL == e) {
+    return NULL;
+  }
+  memset(e, 0, sizeof(embed));
+  e->handlers = *handlers;
+  e->mode = mode;
+  if(EMBED_DIRECT == mode) {
+    return e;
+  }
+
+  e->ring = spscq_init(capacity);
+  e->free = spscq_init(capacity);
+  if(NULL == e->ring || NULL == e->free) {
+    embed_destroy(e);
+    return NULL;
+  }
+
+  // As many slots as cells, the ring never fills up
+  size_t size = spscq_capacity(e->free);
+  e->slots = new (std::nothrow) embed_event[size];
+  if(NULL == e->slots) {
+    embed_destroy(e);
+    return NULL;
+  }
+  for(size_t i = 0; i < size; i++) {
+    spscq_push(e->free, &e->slots[i]);
+  }
+  return e;
+}
+
+void embed_destroy(embed *e)
+{
+  if(NULL != e->ring) {
+    spscq_destroy(e->ring);
+  }
+  if(NULL != e->free) {
+    spscq_destroy(e->free);
+  }
+  delete [] e->slots;
+  delete e;
+}
+
+void embed_stop(embed *e)
+{
+  __atomic_store_n(&e->stopped, 1, __ATOMIC_RELEASE);
+}
+
+embed_event* embed_claim(embed *e, int type, embed_event *scratch)
+{
+  if(!embed_wants(e, type)) {
+    return NULL;
+  }
+
+  embed_event *ev = scratch;
+  if(EMBED_RING == e->mode) {
+    while(NULL == (ev = (embed_event*)spscq_pop(e->free))) {
+      if(__atomic_load_n(&e->stopped, __ATOMIC_ACQUIRE)) {
+        return NULL;
+      }
+      sched_yield();
+    }
+  }
+  ev->type = type;
+  return ev;
+}
+
+size_t embed_poll(embed *e, size_t max)
+{
+  void *batch[EMBED_POLL_BATCH];
+  size_t done = 0;
+
+  while(done < max) {
+    size_t n = max - done < EMBED_POLL_BATCH ? max - done : EMBED_POLL_BATCH;
+    n = spscq_pop_n(e->ring, batch, n);
+    if(0 == n) {
+      break;
+    }
+    for(size_t i = 0; i < n; i++) {
+      embed_dispatch(e, (const embed_event*)batch[i]);
+    }
+    // Never full, see embed_init
+    spscq_push_n(e->free, batch, n);
+    done += n;
+  }
+  return done;
+}
+
+/**
+ * Loads NxCore and initializes the state *nxtape_process* expects,
+ * once per process.
+ */
+static void _load()
+{
+  lazy_init(DEFAULTS_SHARED_VERSION_INIT);
+  g_loaded = 0 <= wininf_nxcore_load();
+}
+
+long embed_run(embed *e, const char *tape, unsigned int flags)
+{
+  pthread_once(&g_load_once, _load);
+  if(!g_loaded) {
+    log(LOG_ERROR, "Failed loading NxCore dll");
+    return -1;
+  }
+
+  unsigned long events = e->events;
+  if(0 > nxtape_embed(tape, flags, e)) {
+    return -1;
+  }
+  return e->events - events;
+}
+
+/**
+ * \return The next value of a xorshift generator
+ */
+static inline unsigned int _xorshift(unsigned int *x)
+{
+  *x ^= *x << 13;
+  *x ^= *x >> 17;
+  *x ^= *x << 5;
+  return *x;
+}
+
+long embed_synthetic(embed *e, unsigned int symbols, unsigned long messages)
+{
+  embed_event scratch;
+  embed_event *ev;
+  unsigned long events = e->events;
+  unsigned int x = 2463534242u;
+  unsigned int clock = 34200000;  // 09:30
+  int *prices = new int[symbols];
+
+  for(unsigned int i = 0; i < symbols; i++) {
+    prices[i] = 10000 + 100 * (i % 100);
+    if(NULL != (ev = embed_claim(e, EMBED_SYMBOL, &scratch))) {
+      ev->symbol.symbol_id = i;
+      ev->symbol.exg = 1;
+      ev->symbol.deleted = 0;
+      snprintf(ev->symbol.name, SYMTAB_NAME_SIZE, "eSYN%u", i);
+      embed_publish(e, ev);
+    }
+  }
+
+  for(unsigned long n = 0;
+      n < messages && 0 < symbols
+        && !__atomic_load_n(&e->stopped, __ATOMIC_ACQUIRE);
+      n++, clock++) {
+    if(0 == n % EMBED_SYNTHETIC_STATUS_INTERVAL
+       && NULL != (ev = embed_claim(e, EMBED_STATUS, &scratch))) {
+      ev->status.clock = clock;
+      embed_publish(e, ev);
+    }
+
+    unsigned int r = _xorshift(&x);
+    unsigned int id = r % symbols;
+    prices[id] += (int)((r >> 8) % 5) - 2;
+
+    // Three quotes per trade
+    if(0 != ((r >> 16) & 3)) {
+      if(NULL != (ev = embed_claim(e, EMBED_QUOTE, &scratch))) {
+        ev->quote.symbol_id = id;
+        ev->quote.timestamp = clock;
+        ev->quote.bid_price = prices[id] - 1;
+        ev->quote.ask_price = prices[id] + 1;
+        ev->quote.bid_size = 100 * (1 + ((r >> 20) & 7));
+        ev->quote.ask_size = 100 * (1 + ((r >> 24) & 7));
+        ev->quote.exg = 1;
+        ev->quote.price_type = 2;
+        embed_publish(e, ev);
+      }
+    } else if(NULL != (ev = embed_claim(e, EMBED_TRADE, &scratch))) {
+      ev->trade.symbol_id = id;
+      ev->trade.timestamp = clock;
+      ev->trade.price = prices[id];
+      ev->trade.size = 100 * (1 + ((r >> 20) & 15));
+      ev->trade.exg = 1;
+      ev->trade.price_type = 2;
+      embed_publish(e, ev);
+    }
+  }
+
+  delete [] prices;
+  return e->events - events;
+}
@@ -0,0 +1,129 @@
+#include "core/partition.h"
+
+#include "nx/nxinf.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const w_partition g_partitions[] = {
+  { "equities", "e", WININF_NXCORE_EXCLUDE_OPRA },
+  { "options",  "o", 0 },
+  { "futures",  "f", WININF_NXCORE_EXCLUDE_OPRA },
+};
+
+const w_partition* partition_find(const char *name)
+{
+  for(size_t i = 0; i < sizeof(g_partitions) / sizeof(w_partition); i++) {
+    if(0 == strcmp(name, g_partitions[i].name)) {
+      return &g_partitions[i];
+    }
+  }
+  return NULL;
+}
+
+int partition_fqcn(const char *fqcn, int index, char *out, size_t size)
+{
+  const char *port = strrchr(fqcn, ':');
+  int rc;
+  if(0 == strncmp(fqcn, "tcp://", 6) && NULL != port && port - fqcn > 5) {
+    rc = snprintf(out, size, "%.*s:%d",
+                  (int)(port - fqcn), fqcn,
+                  atoi(port + 1) + (index + 1) * DEFAULTS_PARTITION_PORT_STEP);
+  } else {
+    rc = snprintf(out, size, "%s.%d", fqcn, index);
+  }
+  return 0 > rc || (size_t)rc >= size ? -1 : 0;
+}
+
+int partition_local_fqcn(const char *fqcn, char *out, size_t size)
+{
+  int rc;
+  if(0 == strncmp(fqcn, "tcp://*:", 8)) {
+    rc = snprintf(out, size, "tcp://127.0.0.1%s", &fqcn[7]);
+  } else {
+    rc = snprintf(out, size, "%s", fqcn);
+  }
+  return 0 > rc || (size_t)rc >= size ? -1 : 0;
+}
+
+/**
+ * \return The endpoint of partition *index* derived from *fqcn*
+ */
+static std::string _fqcn(const char *fqcn, int index)
+{
+  char derived[256];
+  if(0 > partition_fqcn(fqcn, index, derived, sizeof(derived))) {
+    // Too long to be a valid endpoint anyway, binding reports it
+    return fqcn;
+  }
+  return derived;
+}
+
+void partition_args(const w_conf *conf,
+                    int index,
+                    std::vector<std::string> &args)
+{
+  char buf[32];
+
+  args.push_back(std::string("--partition=") + conf->partitions[index]);
+  args.push_back("--cchan-in=" + _fqcn(conf->cchan_in_fqcn, index));
+  args.push_back("--cchan-out=" + _fqcn(conf->cchan_out_fqcn, index));
+  args.push_back("--mchan=" + _fqcn(conf->mchan_fqcn, index));
+  args.push_back(WINEING_MCHAN_ENCODING_DELTA == conf->mchan_encoding ?
+                 "--mchan-encoding=delta" : "--mchan-encoding=protobuf");
+  if(conf->mchan_xpub) {
+    args.push_back("--mchan-xpub");
+  }
+  if(conf->mchan_seq) {
+    args.push_back("--mchan-seq");
+  }
+  if(0 < conf->mchan_trace) {
+    snprintf(buf, sizeof(buf), "--mchan-trace=%u", conf->mchan_trace);
+    args.push_back(buf);
+  }
+  if(NULL != conf->mchan_lz4_fqcn) {
+    args.push_back("--mchan-lz4=" + _fqcn(conf->mchan_lz4_fqcn, index));
+  }
+  if(NULL != conf->mchan_lz4_dict) {
+    args.push_back(std::string("--mchan-lz4-dict=") + conf->mchan_lz4_dict);
+  }
+  if(NULL != conf->bchan_fqcn) {
+    args.push_back("--bchan=" + _fqcn(conf->bchan_fqcn, index));
+  }
+  if(NULL != conf->nchan_fqcn) {
+    args.push_back("--nchan=" + _fqcn(conf->nchan_fqcn, index));
+  }
+
+  std::string intervals ("--bar-intervals=");
+  for(int i = 0; i < conf->bar_intervals_size; i++) {
+    snprintf(buf, sizeof(buf), "%s%u", 0 < i ? "," : "",
+             conf->bar_intervals[i]);
+    intervals += buf;
+  }
+  args.push_back(intervals);
+
+  if(0 < conf->ochan_size) {
+    std::string ochan ("--ochan=");
+    for(int i = 0; i < conf->ochan_size; i++) {
+      ochan += (0 < i ? "," : "") + _fqcn(conf->ochan_fqcns[i], index);
+    }
+    args.push_back(ochan);
+  }
+  if(conf->greeks) {
+    args.push_back("--greeks");
+    snprintf(buf, sizeof(buf), "--greeks-rate=%g", conf->greeks_rate);
+    args.push_back(buf);
+  }
+  if(NULL != conf->checkpoint_dir) {
+    // Each partition checkpoints under its own name, see core/checkpoint.h
+    args.push_back(std::string("--checkpoint-dir=") + conf->checkpoint_dir);
+    snprintf(buf, sizeof(buf), "--checkpoint-interval=%u",
+             conf->checkpoint_interval);
+    args.push_back(buf);
+  }
+
+  args.push_back(std::string("--tape-root=") + conf->tape_basedir);
+  snprintf(buf, sizeof(buf), "--batch-workers=%d", conf->batch_workers);
+  args.push_back(buf);
+}
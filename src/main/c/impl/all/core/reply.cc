@@ -0,0 +1,169 @@
+
+#include "core/reply.h"
+#include "codec/pbframe.h"
+
+#include <errno.h>
+#include <new>
+#include <sched.h>
+#include <semaphore.h>
+#include <stdlib.h>
+
+static reply_buf *g_pool_bufs;  // backing store of the pool
+static mpmcq *g_pool;           // free pooled buffers
+static mpmcq *g_queue;          // Responses awaiting cchan_out_thread
+static sem_t g_queued;          // counts g_queue
+static reply_buf g_last;        // SHUTDOWN_OK if no other buffer is left
+static reply_buf g_close;       // the sentinel, see reply_close
+
+// Templates of the Responses carrying only requestId and type,
+// indexed by type
+static pbframe g_fixed[WineingCtrlProto::Response::Type_ARRAYSIZE];
+
+int reply_init(size_t buffers, size_t capacity)
+{
+  g_pool_bufs = new (std::nothrow) reply_buf[buffers];
+  g_pool = mpmcq_init(buffers);
+  g_queue = mpmcq_init(capacity);
+  if(NULL == g_pool_bufs || NULL == g_pool || NULL == g_queue) {
+    reply_destroy();
+    return -1;
+  }
+
+  for(size_t i = 0; i < buffers; i++) {
+    g_pool_bufs[i].pooled = 1;
+    mpmcq_push(g_pool, &g_pool_bufs[i]);
+  }
+  sem_init(&g_queued, 0, 0);
+  g_last.pooled = 1;
+  g_close.pooled = 1;
+  g_close.last = 1;
+
+  // requestId is field 1
+  WineingCtrlProto::Response res;
+  for(int t = 0; t < WineingCtrlProto::Response::Type_ARRAYSIZE; t++) {
+    if(WineingCtrlProto::Response::Type_IsValid(t)) {
+      res.set_type((WineingCtrlProto::Response::Type)t);
+      pbframe_init(&g_fixed[t], res, 1);
+    }
+  }
+  return 0;
+}
+
+void reply_destroy()
+{
+  if(NULL != g_queue) {
+    reply_buf *b;
+    while(NULL != (b = (reply_buf*)mpmcq_pop(g_queue))) {
+      reply_free(b->data, b);
+    }
+    mpmcq_destroy(g_queue);
+    sem_destroy(&g_queued);
+  }
+  if(NULL != g_pool) {
+    mpmcq_destroy(g_pool);
+  }
+  delete [] g_pool_bufs;
+  g_pool_bufs = NULL;
+  g_pool = NULL;
+  g_queue = NULL;
+}
+
+/**
+ * \return A buffer of at least *size* bytes of data, pooled if
+ *         possible, the one set aside if *last* and none is left
+ */
+static reply_buf* _buffer(size_t size, int last)
+{
+  reply_buf *b = NULL;
+  if(DEFAULTS_CCHAN_BUFFER_SIZE >= size) {
+    b = (reply_buf*)mpmcq_pop(g_pool);
+  }
+  if(NULL == b) {
+    b = (reply_buf*)malloc(offsetof(reply_buf, data) + size);
+    if(NULL != b) {
+      b->pooled = 0;
+    } else if(last && DEFAULTS_CCHAN_BUFFER_SIZE >= size) {
+      b = &g_last;
+    } else {
+      return NULL;
+    }
+  }
+  b->size = size;
+  b->last = last;
+  return b;
+}
+
+/**
+ * Queues *b* to *cchan_out_thread*.
+ */
+static int _queue(reply_buf *b)
+{
+  while(0 > mpmcq_push(g_queue, b)) {
+    if(!b->last) {
+      reply_free(b->data, b);
+      return -1;
+    }
+    // cchan_out_thread exits with the last Response or the sentinel
+    // only, it makes room sending the ones ahead
+    sched_yield();
+  }
+  sem_post(&g_queued);
+  return 0;
+}
+
+int reply_send(const WineingCtrlProto::Response &res)
+{
+  size_t size = res.ByteSize();
+  reply_buf *b = _buffer(size,
+                         WineingCtrlProto::Response::SHUTDOWN_OK == res.type());
+  if(NULL == b) {
+    return -1;
+  }
+  res.SerializeWithCachedSizesToArray((google::protobuf::uint8*)b->data);
+  return _queue(b);
+}
+
+int reply_send_fixed(long long id, WineingCtrlProto::Response::Type type)
+{
+  const pbframe *f = &g_fixed[type];
+  reply_buf *b = _buffer(pbframe_max_size(f),
+                         WineingCtrlProto::Response::SHUTDOWN_OK == type);
+  if(NULL == b) {
+    return -1;
+  }
+  b->size = pbframe_encode(f, (unsigned long long)id, b->data);
+  return _queue(b);
+}
+
+reply_buf* reply_next()
+{
+  reply_buf *b;
+  while(0 > sem_wait(&g_queued) && EINTR == errno);
+
+  // The token stands for a buffer pushed. It may not be visible yet if
+  // another producer claimed an earlier slot and hasn't published it,
+  // waiting on the semaphore again would lose the token.
+  while(NULL == (b = (reply_buf*)mpmcq_pop(g_queue))) {
+    sched_yield();
+  }
+  return &g_close == b ? NULL : b;
+}
+
+void reply_close()
+{
+  _queue(&g_close);
+}
+
+void reply_free(void *data, void *hint)
+{
+  reply_buf *b = (reply_buf*)hint;
+  if(!b->pooled) {
+    free(b);
+    return;
+  }
+  if(&g_last == b || &g_close == b) {
+    return;
+  }
+  // Never fails, the pool holds all of its buffers
+  mpmcq_push(g_pool, b);
+}
@@ -21,19 +21,36 @@
  */
 
 #include "core/wineing.h"
-
+#include "core/batch.h"
+#include "core/checkpoint.h"
+#include "core/partition.h"
+#include "core/reply.h"
+
+#include "agg/greeks.h"
+#include "agg/urate.h"
+#include "codec/lz4batch.h"
 #include "conc/conc.h"
+#include "conc/credit.h"
+#include "conc/rcu.h"
 #include "log/logging.h"
 #include "net/chan.h"
 #include "nx/nxinf.h"
 #include "nx/nxtape.h"
+#include "store/catalog.h"
 
 #include "gen/WineingCtrlProto.pb.h"
 #include "gen/WineingMarketDataProto.pb.h"
 
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <unistd.h>
 #include <pthread.h>
+#include <semaphore.h>
 #include <sstream>
+#include <string>
+#include <vector>
 #include <google/protobuf/io/zero_copy_stream_impl.h>
 #include <google/protobuf/io/zero_copy_stream_impl_lite.h>
 
@@ -49,6 +66,9 @@ w_ctrl g_data = {
   0
 };
 
+rcu g_rconf;
+credit *g_credit;
+
 /**
  * Used to make the *market_thread* sleep if the user has either not
  * started streaming or stopped it.
@@ -56,6 +76,13 @@ w_ctrl g_data = {
 static pthread_mutex_t g_market_sync_mutex;
 static pthread_cond_t  g_market_sync_cond;
 
+/**
+ * Posted by *mchan_lz4_thread* and each *ochan_thread* once their
+ * inproc endpoint is bound. *market_thread* waits for all of them
+ * before connecting, inproc endpoints must be bound first.
+ */
+static sem_t g_inproc_bound;
+
 void wineing_init(w_ctx &ctx)
 {
   log(LOG_INFO, "Initializing wineing");
@@ -72,8 +99,16 @@ void wineing_init(w_ctx &ctx)
     exit(1);
   }
 
+  if(0 > reply_init(DEFAULTS_REPLY_POOL_SIZE, DEFAULTS_REPLY_QUEUE_SIZE)) {
+    log(LOG_ERROR, "Failed allocating the response pool");
+    exit(1);
+  }
+
   pthread_mutex_init(&g_market_sync_mutex, NULL);
   pthread_cond_init(&g_market_sync_cond, NULL);
+  sem_init(&g_inproc_bound, 0, 0);
+  rcu_init(&g_rconf, NULL);
+  g_credit = credit_init();
 }
 
 void wineing_run(w_ctx &ctx)
@@ -83,6 +118,9 @@ void wineing_run(w_ctx &ctx)
   pthread_t cchan_out_t;
   pthread_t cchan_in_t;
   pthread_t market_t;
+  pthread_t mchan_lz4_t;
+  pthread_t ochan_t[WINEING_OCHAN_MAX_SHARDS];
+  w_ochan_arg ochan_args[WINEING_OCHAN_MAX_SHARDS];
 
   // The cchan_in_thread listens for incomming messages on cchan_in
   // managing the mchan_thread (market data channel) as requested by
@@ -90,19 +128,94 @@ void wineing_run(w_ctx &ctx)
   pthread_create(&cchan_out_t, NULL, cchan_out_thread, (void*)&ctx);
   pthread_create(&cchan_in_t, NULL, cchan_in_thread, (void*)&ctx);
   pthread_create(&market_t, NULL, market_thread, (void*)&ctx);
+  if(NULL != ctx.conf->mchan_lz4_fqcn) {
+    pthread_create(&mchan_lz4_t, NULL, mchan_lz4_thread, (void*)&ctx);
+  }
+  for(int i = 0; i < ctx.conf->ochan_size; i++) {
+    ochan_args[i].ctx = &ctx;
+    ochan_args[i].shard = i;
+    pthread_create(&ochan_t[i], NULL, ochan_thread, (void*)&ochan_args[i]);
+  }
 
   // Wait for threads to finish
   pthread_join(market_t, NULL);
+  if(NULL != ctx.conf->mchan_lz4_fqcn) {
+    pthread_join(mchan_lz4_t, NULL);
+  }
+  for(int i = 0; i < ctx.conf->ochan_size; i++) {
+    pthread_join(ochan_t[i], NULL);
+  }
   pthread_join(cchan_out_t, NULL);
   pthread_join(cchan_in_t, NULL);
 }
 
+/**
+ * \struct
+ *
+ * State of *wineing_columnar*.
+ */
+typedef struct
+{
+  const w_conf *conf;
+  int failed;
+} _columnar_job;
+
+/**
+ * Converts tape *path* to columnar files, used with
+ * *wininf_file_glob*.
+ */
+static void _columnar(const char *path, void *obj)
+{
+  _columnar_job *job = (_columnar_job*)obj;
+
+  // File name of the tape, either path separator
+  const char *name = path;
+  for(const char *p = path; '\0' != *p; p++) {
+    if('\\' == *p || '/' == *p) {
+      name = p + 1;
+    }
+  }
+
+  std::stringstream base;
+  base << job->conf->columnar_dir << name;
+
+  log(LOG_INFO, "Converting '%s' to columnar files '%s.*'",
+      path,
+      base.str().c_str());
+  long rows = nxtape_columnar(path, base.str().c_str());
+  if(0 > rows) {
+    log(LOG_ERROR, "Failed converting '%s'", path);
+    job->failed++;
+    return;
+  }
+  log(LOG_INFO, "Converted '%s', %ld rows", path, rows);
+}
+
+int wineing_columnar(w_ctx &ctx)
+{
+  std::stringstream tape;
+  tape << ctx.conf->tape_basedir << ctx.conf->columnar_tape;
+
+  _columnar_job job = { ctx.conf, 0 };
+  if(0 >= wininf_file_glob(tape.str().c_str(), _columnar, &job)) {
+    log(LOG_ERROR, "File '%s' not found.", tape.str().c_str());
+    return -1;
+  }
+  return 0 < job.failed ? -1 : 0;
+}
+
 void wineing_shutdown(w_ctx &ctx)
 {
   log(LOG_INFO, "Shutting down...");
 
+  // Replies until it finished
+  batch_stop();
+
   chan_shutdown();
+  reply_destroy();
+  credit_destroy(g_credit);
 
+  sem_destroy(&g_inproc_bound);
   pthread_cond_destroy(&g_market_sync_cond);
   pthread_mutex_destroy(&g_market_sync_mutex);
 
@@ -147,6 +260,314 @@ static inline void _send_free(void *buffer, void *hint)
   delete [] (char*)buffer;
 }
 
+/**
+ * Closes a channel opened by *_chan_open*.
+ */
+static void _chan_close(chan *c)
+{
+  chan_destroy(c);
+  free((void*)c->fqcn);
+  delete c;
+}
+
+/**
+ * Binds a channel of w_rconf. The channel refers to a copy of *fqcn*,
+ * it outlives the request naming it.
+ *
+ * \param type  CHAN_TYPE_PUB or CHAN_TYPE_XPUB
+ * \return      The channel or NULL if binding failed
+ */
+static chan* _chan_open(const char *name,
+                        const char *fqcn,
+                        int type,
+                        unsigned long long hwm)
+{
+  chan *c = chan_init(strdup(fqcn), type);
+  chan_set_hwm(c, hwm);
+  if(0 > chan_bind(c)) {
+    log(LOG_ERROR, "Failed binding %s (%s). Error [%s]",
+        name,
+        fqcn,
+        chan_error());
+    _chan_close(c);
+    return NULL;
+  }
+  return c;
+}
+
+/**
+ * Frees *rc* but not its channels, they might be shared with a copy.
+ */
+static void _rconf_free(w_rconf *rc)
+{
+  delete [] rc->filter;
+  delete rc;
+}
+
+/**
+ * \return A copy of *rc* sharing its channels
+ */
+static w_rconf* _rconf_copy(const w_rconf *rc)
+{
+  w_rconf *copy = new w_rconf(*rc);
+  if(NULL != rc->filter) {
+    copy->filter = new char[rc->filter_size];
+    memcpy(copy->filter, rc->filter, rc->filter_size);
+  }
+  return copy;
+}
+
+/**
+ * \return The type of mchan, see w_conf.mchan_xpub
+ */
+static inline int _mchan_type(const w_conf *conf)
+{
+  return conf->mchan_xpub ? CHAN_TYPE_XPUB : CHAN_TYPE_PUB;
+}
+
+/**
+ * Applies a RECONFIGURE request: publishes a modified copy of the
+ * current w_rconf and waits until the market data thread no longer
+ * holds the old one before closing the channels replaced. Only ever
+ * invoked by *cchan_in_thread*, the single writer of *g_rconf*.
+ *
+ * \return 0 if successful, -1 otherwise with the reason in *err*
+ */
+static int _reconfigure(const w_conf *conf,
+                        const WineingCtrlProto::Reconfigure &spec,
+                        std::stringstream &err)
+{
+  w_rconf *old = (w_rconf*)rcu_deref(&g_rconf);
+  if(NULL == old) {
+    err << "Market data thread not running.";
+    return -1;
+  }
+  if(spec.has_bchan() && NULL == old->bchan) {
+    err << "Bar aggregation is disabled.";
+    return -1;
+  }
+  // Each Wineing of an A/B pair would apply the change with another
+  // NxCore message and number the frames after it apart, see
+  // codec/seqhdr.h
+  if(conf->mchan_seq && (spec.has_filter() || spec.has_dir_chunk())) {
+    err << "The filter and dir_chunk are fixed with --mchan-seq.";
+    return -1;
+  }
+
+  w_rconf *rc = _rconf_copy(old);
+  rc->generation++;
+
+  if(spec.has_mchan_hwm()) {
+    rc->mchan_hwm = spec.mchan_hwm();
+  }
+  if(spec.has_mchan() && 0 != strcmp(spec.mchan().c_str(), old->mchan->fqcn)) {
+    rc->mchan = _chan_open("mchan",
+                           spec.mchan().c_str(),
+                           _mchan_type(conf),
+                           rc->mchan_hwm);
+    if(NULL == rc->mchan) {
+      err << "Failed binding mchan '" << spec.mchan() << "'.";
+      _rconf_free(rc);
+      return -1;
+    }
+  }
+  if(spec.has_bchan() && 0 != strcmp(spec.bchan().c_str(), old->bchan->fqcn)) {
+    rc->bchan = _chan_open("bchan", spec.bchan().c_str(), CHAN_TYPE_PUB, 0);
+    if(NULL == rc->bchan) {
+      err << "Failed binding bchan '" << spec.bchan() << "'.";
+      if(old->mchan != rc->mchan) {
+        _chan_close(rc->mchan);
+      }
+      _rconf_free(rc);
+      return -1;
+    }
+  }
+
+  if(spec.has_filter()) {
+    delete [] rc->filter;
+    rc->filter_size = spec.filter().ByteSize();
+    rc->filter = new char[rc->filter_size];
+    spec.filter().SerializeWithCachedSizesToArray(
+      (google::protobuf::uint8*)rc->filter);
+    rc->filter_generation = rc->generation;
+  }
+  if(spec.has_dir_chunk()) {
+    rc->dir_chunk = spec.dir_chunk();
+  }
+
+  rcu_publish(&g_rconf, rc);
+  rcu_synchronize(&g_rconf);
+
+  if(old->mchan != rc->mchan) {
+    _chan_close(old->mchan);
+  }
+  if(old->bchan != rc->bchan) {
+    _chan_close(old->bchan);
+  }
+  _rconf_free(old);
+
+  log(LOG_INFO, "Reconfigured [generation: %u]", rc->generation);
+  return 0;
+}
+
+/**
+ * \return The WININF_NXCORE_* flags of a MARKET_START request. The
+ *         ones of the partition are always set.
+ */
+static unsigned int _nxcore_flags(const w_conf *conf,
+                                  const WineingCtrlProto::Request &req)
+{
+  // Market maker quotes are never published
+  unsigned int flags = WININF_NXCORE_EXCLUDE_MM_QUOTES;
+
+  const w_partition *p = NULL == conf->partition ?
+    NULL : partition_find(conf->partition);
+  if(NULL != p) {
+    flags |= p->nxcore_flags;
+  }
+
+  if(req.has_nxcore()) {
+    const WineingCtrlProto::NxCoreFlags &f = req.nxcore();
+    if(f.exclude_quotes()) {
+      flags |= WININF_NXCORE_EXCLUDE_QUOTES;
+    }
+    if(f.exclude_opra()) {
+      flags |= WININF_NXCORE_EXCLUDE_OPRA;
+    }
+    if(f.no_crc_check()) {
+      flags |= WININF_NXCORE_NO_CRC_CHECK;
+    }
+  }
+  return flags;
+}
+
+/**
+ * Adds partition *name* to a DIRECTORY_OK. The optional endpoints
+ * may be NULL.
+ */
+static void _directory_add(WineingCtrlProto::Response &res,
+                           const char *name,
+                           const char *cchan_in,
+                           const char *cchan_out,
+                           const char *mchan,
+                           const char *bchan,
+                           const char *mchan_lz4,
+                           const char *nchan)
+{
+  WineingCtrlProto::Partition *p = res.add_partitions();
+  const w_partition *wp = partition_find(name);
+
+  p->set_name(name);
+  if(NULL != wp) {
+    p->set_prefix(wp->prefix);
+  }
+  p->set_cchan_in(cchan_in);
+  p->set_cchan_out(cchan_out);
+  p->set_mchan(mchan);
+  if(NULL != bchan) {
+    p->set_bchan(bchan);
+  }
+  if(NULL != mchan_lz4) {
+    p->set_mchan_lz4(mchan_lz4);
+  }
+  if(NULL != nchan) {
+    p->set_nchan(nchan);
+  }
+}
+
+/**
+ * Answers DIRECTORY with this process. Only ever invoked by
+ * *cchan_in_thread*, the single writer of *g_rconf*, the channels it
+ * refers to stay open.
+ */
+static void _directory_self(const w_conf *conf,
+                            WineingCtrlProto::Response &res)
+{
+  // RECONFIGURE might have moved mchan and bchan
+  const w_rconf *rc = (const w_rconf*)rcu_deref(&g_rconf);
+  const char *bchan = conf->bchan_fqcn;
+  const char *mchan = conf->mchan_fqcn;
+  if(NULL != rc) {
+    mchan = rc->mchan->fqcn;
+    bchan = NULL != rc->bchan ? rc->bchan->fqcn : NULL;
+  }
+
+  _directory_add(res,
+                 NULL != conf->partition ? conf->partition : "all",
+                 conf->cchan_in_fqcn,
+                 conf->cchan_out_fqcn,
+                 mchan,
+                 bchan,
+                 conf->mchan_lz4_fqcn,
+                 conf->nchan_fqcn);
+}
+
+/**
+ * Answers LIST_TAPES with the tapes of catalog *c* dated within the
+ * request's range.
+ */
+static void _list_tapes(const catalog *c,
+                        const WineingCtrlProto::Request &req,
+                        WineingCtrlProto::Response &res)
+{
+  unsigned int from = req.has_date_from() ? req.date_from() : 0;
+  unsigned int to = req.has_date_to() ? req.date_to() : UINT_MAX;
+  for(int i = 0; i < c->size; i++) {
+    const catalog_tape &t = c->tapes[i];
+    if(t.date < from || t.date > to) {
+      continue;
+    }
+    WineingCtrlProto::Tape *tape = res.add_tapes();
+    tape->set_name(t.name);
+    tape->set_date(t.date);
+    tape->set_feed(t.feed);
+    tape->set_size(t.size);
+  }
+}
+
+/**
+ * Prefetches the tape following *t* in the catalog, the one a client
+ * replaying days in a row asks for next, so that it is read from the
+ * page cache once *t* ends.
+ */
+static void _prefetch_next(const w_conf *conf,
+                           const catalog *c,
+                           const catalog_tape *t)
+{
+  const catalog_tape *next = catalog_next(c, t);
+  if(NULL == next) {
+    return;
+  }
+  std::string path = std::string(conf->tape_basedir) + next->name;
+  if(0 > wininf_file_prefetch(path.c_str())) {
+    log(LOG_DEBUG, "Failed prefetching '%s'", path.c_str());
+  }
+}
+
+/**
+ * Publishes SHUTDOWN to the market data thread and wakes it up.
+ * Invoked by *cchan_in_thread*, the single writer of *g_data*.
+ *
+ * \return The thread local version
+ */
+static int _shutdown(int t_version, w_ctrl *t_data)
+{
+  t_data->cmd = WINEING_CTRL_CMD_SHUTDOWN;
+  t_version = lazy_update_global_if_owner(t_version,
+                                          t_data,
+                                          &g_data,
+                                          _copy_local_to_shared);
+  credit_close(g_credit);
+
+  // In case no START message was successfully processed by the
+  // control thread notifing the market thread is still necessary.
+  // Do that.
+  pthread_mutex_lock( &g_market_sync_mutex );
+  pthread_cond_signal( &g_market_sync_cond );
+  pthread_mutex_unlock( &g_market_sync_mutex );
+  return t_version;
+}
+
 /**
  * The controlling thread. It waits for the client to send control
  * messages to Wineing.
@@ -156,9 +577,8 @@ void* cchan_in_thread(void *_ctx)
   using namespace WineingCtrlProto;
 
   w_ctx *ctx = (w_ctx *)_ctx;
-  chan *cchan_out_inmem;
   chan *cchan_in;
-  char *buffer;
+  catalog *tapes;
   // Statically allocate variables to improve runtime performance
   static Request req;
   static Response res;
@@ -178,14 +598,20 @@ void* cchan_in_thread(void *_ctx)
     log(LOG_ERROR, "Failed binding to cchan_in (%s). Error [%s]",
         ctx->conf->cchan_in_fqcn,
         chan_error());
+
+    // Nobody can ask for SHUTDOWN, the other threads wouldn't exit
+    t_version = _shutdown(t_version, &t_data);
+    reply_close();
+    chan_destroy(cchan_in);
     return NULL;
   }
 
-  // We can not bind to the inproc channel unless it's been created.
-  cchan_out_inmem = chan_init(DEFAULTS_ICHAN_NAME, CHAN_TYPE_PUSH_CONNECT);
-  while(0 > chan_bind(cchan_out_inmem)) {
-    sleep(1);
-  }
+  // Scanned once rather than per request, see LIST_TAPES
+  tapes = catalog_init();
+  int cataloged = catalog_scan(tapes, ctx->conf->tape_basedir);
+  log(LOG_INFO, "Cataloged %d tapes in '%s'",
+      cataloged,
+      ctx->conf->tape_basedir);
 
   log(LOG_DEBUG, "Ready to accept client requests");
 
@@ -235,10 +661,12 @@ void* cchan_in_thread(void *_ctx)
             tape << ctx->conf->tape_basedir \
                  << req.tape_file();
 
-            // Checks whether a file exists the windows way. Remember
-            // we are loading the file with NxCore which is, well,
-            // Windows.
-            if(0 > wininf_file_exists(tape.str().c_str())) {
+            // Checks whether a file exists the windows way unless it
+            // is cataloged. Remember we are loading the file with
+            // NxCore which is, well, Windows.
+            const catalog_tape *ct =
+              catalog_find(tapes, req.tape_file().c_str());
+            if(NULL == ct && 0 > wininf_file_exists(tape.str().c_str())) {
               err << "File '" << tape.str() << "' not found.";
               res.set_type(Response::ERR);
               res.set_err_text(err.str());
@@ -251,10 +679,42 @@ void* cchan_in_thread(void *_ctx)
             memcpy(t_data.data,
                    tape.str().c_str(),
                    t_data.size);
+
+            if(NULL != ct) {
+              _prefetch_next(ctx->conf, tapes, ct);
+            }
+          }
+
+          // The serialized filter follows the tape's NULL byte, see
+          // nxtape.cc
+          if(req.has_filter()) {
+            if(0 == t_data.size) {
+              t_data.data[t_data.size++] = '\0';
+            }
+            int filter_size = req.filter().ByteSize();
+            if(t_data.size + filter_size > WINEING_CTRL_DEFAULT_DATA_SIZE) {
+              err << "Filter too large.";
+              res.set_type(Response::ERR);
+              res.set_err_text(err.str());
+              log(LOG_DEBUG, err.str().c_str());
+              break;
+            }
+            req.filter().SerializeWithCachedSizesToArray(
+              (google::protobuf::uint8*)&t_data.data[t_data.size]);
+            t_data.size += filter_size;
+          }
+
+          // Opened before the tape starts, the callback doesn't
+          // publish a message unpaced
+          if(req.has_tape_file() && req.has_credits()) {
+            credit_open(g_credit, req.credits());
+          } else {
+            credit_close(g_credit);
           }
 
           // Update g_data
           t_data.cmd = WINEING_CTRL_CMD_MARKET_RUN;
+          t_data.flags = _nxcore_flags(ctx->conf, req);
           t_version = lazy_update_global_if_owner(t_version,
                                                   &t_data,
                                                   &g_data,
@@ -272,51 +732,338 @@ void* cchan_in_thread(void *_ctx)
                                                   &t_data,
                                                   &g_data,
                                                   _copy_local_to_shared);
+
+          // Wakes a replay waiting for credits, it stops with the
+          // message it was about to publish
+          credit_close(g_credit);
           break;
 
         case Request::SHUTDOWN:
           res.set_type(Response::SHUTDOWN_OK);
-          t_data.cmd = WINEING_CTRL_CMD_SHUTDOWN;
-          t_version = lazy_update_global_if_owner(t_version,
-                                                  &t_data,
-                                                  &g_data,
-                                                  _copy_local_to_shared);
+          t_version = _shutdown(t_version, &t_data);
+          break;
 
-          // In case no START message was successfully processed by the
-          // control thread notifing the market thread is still necessary.
-          // Do that.
-          pthread_mutex_lock( &g_market_sync_mutex );
-          pthread_cond_signal( &g_market_sync_cond );
-          pthread_mutex_unlock( &g_market_sync_mutex );
+        case Request::BATCH_START:
+          {
+            w_batch *b = batch_init(req.requestid(),
+                                    req.has_journal_dir() ?
+                                    req.journal_dir().c_str() :
+                                    ctx->conf->tape_basedir,
+                                    ctx->conf->batch_workers);
+
+            for(int i = 0; i < req.tape_files_size(); i++) {
+              tape.str("");
+              tape << ctx->conf->tape_basedir \
+                   << req.tape_files(i);
+              if(0 >= wininf_file_glob(tape.str().c_str(), batch_add, b)) {
+                err << "File '" << tape.str() << "' not found.";
+                break;
+              }
+            }
+
+            if(0 < err.tellp() || 0 == b->size) {
+              if(0 == b->size) {
+                err << "No tape files.";
+              }
+              res.set_type(Response::ERR);
+              res.set_err_text(err.str());
+              log(LOG_DEBUG, err.str().c_str());
+              batch_destroy(b);
+              break;
+            }
+
+            // Read before batch_start passes ownership of *b*
+            res.set_tapes_total(b->size);
+            res.set_type(Response::BATCH_START_OK);
+            if(0 > batch_start(b)) {
+              res.clear_tapes_total();
+              res.set_type(Response::BATCH_START_ERR_RUNNING);
+              res.set_err_text("A batch is already running.");
+              batch_destroy(b);
+            }
+          }
           break;
-        }
 
+        case Request::CREDIT:
+          res.set_type(Response::CREDIT_OK);
+          credit_grant(g_credit, req.credits());
+          break;
+
+        case Request::RECONFIGURE:
+          res.set_type(Response::RECONFIGURE_OK);
+          if(0 > _reconfigure(ctx->conf, req.reconfigure(), err)) {
+            res.set_type(Response::ERR);
+            res.set_err_text(err.str());
+            log(LOG_DEBUG, err.str().c_str());
+          }
+          break;
+
+        case Request::DIRECTORY:
+          res.set_type(Response::DIRECTORY_OK);
+          _directory_self(ctx->conf, res);
+          break;
+
+        case Request::LIST_TAPES:
+          res.set_type(Response::LIST_TAPES_OK);
+          if(req.rescan()) {
+            catalog_scan(tapes, ctx->conf->tape_basedir);
+          }
+          _list_tapes(tapes, req, res);
+          break;
+        }
 
-      int buf_size = res.ByteSize();
-      buffer = new char[buf_size];
-      google::protobuf::io::ArrayOutputStream os (buffer, buf_size);
-      res.SerializeToZeroCopyStream(&os);
       // log(LOG_DEBUG, "Sending Response [id: %li, type: %i]",
       //    res.requestid(),
       //    res.type()
       //    );
-      if(0 > chan_send(cchan_out_inmem, buffer, buf_size, _send_free)) {
-        log(LOG_WARN,
-            "Failed sending message to inproc channel (%s). Error %s",
-            DEFAULTS_ICHAN_NAME,
-            chan_error());
+      // The OKs carry nothing else, they're patched into templates
+      switch(res.type())
+        {
+        case Response::MARKET_START_OK:
+        case Response::MARKET_STOP_OK:
+        case Response::SHUTDOWN_OK:
+        case Response::RECONFIGURE_OK:
+        case Response::CREDIT_OK:
+          rc = reply_send_fixed(res.requestid(), res.type());
+          break;
+        default:
+          rc = reply_send(res);
+        }
+      if(0 > rc) {
+        log(LOG_WARN, "Dropped response [id: %li], too many pending",
+            res.requestid());
       }
     }
   }
 
+  // SHUTDOWN_OK is queued ahead, see core/reply.h
+  reply_close();
   chan_destroy(cchan_in);
-  chan_destroy(cchan_out_inmem);
+  catalog_destroy(tapes);
 
   log(LOG_INFO, "Shutting down control_in thread");
 
   return NULL;
 }
 
+/**
+ * Used by *wineing_launch*. Forwards SHUTDOWN to the control channel
+ * of each partition.
+ */
+static void _launch_shutdown(chan **partitions, int size, long long id)
+{
+  WineingCtrlProto::Request req;
+  req.set_requestid(id);
+  req.set_type(WineingCtrlProto::Request::SHUTDOWN);
+
+  for(int i = 0; i < size; i++) {
+    int req_size = req.ByteSize();
+    char *buffer = new char[req_size];
+    req.SerializeWithCachedSizesToArray((google::protobuf::uint8*)buffer);
+    if(0 > chan_send(partitions[i], buffer, req_size, _send_free)) {
+      log(LOG_WARN, "Failed forwarding SHUTDOWN to partition %d. Error [%s]",
+          i,
+          chan_error());
+    }
+  }
+}
+
+int wineing_launch(w_ctx &ctx)
+{
+  using namespace WineingCtrlProto;
+
+  // The endpoints of a partition, served by DIRECTORY
+  typedef struct
+  {
+    char cchan_in[256];
+    char cchan_out[256];
+    char mchan[256];
+    char bchan[256];
+    char mchan_lz4[256];
+    char nchan[256];
+    char local[256];            // cchan_in to connect to
+  } _endpoints;
+
+  const w_conf *conf = ctx.conf;
+  _endpoints *ends = new _endpoints[WINEING_MAX_PARTITIONS];
+  void *procs[WINEING_MAX_PARTITIONS];
+  chan *partitions[WINEING_MAX_PARTITIONS];
+  int size = 0;
+  int failed = 0;
+  chan *cchan_in;
+  pthread_t cchan_out_t;
+  Request req;
+  Response res;
+  int t_version = DEFAULTS_SHARED_VERSION_INIT;
+  w_ctrl t_data = { WINEING_CTRL_CMD_INIT, NULL, 0 };
+
+  log(LOG_INFO, "Launching %d partitions", conf->partitions_size);
+
+  for(; size < conf->partitions_size; size++) {
+    const char *name = conf->partitions[size];
+    _endpoints *e = &ends[size];
+    if(NULL == partition_find(name)) {
+      log(LOG_ERROR, "Unknown partition '%s'", name);
+      failed = 1;
+      break;
+    }
+
+    partition_fqcn(conf->cchan_in_fqcn, size, e->cchan_in, 256);
+    partition_fqcn(conf->cchan_out_fqcn, size, e->cchan_out, 256);
+    partition_fqcn(conf->mchan_fqcn, size, e->mchan, 256);
+    if(NULL != conf->bchan_fqcn) {
+      partition_fqcn(conf->bchan_fqcn, size, e->bchan, 256);
+    }
+    if(NULL != conf->mchan_lz4_fqcn) {
+      partition_fqcn(conf->mchan_lz4_fqcn, size, e->mchan_lz4, 256);
+    }
+    if(NULL != conf->nchan_fqcn) {
+      partition_fqcn(conf->nchan_fqcn, size, e->nchan, 256);
+    }
+
+    // Connected before the partition binds, PUSH queues until then
+    partition_local_fqcn(e->cchan_in, e->local, sizeof(e->local));
+    partitions[size] = chan_init(e->local, CHAN_TYPE_PUSH_CONNECT);
+    if(0 > chan_bind(partitions[size])) {
+      log(LOG_ERROR, "Failed connecting to partition '%s' (%s). Error [%s]",
+          name,
+          e->local,
+          chan_error());
+      chan_destroy(partitions[size]);
+      failed = 1;
+      break;
+    }
+
+    std::vector<std::string> args;
+    std::vector<const char*> argv;
+    partition_args(conf, size, args);
+    for(size_t i = 0; i < args.size(); i++) {
+      argv.push_back(args[i].c_str());
+    }
+    argv.push_back(NULL);
+
+    procs[size] = wininf_spawn_self(&argv[0]);
+    if(NULL == procs[size]) {
+      log(LOG_ERROR, "Failed starting partition '%s'", name);
+      chan_destroy(partitions[size]);
+      failed = 1;
+      break;
+    }
+    log(LOG_INFO, "Started partition '%s' (%s)", name, e->cchan_in);
+  }
+
+  cchan_in = chan_init(conf->cchan_in_fqcn, CHAN_TYPE_PULL_BIND);
+  if(!failed && 0 > chan_bind(cchan_in)) {
+    log(LOG_ERROR, "Failed binding to cchan_in (%s). Error [%s]",
+        conf->cchan_in_fqcn,
+        chan_error());
+    failed = 1;
+  }
+
+  // Responses are queued to *cchan_out_thread* as usual, it exits
+  // with the SHUTDOWN published through g_data
+  if(!failed) {
+    pthread_create(&cchan_out_t, NULL, cchan_out_thread, (void*)&ctx);
+  }
+
+  while(!failed && WINEING_CTRL_CMD_SHUTDOWN < t_data.cmd) {
+    req.Clear();
+    res.Clear();
+    if(0 >= chan_recv(cchan_in, _recv_ctrl, &req)) {
+      continue;
+    }
+
+    res.set_requestid(req.requestid());
+    switch(req.type())
+      {
+      case Request::DIRECTORY:
+        res.set_type(Response::DIRECTORY_OK);
+        for(int i = 0; i < size; i++) {
+          _directory_add(res,
+                         conf->partitions[i],
+                         ends[i].cchan_in,
+                         ends[i].cchan_out,
+                         ends[i].mchan,
+                         NULL != conf->bchan_fqcn ? ends[i].bchan : NULL,
+                         NULL != conf->mchan_lz4_fqcn ?
+                         ends[i].mchan_lz4 : NULL,
+                         NULL != conf->nchan_fqcn ? ends[i].nchan : NULL);
+        }
+        break;
+
+      case Request::SHUTDOWN:
+        res.set_type(Response::SHUTDOWN_OK);
+        _launch_shutdown(partitions, size, req.requestid());
+        t_data.cmd = WINEING_CTRL_CMD_SHUTDOWN;
+        t_version = lazy_update_global_if_owner(t_version,
+                                                &t_data,
+                                                &g_data,
+                                                _copy_local_to_shared);
+        break;
+
+      default:
+        res.set_type(Response::ERR);
+        res.set_err_text("Not served by the launcher, see DIRECTORY.");
+      }
+
+    if(0 > reply_send(res)) {
+      log(LOG_WARN, "Dropped response [id: %li], too many pending",
+          res.requestid());
+    }
+  }
+
+  if(failed) {
+    _launch_shutdown(partitions, size, 0);
+  } else {
+    reply_close();
+    pthread_join(cchan_out_t, NULL);
+  }
+  chan_destroy(cchan_in);
+
+  // Queued messages are still delivered once closed
+  for(int i = 0; i < size; i++) {
+    chan_destroy(partitions[i]);
+    int rc = wininf_wait(procs[i]);
+    if(0 != rc) {
+      log(LOG_ERROR, "Partition '%s' exited with %d", conf->partitions[i], rc);
+      failed = 1;
+    }
+  }
+  delete [] ends;
+
+  log(LOG_INFO, "All partitions exited");
+  return failed ? -1 : 0;
+}
+
+/**
+ * Restores the live directory from the day's latest checkpoint and
+ * writes the path NxCore continues the real-time tape from to *state*.
+ *
+ * \return 0 if successful, -1 if the real-time tape starts cold
+ */
+static int _warm_start(checkpoint *c, char *state, size_t size)
+{
+  char path[CHECKPOINT_PATH_SIZE];
+
+  int slot = checkpoint_latest(c, time(NULL));
+  if(0 > slot) {
+    log(LOG_INFO, "No checkpoint taken today, starting cold");
+    return -1;
+  }
+  if(0 > checkpoint_path(c, slot, CHECKPOINT_NXCORE_SUFFIX, path, sizeof(path))
+     || 0 > wininf_nxcore_path(path, state, size)) {
+    log(LOG_WARN, "Failed mapping checkpoint %d, starting cold", slot);
+    return -1;
+  }
+  long clock = nxtape_checkpoint_restore(c, slot);
+  if(0 > clock) {
+    log(LOG_WARN, "Failed restoring checkpoint %d, starting cold", slot);
+    return -1;
+  }
+  log(LOG_INFO, "Continuing from checkpoint %d taken at %ld ms", slot, clock);
+  return 0;
+}
+
 /**
  * The thread processing NxCore messages.
  */
@@ -336,27 +1083,106 @@ void* market_thread(void *_ctx)
     0
   };
 
-  chan *mchan;
-  chan *cchan_out_inmem;
+  w_rconf *rconf;
+  int rslot;
+  chan *mchan_lz4_inmem = NULL;
+  chan *nchan = NULL;
+  chan *ochan_inmem[WINEING_OCHAN_MAX_SHARDS];
+  char ochan_names[WINEING_OCHAN_MAX_SHARDS][32];
+  checkpoint *ckpt = NULL;
+  int warm = 0;
+  char state[CHECKPOINT_PATH_SIZE];
 
   log(LOG_INFO, "Initializing market data thread (%s)",
       ctx->conf->mchan_fqcn);
 
-  mchan = chan_init(ctx->conf->mchan_fqcn, CHAN_TYPE_PUB);
-  if(0 > chan_bind(mchan)) {
-    log(LOG_ERROR, "Failed binding mchan (%s). Error [%s]",
-        ctx->conf->mchan_fqcn,
-        chan_error());
+  // The channels RECONFIGURE might replace belong to the
+  // configuration, see w_rconf
+  rconf = new w_rconf();
+  rconf->generation = 1;
+  rconf->dir_chunk = DEFAULTS_SYMTAB_DIR_CHUNK;
+  rconf->mchan = _chan_open("mchan",
+                             ctx->conf->mchan_fqcn,
+                             _mchan_type(ctx->conf),
+                             0);
+  if(NULL == rconf->mchan) {
     return NULL;
   }
+  if(NULL != ctx->conf->bchan_fqcn) {
+    rconf->bchan = _chan_open("bchan",
+                               ctx->conf->bchan_fqcn,
+                               CHAN_TYPE_PUB,
+                               0);
+    if(NULL == rconf->bchan) {
+      return NULL;
+    }
+  }
+  rcu_publish(&g_rconf, rconf);
+
+  // Online only while NxCore runs, RECONFIGURE doesn't wait for an
+  // idle thread
+  rslot = rcu_register(&g_rconf);
+  rcu_offline(&g_rconf, rslot);
 
-  // We can not bind to the inproc channel unless it's been created.
-  cchan_out_inmem = chan_init(DEFAULTS_ICHAN_NAME, CHAN_TYPE_PUSH_CONNECT);
-  while(0 > chan_bind(cchan_out_inmem)) {
-    sleep(1);
+  nxtape_init(ctx->conf, rslot);
+  if(NULL != ctx->conf->bchan_fqcn) {
+    nxtape_bars_init();
+  }
+  if(NULL != ctx->conf->nchan_fqcn) {
+    nchan = _chan_open("nchan", ctx->conf->nchan_fqcn, CHAN_TYPE_PUB, 0);
+    if(NULL == nchan) {
+      return NULL;
+    }
+    nxtape_nbbo_init(nchan);
+  }
+
+  // inproc endpoints must be bound before connecting to them
+  int inproc = ctx->conf->ochan_size
+    + (NULL != ctx->conf->mchan_lz4_fqcn ? 1 : 0);
+  for(int i = 0; i < inproc; i++) {
+    while(0 > sem_wait(&g_inproc_bound) && EINTR == errno);
+  }
+
+  if(NULL != ctx->conf->mchan_lz4_fqcn) {
+    mchan_lz4_inmem = chan_init(DEFAULTS_LZ4_ICHAN_NAME,
+                                CHAN_TYPE_PUSH_CONNECT);
+    if(0 > chan_bind(mchan_lz4_inmem)) {
+      log(LOG_ERROR, "Failed connecting to mchan_lz4_inmem (%s). Error [%s]",
+          DEFAULTS_LZ4_ICHAN_NAME,
+          chan_error());
+      return NULL;
+    }
+    nxtape_batch_init(mchan_lz4_inmem);
   }
 
-  nxtape_init(cchan_out_inmem, mchan);
+  for(int i = 0; i < ctx->conf->ochan_size; i++) {
+    snprintf(ochan_names[i], sizeof(ochan_names[i]), "%s%d",
+             DEFAULTS_OCHAN_ICHAN_NAME, i);
+    ochan_inmem[i] = chan_init(ochan_names[i], CHAN_TYPE_PUSH_CONNECT);
+    if(0 > chan_bind(ochan_inmem[i])) {
+      log(LOG_ERROR, "Failed connecting to ochan_inmem (%s). Error [%s]",
+          ochan_names[i],
+          chan_error());
+      return NULL;
+    }
+  }
+  if(0 < ctx->conf->ochan_size) {
+    nxtape_ochan_init(ochan_inmem, ctx->conf->ochan_size);
+  }
+
+  // The first real-time tape continues from the day's latest
+  // checkpoint, see core/checkpoint.h
+  if(NULL != ctx->conf->checkpoint_dir) {
+    ckpt = checkpoint_init(ctx->conf->checkpoint_dir,
+                           NULL != ctx->conf->partition ?
+                           ctx->conf->partition : DEFAULTS_CHECKPOINT_NAME);
+    if(NULL == ckpt) {
+      log(LOG_ERROR, "Failed starting checkpoints (%s)",
+          ctx->conf->checkpoint_dir);
+      return NULL;
+    }
+    warm = 1;
+  }
 
   while(1) {
     // NxCore callback will return upon successfully completing a tape
@@ -376,9 +1202,29 @@ void* market_thread(void *_ctx)
         log(LOG_INFO, "Shutting down market data thread");
         goto shutdown;
       } else if(t_data.cmd == WINEING_CTRL_CMD_MARKET_RUN) {
-        log(LOG_DEBUG, "Running nxcore [tape: %s]",
-            t_data.size == 0 ? "real-time" : t_data.data);
-        wininf_nxcore_run(t_data.data, nxtape_process);
+        // The data might hold a filter only
+        if(0 == t_data.size) {
+          t_data.data[0] = '\0';
+        }
+        log(LOG_DEBUG, "Running nxcore [tape: %s, flags: 0x%x]",
+            '\0' == t_data.data[0] ? "real-time" : t_data.data,
+            t_data.flags);
+
+        // Only the real-time tape is checkpointed, NxCore continues it
+        // from its state instead of the tape
+        char *tape = t_data.data;
+        int realtime = '\0' == t_data.data[0];
+        if(realtime && warm) {
+          warm = 0;
+          if(0 == _warm_start(ckpt, state, sizeof(state))) {
+            tape = state;
+          }
+        }
+        nxtape_checkpoint_init(realtime ? ckpt : NULL);
+
+        rcu_online(&g_rconf, rslot);
+        wininf_nxcore_run(tape, 0, t_data.flags, nxtape_process);
+        rcu_offline(&g_rconf, rslot);
       } else {
         // Be nice to the cpu and sleep for a bit if no data was
         // requested.
@@ -389,101 +1235,453 @@ void* market_thread(void *_ctx)
 
   // Do a proper shutdown freeing all resources.
  shutdown:
-  chan_destroy(mchan);
-  chan_destroy(cchan_out_inmem);
+  // No RECONFIGURE follows SHUTDOWN
+  rconf = (w_rconf*)rcu_publish(&g_rconf, NULL);
+  if(NULL != rconf->bchan) {
+    _chan_close(rconf->bchan);
+  }
+  if(NULL != nchan) {
+    _chan_close(nchan);
+  }
+  if(NULL != mchan_lz4_inmem) {
+    // An empty batch terminates mchan_lz4_thread
+    chan_send(mchan_lz4_inmem, NULL, 0);
+    chan_destroy(mchan_lz4_inmem);
+  }
+  for(int i = 0; i < ctx->conf->ochan_size; i++) {
+    // An empty batch terminates ochan_thread
+    chan_send(ochan_inmem[i], NULL, 0);
+    chan_destroy(ochan_inmem[i]);
+  }
+  if(NULL != ckpt) {
+    // Waits for the checkpoint being written
+    checkpoint_destroy(ckpt);
+  }
+  _chan_close(rconf->mchan);
+  _rconf_free(rconf);
   return NULL;
 }
 
 /**
- * Used by cchan_out_thread. Allocates a buffer of size *size*.
+ * State of *mchan_lz4_thread* passed to *_lz4_compress*.
  */
-int _cchan_in_mem_copy(void *buffer, size_t size, void *out_buffer)
+typedef struct
 {
-  memcpy(out_buffer, buffer, size);
+  lz4comp *comp;
+  chan *mchan_lz4;
+} _lz4_ctx;
+
+/**
+ * Used by *mchan_lz4_thread*. Compresses a batch while it is still
+ * held by zmq and publishes the result.
+ *
+ * \return 0 if successful, -1 if the batch was empty (shutdown)
+ */
+static int _lz4_compress(void *data, size_t size, void *obj)
+{
+  _lz4_ctx *c = (_lz4_ctx*)obj;
+
+  if(0 == size) {
+    return -1;
+  }
+
+  size_t buf_size = lz4comp_bound(size);
+  char *buffer = new char[buf_size];
+  int n = lz4comp_compress(c->comp, (const char*)data, size,
+                           buffer, buf_size);
+  if(0 > n) {
+    log(LOG_WARN, "Failed compressing batch of %lu bytes",
+        (unsigned long)size);
+    delete [] buffer;
+    return 0;
+  }
+
+  if(0 > chan_send(c->mchan_lz4, buffer, n, _send_free)) {
+    log(LOG_WARN, "Sending compressed batch failed. Error %s",
+        chan_error());
+  }
   return 0;
 }
 
-void* cchan_out_thread(void *_ctx)
+/**
+ * Reads the dictionary file, its last LZ4BATCH_MAX_DICT_SIZE bytes as
+ * the clients use them. The caller frees the buffer.
+ *
+ * \return The dictionary or NULL if *path* could not be read
+ */
+static char* _lz4_read_dict(const char *path, size_t *size)
 {
-  using namespace WineingCtrlProto;
+  FILE *f = fopen(path, "rb");
+  if(NULL == f) {
+    return NULL;
+  }
 
-  w_ctx *ctx = (w_ctx *)_ctx;
-  chan *cchan_out;
-  chan *cchan_in_mem;
-  int read;
-  int t_version = DEFAULTS_SHARED_VERSION_READ_INIT;
-  static w_ctrl t_data = {
-    WINEING_CTRL_CMD_INIT,
-    new char[WINEING_CTRL_DEFAULT_DATA_SIZE],
-    0
-  };
-  char *buffer;
+  long end = 0 == fseek(f, 0, SEEK_END) ? ftell(f) : -1;
+  long start = LZ4BATCH_MAX_DICT_SIZE < end ? end - LZ4BATCH_MAX_DICT_SIZE : 0;
+  if(0 > end || 0 != fseek(f, start, SEEK_SET)) {
+    fclose(f);
+    return NULL;
+  }
 
-  log(LOG_INFO, "Initializing control_out thread (%s)",
-      ctx->conf->cchan_out_fqcn);
+  char *dict = new char[LZ4BATCH_MAX_DICT_SIZE];
+  *size = fread(dict, 1, LZ4BATCH_MAX_DICT_SIZE, f);
+  fclose(f);
+  if((size_t)(end - start) != *size) {
+    delete [] dict;
+    return NULL;
+  }
+  return dict;
+}
 
+void* mchan_lz4_thread(void *_ctx)
+{
+  w_ctx *ctx = (w_ctx *)_ctx;
+  chan *mchan_lz4_inmem;
+  char *dict = NULL;
+  size_t dict_size = 0;
+  _lz4_ctx c;
+
+  log(LOG_INFO, "Initializing compressed market data thread (%s)",
+      ctx->conf->mchan_lz4_fqcn);
+
+  if(NULL != ctx->conf->mchan_lz4_dict) {
+    dict = _lz4_read_dict(ctx->conf->mchan_lz4_dict, &dict_size);
+    if(NULL == dict) {
+      log(LOG_ERROR, "Failed reading lz4 dictionary (%s)",
+          ctx->conf->mchan_lz4_dict);
+      sem_post(&g_inproc_bound);
+      return NULL;
+    }
+  }
 
-  // This is where we send Response messages to the
-  // client(s). ZMQ_PUSH is a fan-out type socket.
-  cchan_out = chan_init(ctx->conf->cchan_out_fqcn, CHAN_TYPE_PUB);
-  if(0 > chan_bind(cchan_out)) {
-    log(LOG_ERROR, "Failed binding cchan_out (%s). Error [%s]",
-        ctx->conf->cchan_out_fqcn,
-        chan_error());
+  c.comp = lz4comp_init(dict, dict_size);
+  delete [] dict;
+  if(NULL == c.comp) {
+    log(LOG_ERROR, "Failed allocating the lz4 compressor");
+    sem_post(&g_inproc_bound);
     return NULL;
   }
 
-  // This initializes the inbound memory channel where we get Response
-  // messages required to be sent to the client.
-  cchan_in_mem = chan_init(DEFAULTS_ICHAN_NAME, CHAN_TYPE_PULL_BIND);
-  if(0 > chan_bind(cchan_in_mem)) {
-    log(LOG_ERROR, "Failed binding to cchan_in_mem (%s). Error [%s]",
-        DEFAULTS_ICHAN_NAME,
+  c.mchan_lz4 = chan_init(ctx->conf->mchan_lz4_fqcn, CHAN_TYPE_PUB);
+  if(0 > chan_bind(c.mchan_lz4)) {
+    log(LOG_ERROR, "Failed binding mchan_lz4 (%s). Error [%s]",
+        ctx->conf->mchan_lz4_fqcn,
         chan_error());
+    sem_post(&g_inproc_bound);
     return NULL;
   }
 
-  while(1) {
-    // Read the global state
-    t_version = lazy_update_local_if_changed(t_version,
-                                             &t_data,
-                                             &g_data,
-                                             _copy_shared_to_local);
+  mchan_lz4_inmem = chan_init(DEFAULTS_LZ4_ICHAN_NAME, CHAN_TYPE_PULL_BIND);
+  int rc = chan_bind(mchan_lz4_inmem);
+  sem_post(&g_inproc_bound);
+  if(0 > rc) {
+    log(LOG_ERROR, "Failed binding to mchan_lz4_inmem (%s). Error [%s]",
+        DEFAULTS_LZ4_ICHAN_NAME,
+        chan_error());
+    return NULL;
+  }
 
-    if(WINEING_CTRL_CMD_SHUTDOWN == t_data.cmd) {
-      break;
+  // Returns -1 on the empty batch sent by market_thread on shutdown
+  while(0 <= chan_recv(mchan_lz4_inmem, _lz4_compress, &c)) {
+    const lz4comp_stats &s = c.comp->stats;
+    if(0 == s.batches % DEFAULTS_LZ4_STATS_INTERVAL && 0 < s.bytes_out) {
+      log(LOG_INFO,
+          "lz4 stats [batches: %lu, in: %lu, out: %lu, ratio: %.2f, "
+          "cpu: %.2f ns/byte]",
+          s.batches,
+          s.bytes_in,
+          s.bytes_out,
+          (double)s.bytes_in / s.bytes_out,
+          (double)s.cpu_ns / s.bytes_in);
     }
+  }
 
-    // Allocate buffer for the data we're expecting. It is freed by as
-    // soon as the data is on the wire by _send_free function provided
-    // to chan_send below.
-    buffer = new char[1024];
+  chan_destroy(mchan_lz4_inmem);
+  chan_destroy(c.mchan_lz4);
+  lz4comp_destroy(c.comp);
 
-    // Receive the data
-    read = chan_recv(cchan_in_mem,
-                     _cchan_in_mem_copy,
-                     buffer);
-    if(0 > read) {
-      log(LOG_WARN,
-          "Failed reading message from inproc channel (%s). Error %s",
-          DEFAULTS_ICHAN_NAME,
-          chan_error());
+  log(LOG_INFO, "Shutting down compressed market data thread");
+
+  return NULL;
+}
+
+/**
+ * State of an *ochan_thread* passed to *_ochan_publish*.
+ */
+typedef struct
+{
+  chan *ochan;
+  urate *rates;
+  greeks *quotes;               // NULL unless w_conf.greeks is set
+  long slots[DEFAULTS_OCHAN_BATCH_SIZE];
+  WineingMarketDataProto::MarketData m;
+  char buffer[DEFAULTS_OCHAN_BUFFER_SIZE]; // serialized *m*, copied by zmq
+} _ochan_ctx;
+
+/**
+ * Computes the greeks of the two-sided option quotes of a batch whose
+ * underlying traded, see agg/greeks.h. *c->slots* maps each record to
+ * its quote in *c->quotes*, -1 if it has none. Options expire at
+ * DEFAULTS_GREEKS_EXPIRY_MS of their expiration date.
+ */
+static void _ochan_greeks(_ochan_ctx *c, const nxtape_orec *r, size_t size)
+{
+  greeks_clear(c->quotes);
+  for(size_t i = 0; i < size; i++) {
+    const nxtape_orec &o = r[i];
+    c->slots[i] = -1;
+    if(WineingMarketDataProto::MarketData::QUOTE_EX != o.type
+       || 0 >= o.spot
+       || 0 == o.size
+       || 0 == o.ask_size) {
       continue;
     }
+    double mid = (wininf_nxcore_price(o.price, o.price_type)
+                  + wininf_nxcore_price(o.ask_price, o.price_type)) / 2;
+    double ms = o.days * 86400000.0 + DEFAULTS_GREEKS_EXPIRY_MS - o.clock;
+    c->slots[i] = greeks_add(c->quotes,
+                             o.spot,
+                             wininf_nxcore_price(o.strike,
+                                                 NXTAPE_STRIKE_PRICE_TYPE),
+                             ms / (365 * 86400000.0),
+                             mid,
+                             o.put);
+  }
+  greeks_compute(c->quotes);
+}
+
+/**
+ * Publishes *m* on ochan prefixed with *topic*. The topic includes
+ * the NULL byte so that subscribing to "eAA\0" doesn't match "eAAPL".
+ * Both parts are copied by zmq, the message from *c->buffer* unless
+ * larger.
+ */
+static void _ochan_send(_ochan_ctx *c,
+                        const char *topic,
+                        const WineingMarketDataProto::MarketData &m)
+{
+  char t[SYMTAB_NAME_SIZE];
+  size_t topic_size = strnlen(topic, SYMTAB_NAME_SIZE - 1) + 1;
+  memcpy(t, topic, topic_size - 1);
+  t[topic_size - 1] = '\0';
+
+  int rc = chan_send_copy(c->ochan, t, topic_size, 1);
+  if(0 <= rc) {
+    int buf_size = m.ByteSize();
+    if(DEFAULTS_OCHAN_BUFFER_SIZE >= buf_size) {
+      m.SerializeWithCachedSizesToArray((google::protobuf::uint8*)c->buffer);
+      rc = chan_send_copy(c->ochan, c->buffer, buf_size);
+    } else {
+      char *buffer = new char[buf_size];
+      m.SerializeWithCachedSizesToArray((google::protobuf::uint8*)buffer);
+      rc = chan_send(c->ochan, buffer, buf_size, _send_free);
+    }
+  }
+  if(0 > rc) {
+    log(LOG_WARN, "Sending option message failed. Error %s",
+        chan_error());
+  }
+}
+
+/**
+ * Used by *urate_roll*. Publishes the message rate of an underlying.
+ */
+static void _ochan_rate(unsigned int id,
+                        const char *name,
+                        unsigned int start,
+                        unsigned int messages,
+                        unsigned long long total,
+                        void *obj)
+{
+  using namespace WineingMarketDataProto;
+
+  _ochan_ctx *c = (_ochan_ctx*)obj;
+  MarketData &m = c->m;
+
+  m.Clear();
+  m.set_type(MarketData::UNDERLYING_STATS);
+  m.set_symbol(name);
+  m.set_timestamp(start);
+  m.set_interval(c->rates->interval);
+  m.set_messages(messages);
+  _ochan_send(c, name, m);
+}
+
+/**
+ * Used by *ochan_thread*. Serializes and publishes a batch of
+ * records while it is still held by zmq.
+ *
+ * \return 0 if successful, -1 if the batch was empty (shutdown)
+ */
+static int _ochan_publish(void *data, size_t size, void *obj)
+{
+  using namespace WineingMarketDataProto;
+
+  _ochan_ctx *c = (_ochan_ctx*)obj;
+  MarketData &m = c->m;
+
+  if(0 == size) {
+    return -1;
+  }
+
+  const nxtape_orec *begin = (const nxtape_orec*)data;
+  const nxtape_orec *end = begin + size / sizeof(nxtape_orec);
+  if(NULL != c->quotes) {
+    _ochan_greeks(c, begin, end - begin);
+  }
+  for(const nxtape_orec *r = begin; r < end; r++) {
+    if(MarketData::SYMBOL != r->type) {
+      urate_roll(c->rates, r->clock, _ochan_rate, c);
+    }
+
+    m.Clear();
+    m.set_type((MarketData::Type)r->type);
+    switch(r->type)
+      {
+      case MarketData::STATUS:
+        // Only drives the rates, subscribers filter by underlying
+        continue;
+
+      case MarketData::SYMBOL:
+        m.set_symbol_id(r->symbol_id);
+        m.set_symbol(r->symbol);
+        m.set_listed_exg(r->exg);
+        if(r->deleted) {
+          m.set_deleted(true);
+        }
+        break;
+
+      case MarketData::QUOTE_EX:
+        m.set_symbol_id(r->symbol_id);
+        m.set_timestamp(r->timestamp);
+        m.set_price_type(r->price_type);
+        m.set_reporting_exg(r->exg);
+        m.set_bid_price(r->price);
+        m.set_ask_price(r->ask_price);
+        m.set_bid_size(r->size);
+        m.set_ask_size(r->ask_size);
+        if(NULL != c->quotes && 0 <= c->slots[r - begin]) {
+          long i = c->slots[r - begin];
+          if(greeks_valid(c->quotes, i)) {
+            m.set_iv(c->quotes->iv[i]);
+            m.set_delta(c->quotes->delta[i]);
+            m.set_gamma(c->quotes->gamma[i]);
+            m.set_vega(c->quotes->vega[i]);
+          }
+        }
+        urate_add(c->rates, r->underlying, r->topic);
+        break;
+
+      case MarketData::TRADE:
+        m.set_symbol_id(r->symbol_id);
+        m.set_timestamp(r->timestamp);
+        m.set_price_type(r->price_type);
+        m.set_reporting_exg(r->exg);
+        m.set_price(r->price);
+        m.set_size(r->size);
+        urate_add(c->rates, r->underlying, r->topic);
+        break;
+      }
+    _ochan_send(c, r->topic, m);
+  }
+  return 0;
+}
+
+void* ochan_thread(void *_arg)
+{
+  w_ochan_arg *arg = (w_ochan_arg*)_arg;
+  const char *fqcn = arg->ctx->conf->ochan_fqcns[arg->shard];
+  chan *ochan_inmem;
+  char name[32];
+  _ochan_ctx c;
+
+  log(LOG_INFO, "Initializing option partition %d thread (%s)",
+      arg->shard,
+      fqcn);
+
+  c.ochan = chan_init(fqcn, CHAN_TYPE_PUB);
+  if(0 > chan_bind(c.ochan)) {
+    log(LOG_ERROR, "Failed binding ochan (%s). Error [%s]",
+        fqcn,
+        chan_error());
+    sem_post(&g_inproc_bound);
+    return NULL;
+  }
+
+  snprintf(name, sizeof(name), "%s%d", DEFAULTS_OCHAN_ICHAN_NAME, arg->shard);
+  ochan_inmem = chan_init(name, CHAN_TYPE_PULL_BIND);
+  int rc = chan_bind(ochan_inmem);
+  sem_post(&g_inproc_bound);
+  if(0 > rc) {
+    log(LOG_ERROR, "Failed binding to ochan_inmem (%s). Error [%s]",
+        name,
+        chan_error());
+    return NULL;
+  }
+
+  c.rates = urate_init(DEFAULTS_URATE_CAPACITY, DEFAULTS_URATE_INTERVAL);
+  c.quotes = arg->ctx->conf->greeks ?
+    greeks_init(DEFAULTS_OCHAN_BATCH_SIZE, arg->ctx->conf->greeks_rate) :
+    NULL;
+
+  // Returns -1 on the empty batch sent by market_thread on shutdown
+  while(0 <= chan_recv(ochan_inmem, _ochan_publish, &c));
+
+  chan_destroy(ochan_inmem);
+  chan_destroy(c.ochan);
+  urate_destroy(c.rates);
+  if(NULL != c.quotes) {
+    greeks_destroy(c.quotes);
+  }
+
+  log(LOG_INFO, "Shutting down option partition %d thread", arg->shard);
+
+  return NULL;
+}
+
+void* cchan_out_thread(void *_ctx)
+{
+  w_ctx *ctx = (w_ctx *)_ctx;
+  chan *cchan_out;
+  int last = 0;
+
+  log(LOG_INFO, "Initializing control_out thread (%s)",
+      ctx->conf->cchan_out_fqcn);
+
+  // This is where we send Response messages to the
+  // client(s). ZMQ_PUB is a fan-out type socket.
+  cchan_out = chan_init(ctx->conf->cchan_out_fqcn, CHAN_TYPE_PUB);
+  int bound = 0 <= chan_bind(cchan_out);
+  if(!bound) {
+    // Keeps draining the queue, SHUTDOWN_OK and the sentinel are
+    // never dropped, see core/reply.h
+    log(LOG_ERROR, "Failed binding cchan_out (%s). Error [%s]",
+        ctx->conf->cchan_out_fqcn,
+        chan_error());
+  }
+
+  // The loop ends with SHUTDOWN_OK sent, not with SHUTDOWN set which
+  // happens before SHUTDOWN_OK is queued, or with the sentinel
+  while(!last) {
+    // Blocks until a Response is queued, see core/reply.h
+    reply_buf *b = reply_next();
+    if(NULL == b) {
+      break;
+    }
+    last = b->last;
 
-    // Send the data and free the buffer.
-    read = chan_send(cchan_out,
-                      buffer,
-                      read,
-                     _send_free);
-    if(0 > read) {
+    // The buffer goes to zmq as is and returns to the pool once it is
+    // on the wire. zmq doesn't take it if sending fails.
+    if(!bound) {
+      reply_free(b->data, b);
+    } else if(0 > chan_send(cchan_out, b->data, b->size, reply_free, b)) {
       log(LOG_WARN, "Sending control message failed. Error %s",
           chan_error());
+      reply_free(b->data, b);
     }
   }
 
   // Free all resources
-  chan_destroy(cchan_in_mem);
   chan_destroy(cchan_out);
   log(LOG_INFO, "Shutting down control_out thread");
 
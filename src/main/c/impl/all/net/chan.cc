@@ -2,6 +2,8 @@
 #include "net/chan.h"
 #include "log/logging.h"
 
+#include <stdint.h>
+
 using namespace std;
 
 /*
@@ -27,6 +29,8 @@ chan* chan_init(const char *fqcn, int type)
   chan *c = new chan;
   c->fqcn = fqcn;
   c->type = type;
+  c->sock = NULL;
+  c->hwm = 0;
 
   return c;
 }
@@ -57,6 +61,15 @@ int _to_zmq_type(int type)
     case CHAN_TYPE_REP:
       t = ZMQ_REP;
       break;
+    case CHAN_TYPE_XPUB:
+#if 3 <= ZMQ_VERSION_MAJOR
+      t = ZMQ_XPUB;
+#else
+      // zmq_socket fails, binding reports the error. 2.x XPUB binds
+      // but keeps the subscriptions to itself, see chan_xpub_supported
+      t = -1;
+#endif
+      break;
     }
 
   return t;
@@ -68,10 +81,16 @@ int chan_bind(chan *c)
 
   int rc = c->sock == NULL ? -1 : 0;
 
+  if(rc == 0 && 0 < c->hwm) {
+    uint64_t hwm = c->hwm;
+    rc = zmq_setsockopt(c->sock, ZMQ_HWM, &hwm, sizeof(hwm));
+  }
+
   if(rc == 0) {
     switch(c->type)
       {
       case CHAN_TYPE_PUB:
+      case CHAN_TYPE_XPUB:
       case CHAN_TYPE_REP:
       case CHAN_TYPE_PUSH_BIND:
       case CHAN_TYPE_PULL_BIND:
@@ -97,6 +116,16 @@ int chan_bind(chan *c)
   return rc;
 }
 
+int chan_set_hwm(chan *c, unsigned long long hwm)
+{
+  c->hwm = hwm;
+  if(NULL == c->sock) {
+    return 0;
+  }
+  uint64_t v = hwm;
+  return zmq_setsockopt(c->sock, ZMQ_HWM, &v, sizeof(v));
+}
+
 void chan_destroy(chan *c)
 {
   zmq_close(c->sock);
@@ -0,0 +1,146 @@
+#include "store/catalog.h"
+
+#include "log/logging.h"
+#include "nx/nxinf.h"
+
+#include <new>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+/**
+ * \struct
+ *
+ * State of *catalog_scan* passed to *_scan_add*.
+ */
+typedef struct
+{
+  catalog *c;
+  size_t dir_size;
+} _scan_ctx;
+
+catalog* catalog_init()
+{
+  catalog *c = new catalog;
+  memset(c, 0, sizeof(catalog));
+  return c;
+}
+
+void catalog_destroy(catalog *c)
+{
+  delete [] c->tapes;
+  delete c;
+}
+
+int catalog_parse(const char *name, catalog_tape *t)
+{
+  // <YYYYMMDD>.<feed>.<ext>, nothing but the extension after the feed
+  size_t size = strlen(name);
+  if(CATALOG_NAME_SIZE <= size || 10 > size || '.' != name[8]) {
+    return -1;
+  }
+  unsigned int date = 0;
+  for(int i = 0; i < 8; i++) {
+    if('0' > name[i] || '9' < name[i]) {
+      return -1;
+    }
+    date = date * 10 + name[i] - '0';
+  }
+
+  const char *feed = &name[9];
+  const char *dot = strchr(feed, '.');
+  if(NULL == dot
+     || feed == dot
+     || CATALOG_FEED_SIZE <= dot - feed
+     || '\0' == dot[1]
+     || NULL != strchr(dot + 1, '.')) {
+    return -1;
+  }
+
+  memset(t, 0, sizeof(catalog_tape));
+  memcpy(t->name, name, size);
+  memcpy(t->feed, feed, dot - feed);
+  t->date = date;
+  return 0;
+}
+
+/**
+ * Orders tapes by date, then name.
+ */
+static int _cmp(const void *_a, const void *_b)
+{
+  const catalog_tape *a = (const catalog_tape*)_a;
+  const catalog_tape *b = (const catalog_tape*)_b;
+  if(a->date != b->date) {
+    return a->date < b->date ? -1 : 1;
+  }
+  return strcmp(a->name, b->name);
+}
+
+/**
+ * Used by *wininf_file_glob*. Appends the tape at *path*, unsorted.
+ */
+static void _scan_add(const char *path, void *obj)
+{
+  _scan_ctx *s = (_scan_ctx*)obj;
+  catalog *c = s->c;
+  catalog_tape t;
+
+  if(0 > catalog_parse(&path[s->dir_size], &t)) {
+    return;
+  }
+  long long size = wininf_file_size(path);
+  if(0 > size) {
+    return;
+  }
+  t.size = size;
+
+  if(c->size == c->capacity) {
+    int capacity = 0 < c->capacity ? c->capacity << 1 : 64;
+    catalog_tape *tapes = new (std::nothrow) catalog_tape[capacity];
+    if(NULL == tapes) {
+      log(LOG_ERROR, "Failed adding tape '%s' to the catalog", path);
+      return;
+    }
+    if(NULL != c->tapes) {
+      memcpy(tapes, c->tapes, c->size * sizeof(catalog_tape));
+    }
+    delete [] c->tapes;
+    c->tapes = tapes;
+    c->capacity = capacity;
+  }
+  c->tapes[c->size++] = t;
+}
+
+int catalog_scan(catalog *c, const char *dir)
+{
+  _scan_ctx s = { c, strlen(dir) };
+  std::string pattern = std::string(dir) + "*";
+
+  c->size = 0;
+  wininf_file_glob(pattern.c_str(), _scan_add, &s);
+  qsort(c->tapes, c->size, sizeof(catalog_tape), _cmp);
+  return c->size;
+}
+
+const catalog_tape* catalog_find(const catalog *c, const char *name)
+{
+  catalog_tape key;
+  if(0 > catalog_parse(name, &key)) {
+    return NULL;
+  }
+  return (const catalog_tape*)
+    bsearch(&key, c->tapes, c->size, sizeof(catalog_tape), _cmp);
+}
+
+const catalog_tape* catalog_next(const catalog *c, const catalog_tape *t)
+{
+  // Few tapes share a date, the next day's follow closely
+  const catalog_tape *end = c->tapes + c->size;
+  for(const catalog_tape *n = t + 1; n < end; n++) {
+    if(n->date > t->date && 0 == strcmp(n->feed, t->feed)) {
+      return n;
+    }
+  }
+  return NULL;
+}
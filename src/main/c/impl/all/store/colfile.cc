@@ -0,0 +1,210 @@
+
+#include "store/colfile.h"
+
+#include <new>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <lz4.h>
+
+int colfile_write(const char *path,
+                  const void *data,
+                  size_t elem_size,
+                  uint64_t rows,
+                  uint32_t block_rows)
+{
+  if(0 == block_rows) {
+    block_rows = COLFILE_BLOCK_ROWS;
+  }
+
+  colfile_header h;
+  memset(&h, 0, sizeof(h));
+  h.magic = COLFILE_MAGIC;
+  h.version = COLFILE_VERSION;
+  h.elem_size = elem_size;
+  h.block_rows = block_rows;
+  h.rows = rows;
+  h.blocks = (rows + block_rows - 1) / block_rows;
+
+  FILE *f = fopen(path, "wb");
+  if(NULL == f) {
+    return -1;
+  }
+
+  size_t block_size = (size_t)block_rows * elem_size;
+  int bound = LZ4_compressBound(block_size);
+  colfile_block *blocks = new (std::nothrow) colfile_block[h.blocks + 1];
+  char *buffer = new (std::nothrow) char[bound];
+  int rc = 0;
+
+  if(NULL == blocks || NULL == buffer) {
+    rc = -1;
+    goto out;
+  }
+
+  // The block table is written once all blocks are, skip it
+  uint64_t offset;
+  offset = sizeof(h) + h.blocks * sizeof(colfile_block);
+  if(0 != fseek(f, offset, SEEK_SET)) {
+    rc = -1;
+    goto out;
+  }
+
+  for(uint32_t i = 0; i < h.blocks; i++) {
+    const char *src = (const char*)data + i * block_size;
+    size_t size = i + 1 < h.blocks ?
+      block_size : (rows - (uint64_t)i * block_rows) * elem_size;
+
+    int n = LZ4_compress_default(src, buffer, size, bound);
+    blocks[i].offset = offset;
+    if(0 < n && (size_t)n < size) {
+      blocks[i].size = n;
+      blocks[i].codec = COLFILE_CODEC_LZ4;
+      src = buffer;
+    } else {
+      blocks[i].size = size;
+      blocks[i].codec = COLFILE_CODEC_NONE;
+    }
+
+    if(1 != fwrite(src, blocks[i].size, 1, f)) {
+      rc = -1;
+      goto out;
+    }
+    offset += blocks[i].size;
+  }
+
+  if(0 != fseek(f, 0, SEEK_SET)
+     || 1 != fwrite(&h, sizeof(h), 1, f)
+     || (0 < h.blocks
+         && 1 != fwrite(blocks, h.blocks * sizeof(colfile_block), 1, f))) {
+    rc = -1;
+  }
+
+ out:
+  delete [] buffer;
+  delete [] blocks;
+  if(0 != fclose(f)) {
+    rc = -1;
+  }
+  return rc;
+}
+
+colfile* colfile_open(const char *path)
+{
+  int fd = open(path, O_RDONLY);
+  if(0 > fd) {
+    return NULL;
+  }
+
+  struct stat st;
+  if(0 > fstat(fd, &st) || (size_t)st.st_size < sizeof(colfile_header)) {
+    close(fd);
+    return NULL;
+  }
+
+  void *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if(MAP_FAILED == map) {
+    return NULL;
+  }
+
+  colfile *cf = new colfile;
+  cf->map = (const char*)map;
+  cf->map_size = st.st_size;
+  cf->header = (const colfile_header*)map;
+  cf->blocks = (const colfile_block*)&cf->map[sizeof(colfile_header)];
+  cf->scratch = NULL;
+  cf->scratch_block = -1;
+
+  const colfile_header *h = cf->header;
+  if(COLFILE_MAGIC != h->magic
+     || COLFILE_VERSION != h->version
+     || 0 == h->elem_size
+     || 0 == h->block_rows
+     || sizeof(colfile_header) + (uint64_t)h->blocks * sizeof(colfile_block)
+        > cf->map_size) {
+    colfile_close(cf);
+    return NULL;
+  }
+
+  cf->scratch = new (std::nothrow) char[(size_t)h->block_rows * h->elem_size];
+  if(NULL == cf->scratch) {
+    colfile_close(cf);
+    return NULL;
+  }
+  return cf;
+}
+
+void colfile_close(colfile *cf)
+{
+  munmap((void*)cf->map, cf->map_size);
+  delete [] cf->scratch;
+  delete cf;
+}
+
+const void* colfile_block_data(colfile *cf, uint32_t i, uint32_t *rows)
+{
+  const colfile_header *h = cf->header;
+  if(i >= h->blocks) {
+    return NULL;
+  }
+
+  const colfile_block &b = cf->blocks[i];
+  uint64_t n = h->rows - (uint64_t)i * h->block_rows;
+  *rows = n < h->block_rows ? n : h->block_rows;
+  size_t size = (size_t)*rows * h->elem_size;
+
+  if(b.offset + b.size > cf->map_size) {
+    return NULL;
+  }
+
+  switch(b.codec)
+    {
+    case COLFILE_CODEC_NONE:
+      return size == b.size ? &cf->map[b.offset] : NULL;
+
+    case COLFILE_CODEC_LZ4:
+      if(cf->scratch_block != i) {
+        cf->scratch_block = -1;
+        int r = LZ4_decompress_safe(&cf->map[b.offset],
+                                    cf->scratch,
+                                    b.size,
+                                    size);
+        if(r != (int)size) {
+          return NULL;
+        }
+        cf->scratch_block = i;
+      }
+      return cf->scratch;
+    }
+  return NULL;
+}
+
+int colfile_read(colfile *cf, uint64_t row, uint64_t n, void *dst)
+{
+  const colfile_header *h = cf->header;
+  if(row + n > h->rows || row + n < row) {
+    return -1;
+  }
+
+  char *out = (char*)dst;
+  while(0 < n) {
+    uint32_t rows;
+    uint32_t i = row / h->block_rows;
+    const char *b = (const char*)colfile_block_data(cf, i, &rows);
+    if(NULL == b) {
+      return -1;
+    }
+
+    uint64_t first = row - (uint64_t)i * h->block_rows;
+    uint64_t count = rows - first < n ? rows - first : n;
+    memcpy(out, &b[first * h->elem_size], count * h->elem_size);
+    out += count * h->elem_size;
+    row += count;
+    n -= count;
+  }
+  return 0;
+}
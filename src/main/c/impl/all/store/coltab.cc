@@ -0,0 +1,219 @@
+
+#include "store/coltab.h"
+
+#include <new>
+#include <stdio.h>
+#include <string.h>
+
+coltab* coltab_init(const char *const *names,
+                    const size_t *elem_sizes,
+                    int size)
+{
+  if(0 >= size || COLTAB_MAX_COLUMNS < size) {
+    return NULL;
+  }
+
+  coltab *t = new coltab;
+  memset(t, 0, sizeof(coltab));
+  t->size = size;
+  for(int i = 0; i < size; i++) {
+    t->columns[i].name = names[i];
+    t->columns[i].elem_size = elem_sizes[i];
+  }
+  return t;
+}
+
+void coltab_destroy(coltab *t)
+{
+  for(int i = 0; i < t->size; i++) {
+    delete [] t->columns[i].data;
+  }
+  delete [] t->ids;
+  delete t;
+}
+
+/**
+ * Grows array *a* of *elem_size* byte elements from *size* to
+ * *capacity* elements.
+ */
+static int _grow(char **a, size_t elem_size, uint64_t size, uint64_t capacity)
+{
+  char *n = new (std::nothrow) char[capacity * elem_size];
+  if(NULL == n) {
+    return -1;
+  }
+  if(NULL != *a) {
+    memcpy(n, *a, size * elem_size);
+  }
+  delete [] *a;
+  *a = n;
+  return 0;
+}
+
+int64_t coltab_append(coltab *t, uint32_t id)
+{
+  if(t->rows == t->capacity) {
+    uint64_t capacity = 0 < t->capacity ? t->capacity << 1 : 65536;
+    if(0 > _grow((char**)&t->ids, sizeof(uint32_t), t->rows, capacity)) {
+      return -1;
+    }
+    for(int i = 0; i < t->size; i++) {
+      coltab_column &c = t->columns[i];
+      if(0 > _grow(&c.data, c.elem_size, t->rows, capacity)) {
+        // Arrays grown so far are larger than capacity, harmless
+        return -1;
+      }
+    }
+    t->capacity = capacity;
+  }
+
+  t->ids[t->rows] = id;
+  return t->rows++;
+}
+
+/**
+ * Writes column *data* to <base>.<name>.col.
+ */
+static int _write_column(const char *base,
+                         const char *name,
+                         const void *data,
+                         size_t elem_size,
+                         uint64_t rows)
+{
+  char path[1024];
+  if((int)sizeof(path) <= snprintf(path, sizeof(path), "%s.%s.col", base, name)) {
+    return -1;
+  }
+  return colfile_write(path, data, elem_size, rows, COLFILE_BLOCK_ROWS);
+}
+
+/**
+ * Writes the index of the rows of each symbol to <base>.idx.
+ *
+ * \param first First row of each id, *ids* + 1 elements
+ */
+static int _write_index(const char *base,
+                        const uint64_t *first,
+                        uint32_t ids,
+                        uint64_t rows,
+                        const symtab *syms)
+{
+  char path[1024];
+  if((int)sizeof(path) <= snprintf(path, sizeof(path), "%s.idx", base)) {
+    return -1;
+  }
+
+  FILE *f = fopen(path, "wb");
+  if(NULL == f) {
+    return -1;
+  }
+
+  coltab_index_header h;
+  memset(&h, 0, sizeof(h));
+  h.magic = COLTAB_INDEX_MAGIC;
+  h.version = COLTAB_INDEX_VERSION;
+  h.rows = rows;
+  for(uint32_t id = 0; id < ids; id++) {
+    if(first[id + 1] > first[id]) {
+      h.symbols++;
+    }
+  }
+
+  int rc = 1 == fwrite(&h, sizeof(h), 1, f) ? 0 : -1;
+  for(uint32_t id = 0; 0 == rc && id < ids; id++) {
+    if(first[id + 1] == first[id]) {
+      continue;
+    }
+
+    coltab_index_entry e;
+    memset(&e, 0, sizeof(e));
+    e.id = id;
+    e.first = first[id];
+    e.rows = first[id + 1] - first[id];
+    const symtab_entry *s = id < syms->size ? symtab_get(syms, id) : NULL;
+    if(NULL != s) {
+      memcpy(e.name, s->name, SYMTAB_NAME_SIZE);
+      e.exg = s->exg;
+      e.flags = s->flags;
+    }
+    if(1 != fwrite(&e, sizeof(e), 1, f)) {
+      rc = -1;
+    }
+  }
+
+  if(0 != fclose(f)) {
+    rc = -1;
+  }
+  return rc;
+}
+
+int coltab_write(coltab *t, const char *base, const symtab *syms)
+{
+  uint32_t ids = syms->size;
+  for(uint64_t r = 0; r < t->rows; r++) {
+    if(t->ids[r] >= ids) {
+      ids = t->ids[r] + 1;
+    }
+  }
+
+  // Stable counting sort, ids are dense. *first* ends up holding the
+  // first row of each id, *dst* the sorted position of each row.
+  uint64_t *first = new (std::nothrow) uint64_t[ids + 1];
+  uint64_t *dst = new (std::nothrow) uint64_t[t->rows + 1];
+  char *sorted = NULL;
+  int rc = -1;
+  if(NULL == first || NULL == dst) {
+    goto out;
+  }
+
+  memset(first, 0, (ids + 1) * sizeof(uint64_t));
+  for(uint64_t r = 0; r < t->rows; r++) {
+    first[t->ids[r] + 1]++;
+  }
+  for(uint32_t id = 0; id < ids; id++) {
+    first[id + 1] += first[id];
+  }
+  for(uint64_t r = 0; r < t->rows; r++) {
+    // Uses first[id] as cursor, restored below
+    dst[r] = first[t->ids[r]]++;
+  }
+  for(uint32_t id = ids; 0 < id; id--) {
+    first[id] = first[id - 1];
+  }
+  first[0] = 0;
+
+  // One column at a time to bound memory
+  size_t max_elem_size;
+  max_elem_size = sizeof(uint32_t);
+  for(int i = 0; i < t->size; i++) {
+    if(t->columns[i].elem_size > max_elem_size) {
+      max_elem_size = t->columns[i].elem_size;
+    }
+  }
+  sorted = new (std::nothrow) char[(t->rows + 1) * max_elem_size];
+  if(NULL == sorted) {
+    goto out;
+  }
+
+  for(int i = -1; i < t->size; i++) {
+    const char *name = 0 > i ? "symbol_id" : t->columns[i].name;
+    const char *data = 0 > i ? (const char*)t->ids : t->columns[i].data;
+    size_t elem_size = 0 > i ? sizeof(uint32_t) : t->columns[i].elem_size;
+
+    for(uint64_t r = 0; r < t->rows; r++) {
+      memcpy(&sorted[dst[r] * elem_size], &data[r * elem_size], elem_size);
+    }
+    if(0 > _write_column(base, name, sorted, elem_size, t->rows)) {
+      goto out;
+    }
+  }
+
+  rc = _write_index(base, first, ids, t->rows, syms);
+  t->rows = 0;
+
+ out:
+  delete [] sorted;
+  delete [] dst;
+  delete [] first;
+  return rc;
+}
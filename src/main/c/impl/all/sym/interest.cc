@@ -0,0 +1,131 @@
+#include "sym/interest.h"
+
+#include <string.h>
+
+interest* interest_init()
+{
+  interest *in = new interest;
+  memset(in, 0, sizeof(interest));
+  in->filter = symfilter_init();
+  return in;
+}
+
+void interest_destroy(interest *in)
+{
+  symfilter_destroy(in->filter);
+  delete [] in->topics;
+  delete in;
+}
+
+/**
+ * \return The topic named *name* or NULL if nobody subscribed to it
+ */
+static interest_topic* _find(interest *in, const char *name, int exact)
+{
+  for(unsigned int i = 0; i < in->topics_size; i++) {
+    interest_topic *t = &in->topics[i];
+    if(exact == t->exact && 0 == strcmp(name, t->name)) {
+      return t;
+    }
+  }
+  return NULL;
+}
+
+/**
+ * Appends a topic without subscriptions. Grows in powers of two.
+ */
+static interest_topic* _add(interest *in, const char *name, int exact)
+{
+  if(in->topics_size == in->topics_capacity) {
+    unsigned int capacity = 0 < in->topics_capacity ?
+      in->topics_capacity << 1 : 16;
+    interest_topic *grown = new interest_topic[capacity];
+    if(0 < in->topics_size) {
+      memcpy(grown, in->topics, in->topics_size * sizeof(interest_topic));
+    }
+    delete [] in->topics;
+    in->topics = grown;
+    in->topics_capacity = capacity;
+  }
+
+  interest_topic *t = &in->topics[in->topics_size++];
+  strcpy(t->name, name);
+  t->exact = exact;
+  t->refs = 0;
+  return t;
+}
+
+int interest_update(interest *in, const char *msg, size_t size)
+{
+  if(0 == size || 1 < (unsigned char)msg[0]) {
+    return -1;
+  }
+  int subscribe = msg[0];
+
+  // Symbols end in the NULL byte, prefixes don't
+  const char *topic = &msg[1];
+  size_t topic_size = size - 1;
+  size_t name_size = strnlen(topic, topic_size);
+  int exact = name_size < topic_size;
+  if(SYMTAB_NAME_SIZE <= name_size) {
+    return -1;
+  }
+
+  char name[SYMTAB_NAME_SIZE];
+  memcpy(name, topic, name_size);
+  name[name_size] = '\0';
+
+  interest_topic *t = _find(in, name, exact);
+  if(subscribe) {
+    if(NULL == t) {
+      t = _add(in, name, exact);
+    }
+    t->refs++;
+  } else if(NULL != t && 0 == --t->refs) {
+    // Order doesn't matter, the last one takes its place
+    *t = in->topics[--in->topics_size];
+  } else {
+    return 0;
+  }
+  in->changed = 1;
+  return 0;
+}
+
+void interest_clear(interest *in)
+{
+  in->topics_size = 0;
+  in->changed = 1;
+}
+
+void interest_compile(interest *in)
+{
+  if(!in->changed) {
+    return;
+  }
+
+  symfilter_destroy(in->filter);
+  in->filter = symfilter_init();
+  in->all = 0;
+  for(unsigned int i = 0; i < in->topics_size; i++) {
+    const interest_topic *t = &in->topics[i];
+    if(t->exact) {
+      symfilter_add_symbol(in->filter, t->name);
+    } else if('\0' == t->name[0]) {
+      in->all = 1;
+    } else {
+      symfilter_add_prefix(in->filter, t->name);
+    }
+  }
+  symfilter_compile(in->filter);
+  in->changed = 0;
+}
+
+int interest_eval(interest *in,
+                  unsigned int id,
+                  const char *name,
+                  unsigned short exg,
+                  int option)
+{
+  int pass = symfilter_eval(in->filter, name, exg, option, 0);
+  return symfilter_set(in->filter, id, pass);
+}
@@ -0,0 +1,187 @@
+
+#include "sym/symfilter.h"
+
+#include <new>
+#include <stdlib.h>
+#include <string.h>
+
+symfilter* symfilter_init()
+{
+  symfilter *f = new symfilter;
+  memset(f, 0, sizeof(symfilter));
+  f->any_exchange = 1;
+  f->types = 0xffffffff;
+  return f;
+}
+
+static void _free_list(char **list, unsigned int size)
+{
+  for(unsigned int i = 0; i < size; i++) {
+    free(list[i]);
+  }
+  delete [] list;
+}
+
+void symfilter_destroy(symfilter *f)
+{
+  _free_list(f->symbols, f->symbols_size);
+  _free_list(f->prefixes, f->prefixes_size);
+  _free_list(f->roots, f->roots_size);
+  delete [] f->state;
+  delete f;
+}
+
+/**
+ * Appends a copy of *s* to *list*. Grows in powers of two.
+ */
+static void _add(char ***list, unsigned int *size, const char *s)
+{
+  unsigned int n = *size;
+  if(0 == (n & (n - 1))) {
+    char **grown = new char*[0 < n ? n << 1 : 1];
+    if(0 < n) {
+      memcpy(grown, *list, n * sizeof(char*));
+    }
+    delete [] *list;
+    *list = grown;
+  }
+  (*list)[n] = strdup(s);
+  *size = n + 1;
+}
+
+void symfilter_add_symbol(symfilter *f, const char *name)
+{
+  _add(&f->symbols, &f->symbols_size, name);
+}
+
+void symfilter_add_prefix(symfilter *f, const char *prefix)
+{
+  _add(&f->prefixes, &f->prefixes_size, prefix);
+}
+
+void symfilter_add_root(symfilter *f, const char *root)
+{
+  _add(&f->roots, &f->roots_size, root);
+}
+
+void symfilter_add_exchange(symfilter *f, unsigned int exg)
+{
+  if(exg < SYMFILTER_MAX_EXG) {
+    f->exchanges[exg >> 5] |= 1u << (exg & 31);
+    f->any_exchange = 0;
+  }
+}
+
+void symfilter_add_type(symfilter *f, int type)
+{
+  if(0 > type || 32 <= type) {
+    return;
+  }
+  // The first type added drops all others
+  if(0xffffffff == f->types) {
+    f->types = 0;
+  }
+  f->types |= 1u << type;
+}
+
+void symfilter_set_expiry(symfilter *f, uint32_t from, uint32_t to)
+{
+  f->expiry_from = from;
+  f->expiry_to = to;
+}
+
+static int _cmp(const void *a, const void *b)
+{
+  return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+void symfilter_compile(symfilter *f)
+{
+  if(0 < f->symbols_size) {
+    qsort(f->symbols, f->symbols_size, sizeof(char*), _cmp);
+  }
+  if(0 < f->roots_size) {
+    qsort(f->roots, f->roots_size, sizeof(char*), _cmp);
+  }
+  symfilter_reset(f);
+}
+
+/**
+ * \return 1 if *name* is in the sorted *list*
+ */
+static int _contains(char **list, unsigned int size, const char *name)
+{
+  return 0 < size
+    && NULL != bsearch(&name, list, size, sizeof(char*), _cmp);
+}
+
+int symfilter_eval(const symfilter *f,
+                   const char *name,
+                   unsigned short exg,
+                   int option,
+                   uint32_t expiry)
+{
+  if(!f->any_exchange
+     && (exg >= SYMFILTER_MAX_EXG
+         || 0 == (f->exchanges[exg >> 5] & (1u << (exg & 31))))) {
+    return 0;
+  }
+
+  if(option
+     && ((0 < f->expiry_from && expiry < f->expiry_from)
+         || (0 < f->expiry_to && expiry > f->expiry_to))) {
+    return 0;
+  }
+
+  if(0 == f->symbols_size && 0 == f->prefixes_size && 0 == f->roots_size) {
+    return 1;
+  }
+
+  if(_contains(f->symbols, f->symbols_size, name)
+     || (option && _contains(f->roots, f->roots_size, name))) {
+    return 1;
+  }
+
+  for(unsigned int i = 0; i < f->prefixes_size; i++) {
+    if(0 == strncmp(name, f->prefixes[i], strlen(f->prefixes[i]))) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+int symfilter_set(symfilter *f, unsigned int id, int pass)
+{
+  int state = pass ? SYMFILTER_PASS : SYMFILTER_DROP;
+
+  if(id >= f->capacity) {
+    unsigned int capacity = 0 < f->capacity ? f->capacity : 1024;
+    while(capacity <= id) {
+      capacity <<= 1;
+    }
+    uint32_t *grown = new (std::nothrow) uint32_t[capacity >> 4];
+    if(NULL == grown) {
+      // Evaluated again next time
+      return state;
+    }
+    memset(grown, 0, (capacity >> 4) * sizeof(uint32_t));
+    if(NULL != f->state) {
+      memcpy(grown, f->state, (f->capacity >> 4) * sizeof(uint32_t));
+    }
+    delete [] f->state;
+    f->state = grown;
+    f->capacity = capacity;
+  }
+
+  int shift = (id & 15) << 1;
+  f->state[id >> 4] = (f->state[id >> 4] & ~(3u << shift))
+    | ((uint32_t)state << shift);
+  return state;
+}
+
+void symfilter_reset(symfilter *f)
+{
+  if(NULL != f->state) {
+    memset(f->state, 0, (f->capacity >> 4) * sizeof(uint32_t));
+  }
+}
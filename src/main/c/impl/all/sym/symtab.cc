@@ -0,0 +1,242 @@
+
+#include "sym/symtab.h"
+#include "log/logging.h"
+
+#include <new>
+#include <string.h>
+
+/**
+ * FNV-1a over the symbol name and the listed exchange. Cheap and good
+ * enough for the short keys we see. Only the part of the name that
+ * fits into symtab_entry.name is hashed.
+ */
+static inline unsigned int _hash(const char *name, unsigned short exg)
+{
+  unsigned int h = 2166136261u;
+  const unsigned char *c = (const unsigned char*)name;
+  for(int i = 0; *c && i < SYMTAB_NAME_SIZE - 1; c++, i++) {
+    h = (h ^ *c) * 16777619u;
+  }
+  h = (h ^ (exg & 0xff)) * 16777619u;
+  h = (h ^ (exg >> 8)) * 16777619u;
+  return h;
+}
+
+/**
+ * Distance of the slot at *pos* from its home slot.
+ */
+static inline unsigned int _dist(const symtab *t, unsigned int pos)
+{
+  return (pos - (t->slots[pos].hash & t->mask)) & t->mask;
+}
+
+static inline int _equals(const symtab_entry *e,
+                          const char *name,
+                          unsigned short exg)
+{
+  return e->exg == exg
+    && 0 == strncmp(e->name, name, SYMTAB_NAME_SIZE - 1);
+}
+
+/**
+ * Robin-hood insert. An entry is displaced from its slot if it is
+ * closer to its home slot than the one being inserted.
+ */
+static void _slot_insert(symtab *t, unsigned int hash, unsigned int id)
+{
+  symtab_slot s = { hash, id };
+  unsigned int pos = hash & t->mask;
+  unsigned int dist = 0;
+
+  while(SYMTAB_NONE != t->slots[pos].id) {
+    unsigned int d = _dist(t, pos);
+    if(d < dist) {
+      symtab_slot tmp = t->slots[pos];
+      t->slots[pos] = s;
+      s = tmp;
+      dist = d;
+    }
+    pos = (pos + 1) & t->mask;
+    dist++;
+  }
+  t->slots[pos] = s;
+}
+
+/**
+ * \return The slot holding the key or SYMTAB_NONE
+ */
+static unsigned int _slot_find(const symtab *t,
+                               unsigned int hash,
+                               const char *name,
+                               unsigned short exg)
+{
+  unsigned int pos = hash & t->mask;
+  unsigned int dist = 0;
+
+  while(SYMTAB_NONE != t->slots[pos].id) {
+    // Robin-hood invariant: had the key been inserted it would have
+    // displaced this slot.
+    if(_dist(t, pos) < dist) {
+      break;
+    }
+    if(t->slots[pos].hash == hash
+       && _equals(&t->entries[t->slots[pos].id], name, exg)) {
+      return pos;
+    }
+    pos = (pos + 1) & t->mask;
+    dist++;
+  }
+  return SYMTAB_NONE;
+}
+
+/**
+ * Removes the slot at *pos* by shifting the following slots back
+ * until one sits in its home slot. No tombstones required.
+ */
+static void _slot_remove(symtab *t, unsigned int pos)
+{
+  unsigned int next = (pos + 1) & t->mask;
+
+  while(SYMTAB_NONE != t->slots[next].id && 0 < _dist(t, next)) {
+    t->slots[pos] = t->slots[next];
+    pos = next;
+    next = (next + 1) & t->mask;
+  }
+  t->slots[pos].id = SYMTAB_NONE;
+}
+
+static int _alloc(symtab *t, unsigned int capacity)
+{
+  symtab_entry *entries = new (std::nothrow) symtab_entry[capacity];
+  symtab_slot *slots = new (std::nothrow) symtab_slot[capacity * 2];
+  if(NULL == entries || NULL == slots) {
+    delete [] entries;
+    delete [] slots;
+    return -1;
+  }
+
+  if(NULL != t->entries) {
+    memcpy(entries, t->entries, t->size * sizeof(symtab_entry));
+    delete [] t->entries;
+    delete [] t->slots;
+  }
+
+  t->entries = entries;
+  t->capacity = capacity;
+  t->slots = slots;
+  t->mask = capacity * 2 - 1;
+  memset(t->slots, 0xff, capacity * 2 * sizeof(symtab_slot));
+
+  // Rehash the live entries
+  for(unsigned int id = 0; id < t->size; id++) {
+    const symtab_entry *e = &t->entries[id];
+    if(0 == (e->flags & SYMTAB_FLAG_DELETED)) {
+      _slot_insert(t, _hash(e->name, e->exg), id);
+    }
+  }
+  return 0;
+}
+
+symtab* symtab_init(unsigned int capacity)
+{
+  unsigned int c = 16;
+  while(c < capacity) {
+    c <<= 1;
+  }
+
+  symtab *t = new symtab;
+  t->entries = NULL;
+  t->slots = NULL;
+  t->size = 0;
+  if(0 > _alloc(t, c)) {
+    delete t;
+    return NULL;
+  }
+  return t;
+}
+
+void symtab_destroy(symtab *t)
+{
+  delete [] t->entries;
+  delete [] t->slots;
+  delete t;
+}
+
+unsigned int symtab_intern(symtab *t,
+                           const char *name,
+                           unsigned short exg,
+                           int *added)
+{
+  unsigned int hash = _hash(name, exg);
+  unsigned int pos = _slot_find(t, hash, name, exg);
+
+  if(NULL != added) {
+    *added = 0;
+  }
+  if(SYMTAB_NONE != pos) {
+    return t->slots[pos].id;
+  }
+
+  // Ids are never reused thus we grow on size, not on the number of
+  // live entries.
+  if(t->size == t->capacity && 0 > _alloc(t, t->capacity * 2)) {
+    log(LOG_ERROR, "Failed growing symbol table beyond %u entries",
+        t->capacity);
+    return SYMTAB_NONE;
+  }
+
+  unsigned int id = t->size++;
+  symtab_entry *e = &t->entries[id];
+  strncpy(e->name, name, SYMTAB_NAME_SIZE - 1);
+  e->name[SYMTAB_NAME_SIZE - 1] = '\0';
+  e->exg = exg;
+  e->flags = 0;
+  _slot_insert(t, _hash(e->name, exg), id);
+
+  if(NULL != added) {
+    *added = 1;
+  }
+  return id;
+}
+
+unsigned int symtab_find(const symtab *t,
+                         const char *name,
+                         unsigned short exg)
+{
+  unsigned int pos = _slot_find(t, _hash(name, exg), name, exg);
+  return SYMTAB_NONE == pos ? SYMTAB_NONE : t->slots[pos].id;
+}
+
+int symtab_rename(symtab *t,
+                  unsigned int id,
+                  const char *name,
+                  unsigned short exg)
+{
+  if(id >= t->size || SYMTAB_NONE != symtab_find(t, name, exg)) {
+    return -1;
+  }
+
+  symtab_entry *e = &t->entries[id];
+  if(0 == (e->flags & SYMTAB_FLAG_DELETED)) {
+    _slot_remove(t, _slot_find(t, _hash(e->name, e->exg), e->name, e->exg));
+  }
+
+  strncpy(e->name, name, SYMTAB_NAME_SIZE - 1);
+  e->name[SYMTAB_NAME_SIZE - 1] = '\0';
+  e->exg = exg;
+  e->flags &= ~SYMTAB_FLAG_DELETED;
+  _slot_insert(t, _hash(e->name, exg), id);
+  return 0;
+}
+
+int symtab_remove(symtab *t, unsigned int id)
+{
+  if(id >= t->size || (t->entries[id].flags & SYMTAB_FLAG_DELETED)) {
+    return -1;
+  }
+
+  symtab_entry *e = &t->entries[id];
+  _slot_remove(t, _slot_find(t, _hash(e->name, e->exg), e->name, e->exg));
+  e->flags |= SYMTAB_FLAG_DELETED;
+  return 0;
+}
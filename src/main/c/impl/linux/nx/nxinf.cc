@@ -5,12 +5,24 @@
 
 #include "nx/nxinf.h"
 
+#include <fcntl.h>
+#include <glob.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
 int wininf_nxcore_load()
 {
   return 0;
 }
 
 int wininf_nxcore_run(char *tape,
+                      int user_data,
+                      unsigned int flags,
                       int STDCALL (*fn) (const NxCoreSystem *,
                                          const NxCoreMessage *))
 {
@@ -22,7 +34,97 @@ void wininf_nxcore_free()
 
 }
 
+double wininf_nxcore_price(int price, unsigned char price_type)
+{
+  // Decimal price types only, the number of decimal places
+  double d = price;
+  for(int i = 0; i < price_type && i < 9; i++) {
+    d /= 10;
+  }
+  return d;
+}
+
+int wininf_nxcore_save_state(const char *path)
+{
+  return 0;
+}
+
+int wininf_nxcore_path(const char *path, char *out, size_t size)
+{
+  if(size <= (size_t)snprintf(out, size, "%s", path)) {
+    return -1;
+  }
+  return 0;
+}
+
 int wininf_file_exists(const char *str)
 {
   return 0;
 }
+
+long long wininf_file_size(const char *path)
+{
+  struct stat st;
+  if(0 > stat(path, &st)) {
+    return -1;
+  }
+  return st.st_size;
+}
+
+int wininf_file_prefetch(const char *path)
+{
+  int fd = open(path, O_RDONLY);
+  if(0 > fd) {
+    return -1;
+  }
+  int rc = posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+  close(fd);
+  return 0 == rc ? 0 : -1;
+}
+
+int wininf_file_glob(const char *pattern,
+                     void (*fn) (const char *path, void *obj),
+                     void *obj)
+{
+  glob_t g;
+  if(0 != glob(pattern, 0, NULL, &g)) {
+    return 0;
+  }
+
+  for(size_t i = 0; i < g.gl_pathc; i++) {
+    fn(g.gl_pathv[i], obj);
+  }
+
+  int count = g.gl_pathc;
+  globfree(&g);
+  return count;
+}
+
+void* wininf_spawn_self(const char *const *args)
+{
+  int argc = 0;
+  while(NULL != args[argc]) {
+    argc++;
+  }
+
+  pid_t pid = fork();
+  if(0 == pid) {
+    const char **argv = new const char*[argc + 2];
+    argv[0] = "wineing";
+    for(int i = 0; i <= argc; i++) {
+      argv[i + 1] = args[i];
+    }
+    execv("/proc/self/exe", (char *const *)argv);
+    _exit(127);
+  }
+  return 0 < pid ? (void*)(intptr_t)pid : NULL;
+}
+
+int wininf_wait(void *process)
+{
+  int status;
+  if(0 > waitpid((pid_t)(intptr_t)process, &status, 0)) {
+    return -1;
+  }
+  return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
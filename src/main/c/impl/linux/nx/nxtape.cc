@@ -9,6 +9,9 @@
 #include "nx/nxtape.h"
 
 #include "net/chan.h"
+#include "store/coltab.h"
+
+#include <string>
 
 int STDCALL nxtape_process(const NxCoreSystem *pNxCoreSys,
                            const NxCoreMessage *pNxCoreMsg)
@@ -17,7 +20,72 @@ int STDCALL nxtape_process(const NxCoreSystem *pNxCoreSys,
   return 0;
 }
 
-void nxtape_init(chan *cchan_out, chan *mchan)
+void nxtape_init(const w_conf *conf, int rslot)
+{
+  // do nothing
+}
+
+void nxtape_batch_init(chan *mchan_batch)
+{
+  // do nothing
+}
+
+void nxtape_bars_init()
+{
+  // do nothing
+}
+
+void nxtape_nbbo_init(chan *nchan)
+{
+  // do nothing
+}
+
+void nxtape_ochan_init(chan **ochan, int size)
+{
+  // do nothing
+}
+
+void nxtape_checkpoint_init(checkpoint *c)
+{
+  // do nothing
+}
+
+long nxtape_checkpoint_restore(checkpoint *c, int slot)
+{
+  // do nothing
+  return -1;
+}
+
+long nxtape_replay(const char *tape, const char *journal)
+{
+  // do nothing
+  return 0;
+}
+
+long nxtape_columnar(const char *tape, const char *base)
+{
+  // A tape of a single trade, converted without *nxtape_init* having
+  // run like the Windows version
+  static const char *names[] = { "timestamp", "price" };
+  static const size_t sizes[] = { sizeof(uint32_t), sizeof(int32_t) };
+
+  symtab *syms = symtab_init(1);
+  coltab *trades = coltab_init(names, sizes, 2);
+  int added;
+  unsigned int id = symtab_intern(syms, "eSYN", 14, &added);
+  int64_t row = coltab_append(trades, id);
+  *(uint32_t*)coltab_at(trades, 0, row) = 34200000;
+  *(int32_t*)coltab_at(trades, 1, row) = 10000;
+
+  std::string path (base);
+  long rc = 0 > coltab_write(trades, (path + ".trade").c_str(), syms) ? -1 : 1;
+  coltab_destroy(trades);
+  symtab_destroy(syms);
+  return rc;
+}
+
+int nxtape_embed(const char *tape, unsigned int flags, embed *e)
 {
   // do nothing
+  return 0;
 }
@@ -2,13 +2,29 @@
 #include "nx/nxinf.h"
 
 #include <windows.h>
+#include <fcntl.h>
 #include <stdio.h>
+#include <string.h>
+#include <string>
+#include <unistd.h>
 
 #include "NxCoreAPI.h"
 #include "log/logging.h"
 
 static HINSTANCE g_hlib;
 
+// NxCore's sNxCorePriceToDouble
+typedef double (__stdcall *_priceToDoubleFn) (int price,
+                                               unsigned char price_type);
+static _priceToDoubleFn g_price_fn;
+
+// Wine's kernel32 extension mapping a DOS path to the Unix one,
+// allocated on the process heap
+typedef char* (CDECL *_unixPathFn) (LPCWSTR dos);
+
+// Its inverse, allocated on the process heap as well
+typedef WCHAR* (CDECL *_dosPathFn) (const char *unix_path);
+
 int wininf_nxcore_load()
 {
   log(LOG_DEBUG, "Loading NxCoreAPI64.dll");
@@ -21,10 +37,19 @@ int wininf_nxcore_load()
     return -1;
   }
 
+  g_price_fn = (_priceToDoubleFn) ::GetProcAddress(g_hlib,
+                                                   "sNxCorePriceToDouble");
+  if(!g_price_fn) {
+    log(LOG_ERROR, "Failed loading NxCorePriceToDouble function");
+    return -1;
+  }
+
   return 0;
 }
 
 int wininf_nxcore_run(char *tape,
+                      int user_data,
+                      unsigned int flags,
                       int __stdcall (*fn) (const NxCoreSystem *,
                                            const NxCoreMessage *))
 {
@@ -35,9 +60,28 @@ int wininf_nxcore_run(char *tape,
     return -1;
   }
 
-  processTapeFn(tape, 0, 0, 0, fn);
+  unsigned int control = 0;
+  if(flags & WININF_NXCORE_EXCLUDE_QUOTES) {
+    control |= NxCF_EXCLUDE_QUOTES;
+  }
+  if(flags & WININF_NXCORE_EXCLUDE_MM_QUOTES) {
+    control |= NxCF_EXCLUDE_QUOTES2;
+  }
+  if(flags & WININF_NXCORE_EXCLUDE_OPRA) {
+    control |= NxCF_EXCLUDE_OPRA;
+  }
+  if(flags & WININF_NXCORE_NO_CRC_CHECK) {
+    control |= NxCF_EXCLUDE_CRC_CHECK;
+  }
 
-  return 0;
+  int rc = processTapeFn(tape, 0, control, user_data, fn);
+  if(NxAPIERR_NOERROR == rc) {
+    return 0;
+  }
+  if(NxAPIERR_USER_STOPPED != rc) {
+    log(LOG_ERROR, "NxCore failed processing '%s' (%d)", tape, rc);
+  }
+  return -1;
 }
 
 void wininf_nxcore_free()
@@ -45,6 +89,39 @@ void wininf_nxcore_free()
   ::FreeLibrary(g_hlib);
 }
 
+double wininf_nxcore_price(int price, unsigned char price_type)
+{
+  return g_price_fn(price, price_type);
+}
+
+int wininf_nxcore_save_state(const char *path)
+{
+  NxCoreSaveState saveStateFn =
+    (NxCoreSaveState) ::GetProcAddress(g_hlib, "sNxCoreSaveState");
+  if(!saveStateFn) {
+    log(LOG_ERROR, "Failed loading NxCoreSaveState function");
+    return -1;
+  }
+  return 0 == saveStateFn(path, NxSAVESTATE_ONEPASS) ? 0 : -1;
+}
+
+int wininf_nxcore_path(const char *path, char *out, size_t size)
+{
+  static _dosPathFn dos_path = (_dosPathFn)
+    ::GetProcAddress(::GetModuleHandle("kernel32.dll"),
+                     "wine_get_dos_file_name");
+  if(NULL == dos_path) {
+    return -1;
+  }
+  WCHAR *p = dos_path(path);
+  if(NULL == p) {
+    return -1;
+  }
+  int rc = WideCharToMultiByte(CP_ACP, 0, p, -1, out, size, NULL, NULL);
+  HeapFree(GetProcessHeap(), 0, p);
+  return 0 < rc ? 0 : -1;
+}
+
 int wininf_file_exists(const char *str)
 {
   DWORD attrs = GetFileAttributes(str);
@@ -54,3 +131,111 @@ int wininf_file_exists(const char *str)
   }
   return 0;
 }
+
+long long wininf_file_size(const char *path)
+{
+  WIN32_FILE_ATTRIBUTE_DATA data;
+  if(!GetFileAttributesEx(path, GetFileExInfoStandard, &data)) {
+    return -1;
+  }
+  return ((long long)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+}
+
+int wininf_file_prefetch(const char *path)
+{
+  // Windows has no equivalent of posix_fadvise, the Unix file behind
+  // the DOS path is advised instead
+  static _unixPathFn unix_path = (_unixPathFn)
+    ::GetProcAddress(::GetModuleHandle("kernel32.dll"),
+                     "wine_get_unix_file_name");
+  WCHAR dos[MAX_PATH];
+  if(NULL == unix_path
+     || 0 == MultiByteToWideChar(CP_ACP, 0, path, -1, dos, MAX_PATH)) {
+    return -1;
+  }
+  char *p = unix_path(dos);
+  if(NULL == p) {
+    return -1;
+  }
+
+  int fd = open(p, O_RDONLY);
+  HeapFree(GetProcessHeap(), 0, p);
+  if(0 > fd) {
+    return -1;
+  }
+  int rc = posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+  close(fd);
+  return 0 == rc ? 0 : -1;
+}
+
+int wininf_file_glob(const char *pattern,
+                     void (*fn) (const char *path, void *obj),
+                     void *obj)
+{
+  WIN32_FIND_DATA fd;
+  char path[MAX_PATH];
+  int count = 0;
+
+  // FindFirstFile only returns file names, prefix them with the
+  // pattern's directory
+  const char *sep = strrchr(pattern, '\\');
+  int dir = NULL == sep ? 0 : sep - pattern + 1;
+
+  HANDLE h = FindFirstFile(pattern, &fd);
+  if(INVALID_HANDLE_VALUE == h) {
+    return 0;
+  }
+
+  do {
+    if(fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+      continue;
+    }
+    snprintf(path, sizeof(path), "%.*s%s", dir, pattern, fd.cFileName);
+    fn(path, obj);
+    count++;
+  } while(FindNextFile(h, &fd));
+
+  FindClose(h);
+  return count;
+}
+
+void* wininf_spawn_self(const char *const *args)
+{
+  char path[MAX_PATH];
+  if(0 == GetModuleFileName(NULL, path, sizeof(path))) {
+    log(LOG_ERROR, "Failed resolving the program. Reason %d",
+        GetLastError());
+    return NULL;
+  }
+
+  // The arguments are quoted, none of ours contains a quote
+  std::string cmdline = std::string("\"") + path + "\"";
+  for(int i = 0; NULL != args[i]; i++) {
+    cmdline += std::string(" \"") + args[i] + "\"";
+  }
+
+  STARTUPINFO si;
+  PROCESS_INFORMATION pi;
+  memset(&si, 0, sizeof(si));
+  si.cb = sizeof(si);
+  if(!CreateProcess(path, &cmdline[0], NULL, NULL, 0, 0, NULL, NULL,
+                    &si, &pi)) {
+    log(LOG_ERROR, "Failed starting '%s'. Reason %d", path, GetLastError());
+    return NULL;
+  }
+
+  CloseHandle(pi.hThread);
+  return pi.hProcess;
+}
+
+int wininf_wait(void *process)
+{
+  DWORD code;
+  int rc = -1;
+  if(WAIT_FAILED != WaitForSingleObject(process, INFINITE)
+     && GetExitCodeProcess(process, &code)) {
+    rc = code;
+  }
+  CloseHandle(process);
+  return rc;
+}
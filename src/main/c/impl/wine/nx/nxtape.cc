@@ -5,26 +5,1408 @@
 // simplicity.
 #include <windows.h>
 
+#include "agg/bars.h"
+#include "agg/nbbo.h"
+#include "agg/urate.h"
+#include "codec/lz4batch.h"
+#include "codec/pbframe.h"
+#include "codec/qdelta.h"
+#include "codec/seqhdr.h"
+#include "codec/tracehdr.h"
+#include "codec/varint.h"
 #include "conc/conc.h"
+#include "conc/credit.h"
+#include "conc/rcu.h"
+#include "core/checkpoint.h"
+#include "core/embed.h"
+#include "core/partition.h"
 #include "core/wineing.h"
+#include "log/logging.h"
 #include "net/chan.h"
 #include "nx/nxtape.h"
 #include "nx/nxinf.h"
+#include "store/coltab.h"
+#include "sym/interest.h"
+#include "sym/symfilter.h"
+#include "sym/symtab.h"
 #include "gen/WineingCtrlProto.pb.h"
 #include "gen/WineingMarketDataProto.pb.h"
 
 #include "NxCoreAPI.h"
 
+#include <new>
+#include <stdio.h>
 #include <unistd.h>
 #include <pthread.h>
 #include <sstream>
+#include <string>
 #include <google/protobuf/io/zero_copy_stream_impl.h>
 #include <google/protobuf/io/zero_copy_stream_impl_lite.h>
 
-// Used to send control and market data messages to the client
-// Not thread safe. The thread invoking 
-static chan *g_cchan_out;
+// Used to send market data messages to the client. Not thread safe.
+// Taken from *g_rconf* by the live context, see *_rconf_update*.
 static chan *g_mchan;
+static const w_conf *g_conf;
+
+// The reader slot of the thread running the live tape in *g_rconf*
+static int g_rslot;
+
+// Directory entries republished per STATUS, see w_rconf.dir_chunk
+static int g_dir_chunk = DEFAULTS_SYMTAB_DIR_CHUNK;
+
+// Symbols outside the partition's prefix are ignored by the live
+// context, NULL if ingesting all, see core/partition.h
+static const char *g_prefix;
+static size_t g_prefix_size;
+
+/**
+ * \struct
+ *
+ * State of a tape being processed. The live context publishes on
+ * mchan, replay contexts (see *nxtape_replay*) write to a journal.
+ * Each context is owned by the thread running its NxCore callback.
+ */
+typedef struct
+{
+  // Symbol directory, see sym/symtab.h
+  symtab *syms;
+
+  // Next symbol id to be republished in the periodic directory
+  unsigned int symtab_cursor;
+
+  // Reused for every message. SYMBOL messages have their own because
+  // they might be sent while building another message.
+  WineingMarketDataProto::MarketData m;
+  WineingMarketDataProto::MarketData s;
+
+  // Local version of the shared state
+  int version;
+  w_ctrl data;
+
+  // Journal of a replay context. Frames are buffered in *journal_buf*,
+  // NULL for the live context, using the layout of codec/lz4batch.h.
+  HANDLE journal;
+  lz4batch *journal_buf;
+  char scratch[DEFAULTS_JOURNAL_FRAME_SIZE];
+  unsigned long messages;
+  int journal_failed;           // 1 once writing the journal failed
+
+  // Columns of a columnar replay, see *nxtape_columnar*. NULL
+  // otherwise.
+  coltab *trades;
+  coltab *quotes;
+
+  // Handlers of an embedded replay, see *nxtape_embed*. NULL
+  // otherwise.
+  embed *embedded;
+
+  // Filter declared with MARKET_START or RECONFIGURE, NULL if
+  // everything is published. Only used by the live context.
+  symfilter *filter;
+
+  // w_rconf.generation and w_rconf.filter_generation applied last
+  unsigned int rconf_generation;
+  unsigned int filter_generation;
+} nxtape_ctx;
+
+// Columns of nxtape_ctx.trades
+#define COL_TRADE_TIMESTAMP  0
+#define COL_TRADE_PRICE      1
+#define COL_TRADE_SIZE       2
+#define COL_TRADE_PRICE_TYPE 3
+#define COL_TRADE_EXG        4
+#define COL_TRADE_COLUMNS    5
+
+// Columns of nxtape_ctx.quotes
+#define COL_QUOTE_TIMESTAMP  0
+#define COL_QUOTE_BID_PRICE  1
+#define COL_QUOTE_ASK_PRICE  2
+#define COL_QUOTE_BID_SIZE   3
+#define COL_QUOTE_ASK_SIZE   4
+#define COL_QUOTE_PRICE_TYPE 5
+#define COL_QUOTE_EXG        6
+#define COL_QUOTE_COLUMNS    7
+
+// NxCoreSystem.UserData 0
+static nxtape_ctx g_live;
+
+// Replay contexts by NxCoreSystem.UserData - 1
+static nxtape_ctx *g_replays[WINEING_BATCH_MAX_WORKERS];
+static pthread_mutex_t g_replays_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Last published quote per symbol id. Only used if mchan_encoding is
+// WINEING_MCHAN_ENCODING_DELTA.
+static qdelta *g_qdelta;
+
+// Subscriptions of the XPUB mchan and the channel they were received
+// on, see sym/interest.h. NULL unless w_conf.mchan_xpub is set.
+static interest *g_interest;
+
+// Topic frames of the live directory's symbols by id, formatted once
+// and sent without copying, see *_send_topic*. Never freed, zmq may
+// still hold them.
+static char **g_topics;
+static unsigned int g_topics_capacity;
+static chan *g_interest_chan;
+
+// Batch of frames to be compressed by mchan_lz4_thread. NULL if
+// compression is disabled.
+static lz4batch *g_batch;
+static chan *g_mchan_batch;
+
+// One set of accumulators per bar interval. Empty if bar aggregation
+// is disabled.
+static bars *g_bars[WINEING_BARS_MAX_INTERVALS];
+static int g_bars_size;
+static chan *g_bchan;
+
+// Books of the live tape's symbols. NULL if NBBO consolidation is
+// disabled.
+static nbbo *g_nbbo;
+static chan *g_nchan;
+
+// Option partitions, see *nxtape_ochan_init*. Empty if options are
+// published on mchan.
+static chan *g_ochan[WINEING_OCHAN_MAX_SHARDS];
+static nxtape_orec *g_obatch[WINEING_OCHAN_MAX_SHARDS];
+static int g_obatch_size[WINEING_OCHAN_MAX_SHARDS];
+static int g_ochan_size;
+
+// Underlyings of the live context's options. *g_under* maps a symbol
+// id to its underlying's id + 1, zero if unknown, *g_ushard* an
+// underlying id to its partition.
+static symtab *g_underlyings;
+static unsigned int *g_under;
+static unsigned int g_under_capacity;
+static unsigned char *g_ushard;
+static unsigned int g_ushard_capacity;
+
+// Last trade of each underlying, indexed like *g_underlyings*, and the
+// underlying of each live symbol: its id + 2, 1 if it is none, zero if
+// not looked up yet. NULL unless w_conf.greeks is set.
+static double *g_spot;
+static unsigned int g_spot_capacity;
+static unsigned int *g_spot_of;
+static unsigned int g_spot_of_capacity;
+
+// Checkpoints of the live tape, NULL if disabled, see
+// core/checkpoint.h. The next one is due at *g_ckpt_next* on the NxCore
+// clock, 0 until the tape runs.
+static checkpoint *g_ckpt;
+static unsigned int g_ckpt_next;
+
+// Sequence number of the next frame published on mchan if
+// w_conf.mchan_seq, see codec/seqhdr.h
+static uint64_t g_seq;
+
+// Frames published on mchan before the next one is traced if
+// w_conf.mchan_trace, and the trace of the NxCore message processed,
+// see codec/tracehdr.h
+static unsigned int g_trace_left;
+static tracehdr g_trace;
+static const NxCoreSystem *g_trace_sys;
+
+// The STATUS MarketData, it never changes. Published without copying
+// or serializing, see *_send_frame*.
+static pbframe g_status;
+static pthread_once_t g_frames_once = PTHREAD_ONCE_INIT;
+
+/**
+ * Called by *chan_send* once the data is on the wire.
+ */
+static inline void _send_free(void *buffer, void *hint)
+{
+  delete [] (char*)buffer;
+}
+
+/**
+ * Hands the pending batch over to mchan_lz4_thread. Ownership of the
+ * buffer passes to zmq.
+ */
+static void _batch_flush()
+{
+  size_t size;
+  char *data = lz4batch_take(g_batch, &size);
+  if(NULL != data) {
+    chan_send(g_mchan_batch, data, size, _send_free);
+  }
+}
+
+/**
+ * Sends a frame larger than DEFAULTS_LZ4_BATCH_SIZE as a batch of its
+ * own.
+ */
+static void _batch_single(const char *buffer, size_t size)
+{
+  lz4batch *b = lz4batch_init(VARINT_MAX_SIZE + size);
+  size_t n;
+  if(0 > lz4batch_append(b, buffer, size)) {
+    log(LOG_WARN, "Dropping frame of %lu bytes from mchan_lz4",
+        (unsigned long)size);
+  } else {
+    char *data = lz4batch_take(b, &n);
+    chan_send(g_mchan_batch, data, n, _send_free);
+  }
+  lz4batch_destroy(b);
+}
+
+/**
+ * Appends a frame to the batch if compression is enabled. Must be
+ * invoked before the frame is handed to zmq.
+ */
+static inline void _batch(const char *buffer, size_t size)
+{
+  if(NULL == g_batch) {
+    return;
+  }
+  if(0 > lz4batch_append(g_batch, buffer, size)) {
+    _batch_flush();
+    if(0 > lz4batch_append(g_batch, buffer, size)) {
+      _batch_single(buffer, size);
+    }
+  }
+}
+
+/**
+ * Writes the buffered frames to the journal. A failed write, e.g. of a
+ * full disk, fails the replay, the journal is truncated.
+ */
+static void _journal_flush(nxtape_ctx *c)
+{
+  DWORD written = 0;
+  lz4batch *b = c->journal_buf;
+  if(0 == b->size || c->journal_failed) {
+    b->size = 0;
+    return;
+  }
+  if(!WriteFile(c->journal, b->data, b->size, &written, NULL)
+     || written != b->size) {
+    log(LOG_ERROR, "Failed writing journal, %lu of %lu bytes written",
+        (unsigned long)written, (unsigned long)b->size);
+    c->journal_failed = 1;
+  }
+  b->size = 0;
+}
+
+/**
+ * Appends an encoded frame to the journal.
+ */
+static void _journal_frame(nxtape_ctx *c, const char *data, size_t size)
+{
+  if(0 > lz4batch_append(c->journal_buf, data, size)) {
+    _journal_flush(c);
+    if(0 > lz4batch_append(c->journal_buf, data, size)) {
+      log(LOG_WARN, "Dropping journal frame of %lu bytes",
+          (unsigned long)size);
+      return;
+    }
+  }
+  c->messages++;
+}
+
+/**
+ * Appends *m* to the journal.
+ */
+static void _journal(nxtape_ctx *c,
+                     const WineingMarketDataProto::MarketData &m)
+{
+  int buf_size = m.ByteSize();
+  if(buf_size > (int)sizeof(c->scratch)) {
+    log(LOG_WARN, "Dropping journal frame of %d bytes", buf_size);
+    return;
+  }
+  google::protobuf::io::ArrayOutputStream os (c->scratch, buf_size);
+  m.SerializeToZeroCopyStream(&os);
+  _journal_frame(c, c->scratch, buf_size);
+}
+
+/**
+ * Takes a credit for the next message on mchan. Blocks the callback
+ * of a paced replay until the consumer grants more, see
+ * Request.credits.
+ */
+static inline void _pace()
+{
+  if(CREDIT_EMPTY != credit_take(g_credit)) {
+    return;
+  }
+
+  // Might be long, RECONFIGURE doesn't wait. The channels are loaded
+  // again once back online.
+  rcu_offline(&g_rconf, g_rslot);
+  credit_wait(g_credit);
+  rcu_online(&g_rconf, g_rslot);
+
+  const w_rconf *rc = (const w_rconf*)rcu_deref(&g_rconf);
+  g_mchan = rc->mchan;
+  g_bchan = rc->bchan;
+}
+
+template <typename T>
+static int _reserve(T **a, unsigned int *capacity, unsigned int i);
+
+/**
+ * \return The topic of *name*, a directory key, in a new buffer. The
+ *         topic is the NxCore symbol including its NULL byte, the key of
+ *         an option holds its DateAndStrike as well.
+ */
+static inline char* _topic(const char *name, size_t *size)
+{
+  *size = strcspn(name, " ") + 1;
+  char *topic = new char[*size];
+  memcpy(topic, name, *size - 1);
+  topic[*size - 1] = '\0';
+  return topic;
+}
+
+/**
+ * Sends the topic frame of symbol *id*, SYMTAB_NONE for STATUS, if
+ * mchan is an XPUB channel. Topics of the live directory are sent
+ * from *g_topics*.
+ */
+static inline void _send_topic(nxtape_ctx *c, unsigned int id)
+{
+  if(NULL == g_interest) {
+    return;
+  }
+  if(SYMTAB_NONE == id) {
+    chan_send_more(g_mchan, (void*)"", 1);
+    return;
+  }
+
+  size_t size;
+  if(&g_live != c || 0 > _reserve(&g_topics, &g_topics_capacity, id)) {
+    char *topic = _topic(symtab_get(c->syms, id)->name, &size);
+    chan_send_more(g_mchan, topic, size, _send_free);
+    return;
+  }
+  char *topic = g_topics[id];
+  if(NULL == topic) {
+    topic = g_topics[id] = _topic(symtab_get(c->syms, id)->name, &size);
+  } else {
+    size = strlen(topic) + 1;
+  }
+  chan_send_more(g_mchan, topic, size);
+}
+
+/**
+ * \return 1 if the frame about to be published on mchan is traced, one
+ *         in w_conf.mchan_trace is
+ */
+static inline int _trace_sample()
+{
+  if(0 == g_conf->mchan_trace || 0 < g_trace_left--) {
+    return 0;
+  }
+  g_trace_left = g_conf->mchan_trace - 1;
+  return 1;
+}
+
+/**
+ * Writes the trace of the frame about to be sent to *p*, see
+ * codec/tracehdr.h. NxCore's time is only converted for the sampled
+ * frames.
+ */
+static inline void _trace_put(char *p, int64_t encoded)
+{
+  const NxCoreSystem *s = g_trace_sys;
+  g_trace.nxcore = tracehdr_time(s->nxDate.Year,
+                                 s->nxDate.Month,
+                                 s->nxDate.Day,
+                                 s->nxTime.MsOfDay,
+                                 s->nxTime.TimeZone);
+  g_trace.encode = encoded;
+  g_trace.send = tracehdr_now();
+  tracehdr_put(p, &g_trace);
+}
+
+/**
+ * Serializes *m* and sends it through mchan, or writes it to the
+ * journal if *c* is a replay context.
+ */
+static inline void _send(nxtape_ctx *c,
+                         const WineingMarketDataProto::MarketData &m)
+{
+  if(NULL != c->journal_buf) {
+    _journal(c, m);
+    return;
+  }
+
+  int seq = g_conf->mchan_seq ? SEQHDR_SIZE : 0;
+  int trace = &g_live == c
+    && WineingMarketDataProto::MarketData::SYMBOL != m.type()
+    && _trace_sample() ? TRACEHDR_SIZE : 0;
+  int head = seq + trace;
+  int buf_size = head + m.ByteSize();
+  char *buffer = new char[buf_size];
+  google::protobuf::io::ArrayOutputStream os (buffer + head, buf_size - head);
+  m.SerializeToZeroCopyStream(&os);
+  int64_t encoded = trace ? tracehdr_now() : 0;
+  _pace();
+  if(seq) {
+    seqhdr_put(buffer, g_seq++);
+  }
+  _send_topic(c, m.has_symbol_id() ? m.symbol_id() : SYMTAB_NONE);
+  if(trace) {
+    _trace_put(buffer + seq, encoded);
+  }
+  _batch(buffer, buf_size);
+  chan_send(g_mchan, buffer, buf_size, _send_free);
+}
+
+/**
+ * Sends the frame of a template without a varying field, see
+ * codec/pbframe.h. The template outlives the message, zmq sends it
+ * as is and doesn't free it.
+ */
+static inline void _send_frame(nxtape_ctx *c, const pbframe *f)
+{
+  if(NULL != c->quotes) {
+    // Columnar files only hold quotes and trades
+    return;
+  }
+  if(NULL != c->journal_buf) {
+    _journal_frame(c, f->data, f->size);
+    return;
+  }
+  _pace();
+  _send_topic(c, SYMTAB_NONE);
+  if(g_conf->mchan_seq) {
+    // Frames differ by their header, the template is copied
+    char *buffer = new char[SEQHDR_SIZE + f->size];
+    memcpy(seqhdr_put(buffer, g_seq++), f->data, f->size);
+    _batch(buffer, SEQHDR_SIZE + f->size);
+    chan_send(g_mchan, buffer, SEQHDR_SIZE + f->size, _send_free);
+    return;
+  }
+  _batch(f->data, f->size);
+  chan_send(g_mchan, (void*)f->data, f->size);
+}
+
+/**
+ * Sends quote *q* of symbol *id* as a delta frame, see codec/qdelta.h.
+ */
+static inline void _send_qdelta(unsigned int id, const qdelta_quote *q)
+{
+  int seq = g_conf->mchan_seq ? SEQHDR_SIZE : 0;
+  int trace = _trace_sample() ? TRACEHDR_SIZE : 0;
+  int head = seq + trace;
+  char *buffer = new char[head + QDELTA_MAX_FRAME_SIZE];
+  int buf_size = qdelta_encode(g_qdelta, id, q, buffer + head);
+  if(0 > buf_size) {
+    delete [] buffer;
+    return;
+  }
+  buf_size += head;
+  int64_t encoded = trace ? tracehdr_now() : 0;
+  _pace();
+  if(seq) {
+    seqhdr_put(buffer, g_seq++);
+  }
+  _send_topic(&g_live, id);
+  if(trace) {
+    _trace_put(buffer + seq, encoded);
+  }
+  _batch(buffer, buf_size);
+  chan_send(g_mchan, buffer, buf_size, _send_free);
+}
+
+/**
+ * Used by *_bars_roll* and *bars_add*. Publishes a completed bar on
+ * bchan.
+ */
+static void _send_bar(unsigned int id, const bar *b, void *obj)
+{
+  using namespace WineingMarketDataProto;
+
+  static MarketData m;
+
+  m.Clear();
+  m.set_type(MarketData::BAR);
+  m.set_symbol_id(id);
+  m.set_timestamp(b->start);
+  m.set_interval(b->interval);
+  m.set_price_type(b->price_type);
+  m.set_open(b->open);
+  m.set_high(b->high);
+  m.set_low(b->low);
+  m.set_close(b->close);
+  m.set_volume(b->volume);
+  m.set_vwap(b->vwap);
+  m.set_trades(b->trades);
+
+  int buf_size = m.ByteSize();
+  char *buffer = new char[buf_size];
+  google::protobuf::io::ArrayOutputStream os (buffer, buf_size);
+  m.SerializeToZeroCopyStream(&os);
+  chan_send(g_bchan, buffer, buf_size, _send_free);
+}
+
+/**
+ * Updates the NBBO of symbol *id* with an exchange quote, publishing
+ * it on nchan if it changed.
+ */
+static inline void _nbbo_quote(unsigned int id,
+                               const NxCoreHeader &h,
+                               const NxCoreQuote &q)
+{
+  using namespace WineingMarketDataProto;
+
+  static MarketData m;
+
+  if(0 >= nbbo_update(g_nbbo, id, h.ReportingExg,
+                      q.BidPrice, q.BidSize, q.AskPrice, q.AskSize,
+                      q.PriceType)) {
+    return;
+  }
+
+  const nbbo_quote *b = nbbo_get(g_nbbo, id);
+  m.Clear();
+  m.set_type(MarketData::NBBO);
+  m.set_symbol_id(id);
+  m.set_timestamp(h.nxExgTimestamp.MsOfDay);
+  m.set_price_type(b->price_type);
+  m.set_bid_price(b->bid);
+  m.set_ask_price(b->ask);
+  m.set_bid_size(b->bid_size);
+  m.set_ask_size(b->ask_size);
+  m.set_bid_exg(b->bid_exg);
+  m.set_ask_exg(b->ask_exg);
+
+  int buf_size = m.ByteSize();
+  char *buffer = new char[buf_size];
+  google::protobuf::io::ArrayOutputStream os (buffer, buf_size);
+  m.SerializeToZeroCopyStream(&os);
+  chan_send(g_nchan, buffer, buf_size, _send_free);
+}
+
+/**
+ * Completes the bars of all intervals ending before *ms_of_day*.
+ */
+static inline void _bars_roll(unsigned int ms_of_day)
+{
+  for(int i = 0; i < g_bars_size; i++) {
+    bars_roll(g_bars[i], ms_of_day, _send_bar, NULL);
+  }
+}
+
+/**
+ * Makes sure array *a* of *capacity* elements holds index *i*. New
+ * elements are zeroed.
+ *
+ * \return 0 if successful, -1 if the array could not grow
+ */
+template <typename T>
+static int _reserve(T **a, unsigned int *capacity, unsigned int i)
+{
+  if(i < *capacity) {
+    return 0;
+  }
+
+  unsigned int n = 0 < *capacity ? *capacity : 1024;
+  while(n <= i) {
+    n <<= 1;
+  }
+  T *grown = new (std::nothrow) T[n];
+  if(NULL == grown) {
+    return -1;
+  }
+  memset(grown, 0, n * sizeof(T));
+  if(NULL != *a) {
+    memcpy(grown, *a, *capacity * sizeof(T));
+  }
+  delete [] *a;
+  *a = grown;
+  *capacity = n;
+  return 0;
+}
+
+/**
+ * Hands the pending records of partition *shard* over to its
+ * ochan_thread. Ownership of the buffer passes to zmq.
+ */
+static void _ochan_flush(int shard)
+{
+  if(0 == g_obatch_size[shard]) {
+    return;
+  }
+  chan_send(g_ochan[shard],
+            g_obatch[shard],
+            g_obatch_size[shard] * sizeof(nxtape_orec),
+            _send_free);
+  g_obatch[shard] =
+    (nxtape_orec*)new char[DEFAULTS_OCHAN_BATCH_SIZE * sizeof(nxtape_orec)];
+  g_obatch_size[shard] = 0;
+}
+
+/**
+ * \return The next record of partition *shard*, zeroed
+ */
+static inline nxtape_orec* _ochan_next(int shard)
+{
+  if(DEFAULTS_OCHAN_BATCH_SIZE == g_obatch_size[shard]) {
+    _ochan_flush(shard);
+  }
+  nxtape_orec *r = &g_obatch[shard][g_obatch_size[shard]++];
+  memset(r, 0, sizeof(nxtape_orec));
+  return r;
+}
+
+/**
+ * \return The next record of underlying *uid*'s partition
+ */
+static inline nxtape_orec* _ochan_rec(unsigned int uid, unsigned int clock)
+{
+  nxtape_orec *r = _ochan_next(g_ushard[uid]);
+  memcpy(r->topic, symtab_get(g_underlyings, uid)->name, SYMTAB_NAME_SIZE);
+  r->underlying = uid;
+  r->clock = clock;
+  return r;
+}
+
+/**
+ * Records the underlying of option *id*. The underlying of an option
+ * without one, which NxCore does not guarantee, is its root.
+ *
+ * \return The underlying id or SYMTAB_NONE
+ */
+static unsigned int _ochan_map(unsigned int id,
+                               const NxString *symbol,
+                               const NxOptionHdr *option)
+{
+  const char *name = NULL != option->pnxsUnderlying ?
+    option->pnxsUnderlying->String : symbol->String;
+
+  int added = 0;
+  unsigned int uid = symtab_intern(g_underlyings, name, 0, &added);
+  if(SYMTAB_NONE == uid
+     || 0 > _reserve(&g_under, &g_under_capacity, id)
+     || 0 > _reserve(&g_ushard, &g_ushard_capacity, uid)) {
+    return SYMTAB_NONE;
+  }
+  if(added) {
+    g_ushard[uid] = urate_shard(name, g_ochan_size);
+    if(NULL != g_spot_of) {
+      // Underlyings seen trading before their first option
+      unsigned int sid =
+        symtab_find(g_live.syms, name, option->exgUnderlying);
+      if(SYMTAB_NONE != sid
+         && 0 <= _reserve(&g_spot_of, &g_spot_of_capacity, sid)) {
+        g_spot_of[sid] = uid + 2;
+      }
+    }
+  }
+  g_under[id] = uid + 1;
+  return uid;
+}
+
+/**
+ * Records trade *t* of live symbol *id* as the spot of the options
+ * it underlies.
+ */
+static inline void _spot_trade(unsigned int id, const NxCoreTrade &t)
+{
+  if(0 > _reserve(&g_spot_of, &g_spot_of_capacity, id)) {
+    return;
+  }
+  if(0 == g_spot_of[id]) {
+    unsigned int uid =
+      symtab_find(g_underlyings, symtab_get(g_live.syms, id)->name, 0);
+    g_spot_of[id] = SYMTAB_NONE == uid ? 1 : uid + 2;
+  }
+  unsigned int uid = g_spot_of[id] - 2;
+  if(1 < g_spot_of[id]
+     && 0 <= _reserve(&g_spot, &g_spot_capacity, uid)) {
+    g_spot[uid] = wininf_nxcore_price(t.Price, t.PriceType);
+  }
+}
+
+/**
+ * \return The underlying of symbol *id* if its messages are
+ *         partitioned, SYMTAB_NONE otherwise
+ */
+static inline unsigned int _ochan_get(const nxtape_ctx *c, unsigned int id)
+{
+  return &g_live == c && id < g_under_capacity && 0 < g_under[id] ?
+    g_under[id] - 1 : SYMTAB_NONE;
+}
+
+/**
+ * Like *_ochan_get* but maps options seen the first time.
+ */
+static inline unsigned int _ochan_underlying(const nxtape_ctx *c,
+                                             unsigned int id,
+                                             const NxCoreHeader &h)
+{
+  if(&g_live != c || 0 == g_ochan_size || NULL == h.pnxOptionHdr) {
+    return SYMTAB_NONE;
+  }
+  unsigned int uid = _ochan_get(c, id);
+  return SYMTAB_NONE != uid ?
+    uid : _ochan_map(id, h.pnxStringSymbol, h.pnxOptionHdr);
+}
+
+/**
+ * Hands a STATUS record carrying the NxCore clock to each partition
+ * and flushes them. Bounds the latency of quiet partitions.
+ */
+static void _ochan_status(unsigned int clock)
+{
+  for(int i = 0; i < g_ochan_size; i++) {
+    nxtape_orec *r = _ochan_next(i);
+    r->type = WineingMarketDataProto::MarketData::STATUS;
+    r->clock = clock;
+    _ochan_flush(i);
+  }
+}
+
+/**
+ * Hands the directory entry *e* of symbol *id* to the embedding
+ * application.
+ */
+static void _embed_symbol(nxtape_ctx *c,
+                          unsigned int id,
+                          const symtab_entry *e)
+{
+  embed_event scratch;
+  embed_event *ev = embed_claim(c->embedded, EMBED_SYMBOL, &scratch);
+  if(NULL == ev) {
+    return;
+  }
+  ev->symbol.symbol_id = id;
+  ev->symbol.exg = e->exg;
+  ev->symbol.deleted = 0 != (e->flags & SYMTAB_FLAG_DELETED);
+  memcpy(ev->symbol.name, e->name, SYMTAB_NAME_SIZE);
+  embed_publish(c->embedded, ev);
+}
+
+/**
+ * Hands a quote of symbol *id* to the embedding application.
+ */
+static inline void _embed_quote(nxtape_ctx *c,
+                                unsigned int id,
+                                const NxCoreHeader &h,
+                                const NxCoreQuote &q)
+{
+  embed_event scratch;
+  embed_event *ev = embed_claim(c->embedded, EMBED_QUOTE, &scratch);
+  if(NULL == ev) {
+    return;
+  }
+  ev->quote.symbol_id = id;
+  ev->quote.timestamp = h.nxExgTimestamp.MsOfDay;
+  ev->quote.bid_price = q.BidPrice;
+  ev->quote.ask_price = q.AskPrice;
+  ev->quote.bid_size = q.BidSize;
+  ev->quote.ask_size = q.AskSize;
+  ev->quote.exg = h.ReportingExg;
+  ev->quote.price_type = q.PriceType;
+  embed_publish(c->embedded, ev);
+}
+
+/**
+ * Hands a trade of symbol *id* to the embedding application.
+ */
+static inline void _embed_trade(nxtape_ctx *c,
+                                unsigned int id,
+                                const NxCoreHeader &h,
+                                const NxCoreTrade &t)
+{
+  embed_event scratch;
+  embed_event *ev = embed_claim(c->embedded, EMBED_TRADE, &scratch);
+  if(NULL == ev) {
+    return;
+  }
+  ev->trade.symbol_id = id;
+  ev->trade.timestamp = h.nxExgTimestamp.MsOfDay;
+  ev->trade.price = t.Price;
+  ev->trade.size = t.Size;
+  ev->trade.exg = h.ReportingExg;
+  ev->trade.price_type = t.PriceType;
+  embed_publish(c->embedded, ev);
+}
+
+/**
+ * Hands a STATUS message to the embedding application.
+ */
+static inline void _embed_status(nxtape_ctx *c, unsigned int clock)
+{
+  embed_event scratch;
+  embed_event *ev = embed_claim(c->embedded, EMBED_STATUS, &scratch);
+  if(NULL != ev) {
+    ev->status.clock = clock;
+    embed_publish(c->embedded, ev);
+  }
+}
+
+/**
+ * Publishes the directory entry of symbol *id* unless it is filtered.
+ * Entries of partitioned options go to the option's partition.
+ */
+static void _send_symbol(nxtape_ctx *c, unsigned int id)
+{
+  using namespace WineingMarketDataProto;
+
+  if(NULL != c->filter && SYMFILTER_PASS != symfilter_get(c->filter, id)) {
+    return;
+  }
+  if(NULL != c->quotes) {
+    // coltab_write writes the directory, mchan isn't even set up
+    return;
+  }
+
+  MarketData &s = c->s;
+  const symtab_entry *e = symtab_get(c->syms, id);
+
+  if(NULL != c->embedded) {
+    _embed_symbol(c, id, e);
+    return;
+  }
+
+  unsigned int uid = _ochan_get(c, id);
+  if(SYMTAB_NONE != uid) {
+    nxtape_orec *r = _ochan_rec(uid, 0);
+    r->type = MarketData::SYMBOL;
+    r->symbol_id = id;
+    r->exg = e->exg;
+    r->deleted = 0 != (e->flags & SYMTAB_FLAG_DELETED);
+    memcpy(r->symbol, e->name, SYMTAB_NAME_SIZE);
+    return;
+  }
+
+  if(&g_live == c
+     && NULL != g_interest
+     && SYMFILTER_PASS != interest_get(g_interest, id)) {
+    return;
+  }
+
+  s.Clear();
+  s.set_type(MarketData::SYMBOL);
+  s.set_symbol_id(id);
+  s.set_symbol(e->name);
+  s.set_listed_exg(e->exg);
+  if(e->flags & SYMTAB_FLAG_DELETED) {
+    s.set_deleted(true);
+  }
+  _send(c, s);
+}
+
+/**
+ * Republishes the next w_rconf.dir_chunk directory entries so that
+ * late joiners learn about symbols they have not seen added.
+ */
+static void _send_symbol_dir(nxtape_ctx *c)
+{
+  for(int i = 0;
+      i < g_dir_chunk && 0 < c->syms->size;
+      i++) {
+    if(c->symtab_cursor >= c->syms->size) {
+      c->symtab_cursor = 0;
+    }
+    _send_symbol(c, c->symtab_cursor++);
+  }
+}
+
+/**
+ * The NxString holding our symbol id in its UserData1 field (id + 1,
+ * zero means not yet assigned). Option contracts share the root
+ * symbol's string thus we use the DateAndStrike string instead.
+ */
+static inline NxString* _symbol_ud(const NxString *symbol,
+                                   const NxOptionHdr *option)
+{
+  return (NxString*)(NULL != option ? option->pnxsDateAndStrike : symbol);
+}
+
+/**
+ * Writes the directory key of a symbol to *key*. Options are keyed by
+ * root and DateAndStrike.
+ */
+static inline void _symbol_key(const NxString *symbol,
+                               const NxOptionHdr *option,
+                               char *key)
+{
+  if(NULL != option && NULL != option->pnxsDateAndStrike) {
+    snprintf(key, SYMTAB_NAME_SIZE, "%s %s",
+             symbol->String,
+             option->pnxsDateAndStrike->String);
+  } else {
+    snprintf(key, SYMTAB_NAME_SIZE, "%s", symbol->String);
+  }
+}
+
+/**
+ * \return 1 if *name* is the directory key of a symbol, see
+ *         *_symbol_key*, compared without formatting the key
+ */
+static inline int _symbol_keyed(const char *name,
+                                const NxString *symbol,
+                                const NxOptionHdr *option)
+{
+  const char *parts[3] = { symbol->String, NULL, NULL };
+  if(NULL != option && NULL != option->pnxsDateAndStrike) {
+    parts[1] = " ";
+    parts[2] = option->pnxsDateAndStrike->String;
+  }
+
+  int i = 0;
+  for(int p = 0; p < 3 && NULL != parts[p]; p++) {
+    for(const char *s = parts[p]; '\0' != *s; s++, i++) {
+      if(SYMTAB_NAME_SIZE - 1 == i) {
+        // Truncated like the key
+        return '\0' == name[i];
+      }
+      if(*s != name[i]) {
+        return 0;
+      }
+    }
+  }
+  return '\0' == name[i];
+}
+
+/**
+ * Evaluates the filter of *c* against symbol *id*.
+ *
+ * \return SYMFILTER_PASS or SYMFILTER_DROP
+ */
+static int _filter_eval(nxtape_ctx *c,
+                        unsigned int id,
+                        const NxString *symbol,
+                        const NxOptionHdr *option,
+                        unsigned short exg)
+{
+  unsigned int expiry = 0;
+  if(NULL != option) {
+    const NxDate &d = option->nxExpirationDate;
+    expiry = d.Year * 10000 + d.Month * 100 + d.Day;
+  }
+  int pass = symfilter_eval(c->filter,
+                            symbol->String,
+                            exg,
+                            NULL != option,
+                            expiry);
+  return symfilter_set(c->filter, id, pass);
+}
+
+/**
+ * \return 1 if messages of symbol *id* are published. A symbol seen
+ *         the first time since the filter changed is evaluated and,
+ *         if it passes, its directory entry published.
+ */
+static inline int _filter_symbol(nxtape_ctx *c,
+                                 unsigned int id,
+                                 const NxCoreHeader &h)
+{
+  if(NULL == c->filter) {
+    return 1;
+  }
+
+  int state = symfilter_get(c->filter, id);
+  if(SYMFILTER_UNKNOWN == state) {
+    state = _filter_eval(c, id, h.pnxStringSymbol, h.pnxOptionHdr, h.ListedExg);
+    _send_symbol(c, id);
+  }
+  return SYMFILTER_PASS == state;
+}
+
+/**
+ * \return 1 if a subscriber of the XPUB mchan is interested in symbol
+ *         *id*, always for other channels. A symbol seen the first
+ *         time since the subscriptions changed is evaluated and, if it
+ *         passes, its directory entry published.
+ */
+static inline int _interested(nxtape_ctx *c,
+                              unsigned int id,
+                              const NxCoreHeader &h)
+{
+  if(NULL == g_interest || &g_live != c) {
+    return 1;
+  }
+
+  int state = interest_get(g_interest, id);
+  if(SYMFILTER_UNKNOWN == state) {
+    state = interest_eval(g_interest,
+                          id,
+                          h.pnxStringSymbol->String,
+                          h.ListedExg,
+                          NULL != h.pnxOptionHdr);
+    _send_symbol(c, id);
+  }
+  return SYMFILTER_PASS == state;
+}
+
+/**
+ * Used by *chan_recv*. Applies a subscription received on the XPUB
+ * mchan.
+ */
+static int _interest_recv(void *data, size_t size, void *obj)
+{
+  if(0 > interest_update((interest*)obj, (const char*)data, size)) {
+    log(LOG_WARN, "Ignoring invalid subscription of %lu bytes",
+        (unsigned long)size);
+  }
+  return 0;
+}
+
+/**
+ * Applies the subscriptions received since the last call. Those of a
+ * channel replaced by RECONFIGURE are dropped, subscribers have to
+ * subscribe again on the new one.
+ */
+static void _interest_poll()
+{
+  if(g_interest_chan != g_mchan) {
+    interest_clear(g_interest);
+    g_interest_chan = g_mchan;
+  }
+  while(0 <= chan_recv(g_mchan, _interest_recv, g_interest,
+                       CHAN_RECV_NOBLOCK));
+  interest_compile(g_interest);
+}
+
+/**
+ * \return 1 if messages of *type* (a MarketData.Type) are published
+ */
+static inline int _filter_type(const nxtape_ctx *c, int type)
+{
+  using namespace WineingMarketDataProto;
+
+  if(NULL != c->embedded) {
+    return
+      (MarketData::QUOTE_EX == type && embed_wants(c->embedded, EMBED_QUOTE))
+      || (MarketData::TRADE == type && embed_wants(c->embedded, EMBED_TRADE));
+  }
+  return NULL == c->filter || symfilter_type(c->filter, type);
+}
+
+/**
+ * Replaces the filter of *c* with the serialized Filter *data*. An
+ * empty one publishes everything.
+ */
+static void _filter_compile(nxtape_ctx *c, const char *data, size_t size)
+{
+  if(NULL != c->filter) {
+    symfilter_destroy(c->filter);
+    c->filter = NULL;
+  }
+
+  if(0 == size) {
+    return;
+  }
+
+  WineingCtrlProto::Filter spec;
+  if(!spec.ParseFromArray(data, size)) {
+    log(LOG_WARN, "Failed parsing filter, publishing everything");
+    return;
+  }
+
+  symfilter *f = symfilter_init();
+  for(int i = 0; i < spec.symbols_size(); i++) {
+    symfilter_add_symbol(f, spec.symbols(i).c_str());
+  }
+  for(int i = 0; i < spec.prefixes_size(); i++) {
+    symfilter_add_prefix(f, spec.prefixes(i).c_str());
+  }
+  for(int i = 0; i < spec.option_roots_size(); i++) {
+    symfilter_add_root(f, spec.option_roots(i).c_str());
+  }
+  for(int i = 0; i < spec.exchanges_size(); i++) {
+    symfilter_add_exchange(f, spec.exchanges(i));
+  }
+  for(int i = 0; i < spec.types_size(); i++) {
+    symfilter_add_type(f, spec.types(i));
+  }
+  if(0 < spec.types_size()) {
+    // Always published, clients rely on them
+    symfilter_add_type(f, WineingMarketDataProto::MarketData::STATUS);
+    symfilter_add_type(f, WineingMarketDataProto::MarketData::SYMBOL);
+  }
+  symfilter_set_expiry(f, spec.expiry_from(), spec.expiry_to());
+  symfilter_compile(f);
+  c->filter = f;
+}
+
+/**
+ * Compiles the filter passed with MARKET_START. The serialized Filter
+ * follows the tape's NULL byte in the shared data.
+ */
+static void _filter_update(nxtape_ctx *c)
+{
+  size_t tape_size = strnlen(c->data.data, c->data.size) + 1;
+  if(c->data.size <= tape_size) {
+    _filter_compile(c, NULL, 0);
+    return;
+  }
+  _filter_compile(c, &c->data.data[tape_size], c->data.size - tape_size);
+}
+
+/**
+ * Applies a configuration published by RECONFIGURE to the live
+ * context. Invoked once per generation, the channels are taken for
+ * every message.
+ */
+static void _rconf_update(nxtape_ctx *c, const w_rconf *rc)
+{
+  // The HWM of a new channel is set before it is bound
+  if(rc->mchan->hwm != rc->mchan_hwm) {
+    chan_set_hwm(rc->mchan, rc->mchan_hwm);
+  }
+  g_dir_chunk = rc->dir_chunk;
+
+  if(c->filter_generation != rc->filter_generation) {
+    _filter_compile(c, rc->filter, rc->filter_size);
+    c->filter_generation = rc->filter_generation;
+  }
+  c->rconf_generation = rc->generation;
+}
+
+/**
+ * Resolves the id of a symbol. The id cached in the NxString is
+ * validated against the listed exchange and the key because NxCore
+ * shares strings among symbols listed on different exchanges, and
+ * DateAndStrike strings among options of different roots. Only if
+ * that fails do we go through the hash table.
+ *
+ * \param intern If 1 unknown symbols are added to the directory and
+ *               published
+ * \return       The id or SYMTAB_NONE
+ */
+static unsigned int _symbol_id(nxtape_ctx *c,
+                               const NxString *symbol,
+                               const NxOptionHdr *option,
+                               unsigned short exg,
+                               int intern)
+{
+  NxString *ud = _symbol_ud(symbol, option);
+  if(NULL == symbol || NULL == ud) {
+    return SYMTAB_NONE;
+  }
+
+  unsigned int id = (unsigned int)ud->UserData1 - 1;
+  const symtab_entry *e = symtab_get(c->syms, id);
+  if(NULL != e
+     && e->exg == exg
+     && 0 == (e->flags & SYMTAB_FLAG_DELETED)
+     && _symbol_keyed(e->name, symbol, option)) {
+    return id;
+  }
+
+  // Never cached, the messages of other partitions mostly are
+  // excluded by NxCore already
+  if(NULL != g_prefix
+     && &g_live == c
+     && 0 != strncmp(symbol->String, g_prefix, g_prefix_size)) {
+    return SYMTAB_NONE;
+  }
+
+  char key[SYMTAB_NAME_SIZE];
+  int added = 0;
+  _symbol_key(symbol, option, key);
+  id = intern ?
+    symtab_intern(c->syms, key, exg, &added) :
+    symtab_find(c->syms, key, exg);
+
+  if(SYMTAB_NONE != id) {
+    ud->UserData1 = id + 1;
+    if(added) {
+      if(NULL != c->filter) {
+        _filter_eval(c, id, symbol, option, exg);
+      }
+      if(&g_live == c && 0 < g_ochan_size && NULL != option) {
+        _ochan_map(id, symbol, option);
+      }
+      _send_symbol(c, id);
+    }
+  }
+  return id;
+}
+
+/**
+ * Maintains the directory on NxCore symbol additions, deletions and
+ * modifications.
+ */
+static void _symbol_change(nxtape_ctx *c, const NxCoreMessage *pNxCoreMsg)
+{
+  const NxCoreHeader &h = pNxCoreMsg->coreHeader;
+  const NxCoreSymbolChange &sc = pNxCoreMsg->coreData.SymbolChange;
+  unsigned int id;
+
+  switch(sc.Status)
+    {
+    case NxSS_ADD:
+      _symbol_id(c, h.pnxStringSymbol, h.pnxOptionHdr, h.ListedExg, 1);
+      break;
+
+    case NxSS_DEL:
+      id = _symbol_id(c, h.pnxStringSymbol, h.pnxOptionHdr, h.ListedExg, 0);
+      if(0 == symtab_remove(c->syms, id)) {
+        _symbol_ud(h.pnxStringSymbol, h.pnxOptionHdr)->UserData1 = 0;
+        _send_symbol(c, id);
+      }
+      break;
+
+    case NxSS_MOD:
+      // Keep the id of the old symbol so that consumers' state
+      // remains valid.
+      id = _symbol_id(c,
+                      sc.pnxsSymbolOld,
+                      sc.pnxOptionHdrOld,
+                      sc.ListedExgOld,
+                      0);
+      if(SYMTAB_NONE != id) {
+        char key[SYMTAB_NAME_SIZE];
+        _symbol_key(h.pnxStringSymbol, h.pnxOptionHdr, key);
+        if(0 == symtab_rename(c->syms, id, key, h.ListedExg)) {
+          if(&g_live == c && id < g_topics_capacity) {
+            // Formatted again when next sent. The old topic may still
+            // be queued in zmq and is leaked, renames are rare.
+            g_topics[id] = NULL;
+          }
+          _symbol_ud(h.pnxStringSymbol, h.pnxOptionHdr)->UserData1 = id + 1;
+          if(NULL != c->filter) {
+            _filter_eval(c, id, h.pnxStringSymbol, h.pnxOptionHdr, h.ListedExg);
+          }
+          if(SYMTAB_NONE != _ochan_get(c, id)) {
+            _ochan_map(id, h.pnxStringSymbol, h.pnxOptionHdr);
+          }
+          _send_symbol(c, id);
+          break;
+        }
+      }
+      _symbol_id(c, h.pnxStringSymbol, h.pnxOptionHdr, h.ListedExg, 1);
+      break;
+    }
+}
+
+/**
+ * Appends a quote to the columns of *c*.
+ */
+static inline void _column_quote(nxtape_ctx *c,
+                                 unsigned int id,
+                                 const NxCoreHeader &h,
+                                 const NxCoreQuote &q)
+{
+  coltab *t = c->quotes;
+  int64_t row = coltab_append(t, id);
+  if(0 > row) {
+    return;
+  }
+  *(uint32_t*)coltab_at(t, COL_QUOTE_TIMESTAMP, row) = h.nxExgTimestamp.MsOfDay;
+  *(int32_t*)coltab_at(t, COL_QUOTE_BID_PRICE, row) = q.BidPrice;
+  *(int32_t*)coltab_at(t, COL_QUOTE_ASK_PRICE, row) = q.AskPrice;
+  *(uint32_t*)coltab_at(t, COL_QUOTE_BID_SIZE, row) = q.BidSize;
+  *(uint32_t*)coltab_at(t, COL_QUOTE_ASK_SIZE, row) = q.AskSize;
+  *(uint8_t*)coltab_at(t, COL_QUOTE_PRICE_TYPE, row) = q.PriceType;
+  *(uint16_t*)coltab_at(t, COL_QUOTE_EXG, row) = h.ReportingExg;
+}
+
+/**
+ * Appends a trade to the columns of *c*.
+ */
+static inline void _column_trade(nxtape_ctx *c,
+                                 unsigned int id,
+                                 const NxCoreHeader &h,
+                                 const NxCoreTrade &tr)
+{
+  coltab *t = c->trades;
+  int64_t row = coltab_append(t, id);
+  if(0 > row) {
+    return;
+  }
+  *(uint32_t*)coltab_at(t, COL_TRADE_TIMESTAMP, row) = h.nxExgTimestamp.MsOfDay;
+  *(int32_t*)coltab_at(t, COL_TRADE_PRICE, row) = tr.Price;
+  *(uint32_t*)coltab_at(t, COL_TRADE_SIZE, row) = tr.Size;
+  *(uint8_t*)coltab_at(t, COL_TRADE_PRICE_TYPE, row) = tr.PriceType;
+  *(uint16_t*)coltab_at(t, COL_TRADE_EXG, row) = h.ReportingExg;
+}
+
+/**
+ * Hands a quote of option *id* to the partition of underlying *uid*.
+ */
+static inline void _ochan_quote(unsigned int uid,
+                                unsigned int clock,
+                                unsigned int id,
+                                const NxCoreHeader &h,
+                                const NxCoreQuote &q)
+{
+  nxtape_orec *r = _ochan_rec(uid, clock);
+  r->type = WineingMarketDataProto::MarketData::QUOTE_EX;
+  r->symbol_id = id;
+  r->timestamp = h.nxExgTimestamp.MsOfDay;
+  r->price = q.BidPrice;
+  r->ask_price = q.AskPrice;
+  r->size = q.BidSize;
+  r->ask_size = q.AskSize;
+  r->exg = h.ReportingExg;
+  r->price_type = q.PriceType;
+  if(NULL != g_spot_of) {
+    const NxOptionHdr *o = h.pnxOptionHdr;
+    r->spot = uid < g_spot_capacity ? g_spot[uid] : 0;
+    r->strike = o->strikePrice;
+    r->days = o->nxExpirationDate.NDays - h.nxSessionDate.NDays;
+    r->put = 1 == o->PutCall;
+  }
+}
+
+/**
+ * Hands a trade of option *id* to the partition of underlying *uid*.
+ */
+static inline void _ochan_trade(unsigned int uid,
+                                unsigned int clock,
+                                unsigned int id,
+                                const NxCoreHeader &h,
+                                const NxCoreTrade &t)
+{
+  nxtape_orec *r = _ochan_rec(uid, clock);
+  r->type = WineingMarketDataProto::MarketData::TRADE;
+  r->symbol_id = id;
+  r->timestamp = h.nxExgTimestamp.MsOfDay;
+  r->price = t.Price;
+  r->size = t.Size;
+  r->exg = h.ReportingExg;
+  r->price_type = t.PriceType;
+}
+
+/**
+ * Saves NxCore's state and hands the directory to *g_ckpt* if a
+ * checkpoint is due. Invoked with STATUS messages of the running live
+ * tape.
+ */
+static void _checkpoint(unsigned int clock)
+{
+  if(0 == g_ckpt_next) {
+    g_ckpt_next = clock + g_conf->checkpoint_interval;
+    return;
+  }
+  if(clock < g_ckpt_next) {
+    return;
+  }
+  g_ckpt_next = clock + g_conf->checkpoint_interval;
+
+  int slot = checkpoint_begin(g_ckpt);
+  if(0 > slot) {
+    log(LOG_WARN, "Skipping checkpoint, the previous one is still written");
+    return;
+  }
+
+  char path[CHECKPOINT_PATH_SIZE];
+  char nxpath[CHECKPOINT_PATH_SIZE];
+  if(0 > checkpoint_path(g_ckpt, slot, CHECKPOINT_NXCORE_SUFFIX, path, sizeof(path))
+     || 0 > wininf_nxcore_path(path, nxpath, sizeof(nxpath))
+     || 0 > wininf_nxcore_save_state(nxpath)
+     || 0 > checkpoint_submit(g_ckpt, slot, g_live.syms, clock, g_seq)) {
+    log(LOG_ERROR, "Failed checkpointing to slot %d", slot);
+  }
+}
+
+/**
+ * \return The context of the tape *pNxCoreSys* belongs to
+ */
+static inline nxtape_ctx* _ctx(const NxCoreSystem *pNxCoreSys)
+{
+  return 0 == pNxCoreSys->UserData ?
+    &g_live : g_replays[pNxCoreSys->UserData - 1];
+}
 
 /**
  * Prcesses each market data update from NxCore sends it through a ZMQ
@@ -35,19 +1417,41 @@ int STDCALL nxtape_process(const NxCoreSystem *pNxCoreSys,
 {
   using namespace WineingMarketDataProto;
 
-  char *buffer;
-  static MarketData m;
-  static int t_version = DEFAULTS_SHARED_VERSION_READ_INIT;
-  static w_ctrl t_data = {
-    WINEING_CTRL_CMD_INIT,
-    new char[WINEING_CTRL_DEFAULT_DATA_SIZE],
-    0
-  };
+  nxtape_ctx *c = _ctx(pNxCoreSys);
+  int live = &g_live == c;
+  MarketData &m = c->m;
+
+  const NxCoreHeader &h = pNxCoreMsg->coreHeader;
+  unsigned int id;
+  unsigned int uid;
+  int spot;
 
-  t_version = lazy_update_local_if_changed(t_version,
-                                           &t_data,
-                                           &g_data,
-                                           _copy_shared_to_local);
+  int version = lazy_update_local_if_changed(c->version,
+                                             &c->data,
+                                             &g_data,
+                                             _copy_shared_to_local);
+  if(live && version != c->version) {
+    _filter_update(c);
+  }
+  c->version = version;
+
+  if(live && 0 < g_conf->mchan_trace) {
+    // Sampled when sent, most traces are never used
+    g_trace.callback = tracehdr_now();
+    g_trace_sys = pNxCoreSys;
+  }
+
+  if(live) {
+    // The channels of the previous message are no longer used, see
+    // conc/rcu.h
+    rcu_quiescent(&g_rconf, g_rslot);
+    const w_rconf *rc = (const w_rconf*)rcu_deref(&g_rconf);
+    g_mchan = rc->mchan;
+    g_bchan = rc->bchan;
+    if(rc->generation != c->rconf_generation) {
+      _rconf_update(c, rc);
+    }
+  }
 
   // Because we reuse protobuf objects we to clear them
   m.Clear();
@@ -61,47 +1465,467 @@ int STDCALL nxtape_process(const NxCoreSystem *pNxCoreSys,
   switch( pNxCoreMsg->MessageType )
     {
     case NxMSG_STATUS:
-      m.set_type(MarketData::STATUS);
+      if(NULL != c->embedded) {
+        _embed_status(c, pNxCoreSys->nxTime.MsOfDay);
+        break;
+      }
+      if(live
+         && NxCORESTATUS_INITIALIZING == pNxCoreSys->Status
+         && g_seq < seqhdr_day(pNxCoreSys->nxDate.NDays)) {
+        // A day's tape numbers its frames alike in every Wineing, a
+        // restored checkpoint continues the day
+        g_seq = seqhdr_day(pNxCoreSys->nxDate.NDays);
+      }
+      _send_frame(c, &g_status);
+      if(!live) {
+        // A journal is read from the start, no need to republish the
+        // directory
+        break;
+      }
+      if(NULL != g_interest) {
+        _interest_poll();
+      }
+      _send_symbol_dir(c);
+
+      // Bounds the latency of the compressed channel to the NxCore
+      // clock interval on quiet symbols
+      if(NULL != g_batch) {
+        _batch_flush();
+      }
+      _ochan_status(pNxCoreSys->nxTime.MsOfDay);
 
-      int buf_size = m.ByteSize();
-      buffer = new char[buf_size];
-      google::protobuf::io::ArrayOutputStream os (buffer, buf_size);
-      m.SerializeToZeroCopyStream(&os);
-      chan_send(g_mchan, buffer, m.ByteSize());
+      // Completes bars even if no trade follows
+      _bars_roll(pNxCoreSys->nxTime.MsOfDay);
+
+      // Quotes of the previous tape are stale
+      if(NULL != g_nbbo && NxCORESTATUS_INITIALIZING == pNxCoreSys->Status) {
+        nbbo_clear(g_nbbo);
+      }
+
+      if(NULL != g_ckpt) {
+        if(NxCORESTATUS_INITIALIZING == pNxCoreSys->Status) {
+          g_ckpt_next = 0;
+        } else if(NxCORESTATUS_RUNNING == pNxCoreSys->Status) {
+          _checkpoint(pNxCoreSys->nxTime.MsOfDay);
+        }
+      }
       break;
 
-    // case NxMSG_EXGQUOTE:
-    //   m.set_type(MarketData::QUOTE_EX);
-    //   chan_send(g_mchan, buffer, m.ByteSize(), NULL);
-    //   break;
+    case NxMSG_EXGQUOTE:
+      if(!_filter_type(c, MarketData::QUOTE_EX)
+         && !_filter_type(c, MarketData::NBBO)) {
+        break;
+      }
+      id = _symbol_id(c, h.pnxStringSymbol, h.pnxOptionHdr, h.ListedExg, 1);
+      if(SYMTAB_NONE != id && _filter_symbol(c, id, h)) {
+        const NxCoreQuote &q = pNxCoreMsg->coreData.ExgQuote.coreQuote;
+        if(NULL != c->quotes) {
+          _column_quote(c, id, h, q);
+          break;
+        }
+        if(NULL != c->embedded) {
+          _embed_quote(c, id, h, q);
+          break;
+        }
+        if(live && NULL != g_nbbo && _filter_type(c, MarketData::NBBO)) {
+          _nbbo_quote(id, h, q);
+        }
+        if(!_filter_type(c, MarketData::QUOTE_EX)) {
+          break;
+        }
+        uid = _ochan_underlying(c, id, h);
+        if(SYMTAB_NONE != uid) {
+          _ochan_quote(uid, pNxCoreSys->nxTime.MsOfDay, id, h, q);
+          break;
+        }
+        if(!_interested(c, id, h)) {
+          break;
+        }
+        if(live && NULL != g_qdelta) {
+          qdelta_quote d = {
+            (int)h.nxExgTimestamp.MsOfDay,
+            q.BidPrice,
+            q.AskPrice,
+            q.BidSize,
+            q.AskSize,
+            h.ReportingExg,
+            q.PriceType
+          };
+          _send_qdelta(id, &d);
+          break;
+        }
+        m.set_type(MarketData::QUOTE_EX);
+        m.set_symbol_id(id);
+        m.set_timestamp(h.nxExgTimestamp.MsOfDay);
+        m.set_price_type(q.PriceType);
+        m.set_reporting_exg(h.ReportingExg);
+        m.set_bid_price(q.BidPrice);
+        m.set_ask_price(q.AskPrice);
+        m.set_bid_size(q.BidSize);
+        m.set_ask_size(q.AskSize);
+        _send(c, m);
+      }
+      break;
 
-    // case NxMSG_MMQUOTE:
-    //   m.set_type(MarketData::QUOTE_EX);
-    //   chan_send(g_mchan, buffer, m.ByteSize(), NULL);
-    //   break;
+    case NxMSG_TRADE:
+      spot = live && NULL != g_spot_of && NULL == h.pnxOptionHdr;
+      if(!_filter_type(c, MarketData::TRADE)
+         && !_filter_type(c, MarketData::BAR)
+         && !spot) {
+        break;
+      }
+      id = _symbol_id(c, h.pnxStringSymbol, h.pnxOptionHdr, h.ListedExg, 1);
+      if(SYMTAB_NONE != id && spot) {
+        // Whether or not the underlying itself is published
+        _spot_trade(id, pNxCoreMsg->coreData.Trade);
+      }
+      if(SYMTAB_NONE != id && _filter_symbol(c, id, h)) {
+        const NxCoreTrade &t = pNxCoreMsg->coreData.Trade;
+        if(NULL != c->trades) {
+          _column_trade(c, id, h, t);
+          break;
+        }
+        if(NULL != c->embedded) {
+          _embed_trade(c, id, h, t);
+          break;
+        }
+        uid = _ochan_underlying(c, id, h);
+        if(SYMTAB_NONE != uid && _filter_type(c, MarketData::TRADE)) {
+          _ochan_trade(uid, pNxCoreSys->nxTime.MsOfDay, id, h, t);
+        } else if(_filter_type(c, MarketData::TRADE)
+                  && _interested(c, id, h)) {
+          m.set_type(MarketData::TRADE);
+          m.set_symbol_id(id);
+          m.set_timestamp(h.nxExgTimestamp.MsOfDay);
+          m.set_price_type(t.PriceType);
+          m.set_reporting_exg(h.ReportingExg);
+          m.set_price(t.Price);
+          m.set_size(t.Size);
+          _send(c, m);
+        }
+        if(!live || !_filter_type(c, MarketData::BAR)) {
+          break;
+        }
+
+        // Bars follow the NxCore clock rather than exchange
+        // timestamps which are not monotonic across exchanges
+        _bars_roll(pNxCoreSys->nxTime.MsOfDay);
+        for(int i = 0; i < g_bars_size; i++) {
+          bars_add(g_bars[i], id, t.Price, t.Size, t.PriceType,
+                   _send_bar, NULL);
+        }
+      }
+      break;
 
-    // case NxMSG_TRADE:
-    //   m.set_type(MarketData::QUOTE_EX);
+    case NxMSG_SYMBOLSPIN:
+      // NxCore spins all known symbols when a tape starts. Populates
+      // the directory without publishing anything but SYMBOLs.
+      _symbol_id(c, h.pnxStringSymbol, h.pnxOptionHdr, h.ListedExg, 1);
+      break;
+
+    case NxMSG_SYMBOLCHANGE:
+      _symbol_change(c, pNxCoreMsg);
+      break;
+
+    // case NxMSG_MMQUOTE:
+    //   m.set_type(MarketData::QUOTE_MM);
     //   chan_send(g_mchan, buffer, m.ByteSize(), NULL);
     //   break;
 
     // case NxMSG_CATEGORY:
-    //   m.set_type(MarketData::QUOTE_EX);
+    //   m.set_type(MarketData::CATEGORY);
     //   chan_send(g_mchan, buffer, m.ByteSize(), NULL);
     //   break;
-      //case NxMSG_SYMBOLCHANGE:
-      //break;
-      //case NxMSG_SYMBOLSPIN:
-      //break;
     }
 
-  return t_data.cmd < WINEING_CTRL_CMD_MARKET_RUN ?
+  // Replays are independent of MARKET_START/STOP and only stop on
+  // shutdown, embedded ones once the application stops them
+  if(!live) {
+    return WINEING_CTRL_CMD_SHUTDOWN == c->data.cmd
+      || c->journal_failed
+      || (NULL != c->embedded && c->embedded->stopped) ?
+      NxCALLBACKRETURN_STOP : NxCALLBACKRETURN_CONTINUE;
+  }
+  return c->data.cmd < WINEING_CTRL_CMD_MARKET_RUN ?
     NxCALLBACKRETURN_STOP : NxCALLBACKRETURN_CONTINUE;
 }
 
-void nxtape_init(chan *cchan_out, chan *mchan)
+/**
+ * Builds the templates of the fixed frames. Invoked once, by the
+ * first tape started.
+ */
+static void _frames_init()
+{
+  WineingMarketDataProto::MarketData m;
+  m.set_type(WineingMarketDataProto::MarketData::STATUS);
+  pbframe_init(&g_status, m, PBFRAME_NONE);
+}
+
+void nxtape_init(const w_conf *conf, int rslot)
+{
+  g_conf = conf;
+  g_rslot = rslot;
+  pthread_once(&g_frames_once, _frames_init);
+
+  const w_partition *p = NULL == conf->partition ?
+    NULL : partition_find(conf->partition);
+  if(NULL != p) {
+    g_prefix = p->prefix;
+    g_prefix_size = strlen(p->prefix);
+  }
+
+  // The directory outlives single tapes. Symbols keep their ids when
+  // the next tape is replayed.
+  if(NULL == g_live.syms) {
+    g_live.syms = symtab_init(DEFAULTS_SYMTAB_CAPACITY);
+    g_live.symtab_cursor = 0;
+    g_live.version = DEFAULTS_SHARED_VERSION_READ_INIT;
+    g_live.data.cmd = WINEING_CTRL_CMD_INIT;
+    g_live.data.data = new char[WINEING_CTRL_DEFAULT_DATA_SIZE];
+    g_live.data.size = 0;
+  }
+
+  if(NULL == g_qdelta
+     && WINEING_MCHAN_ENCODING_DELTA == conf->mchan_encoding) {
+    g_qdelta = qdelta_init(DEFAULTS_SYMTAB_CAPACITY, DEFAULTS_QDELTA_REFRESH);
+  }
+
+  if(NULL == g_interest && conf->mchan_xpub) {
+    g_interest = interest_init();
+  }
+}
+
+void nxtape_batch_init(chan *mchan_batch)
 {
-  g_cchan_out = cchan_out;
-  g_mchan = mchan;
+  g_mchan_batch = mchan_batch;
+  if(NULL == g_batch) {
+    g_batch = lz4batch_init(DEFAULTS_LZ4_BATCH_SIZE);
+  }
+}
+
+void nxtape_bars_init()
+{
+  if(0 == g_bars_size) {
+    for(int i = 0; i < g_conf->bar_intervals_size; i++) {
+      g_bars[g_bars_size++] = bars_init(DEFAULTS_SYMTAB_CAPACITY,
+                                        g_conf->bar_intervals[i]);
+    }
+  }
+}
+
+void nxtape_nbbo_init(chan *nchan)
+{
+  g_nchan = nchan;
+  if(NULL == g_nbbo) {
+    g_nbbo = nbbo_init(DEFAULTS_SYMTAB_CAPACITY);
+  }
+}
+
+void nxtape_ochan_init(chan **ochan, int size)
+{
+  g_ochan_size = size;
+  for(int i = 0; i < size; i++) {
+    g_ochan[i] = ochan[i];
+    if(NULL == g_obatch[i]) {
+      g_obatch[i] = (nxtape_orec*)
+        new char[DEFAULTS_OCHAN_BATCH_SIZE * sizeof(nxtape_orec)];
+    }
+  }
+  if(NULL == g_underlyings) {
+    g_underlyings = symtab_init(DEFAULTS_URATE_CAPACITY);
+  }
+  if(g_conf->greeks && NULL == g_spot_of) {
+    _reserve(&g_spot, &g_spot_capacity, 0);
+    _reserve(&g_spot_of, &g_spot_of_capacity, 0);
+  }
+}
+
+void nxtape_checkpoint_init(checkpoint *c)
+{
+  g_ckpt = c;
+  g_ckpt_next = 0;
+}
+
+long nxtape_checkpoint_restore(checkpoint *c, int slot)
+{
+  uint64_t seq;
+  long clock = checkpoint_restore(c, slot, g_live.syms, &seq);
+  if(0 <= clock) {
+    g_seq = seq;
+  } else if(0 < g_live.syms->size) {
+    // Partially restored, start over with an empty directory
+    symtab_destroy(g_live.syms);
+    g_live.syms = symtab_init(DEFAULTS_SYMTAB_CAPACITY);
+  }
+  return clock;
+}
+
+/**
+ * Allocates a replay context and registers it in a free slot.
+ *
+ * \return The slot or -1 if all are in use
+ */
+static int _replay_init()
+{
+  int slot;
+
+  pthread_mutex_lock(&g_replays_mutex);
+  for(slot = 0; slot < WINEING_BATCH_MAX_WORKERS; slot++) {
+    if(NULL == g_replays[slot]) {
+      break;
+    }
+  }
+  if(WINEING_BATCH_MAX_WORKERS == slot) {
+    pthread_mutex_unlock(&g_replays_mutex);
+    return -1;
+  }
+
+  nxtape_ctx *c = new (std::nothrow) nxtape_ctx;
+  if(NULL == c) {
+    pthread_mutex_unlock(&g_replays_mutex);
+    return -1;
+  }
+  g_replays[slot] = c;
+  pthread_mutex_unlock(&g_replays_mutex);
+
+  pthread_once(&g_frames_once, _frames_init);
+
+  c->syms = symtab_init(DEFAULTS_SYMTAB_CAPACITY);
+  c->symtab_cursor = 0;
+  c->version = DEFAULTS_SHARED_VERSION_READ_INIT;
+  c->data.cmd = WINEING_CTRL_CMD_INIT;
+  c->data.data = new char[WINEING_CTRL_DEFAULT_DATA_SIZE];
+  c->data.size = 0;
+  c->journal = INVALID_HANDLE_VALUE;
+  c->journal_buf = NULL;
+  c->trades = NULL;
+  c->quotes = NULL;
+  c->embedded = NULL;
+  c->filter = NULL;
+  c->messages = 0;
+  c->journal_failed = 0;
+  return slot;
+}
+
+/**
+ * Frees the context of *slot*.
+ */
+static void _replay_destroy(int slot)
+{
+  nxtape_ctx *c = g_replays[slot];
+
+  pthread_mutex_lock(&g_replays_mutex);
+  g_replays[slot] = NULL;
+  pthread_mutex_unlock(&g_replays_mutex);
+
+  symtab_destroy(c->syms);
+  delete [] c->data.data;
+  delete c;
+}
+
+long nxtape_replay(const char *tape, const char *journal)
+{
+  long rc = -1;
+  int slot = _replay_init();
+  if(0 > slot) {
+    return -1;
+  }
+
+  nxtape_ctx *c = g_replays[slot];
+  c->journal_buf = lz4batch_init(DEFAULTS_JOURNAL_BUFFER_SIZE);
+  c->journal = CreateFile(journal,
+                          GENERIC_WRITE,
+                          0,
+                          NULL,
+                          CREATE_ALWAYS,
+                          FILE_ATTRIBUTE_NORMAL,
+                          NULL);
+
+  if(INVALID_HANDLE_VALUE == c->journal) {
+    log(LOG_ERROR, "Failed creating journal '%s'", journal);
+  } else {
+    // NxCore keeps separate string tables per processed tape, the
+    // symbol ids cached in NxString.UserData1 don't clash
+    // Market maker quotes are never journaled
+    if(0 == wininf_nxcore_run((char*)tape,
+                              slot + 1,
+                              WININF_NXCORE_EXCLUDE_MM_QUOTES,
+                              nxtape_process)) {
+      rc = c->messages;
+    }
+    _journal_flush(c);
+    if(c->journal_failed) {
+      rc = -1;
+    }
+    CloseHandle(c->journal);
+  }
+
+  lz4batch_destroy(c->journal_buf);
+  _replay_destroy(slot);
+  return rc;
+}
+
+long nxtape_columnar(const char *tape, const char *base)
+{
+  static const char *trade_names[] = {
+    "timestamp", "price", "size", "price_type", "exg"
+  };
+  static const size_t trade_sizes[] = {
+    sizeof(uint32_t), sizeof(int32_t), sizeof(uint32_t),
+    sizeof(uint8_t), sizeof(uint16_t)
+  };
+  static const char *quote_names[] = {
+    "timestamp", "bid_price", "ask_price", "bid_size", "ask_size",
+    "price_type", "exg"
+  };
+  static const size_t quote_sizes[] = {
+    sizeof(uint32_t), sizeof(int32_t), sizeof(int32_t), sizeof(uint32_t),
+    sizeof(uint32_t), sizeof(uint8_t), sizeof(uint16_t)
+  };
+
+  long rc = -1;
+  int slot = _replay_init();
+  if(0 > slot) {
+    return -1;
+  }
+
+  nxtape_ctx *c = g_replays[slot];
+  c->trades = coltab_init(trade_names, trade_sizes, COL_TRADE_COLUMNS);
+  c->quotes = coltab_init(quote_names, quote_sizes, COL_QUOTE_COLUMNS);
+
+  if(0 == wininf_nxcore_run((char*)tape,
+                            slot + 1,
+                            WININF_NXCORE_EXCLUDE_MM_QUOTES,
+                            nxtape_process)) {
+    std::string path (base);
+    rc = c->trades->rows + c->quotes->rows;
+    if(0 > coltab_write(c->trades, (path + ".trade").c_str(), c->syms)
+       || 0 > coltab_write(c->quotes, (path + ".quote").c_str(), c->syms)) {
+      log(LOG_ERROR, "Failed writing columns '%s'", base);
+      rc = -1;
+    }
+  }
+
+  coltab_destroy(c->trades);
+  coltab_destroy(c->quotes);
+  _replay_destroy(slot);
+  return rc;
+}
+
+int nxtape_embed(const char *tape, unsigned int flags, embed *e)
+{
+  int slot = _replay_init();
+  if(0 > slot) {
+    return -1;
+  }
+
+  g_replays[slot]->embedded = e;
+  int rc = wininf_nxcore_run((char*)tape, slot + 1, flags, nxtape_process);
 
+  // Stopped by the application, not a failure
+  if(0 > rc && e->stopped) {
+    rc = 0;
+  }
+  _replay_destroy(slot);
+  return rc;
 }
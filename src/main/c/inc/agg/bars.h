@@ -0,0 +1,113 @@
+#ifndef _BARS_H
+#define _BARS_H
+
+/*
+  OHLCV bar aggregation of trades.
+
+  The accumulators of all symbols are kept in a struct of arrays
+  indexed by symbol id (see sym/symtab.h). Updating a bar touches only
+  the arrays it needs and rolling over walks the list of symbols that
+  traded in the interval rather than all symbols.
+
+  Bars are aligned to multiples of the interval since midnight
+  (NxCore's MsOfDay). The caller drives time, usually with the NxCore
+  system clock: a bar is complete as soon as the clock passed on a
+  trade or a clock update (NxCore STATUS) falls into a later interval.
+  Only symbols with at least one trade in the interval emit a bar.
+
+  Prices are NxCore integers of the price type of the bar's trades.
+  They only compare within a price type, a trade of another one
+  completes the symbol's bar early and opens the next one in the same
+  interval. Not thread safe.
+*/
+
+/**
+ * \struct
+ *
+ * A completed bar as passed to *bars_emitFn*.
+ */
+typedef struct
+{
+  unsigned int start;       // ms of day the interval started
+  unsigned int interval;    // ms
+  int open;
+  int high;
+  int low;
+  int close;
+  unsigned long long volume;
+  double vwap;
+  unsigned int trades;
+  unsigned char price_type;
+} bar;
+
+/**
+ * \struct
+ *
+ * The per-symbol accumulators of the current interval.
+ */
+typedef struct
+{
+  int *open;
+  int *high;
+  int *low;
+  int *close;
+  unsigned long long *volume;
+  double *notional;         // sum of price * size
+  unsigned int *trades;     // 0 if the symbol did not trade yet
+  unsigned char *price_type;
+  unsigned int capacity;
+
+  unsigned int *touched;    // ids with trades in the current interval
+  unsigned int touched_size;
+
+  unsigned int interval;
+  unsigned int bucket;      // current interval, start / interval
+} bars;
+
+/**
+ * Invoked for each completed bar.
+ *
+ * \param id  The symbol id
+ * \param b   The bar, only valid for the duration of the call
+ */
+typedef void (*bars_emitFn)(unsigned int id, const bar *b, void *obj);
+
+/**
+ * Allocates the accumulators.
+ *
+ * \param capacity Initial number of symbols
+ * \param interval Bar length in ms
+ * \return         The accumulators or NULL if allocation failed
+ */
+bars* bars_init(unsigned int capacity, unsigned int interval);
+
+/**
+ * Frees the accumulators.
+ */
+void bars_destroy(bars *b);
+
+/**
+ * Completes the current interval if *ms_of_day* falls into another
+ * one, invoking *fn* for each symbol that traded. Going back in time,
+ * e.g. when the next tape starts, completes the interval as well.
+ *
+ * \return The number of bars emitted
+ */
+int bars_roll(bars *b, unsigned int ms_of_day, bars_emitFn fn, void *obj);
+
+/**
+ * Adds a trade to the bar of symbol *id*. The caller is responsible for
+ * invoking *bars_roll* with the trade's time first. *fn* is invoked
+ * with the bar so far if *price_type* differs from its trades'.
+ *
+ * \return 0 if successful, -1 if the accumulators could not grow
+ */
+int bars_add(bars *b,
+             unsigned int id,
+             int price,
+             unsigned int size,
+             unsigned char price_type,
+             bars_emitFn fn,
+             void *obj);
+
+#endif /* _BARS_H */
@@ -0,0 +1,141 @@
+#ifndef _GREEKS_H
+#define _GREEKS_H
+
+#include <stddef.h>
+
+/*
+  Implied volatility, delta, gamma and vega of batches of option
+  quotes.
+
+  Options are priced with Black-Scholes, European exercise and no
+  dividends, at the mid of the quote. Quotes are added to a batch, a
+  struct of arrays, and computed at once. The volatility is solved
+  with a fixed number of Newton iterations started at the inflection
+  point of the price (Manaster and Koehler), which converges
+  monotonically for every price within the arbitrage bounds. The
+  normal distribution is approximated to 1e-7 (Abramowitz and Stegun
+  26.2.17), exp and log with polynomials, so that lanes never branch.
+
+  The kernel is compiled for AVX-512, AVX2 with FMA and plain scalar
+  code. The widest the CPU supports is chosen at runtime on first use.
+  All produce the same results up to rounding.
+
+  Results are NaN for quotes outside the arbitrage bounds, expired
+  options and one-sided quotes. Not thread safe, each thread owns its
+  batches.
+*/
+
+// Instruction sets of the kernel, see *greeks_compute_isa*
+#define GREEKS_ISA_SCALAR 0
+#define GREEKS_ISA_AVX2   1
+#define GREEKS_ISA_AVX512 2
+
+// Newton iterations solving the implied volatility
+#define GREEKS_ITERATIONS 16
+
+/**
+ * \struct
+ *
+ * A batch of option quotes and their results, indexed alike. Arrays
+ * are padded to a multiple of 8 elements.
+ */
+typedef struct
+{
+  // Inputs, see *greeks_add*
+  double *spot;
+  double *strike;
+  double *years;
+  double *price;
+  double *sign;                 // 1 for calls, -1 for puts
+
+  // Results of *greeks_compute*
+  double *iv;
+  double *delta;
+  double *gamma;
+  double *vega;                 // per 1.0 of volatility
+
+  size_t size;
+  size_t capacity;
+  double rate;                  // risk free, continuously compounded
+} greeks;
+
+/**
+ * Allocates a batch.
+ *
+ * \param capacity Quotes the batch holds at most
+ * \param rate     The risk free rate, e.g. 0.05
+ * \return         The batch or NULL if allocation failed
+ */
+greeks* greeks_init(size_t capacity, double rate);
+
+/**
+ * Frees *g*.
+ */
+void greeks_destroy(greeks *g);
+
+/**
+ * Removes all quotes.
+ */
+inline void greeks_clear(greeks *g)
+{
+  g->size = 0;
+}
+
+/**
+ * Adds an option quote.
+ *
+ * \param spot   Price of the underlying
+ * \param strike Strike price
+ * \param years  Time to expiry in years
+ * \param price  Mid of the option quote
+ * \param put    1 for puts, 0 for calls
+ * \return       The quote's index or -1 if the batch is full
+ */
+inline long greeks_add(greeks *g,
+                       double spot,
+                       double strike,
+                       double years,
+                       double price,
+                       int put)
+{
+  if(g->size == g->capacity) {
+    return -1;
+  }
+  size_t i = g->size++;
+  g->spot[i] = spot;
+  g->strike[i] = strike;
+  g->years[i] = years;
+  g->price[i] = price;
+  g->sign[i] = put ? -1.0 : 1.0;
+  return i;
+}
+
+/**
+ * \return 1 if the results of quote *i* are computed, 0 if they are
+ *         NaN. Doesn't need math.h.
+ */
+inline int greeks_valid(const greeks *g, size_t i)
+{
+  return g->iv[i] == g->iv[i];
+}
+
+/**
+ * \return The widest instruction set supported by the CPU
+ */
+int greeks_isa();
+
+/**
+ * Computes the results of all quotes with the widest kernel the CPU
+ * supports.
+ */
+void greeks_compute(greeks *g);
+
+/**
+ * Computes the results of all quotes with the kernel of instruction
+ * set *isa*, e.g. to compare them.
+ *
+ * \return 0 if successful, -1 if the CPU doesn't support *isa*
+ */
+int greeks_compute_isa(greeks *g, int isa);
+
+#endif /* _GREEKS_H */
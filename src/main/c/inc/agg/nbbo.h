@@ -0,0 +1,123 @@
+#ifndef _NBBO_H
+#define _NBBO_H
+
+/*
+  National best bid and offer consolidated from exchange quotes.
+
+  Each symbol has a book of the last quote of every venue in
+  fixed-width arrays (struct of arrays within the book). NxCore
+  reporting exchanges are assigned lanes in the order they first quote,
+  the same lane in all books. An exchange quote replaces the lane of its venue
+  and updates the NBBO incrementally: a lane improving on the best
+  price takes it over, a lane neither at nor improving on it leaves
+  that side as is. Otherwise the side is recomputed with a max (bids)
+  or min (asks) over all lanes, four at a time with SSE2 where
+  available.
+
+  Sizes are the sum over all venues quoting the best price, the
+  exchange is the lowest venue quoting it. A side without quotes has
+  price and size 0. A price or size of 0 removes the venue's quote from
+  that side.
+
+  Books are allocated on a symbol's first quote, symbols are
+  identified by ids (see sym/symtab.h). Prices are NxCore integers of
+  the price type of the symbol's last quote. Not thread safe.
+*/
+
+// Lanes per book. Quotes of exchanges without a lane once all are
+// assigned are dropped and counted. A multiple of four.
+#define NBBO_VENUES 32
+
+// Exchange codes mapped to lanes, NxCore's ReportingExg is a short
+#define NBBO_EXCHANGES 65536
+
+/**
+ * \struct
+ *
+ * The NBBO of a symbol.
+ */
+typedef struct
+{
+  int bid;
+  int ask;
+  unsigned int bid_size;        // summed over the venues at *bid*
+  unsigned int ask_size;
+  unsigned short bid_exg;       // lowest venue at *bid*
+  unsigned short ask_exg;
+  unsigned char price_type;
+} nbbo_quote;
+
+/**
+ * \struct
+ *
+ * The last quote of each venue of a symbol.
+ */
+typedef struct
+{
+  int bid[NBBO_VENUES];         // INT_MIN if the venue has no bid
+  int ask[NBBO_VENUES];         // INT_MAX if the venue has no ask
+  unsigned int bid_size[NBBO_VENUES];
+  unsigned int ask_size[NBBO_VENUES];
+} nbbo_book;
+
+/**
+ * \struct
+ *
+ * The books and NBBOs of all symbols, indexed by symbol id.
+ */
+typedef struct
+{
+  nbbo_book **books;            // NULL until the symbol's first quote
+  nbbo_quote *best;
+  unsigned int capacity;
+  unsigned char lanes[NBBO_EXCHANGES]; // lane + 1 of each venue, 0 if none
+  unsigned short venues[NBBO_VENUES];  // venue of each lane
+  unsigned int venue_count;
+  unsigned long dropped;        // quotes of venues without a lane
+} nbbo;
+
+/**
+ * Allocates the tables.
+ *
+ * \param capacity Initial number of symbols
+ * \return         The tables or NULL if allocation failed
+ */
+nbbo* nbbo_init(unsigned int capacity);
+
+/**
+ * Frees the tables and all books.
+ */
+void nbbo_destroy(nbbo *n);
+
+/**
+ * Removes all quotes, e.g. when the next tape starts. Books stay
+ * allocated, venues keep their lanes.
+ */
+void nbbo_clear(nbbo *n);
+
+/**
+ * Replaces the quote of venue *exg* of symbol *id* and updates the
+ * symbol's NBBO.
+ *
+ * \return 1 if the NBBO changed, 0 if not or if *exg* got no lane,
+ *         -1 if the tables could not grow
+ */
+int nbbo_update(nbbo *n,
+                unsigned int id,
+                unsigned int exg,
+                int bid,
+                unsigned int bid_size,
+                int ask,
+                unsigned int ask_size,
+                unsigned char price_type);
+
+/**
+ * \return The NBBO of symbol *id*, which must have been passed to
+ *         *nbbo_update* before
+ */
+inline const nbbo_quote* nbbo_get(const nbbo *n, unsigned int id)
+{
+  return &n->best[id];
+}
+
+#endif /* _NBBO_H */
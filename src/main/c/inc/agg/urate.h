@@ -0,0 +1,105 @@
+#ifndef _URATE_H
+#define _URATE_H
+
+#include "sym/symtab.h"
+
+/*
+  Per-underlying message rates of the option partitions published on
+  ochan.
+
+  Option messages are partitioned by underlying. Each partition is
+  owned by one of w_conf.ochan_size publisher threads, the partition
+  of an underlying is *urate_shard* of its name. Consumers compute the
+  same hash to find the endpoint carrying the underlyings they
+  subscribe to.
+
+  Underlyings are identified by a dense id handed out by the NxCore
+  callback (see sym/symtab.h). Counters are kept in arrays indexed by
+  that id and, like bars (see agg/bars.h), aligned to multiples of
+  the interval since midnight. Rolling over walks the underlyings
+  with messages in the interval only.
+
+  Not thread safe. Each publisher thread owns the counters of its
+  partition.
+*/
+
+/**
+ * \struct
+ *
+ * The per-underlying counters of the current interval.
+ */
+typedef struct
+{
+  unsigned int *messages;       // in the current interval
+  unsigned long long *total;    // since the counters were allocated
+  char (*names)[SYMTAB_NAME_SIZE];
+  unsigned int capacity;
+
+  unsigned int *touched;        // ids with messages in the interval
+  unsigned int touched_size;
+
+  unsigned int interval;
+  unsigned int bucket;          // current interval, start / interval
+} urate;
+
+/**
+ * Invoked for each underlying with messages in a completed interval.
+ *
+ * \param id       The underlying id
+ * \param name     The underlying, e.g. "eAAPL"
+ * \param start    ms of day the interval started
+ * \param messages Messages in the interval
+ * \param total    Messages since the counters were allocated
+ */
+typedef void (*urate_emitFn)(unsigned int id,
+                             const char *name,
+                             unsigned int start,
+                             unsigned int messages,
+                             unsigned long long total,
+                             void *obj);
+
+/**
+ * Allocates the counters.
+ *
+ * \param capacity Initial number of underlyings
+ * \param interval Length of the rate interval in ms
+ * \return         The counters or NULL if allocation failed
+ */
+urate* urate_init(unsigned int capacity, unsigned int interval);
+
+/**
+ * Frees the counters.
+ */
+void urate_destroy(urate *r);
+
+/**
+ * Counts a message of underlying *id*. *name* is copied the first
+ * time the id is seen. The caller is responsible for invoking
+ * *urate_roll* with the message's time first.
+ *
+ * \return 0 if successful, -1 if the counters could not grow
+ */
+int urate_add(urate *r, unsigned int id, const char *name);
+
+/**
+ * Completes the current interval if *ms_of_day* falls into another
+ * one, invoking *fn* for each underlying with messages.
+ *
+ * \return The number of underlyings emitted
+ */
+int urate_roll(urate *r, unsigned int ms_of_day, urate_emitFn fn, void *obj);
+
+/**
+ * \return The partition of underlying *name*, in [0, shards). FNV-1a
+ *         of the name, stable across runs.
+ */
+inline unsigned int urate_shard(const char *name, unsigned int shards)
+{
+  unsigned int h = 2166136261u;
+  for(; '\0' != *name; name++) {
+    h = (h ^ (unsigned char)*name) * 16777619u;
+  }
+  return 0 < shards ? h % shards : 0;
+}
+
+#endif /* _URATE_H */
@@ -0,0 +1,162 @@
+#ifndef _LZ4BATCH_H
+#define _LZ4BATCH_H
+
+#include <stddef.h>
+
+/*
+  Batching and LZ4 block compression [1] of market data frames for
+  bandwidth bound consumers, e.g. on WAN links.
+
+  The NxCore callback appends each frame it publishes to a batch. A
+  full batch (or one flushed on a NxCore STATUS message) is handed
+  over to a separate thread which compresses it and publishes it on
+  its own channel. Compression therefore never runs in the NxCore
+  callback.
+
+  Uncompressed batch layout, one entry per frame:
+
+    varint   frame size
+    bytes    frame (protobuf MarketData or delta frame, see qdelta.h)
+
+  Compressed message layout as sent on the wire:
+
+    varint   uncompressed batch size
+    bytes    LZ4 block
+
+  An optional dictionary primes the compressor. LZ4 has no dictionary
+  trainer, a dictionary is simply a sample of typical frames, e.g. a
+  few concatenated uncompressed batches. Consumers need the same
+  dictionary to decompress. Only the last 64KB of the dictionary are
+  used.
+
+  [1] https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md
+*/
+
+#define LZ4BATCH_MAX_DICT_SIZE  65536
+
+/**
+ * \struct
+ *
+ * A batch of frames being built by the NxCore callback.
+ */
+typedef struct
+{
+  char *data;
+  size_t size;
+  size_t capacity;
+} lz4batch;
+
+/**
+ * \struct
+ *
+ * Compression statistics of a *lz4comp*.
+ */
+typedef struct
+{
+  unsigned long batches;
+  unsigned long bytes_in;
+  unsigned long bytes_out;
+  unsigned long cpu_ns;     // thread cpu time spent compressing
+} lz4comp_stats;
+
+/**
+ * \struct
+ *
+ * Compressor state. Owned by the compressing thread.
+ */
+typedef struct
+{
+  void *stream;             // LZ4_stream_t
+  char *dict;
+  int dict_size;
+  lz4comp_stats stats;
+} lz4comp;
+
+/**
+ * Allocates a batch holding up to *capacity* bytes.
+ */
+lz4batch* lz4batch_init(size_t capacity);
+
+/**
+ * Frees the batch and its buffer.
+ */
+void lz4batch_destroy(lz4batch *b);
+
+/**
+ * Appends a frame.
+ *
+ * \return 0 if successful, -1 if the frame does not fit. The batch is
+ *         not modified in that case.
+ */
+int lz4batch_append(lz4batch *b, const void *frame, size_t size);
+
+/**
+ * Hands the batch's buffer over to the caller who is responsible for
+ * freeing it with delete []. The batch continues with a new, empty
+ * buffer.
+ *
+ * \param size [out] Number of bytes in the returned buffer
+ * \return     The buffer or NULL if the batch is empty
+ */
+char* lz4batch_take(lz4batch *b, size_t *size);
+
+/**
+ * Iterates the frames of an uncompressed batch.
+ *
+ * \param pos   [in,out] Offset of the next frame, start with 0
+ * \param frame [out]    The frame
+ * \param size  [out]    The frame's size
+ * \return      1 if a frame was returned, 0 at the end of the batch,
+ *              -1 if the batch is malformed
+ */
+int lz4batch_next(const char *batch,
+                  size_t batch_size,
+                  size_t *pos,
+                  const char **frame,
+                  size_t *size);
+
+/**
+ * Allocates a compressor.
+ *
+ * \param dict      Optional dictionary, copied. May be NULL.
+ * \param dict_size Size of the dictionary
+ * \return          The compressor or NULL if allocation failed
+ */
+lz4comp* lz4comp_init(const char *dict, size_t dict_size);
+
+/**
+ * Frees the compressor.
+ */
+void lz4comp_destroy(lz4comp *c);
+
+/**
+ * \return Buffer size required to compress *size* bytes
+ */
+size_t lz4comp_bound(size_t size);
+
+/**
+ * Compresses a batch into *dst* (see message layout above) and
+ * updates the statistics.
+ *
+ * \param dst      Destination of at least *lz4comp_bound(size)* bytes
+ * \return         Number of bytes written or -1 if compression failed
+ */
+int lz4comp_compress(lz4comp *c,
+                     const char *src,
+                     size_t size,
+                     char *dst,
+                     size_t dst_size);
+
+/**
+ * Decompresses a message produced by *lz4comp_compress*.
+ *
+ * \return Number of bytes written to *dst* or -1 if the message is
+ *         malformed or *dst* too small
+ */
+int lz4comp_decompress(const lz4comp *c,
+                       const char *src,
+                       size_t size,
+                       char *dst,
+                       size_t dst_size);
+
+#endif /* _LZ4BATCH_H */
@@ -0,0 +1,87 @@
+#ifndef _PBFRAME_H
+#define _PBFRAME_H
+
+/*
+  Pre-encoded protobuf frames.
+
+  Many messages differ from each other in a single varint field only,
+  e.g. the requestId of a MARKET_STOP_OK Response, or in nothing at
+  all, e.g. a MarketData STATUS. Such a message is serialized once into
+  a template. Encoding it is then a memcpy of the template with the
+  varint written in between, no ByteSize and no Serialize walking the
+  message.
+
+  Protobuf serializes the known fields of a message in field number
+  order [1]. The template of a message with field f varying is thus
+  the serialization of the fields numbered below f, followed by f's
+  tag, followed by the serialization of the fields numbered above f.
+  The output is byte for byte what protobuf would produce.
+
+  The varying field must be varint encoded, i.e. one of int32, int64,
+  uint32, uint64, bool or enum, and neither repeated nor zig-zag
+  encoded (sint32, sint64).
+
+  [1] https://developers.google.com/protocol-buffers/docs/encoding#order
+*/
+
+#include "codec/varint.h"
+
+#include <google/protobuf/message.h>
+#include <stddef.h>
+#include <string.h>
+
+// Upper bound of a template
+#define PBFRAME_MAX_SIZE  64
+
+// *field* of a template without a varying field
+#define PBFRAME_NONE      0
+
+/**
+ * \struct
+ *
+ * A template. The varint goes between data[head - 1] and data[head].
+ */
+typedef struct
+{
+  char data[PBFRAME_MAX_SIZE];
+  size_t head;            // bytes preceding the varint, including its tag
+  size_t size;            // bytes of the template
+  int field;              // number of the varying field or PBFRAME_NONE
+} pbframe;
+
+/**
+ * Builds the template of *m* with *field* varying. The value of
+ * *field* in *m*, if set, is ignored.
+ *
+ * \param field The field number or PBFRAME_NONE if *m* is encoded as is
+ * \return 0 if successful, -1 if *field* is not a varint field of *m*
+ *         or the template exceeds PBFRAME_MAX_SIZE
+ */
+int pbframe_init(pbframe *f, const google::protobuf::Message &m, int field);
+
+/**
+ * \return The upper bound of the frames encoded from *f*
+ */
+inline size_t pbframe_max_size(const pbframe *f)
+{
+  return f->size + (PBFRAME_NONE != f->field ? VARINT_MAX_SIZE64 : 0);
+}
+
+/**
+ * Encodes the template's message with the varying field set to *v* to
+ * *out*. *out* must hold at least *pbframe_max_size* bytes.
+ *
+ * \return The size of the frame
+ */
+inline size_t pbframe_encode(const pbframe *f, unsigned long long v, char *out)
+{
+  memcpy(out, f->data, f->head);
+  char *p = out + f->head;
+  if(PBFRAME_NONE != f->field) {
+    p = varint_put64(p, v);
+  }
+  memcpy(p, &f->data[f->head], f->size - f->head);
+  return (p - out) + (f->size - f->head);
+}
+
+#endif /* _PBFRAME_H */
@@ -0,0 +1,154 @@
+#ifndef _QDELTA_H
+#define _QDELTA_H
+
+#include <stddef.h>
+
+/*
+  Delta encoding of quotes. Instead of a MarketData QUOTE_EX message
+  each quote is sent as a compact frame carrying only the fields that
+  changed since the last quote published for the same symbol id. The
+  changes are zig-zag encoded [1] varints [2] thus a price moving by a
+  tick costs a single byte.
+
+  Frame layout (varints are little-endian base 128):
+
+    byte     header   QDELTA_FRAME_MARKER | QDELTA_FLAG_*
+    varint   symbol id
+    byte     sequence (low byte of the per-symbol sequence)
+    byte     field mask, one QDELTA_FIELD_* bit per field that follows
+    varint*  fields in QDELTA_FIELD_* order, zig-zag encoded deltas or
+             absolute values if QDELTA_FLAG_FULL is set
+
+  The header always has its most significant bit set. Protobuf encoded
+  MarketData messages start with the tag of field 1 (0x08), so
+  consumers can tell both frame kinds apart by the first byte.
+
+  Every *refresh* quotes per symbol a full frame is sent. A consumer
+  detecting a gap in the per-symbol sequence drops its state for the
+  symbol and ignores deltas until the next full frame (resync).
+
+  The same qdelta struct is used for encoding and decoding, holding
+  the last state per symbol id. Not thread safe.
+
+  [1] https://developers.google.com/protocol-buffers/docs/encoding#types
+  [2] https://developers.google.com/protocol-buffers/docs/encoding#varints
+*/
+
+#define QDELTA_FRAME_MARKER     0x80
+#define QDELTA_FLAG_FULL        0x01
+
+#define QDELTA_FIELD_TIMESTAMP  0x01
+#define QDELTA_FIELD_BID_PRICE  0x02
+#define QDELTA_FIELD_ASK_PRICE  0x04
+#define QDELTA_FIELD_BID_SIZE   0x08
+#define QDELTA_FIELD_ASK_SIZE   0x10
+#define QDELTA_FIELD_EXG        0x20
+#define QDELTA_FIELD_PRICE_TYPE 0x40
+#define QDELTA_FIELD_ALL        0x7f
+
+// Upper bound of an encoded frame: header, symbol id, sequence, mask
+// and seven fields of at most five bytes each.
+#define QDELTA_MAX_FRAME_SIZE   48
+
+// Return values of qdelta_decode
+#define QDELTA_DECODE_OK        0
+#define QDELTA_DECODE_GAP       1
+#define QDELTA_DECODE_ERR       -1
+
+/**
+ * \struct
+ *
+ * A quote as carried by a frame. Prices are NxCore integers.
+ */
+typedef struct
+{
+  int timestamp;
+  int bid_price;
+  int ask_price;
+  int bid_size;
+  int ask_size;
+  int exg;
+  int price_type;
+} qdelta_quote;
+
+/**
+ * \struct
+ *
+ * Last published (or received) state of a symbol.
+ */
+typedef struct
+{
+  qdelta_quote last;
+  unsigned int seq;
+  unsigned int countdown;   // quotes left until the next full frame
+  int valid;                // 0 until the first full frame
+} qdelta_sym;
+
+/**
+ * \struct
+ *
+ * Per-symbol state indexed by symbol id. Grows on demand.
+ */
+typedef struct
+{
+  qdelta_sym *syms;
+  unsigned int capacity;
+  unsigned int refresh;
+} qdelta;
+
+/**
+ * Allocates the codec state.
+ *
+ * \param capacity Initial number of symbols
+ * \param refresh  Send a full frame every *refresh* quotes per symbol
+ * \return         The codec or NULL if allocation failed
+ */
+qdelta* qdelta_init(unsigned int capacity, unsigned int refresh);
+
+/**
+ * Frees the codec state.
+ */
+void qdelta_destroy(qdelta *c);
+
+/**
+ * Forces a full frame for symbol *id* with the next quote.
+ */
+void qdelta_reset(qdelta *c, unsigned int id);
+
+/**
+ * Encodes quote *q* of symbol *id* and updates the state.
+ *
+ * \param buf Destination, at least QDELTA_MAX_FRAME_SIZE bytes
+ * \return    The number of bytes written or -1 if the state could not
+ *            grow
+ */
+int qdelta_encode(qdelta *c,
+                  unsigned int id,
+                  const qdelta_quote *q,
+                  char *buf);
+
+/**
+ * Decodes a frame and updates the state.
+ *
+ * \param id [out] The symbol id
+ * \param q  [out] The quote with all fields set
+ * \return   QDELTA_DECODE_OK if *q* is valid, QDELTA_DECODE_GAP if
+ *           the symbol awaits a full frame, QDELTA_DECODE_ERR if the
+ *           frame is malformed
+ */
+int qdelta_decode(qdelta *c,
+                  const char *buf,
+                  size_t size,
+                  unsigned int *id,
+                  qdelta_quote *q);
+
+/**
+ * \return 1 if *buf* holds a delta frame, 0 if it is a protobuf
+ *         message
+ */
+inline int qdelta_is_frame(const char *buf, size_t size)
+{
+  return 0 < size && (buf[0] & QDELTA_FRAME_MARKER);
+}
+
+#endif /* _QDELTA_H */
@@ -0,0 +1,87 @@
+#ifndef _SEQHDR_H
+#define _SEQHDR_H
+
+/*
+  Sequence numbers of mchan frames.
+
+  Run with --mchan-seq every mchan frame, protobuf or delta encoded,
+  is preceded by a header carrying its sequence number:
+
+    byte     SEQHDR_MARKER
+    8 bytes  sequence number, little-endian
+    frame    the MarketData message or qdelta frame
+
+  Consumers tell the header apart by the first byte. Protobuf messages
+  never start with it (field number 0 is invalid), delta frames start
+  with QDELTA_FRAME_MARKER set (see codec/qdelta.h).
+
+  The sequence number of the first frame of a day's tape is the day
+  (NxCore's NDays) shifted by SEQHDR_DAY_SHIFT, each frame published
+  after it takes the next one. Two Wineings ingesting the same feed
+  with the same configuration therefore number each frame alike, a
+  consumer subscribed to both (A/B arbitration) keeps whichever copy
+  arrives first and drops the other.
+
+  That only holds while both publish the same frames. Both are started
+  with the same MARKET_START filter. State that differs between them
+  is ruled out: --mchan-xpub (frames depend on each one's subscribers)
+  is rejected at startup, RECONFIGURE of the filter or dir_chunk
+  (applied with whichever message each processes next) with an ERR.
+  Credits only delay a replay, a client pacing one grants them to a
+  single Wineing. Numbers keep increasing across
+  days. Checkpoints carry the number so that a warm restart continues
+  where it left off, see core/checkpoint.h.
+*/
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SEQHDR_MARKER    0x01
+#define SEQHDR_SIZE      9
+#define SEQHDR_DAY_SHIFT 40
+
+/**
+ * \return The sequence number of the first frame of day *days*
+ */
+inline uint64_t seqhdr_day(unsigned int days)
+{
+  return (uint64_t)days << SEQHDR_DAY_SHIFT;
+}
+
+/**
+ * Writes the header of sequence number *seq* to *p*, SEQHDR_SIZE
+ * bytes.
+ *
+ * \return Pointer past the header, where the frame goes
+ */
+inline char* seqhdr_put(char *p, uint64_t seq)
+{
+  *p++ = (char)SEQHDR_MARKER;
+  for(int i = 0; i < 8; i++) {
+    *p++ = (char)(seq >> (i << 3));
+  }
+  return p;
+}
+
+/**
+ * \return 1 if *buf* starts with a header, 0 otherwise
+ */
+inline int seqhdr_is_frame(const char *buf, size_t size)
+{
+  return SEQHDR_SIZE <= size && SEQHDR_MARKER == (unsigned char)buf[0];
+}
+
+/**
+ * \return The sequence number of the header at *buf*, see
+ *         *seqhdr_is_frame*
+ */
+inline uint64_t seqhdr_get(const char *buf)
+{
+  uint64_t seq = 0;
+  for(int i = 8; i > 0; i--) {
+    seq = (seq << 8) | (unsigned char)buf[i];
+  }
+  return seq;
+}
+
+#endif /* _SEQHDR_H */
@@ -0,0 +1,121 @@
+#ifndef _TRACEHDR_H
+#define _TRACEHDR_H
+
+/*
+  Latency traces of sampled mchan frames.
+
+  Run with --mchan-trace=<n> one in n quotes and trades published on
+  mchan is preceded by a header carrying the times it passed each hop
+  of Wineing, in microseconds since the epoch:
+
+    byte     TRACEHDR_MARKER
+    8 bytes  NxCore's system time of the message (ms resolution)
+    8 bytes  entry of the NxCore callback
+    8 bytes  message encoded
+    8 bytes  handed to zmq_send
+    frame    the MarketData message or qdelta frame
+
+  All little-endian. The header follows the sequence header if frames
+  are numbered as well (see codec/seqhdr.h) and is told apart the same
+  way, by its first byte. A consumer adds the time it received the
+  frame and attributes the latency to NxCore, Wine's callback dispatch,
+  the encoder, and zmq plus the network plus itself. Hops between
+  hosts are only as accurate as their clocks are in sync.
+*/
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#define TRACEHDR_MARKER 0x02
+#define TRACEHDR_SIZE   33
+
+/**
+ * \struct
+ *
+ * The times a frame passed each hop, in microseconds since the epoch.
+ */
+typedef struct
+{
+  int64_t nxcore;
+  int64_t callback;
+  int64_t encode;
+  int64_t send;
+} tracehdr;
+
+/**
+ * \return The current time in microseconds since the epoch
+ */
+inline int64_t tracehdr_now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/**
+ * Converts a date and time of day as reported by NxCore to
+ * microseconds since the epoch.
+ *
+ * \param ms_of_day Milliseconds since midnight of *zone*
+ * \param zone Hours east of UTC, negative in the US
+ */
+inline int64_t tracehdr_time(int year,
+                             int month,
+                             int day,
+                             unsigned int ms_of_day,
+                             int zone)
+{
+  // Days since 1970-01-01 of the proleptic Gregorian calendar, years
+  // starting in March put the leap day last
+  int y = year - (month <= 2);
+  int era = (0 <= y ? y : y - 399) / 400;
+  int yoe = y - era * 400;
+  int doy = (153 * (month + (2 < month ? -3 : 9)) + 2) / 5 + day - 1;
+  int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  int64_t days = (int64_t)era * 146097 + doe - 719468;
+
+  return ((days * 86400 - (int64_t)zone * 3600) * 1000 + ms_of_day) * 1000;
+}
+
+/**
+ * Writes the header of *t* to *p*, TRACEHDR_SIZE bytes.
+ *
+ * \return Pointer past the header, where the frame goes
+ */
+inline char* tracehdr_put(char *p, const tracehdr *t)
+{
+  const int64_t times[] = { t->nxcore, t->callback, t->encode, t->send };
+  *p++ = (char)TRACEHDR_MARKER;
+  for(int i = 0; i < 4; i++) {
+    for(int j = 0; j < 8; j++) {
+      *p++ = (char)((uint64_t)times[i] >> (j << 3));
+    }
+  }
+  return p;
+}
+
+/**
+ * \return 1 if *buf* starts with a header, 0 otherwise
+ */
+inline int tracehdr_is_frame(const char *buf, size_t size)
+{
+  return TRACEHDR_SIZE <= size && TRACEHDR_MARKER == (unsigned char)buf[0];
+}
+
+/**
+ * Reads the header at *buf* into *t*, see *tracehdr_is_frame*.
+ */
+inline void tracehdr_get(const char *buf, tracehdr *t)
+{
+  int64_t *times[] = { &t->nxcore, &t->callback, &t->encode, &t->send };
+  for(int i = 0; i < 4; i++) {
+    uint64_t v = 0;
+    for(int j = 8; j > 0; j--) {
+      v = (v << 8) | (unsigned char)buf[(i << 3) + j];
+    }
+    *times[i] = (int64_t)v;
+  }
+}
+
+#endif /* _TRACEHDR_H */
@@ -0,0 +1,80 @@
+#ifndef _VARINT_H
+#define _VARINT_H
+
+#include <stddef.h>
+
+/*
+  Little-endian base 128 varints and zig-zag encoding as used by
+  protobuf, see
+  https://developers.google.com/protocol-buffers/docs/encoding
+*/
+
+// Maximum size of an encoded 32 bit varint
+#define VARINT_MAX_SIZE 5
+
+// Maximum size of an encoded 64 bit varint
+#define VARINT_MAX_SIZE64 10
+
+inline unsigned int varint_zigzag(int v)
+{
+  return ((unsigned int)v << 1) ^ (unsigned int)(v >> 31);
+}
+
+inline int varint_unzigzag(unsigned int v)
+{
+  return (int)(v >> 1) ^ -(int)(v & 1);
+}
+
+/**
+ * Writes *v* to *p*.
+ *
+ * \return Pointer past the varint
+ */
+inline char* varint_put(char *p, unsigned int v)
+{
+  while(0x80 <= v) {
+    *p++ = (char)(v | 0x80);
+    v >>= 7;
+  }
+  *p++ = (char)v;
+  return p;
+}
+
+/**
+ * Writes *v* to *p*. Negative int64 and int32 protobuf fields are
+ * encoded as their 64 bit two's complement.
+ *
+ * \return Pointer past the varint
+ */
+inline char* varint_put64(char *p, unsigned long long v)
+{
+  while(0x80 <= v) {
+    *p++ = (char)(v | 0x80);
+    v >>= 7;
+  }
+  *p++ = (char)v;
+  return p;
+}
+
+/**
+ * Reads a varint from *p*.
+ *
+ * \return Pointer past the varint or NULL if it runs past *end*
+ */
+inline const char* varint_get(const char *p,
+                              const char *end,
+                              unsigned int *v)
+{
+  unsigned int r = 0;
+  for(int shift = 0; p < end && shift < 35; shift += 7) {
+    unsigned char b = (unsigned char)*p++;
+    r |= (unsigned int)(b & 0x7f) << shift;
+    if(0 == (b & 0x80)) {
+      *v = r;
+      return p;
+    }
+  }
+  return NULL;
+}
+
+#endif /* _VARINT_H */
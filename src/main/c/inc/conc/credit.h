@@ -0,0 +1,100 @@
+#ifndef _CREDIT_H
+#define _CREDIT_H
+
+/*
+  Credit based flow control [1] between a consumer granting credits
+  and a single producer taking one per message sent. A producer out
+  of credits blocks until the consumer grants more, nothing is
+  dropped and the producer runs exactly at the consumer's speed.
+
+  Taking a credit is a load and an atomic decrement, the mutex is
+  only taken by a producer that ran out. Granting only signals if the
+  producer is waiting.
+
+  A closed counter doesn't limit the producer: *credit_take* never
+  fails and a blocked producer returns. Counters are created closed.
+
+  Expects the compile macro CACHE_LINE_SIZE, see conc/conc.h.
+
+  [1] http://en.wikipedia.org/wiki/Credit-based_flow_control
+*/
+
+#include <pthread.h>
+
+#if !defined(CACHE_LINE_SIZE)
+#error CACHE_LINE_SIZE not set. Invoke gcc with -DCACHE_LINE_SIZE=xx
+#define CACHE_LINE_SIZE  8
+#endif
+
+// Return values of *credit_take* and *credit_wait*
+#define CREDIT_TAKEN      0
+#define CREDIT_CLOSED     1
+#define CREDIT_EMPTY     -1
+
+/**
+ * \struct
+ *
+ * A credit counter.
+ */
+typedef struct
+{
+  long long available __attribute__ ((aligned (CACHE_LINE_SIZE)));
+  int closed;
+  int waiting;                  // the producer is blocked
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+} credit;
+
+/**
+ * \return A closed counter
+ */
+credit* credit_init();
+
+void credit_destroy(credit *c);
+
+/**
+ * Opens the counter with *n* credits. The producer must not be
+ * taking credits.
+ */
+void credit_open(credit *c, unsigned long long n);
+
+/**
+ * Closes the counter and wakes the producer if it is blocked.
+ */
+void credit_close(credit *c);
+
+/**
+ * Grants *n* more credits. Safe to invoke from several threads.
+ */
+void credit_grant(credit *c, unsigned long long n);
+
+/**
+ * Blocks until a credit is taken or the counter is closed. Invoked by
+ * the producer after *credit_take* returned CREDIT_EMPTY.
+ *
+ * \return CREDIT_TAKEN or CREDIT_CLOSED
+ */
+int credit_wait(credit *c);
+
+/**
+ * Takes a credit without blocking. Only invoked by the producer.
+ *
+ * \return CREDIT_TAKEN, CREDIT_CLOSED or CREDIT_EMPTY if the producer
+ *         has to wait
+ */
+inline int credit_take(credit *c)
+{
+  // Sequentially consistent, pairs with *credit_grant* reading
+  // *waiting*, see credit.cc
+  if(__atomic_load_n(&c->closed, __ATOMIC_SEQ_CST)) {
+    return CREDIT_CLOSED;
+  }
+  // Others only ever add, a positive count stays positive
+  if(0 < __atomic_load_n(&c->available, __ATOMIC_SEQ_CST)) {
+    __atomic_sub_fetch(&c->available, 1, __ATOMIC_SEQ_CST);
+    return CREDIT_TAKEN;
+  }
+  return CREDIT_EMPTY;
+}
+
+#endif /* _CREDIT_H */
@@ -0,0 +1,296 @@
+#ifndef _QUEUE_H
+#define _QUEUE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+  Bounded lock-free queues of pointers for handing data between
+  threads without going through a ZMQ inproc socket, which costs a
+  zmq_msg_t and a pass through the ZMQ io machinery per message.
+
+  - spscq: single producer, single consumer. A Lamport ring [1] where
+    each side caches the other side's index, the shared index is only
+    read once the cached one says the queue is full (or empty).
+
+  - mpmcq: multiple producers, multiple consumers. Vyukov's bounded
+    queue [2]: each cell carries a sequence number telling producers
+    and consumers whether it is free or full for the current lap, the
+    positions are claimed with a CAS.
+
+  Both push and pop batches. A batch is claimed with a single update
+  of the shared index, the cost of the atomic operations and of the
+  cache-line transfer is amortized over the batch. Producer and
+  consumer state is kept on separate cache lines to avoid false
+  sharing [3].
+
+  Capacities are rounded up to a power of two. Elements are non-NULL
+  pointers, ownership of the pointee passes with the pointer. The
+  queues never block, the caller decides whether to spin, yield or
+  sleep when full or empty.
+
+  Expects the compile macro CACHE_LINE_SIZE, see conc/conc.h.
+
+  [1] http://www.1024cores.net/home/lock-free-algorithms/queues/unbounded-spsc-queue
+  [2] http://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+  [3] http://en.wikipedia.org/wiki/False_sharing
+*/
+
+#if !defined(CACHE_LINE_SIZE)
+#error CACHE_LINE_SIZE not set. Invoke gcc with -DCACHE_LINE_SIZE=xx
+#define CACHE_LINE_SIZE  8
+#endif
+
+/**
+ * \struct
+ *
+ * Single producer, single consumer queue.
+ */
+typedef struct
+{
+  // Written by the producer
+  size_t head __attribute__ ((aligned (CACHE_LINE_SIZE)));
+  size_t tail_cache;      // last tail seen by the producer
+
+  // Written by the consumer
+  size_t tail __attribute__ ((aligned (CACHE_LINE_SIZE)));
+  size_t head_cache;      // last head seen by the consumer
+
+  // Read only
+  void **ring __attribute__ ((aligned (CACHE_LINE_SIZE)));
+  size_t mask;            // capacity minus one
+} spscq;
+
+/**
+ * \struct
+ *
+ * A cell of *mpmcq*. *seq* equals the position of the cell's next
+ * push if the cell is free and that position plus one if it is full.
+ */
+typedef struct
+{
+  size_t seq;
+  void *data;
+} mpmcq_cell;
+
+/**
+ * \struct
+ *
+ * Multiple producers, multiple consumers queue.
+ */
+typedef struct
+{
+  size_t head __attribute__ ((aligned (CACHE_LINE_SIZE)));
+  size_t tail __attribute__ ((aligned (CACHE_LINE_SIZE)));
+  mpmcq_cell *cells __attribute__ ((aligned (CACHE_LINE_SIZE)));
+  size_t mask;
+} mpmcq;
+
+/**
+ * Allocates an empty queue of at least *capacity* elements.
+ *
+ * \return The queue or NULL if allocation failed
+ */
+spscq* spscq_init(size_t capacity);
+
+/**
+ * Frees the queue. Elements still queued are not freed.
+ */
+void spscq_destroy(spscq *q);
+
+/**
+ * Allocates an empty queue of at least *capacity* elements.
+ *
+ * \return The queue or NULL if allocation failed
+ */
+mpmcq* mpmcq_init(size_t capacity);
+
+/**
+ * Frees the queue. Elements still queued are not freed.
+ */
+void mpmcq_destroy(mpmcq *q);
+
+/**
+ * \return The capacity of the queue
+ */
+inline size_t spscq_capacity(const spscq *q)
+{
+  return q->mask + 1;
+}
+
+/**
+ * Pushes up to *n* elements of *e*. Only invoked by the producer.
+ *
+ * \return The number of elements pushed, less than *n* if the queue
+ *         is full
+ */
+inline size_t spscq_push_n(spscq *q, void *const *e, size_t n)
+{
+  size_t head = q->head;
+  size_t size = q->mask + 1;
+
+  if(head + n - q->tail_cache > size) {
+    q->tail_cache = __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE);
+    if(head + n - q->tail_cache > size) {
+      n = size - (head - q->tail_cache);
+    }
+  }
+
+  for(size_t i = 0; i < n; i++) {
+    q->ring[(head + i) & q->mask] = e[i];
+  }
+  __atomic_store_n(&q->head, head + n, __ATOMIC_RELEASE);
+  return n;
+}
+
+/**
+ * Pops up to *n* elements into *e*. Only invoked by the consumer.
+ *
+ * \return The number of elements popped, 0 if the queue is empty
+ */
+inline size_t spscq_pop_n(spscq *q, void **e, size_t n)
+{
+  size_t tail = q->tail;
+
+  if(q->head_cache - tail < n) {
+    q->head_cache = __atomic_load_n(&q->head, __ATOMIC_ACQUIRE);
+    if(q->head_cache - tail < n) {
+      n = q->head_cache - tail;
+    }
+  }
+
+  for(size_t i = 0; i < n; i++) {
+    e[i] = q->ring[(tail + i) & q->mask];
+  }
+  __atomic_store_n(&q->tail, tail + n, __ATOMIC_RELEASE);
+  return n;
+}
+
+/**
+ * \return 0 if *e* was pushed, -1 if the queue is full
+ */
+inline int spscq_push(spscq *q, void *e)
+{
+  return 1 == spscq_push_n(q, &e, 1) ? 0 : -1;
+}
+
+/**
+ * \return The element or NULL if the queue is empty
+ */
+inline void* spscq_pop(spscq *q)
+{
+  void *e;
+  return 1 == spscq_pop_n(q, &e, 1) ? e : NULL;
+}
+
+/**
+ * \return The capacity of the queue
+ */
+inline size_t mpmcq_capacity(const mpmcq *q)
+{
+  return q->mask + 1;
+}
+
+/**
+ * Pushes up to *n* elements of *e*. The free cells following the
+ * current head are claimed at once, a batch is therefore contiguous
+ * in the queue.
+ *
+ * \return The number of elements pushed, 0 if the queue is full
+ */
+inline size_t mpmcq_push_n(mpmcq *q, void *const *e, size_t n)
+{
+  size_t pos = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+
+  for(;;) {
+    // Cells free for this lap stay free until claimed through head
+    size_t k = 0;
+    while(k < n
+          && pos + k == __atomic_load_n(&q->cells[(pos + k) & q->mask].seq,
+                                        __ATOMIC_ACQUIRE)) {
+      k++;
+    }
+
+    if(0 == k) {
+      size_t seq = __atomic_load_n(&q->cells[pos & q->mask].seq,
+                                   __ATOMIC_ACQUIRE);
+      if(0 > (intptr_t)(seq - pos)) {
+        // The cell still holds the element of the previous lap
+        return 0;
+      }
+      pos = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+      continue;
+    }
+
+    if(__atomic_compare_exchange_n(&q->head, &pos, pos + k, true,
+                                   __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+      for(size_t i = 0; i < k; i++) {
+        mpmcq_cell *c = &q->cells[(pos + i) & q->mask];
+        c->data = e[i];
+        __atomic_store_n(&c->seq, pos + i + 1, __ATOMIC_RELEASE);
+      }
+      return k;
+    }
+    // *pos* holds the current head
+  }
+}
+
+/**
+ * Pops up to *n* elements into *e*. The full cells following the
+ * current tail are claimed at once.
+ *
+ * \return The number of elements popped, 0 if the queue is empty
+ */
+inline size_t mpmcq_pop_n(mpmcq *q, void **e, size_t n)
+{
+  size_t pos = __atomic_load_n(&q->tail, __ATOMIC_RELAXED);
+
+  for(;;) {
+    size_t k = 0;
+    while(k < n
+          && pos + k + 1 == __atomic_load_n(&q->cells[(pos + k) & q->mask].seq,
+                                            __ATOMIC_ACQUIRE)) {
+      k++;
+    }
+
+    if(0 == k) {
+      size_t seq = __atomic_load_n(&q->cells[pos & q->mask].seq,
+                                   __ATOMIC_ACQUIRE);
+      if(0 > (intptr_t)(seq - (pos + 1))) {
+        // Not yet pushed
+        return 0;
+      }
+      pos = __atomic_load_n(&q->tail, __ATOMIC_RELAXED);
+      continue;
+    }
+
+    if(__atomic_compare_exchange_n(&q->tail, &pos, pos + k, true,
+                                   __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+      for(size_t i = 0; i < k; i++) {
+        mpmcq_cell *c = &q->cells[(pos + i) & q->mask];
+        e[i] = c->data;
+        __atomic_store_n(&c->seq, pos + i + q->mask + 1, __ATOMIC_RELEASE);
+      }
+      return k;
+    }
+  }
+}
+
+/**
+ * \return 0 if *e* was pushed, -1 if the queue is full
+ */
+inline int mpmcq_push(mpmcq *q, void *e)
+{
+  return 1 == mpmcq_push_n(q, &e, 1) ? 0 : -1;
+}
+
+/**
+ * \return The element or NULL if the queue is empty
+ */
+inline void* mpmcq_pop(mpmcq *q)
+{
+  void *e;
+  return 1 == mpmcq_pop_n(q, &e, 1) ? e : NULL;
+}
+
+#endif /* _QUEUE_H */
@@ -0,0 +1,129 @@
+#ifndef _RCU_H
+#define _RCU_H
+
+/*
+  Read-copy-update [1] of a pointer to immutable data, with quiescent
+  state based reclamation (QSBR) [2].
+
+  Readers load the pointer with *rcu_deref*, a plain acquire load
+  without locks or atomic read-modify-writes. Writers never modify
+  the published data. They publish a modified copy with
+  *rcu_publish*, wait with *rcu_synchronize* until no reader can
+  still hold the old pointer, then free it.
+
+  A reader holds a pointer only between two quiescent states. It
+  announces one with *rcu_quiescent*, e.g. once per message
+  processed, and must not use a pointer loaded before. A reader
+  that doesn't dereference for a while, e.g. blocked or idle, goes
+  *rcu_offline* so that writers don't wait for it.
+
+  Writers are serialized by the caller. Readers register once, at
+  most RCU_MAX_READERS of them.
+
+  Expects the compile macro CACHE_LINE_SIZE, see conc/conc.h.
+
+  [1] http://en.wikipedia.org/wiki/Read-copy-update
+  [2] http://www.rdrop.com/users/paulmck/RCU/hart_ipdps06.pdf
+*/
+
+#include <stddef.h>
+
+#if !defined(CACHE_LINE_SIZE)
+#error CACHE_LINE_SIZE not set. Invoke gcc with -DCACHE_LINE_SIZE=xx
+#define CACHE_LINE_SIZE  8
+#endif
+
+#define RCU_MAX_READERS   8
+
+// Value of rcu_reader.epoch while offline
+#define RCU_OFFLINE       0
+
+/**
+ * \struct
+ *
+ * A reader's last quiescent state. Written by the reader only.
+ */
+typedef struct
+{
+  unsigned long epoch __attribute__ ((aligned (CACHE_LINE_SIZE)));
+} rcu_reader;
+
+/**
+ * \struct
+ *
+ * An RCU protected pointer.
+ */
+typedef struct
+{
+  void *ptr __attribute__ ((aligned (CACHE_LINE_SIZE)));
+  unsigned long epoch;          // incremented by *rcu_synchronize*
+  int readers_size;
+  rcu_reader readers[RCU_MAX_READERS];
+} rcu;
+
+/**
+ * Initializes *r* to *ptr* without readers.
+ */
+void rcu_init(rcu *r, void *ptr);
+
+/**
+ * Registers a reader. The reader is online. Safe to invoke from
+ * several threads.
+ *
+ * \return The reader's slot or -1 if RCU_MAX_READERS are registered
+ */
+int rcu_register(rcu *r);
+
+/**
+ * Replaces the pointer. The old one stays valid for readers until
+ * *rcu_synchronize* returned.
+ *
+ * \return The old pointer
+ */
+void* rcu_publish(rcu *r, void *ptr);
+
+/**
+ * Waits until every online reader passed a quiescent state, i.e. no
+ * reader holds a pointer replaced before the call.
+ */
+void rcu_synchronize(rcu *r);
+
+/**
+ * \return The current pointer, valid until the reader's next
+ *         quiescent state
+ */
+inline void* rcu_deref(const rcu *r)
+{
+  return __atomic_load_n(&r->ptr, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * Announces that reader *slot* holds no pointer loaded so far.
+ */
+inline void rcu_quiescent(rcu *r, int slot)
+{
+  __atomic_store_n(&r->readers[slot].epoch,
+                   __atomic_load_n(&r->epoch, __ATOMIC_SEQ_CST),
+                   __ATOMIC_RELEASE);
+}
+
+/**
+ * Announces that reader *slot* holds no pointer and won't dereference
+ * until *rcu_online*.
+ */
+inline void rcu_offline(rcu *r, int slot)
+{
+  __atomic_store_n(&r->readers[slot].epoch, RCU_OFFLINE, __ATOMIC_RELEASE);
+}
+
+/**
+ * Takes reader *slot* back online, before it dereferences again.
+ */
+inline void rcu_online(rcu *r, int slot)
+{
+  __atomic_store_n(&r->readers[slot].epoch,
+                   __atomic_load_n(&r->epoch, __ATOMIC_SEQ_CST),
+                   __ATOMIC_SEQ_CST);
+}
+
+#endif /* _RCU_H */
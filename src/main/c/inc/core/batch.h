@@ -0,0 +1,99 @@
+#ifndef _BATCH_H
+#define _BATCH_H
+
+/*
+  Batch replay of historical tapes.
+
+  A batch is a list of tape files replayed by a pool of worker threads
+  independently of the live tape run by *market_thread*. Each worker
+  claims the next tape of the list, replays it with *nxtape_replay*
+  into a journal file of its own and reports progress to the client
+  through *cchan_out_thread*. Memory is bounded by the number of
+  workers rather than the number of tapes. Each worker prefetches the
+  tape claimed once its own is replayed, see *wininf_file_prefetch*.
+
+  At most one batch runs at a time.
+*/
+
+#include "core/wineing.h"
+
+/**
+ * \struct
+ *
+ * A batch job as requested by BATCH_START.
+ */
+typedef struct
+{
+  long request_id;              // id of the BATCH_START request
+  char **tapes;                 // absolute paths of the tape files
+  int size;
+  int capacity;
+  char *journal_dir;            // directory journals are written to
+  int workers;                  // number of worker threads
+
+  int volatile next;            // index of the next tape to replay
+  int volatile done;            // number of tapes replayed
+  int volatile failed;          // number of tapes failed
+} w_batch;
+
+/**
+ * Allocates an empty batch.
+ *
+ * \param request_id  The id of the BATCH_START request
+ * \param journal_dir Directory journals are written to, including the
+ *                    trailing path separator
+ * \param workers     Number of tapes replayed concurrently, capped at
+ *                    WINEING_BATCH_MAX_WORKERS
+ */
+w_batch* batch_init(long request_id, const char *journal_dir, int workers);
+
+/**
+ * Frees the batch.
+ */
+void batch_destroy(w_batch *b);
+
+/**
+ * Appends tape file *path* to the batch. The signature matches the
+ * callback of *wininf_file_glob*.
+ *
+ * \param b The batch (a w_batch*)
+ */
+void batch_add(const char *path, void *b);
+
+/**
+ * Claims the next tape. Safe to invoke from several threads.
+ *
+ * \return The index of the tape or -1 if all tapes are claimed or the
+ *         batch is stopped, see *batch_stop*
+ */
+int batch_next(w_batch *b);
+
+/**
+ * Writes the path of the journal of tape *i* to *out*, that is the
+ * journal directory followed by the tape's file name and
+ * DEFAULTS_JOURNAL_SUFFIX.
+ *
+ * \return 0 if successful, -1 if *out* is too small
+ */
+int batch_journal_path(const w_batch *b, int i, char *out, size_t size);
+
+/**
+ * Starts replaying the batch in the background. Ownership of *b* is
+ * passed to the batch thread which frees it once all tapes are
+ * replayed, sending BATCH_PROGRESS for each tape and BATCH_DONE at the
+ * end through *cchan_out_thread*.
+ *
+ * \return 0 if successful, -1 if a batch is already running in which
+ *         case the caller keeps ownership of *b*
+ */
+int batch_start(w_batch *b);
+
+/**
+ * Stops the batch running, if any, and waits for its thread to finish.
+ * No further tapes are claimed, those being replayed stop on the
+ * SHUTDOWN command. Invoke before the reply pool and the channels are
+ * torn down, the batch replies until it finished.
+ */
+void batch_stop();
+
+#endif /* _BATCH_H */
@@ -0,0 +1,165 @@
+#ifndef _CHECKPOINT_H
+#define _CHECKPOINT_H
+
+/*
+  Checkpoints of the live tape for a warm restart.
+
+  NxCore started intraday rebuilds its state from the start of the
+  day, minutes pass before data flows again. Instead the live tape
+  periodically saves NxCore's state together with the symbol
+  directory. A restarted Wineing starts NxCore from the state of the
+  day's latest checkpoint, catching up only the time since, and
+  restores the directory first. Both belong together: NxCore's state
+  holds the symbol ids stashed in its strings (see sym/symtab.h),
+  restoring the directory keeps them and the ids clients know valid.
+
+  A checkpoint is written to one of CHECKPOINT_SLOTS slots, each
+  holding NxCore's state and the directory:
+
+    <dir><name>.<slot>.nxs    NxCore's state
+    <dir><name>.<slot>.syms   checkpoint_header and the directory
+    <dir><name>.ckpt          checkpoint_header of the latest one
+
+  The manifest (.ckpt) is replaced by a rename once both files of a
+  slot are synced. A crash while a checkpoint is written leaves the
+  manifest pointing to the previous slot, which is never written to
+  at the same time.
+
+  NxCore saves its state only from within its callback, on the thread
+  running the tape, see *checkpoint_begin*. The directory is copied
+  there as well, writing and syncing it and the manifest is left to
+  the checkpoint's background thread. A checkpoint due while the
+  previous one is still being written is skipped.
+*/
+
+#include "sym/symtab.h"
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#define CHECKPOINT_MAGIC          0x504b4357   // "WCKP"
+#define CHECKPOINT_VERSION        2
+#define CHECKPOINT_SLOTS          2
+#define CHECKPOINT_NXCORE_SUFFIX  ".nxs"
+#define CHECKPOINT_SYMS_SUFFIX    ".syms"
+#define CHECKPOINT_PATH_SIZE      1024
+
+/**
+ * \struct
+ *
+ * Header of the directory file and the manifest.
+ */
+typedef struct
+{
+  uint32_t magic;
+  uint32_t version;
+  uint32_t slot;
+  uint32_t clock;               // NxCore clock, ms of day
+  int64_t created;              // seconds since the epoch
+  uint32_t symbols;             // directory entries following
+  uint32_t reserved;
+  uint64_t seq;                 // next mchan sequence number, see codec/seqhdr.h
+} checkpoint_header;
+
+/**
+ * \struct
+ *
+ * The checkpoints of a Wineing.
+ */
+typedef struct
+{
+  char *dir;
+  char *name;
+  int slot;                     // of the latest checkpoint, -1 if none
+
+  // The checkpoint being written, guarded by *mutex*
+  int pending;                  // 1 until written
+  int stop;
+  int job_slot;
+  uint32_t job_clock;
+  uint64_t job_seq;
+  symtab_entry *entries;        // copy of the directory
+  unsigned int size;
+  unsigned int capacity;
+
+  pthread_t thread;
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+} checkpoint;
+
+/**
+ * Reads the manifest, if any, and starts the background thread.
+ *
+ * \param dir  Directory of the checkpoints, including the trailing
+ *             path separator
+ * \param name Prefix of the files, distinct per Wineing sharing *dir*
+ * \return     The instance or NULL if the thread could not be started
+ */
+checkpoint* checkpoint_init(const char *dir, const char *name);
+
+/**
+ * Waits for a pending checkpoint to be written, stops the thread and
+ * frees *c*.
+ */
+void checkpoint_destroy(checkpoint *c);
+
+/**
+ * Writes the path of file *suffix* of *slot* to *out*, e.g.
+ * CHECKPOINT_NXCORE_SUFFIX.
+ *
+ * \return 0 if successful, -1 if *out* is too small
+ */
+int checkpoint_path(const checkpoint *c,
+                    int slot,
+                    const char *suffix,
+                    char *out,
+                    size_t size);
+
+/**
+ * Starts a checkpoint. The caller saves NxCore's state to the slot's
+ * CHECKPOINT_NXCORE_SUFFIX file and passes the slot to
+ * *checkpoint_submit*.
+ *
+ * \return The slot to write to or -1 if the previous checkpoint is
+ *         still being written
+ */
+int checkpoint_begin(checkpoint *c);
+
+/**
+ * Copies directory *syms* and hands the checkpoint of *slot* over to
+ * the background thread.
+ *
+ * \param clock The NxCore clock of the checkpoint
+ * \param seq   The next mchan sequence number
+ * \return      0 if successful, -1 if the copy could not be allocated
+ */
+int checkpoint_submit(checkpoint *c,
+                      int slot,
+                      const symtab *syms,
+                      uint32_t clock,
+                      uint64_t seq);
+
+/**
+ * \param now The current time
+ * \return    The slot of the latest checkpoint if it was taken on the
+ *            same local day as *now*, -1 otherwise
+ */
+int checkpoint_latest(checkpoint *c, time_t now);
+
+/**
+ * Restores the directory of *slot* into the empty table *syms*. Ids
+ * remain the same, deleted symbols included.
+ *
+ * \param seq [out] The next mchan sequence number
+ * \return The NxCore clock of the checkpoint or -1 if the slot is
+ *         unreadable or *syms* wasn't empty. *syms* is undefined in
+ *         the latter case.
+ */
+long checkpoint_restore(const checkpoint *c,
+                        int slot,
+                        symtab *syms,
+                        uint64_t *seq);
+
+#endif /* _CHECKPOINT_H */
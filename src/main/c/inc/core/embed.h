@@ -0,0 +1,234 @@
+#ifndef _EMBED_H
+#define _EMBED_H
+
+/*
+  In-process embedding of Wineing (libwineing, see the 'lib' target).
+
+  Applications linking Wineing register handlers for trades, quotes,
+  STATUS messages and directory entries. A tape run with *embed_run*
+  hands them plain structs instead of publishing protobuf messages on
+  mchan: nothing is serialized, no socket is involved.
+
+  - EMBED_DIRECT invokes the handlers on the thread running the NxCore
+    callback, the lowest latency if the handlers are short.
+
+  - EMBED_RING queues the events in a single producer, single consumer
+    ring (see conc/queue.h), the application's thread dispatches them
+    with *embed_poll*. Event slots are returned to the producer through
+    a second ring once handled, nothing is copied twice and nothing
+    allocated. A full ring blocks the tape, events are never dropped.
+
+  Symbols are identified by ids as on mchan. The directory entry of a
+  symbol, an EMBED_SYMBOL event, precedes its first trade or quote.
+  Prices are NxCore's integers, see NxCore's price types.
+
+  *embed_synthetic* feeds generated events through the same path, for
+  testing applications and the library without NxCore (e.g. built
+  against the Linux stub).
+
+  Expects the compile macro CACHE_LINE_SIZE, see conc/conc.h.
+*/
+
+#include "conc/queue.h"
+#include "sym/symtab.h"
+
+// Values of *embed_init*'s mode
+#define EMBED_DIRECT              0
+#define EMBED_RING                1
+
+// Values of embed_event.type
+#define EMBED_STATUS              0
+#define EMBED_SYMBOL              1
+#define EMBED_QUOTE               2
+#define EMBED_TRADE               3
+
+typedef struct
+{
+  unsigned int clock;           // NxCore clock, ms of day
+} embed_status;
+
+typedef struct
+{
+  unsigned int symbol_id;
+  unsigned short exg;           // listed exchange
+  unsigned char deleted;
+  char name[SYMTAB_NAME_SIZE];  // NxCore symbol, options with DateAndStrike
+} embed_symbol;
+
+typedef struct
+{
+  unsigned int symbol_id;
+  unsigned int timestamp;       // exchange timestamp, ms of day
+  int bid_price;
+  int ask_price;
+  unsigned int bid_size;
+  unsigned int ask_size;
+  unsigned short exg;           // reporting exchange
+  unsigned char price_type;
+} embed_quote;
+
+typedef struct
+{
+  unsigned int symbol_id;
+  unsigned int timestamp;       // exchange timestamp, ms of day
+  int price;
+  unsigned int size;
+  unsigned short exg;           // reporting exchange
+  unsigned char price_type;
+} embed_trade;
+
+/**
+ * \struct
+ *
+ * An event queued in EMBED_RING mode.
+ */
+typedef struct
+{
+  int type;                     // one of EMBED_STATUS, ...
+  union {
+    embed_status status;
+    embed_symbol symbol;
+    embed_quote quote;
+    embed_trade trade;
+  };
+} embed_event;
+
+/**
+ * \struct
+ *
+ * The application's handlers. A NULL handler skips events of its
+ * type, NxCore messages nobody handles are not even decoded.
+ */
+typedef struct
+{
+  void (*status) (const embed_status *s, void *obj);
+  void (*symbol) (const embed_symbol *s, void *obj);
+  void (*quote) (const embed_quote *q, void *obj);
+  void (*trade) (const embed_trade *t, void *obj);
+  void *obj;                    // passed to every handler
+} embed_handlers;
+
+/**
+ * \struct
+ *
+ * An embedded Wineing.
+ */
+typedef struct
+{
+  embed_handlers handlers;
+  int mode;                     // EMBED_DIRECT or EMBED_RING
+  int volatile stopped;         // set by *embed_stop*
+  unsigned long events;         // published, written by the producer
+
+  // EMBED_RING only, NULL otherwise
+  spscq *ring;                  // events to be dispatched
+  spscq *free;                  // slots handled by the consumer
+  embed_event *slots;
+} embed;
+
+/**
+ * \param handlers Copied
+ * \param mode     EMBED_DIRECT or EMBED_RING
+ * \param capacity Events queued at most in EMBED_RING mode
+ * \return         The instance or NULL if allocation failed
+ */
+embed* embed_init(const embed_handlers *handlers, int mode, size_t capacity);
+
+/**
+ * Frees *e*. Events still queued are discarded.
+ */
+void embed_destroy(embed *e);
+
+/**
+ * Runs *tape* in the calling thread until it is complete or
+ * *embed_stop* is invoked. The tape has a symbol directory of its own.
+ * NxCore is loaded the first time. Don't mix with *wineing_init* in
+ * the same process.
+ *
+ * \param tape  Path of the tape file, "" for real-time data
+ * \param flags WININF_NXCORE_* flags, see nx/nxinf.h
+ * \return      The number of events published or -1 on error
+ */
+long embed_run(embed *e, const char *tape, unsigned int flags);
+
+/**
+ * Publishes a deterministic feed of *messages* trades and quotes of
+ * *symbols* generated symbols, with a STATUS message every
+ * EMBED_SYNTHETIC_STATUS_INTERVAL of them, in the calling thread.
+ *
+ * \return The number of events published, less if stopped
+ */
+long embed_synthetic(embed *e, unsigned int symbols, unsigned long messages);
+
+#define EMBED_SYNTHETIC_STATUS_INTERVAL 1000
+
+/**
+ * Stops *embed_run* and *embed_synthetic* with the next message, a
+ * producer blocked on a full ring included. Safe to invoke from any
+ * thread.
+ */
+void embed_stop(embed *e);
+
+/**
+ * Dispatches up to *max* queued events to the handlers. Only invoked
+ * by the consumer thread of an EMBED_RING instance.
+ *
+ * \return The number of events dispatched, 0 if none was queued
+ */
+size_t embed_poll(embed *e, size_t max);
+
+/**
+ * \return 1 if events of *type* are handled
+ */
+inline int embed_wants(const embed *e, int type)
+{
+  switch(type)
+    {
+    case EMBED_STATUS: return NULL != e->handlers.status;
+    case EMBED_SYMBOL: return NULL != e->handlers.symbol;
+    case EMBED_QUOTE:  return NULL != e->handlers.quote;
+    case EMBED_TRADE:  return NULL != e->handlers.trade;
+    }
+  return 0;
+}
+
+/**
+ * Invokes the handler of *ev*.
+ */
+inline void embed_dispatch(const embed *e, const embed_event *ev)
+{
+  const embed_handlers &h = e->handlers;
+  switch(ev->type)
+    {
+    case EMBED_STATUS: h.status(&ev->status, h.obj); break;
+    case EMBED_SYMBOL: h.symbol(&ev->symbol, h.obj); break;
+    case EMBED_QUOTE:  h.quote(&ev->quote, h.obj); break;
+    case EMBED_TRADE:  h.trade(&ev->trade, h.obj); break;
+    }
+}
+
+/**
+ * Claims the slot of the next event of *type*. The producer fills it
+ * in and passes it to *embed_publish*. Blocks while the ring is full.
+ *
+ * \param scratch Returned in EMBED_DIRECT mode
+ * \return        The slot or NULL if nobody handles *type* or if
+ *                stopped
+ */
+embed_event* embed_claim(embed *e, int type, embed_event *scratch);
+
+/**
+ * Dispatches or queues an event claimed with *embed_claim*.
+ */
+inline void embed_publish(embed *e, embed_event *ev)
+{
+  e->events++;
+  if(EMBED_DIRECT == e->mode) {
+    embed_dispatch(e, ev);
+  } else {
+    // Never full, there are as many slots as cells
+    spscq_push(e->ring, ev);
+  }
+}
+
+#endif /* _EMBED_H */
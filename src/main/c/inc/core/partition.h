@@ -0,0 +1,69 @@
+#ifndef _PARTITION_H
+#define _PARTITION_H
+
+/*
+  Partitioned ingestion. A launcher (--partitions) runs one Wineing
+  process per partition, each ingesting a disjoint part of the feed
+  (--partition), so that decoding and encoding scale across cores and
+  processes.
+
+  A partition is a NxCore symbol prefix ("e" equities, "o" options,
+  "f" futures) plus the NxCore control flags that keep NxCore from
+  even decoding what the partition doesn't publish, e.g. OPRA for
+  equities. Symbols outside the prefix never get an id.
+
+  Partition i binds its channels to the launcher's endpoints with the
+  TCP port moved up by (i + 1) * DEFAULTS_PARTITION_PORT_STEP, other
+  transports get ".<i>" appended. The launcher binds the original
+  control channels only and answers DIRECTORY with the endpoints of
+  every partition. A plain Wineing answers DIRECTORY with itself.
+*/
+
+#include "core/wineing.h"
+
+#include <string>
+#include <vector>
+
+/**
+ * \struct
+ *
+ * A partition of the feed.
+ */
+typedef struct
+{
+  const char *name;             // e.g. "equities"
+  const char *prefix;           // NxCore symbol prefix
+  unsigned int nxcore_flags;    // WININF_NXCORE_EXCLUDE_*, see nxinf.h
+} w_partition;
+
+/**
+ * \return The partition named *name* or NULL if there is none
+ */
+const w_partition* partition_find(const char *name);
+
+/**
+ * Derives the endpoint of partition *index* from *fqcn*, see above.
+ *
+ * \return 0 if successful, -1 if *out* is too small
+ */
+int partition_fqcn(const char *fqcn, int index, char *out, size_t size);
+
+/**
+ * Turns the endpoint *fqcn* a channel binds to into one to connect to
+ * from the same host, i.e. replaces the wildcard interface of TCP
+ * endpoints with the loopback one.
+ *
+ * \return 0 if successful, -1 if *out* is too small
+ */
+int partition_local_fqcn(const char *fqcn, char *out, size_t size);
+
+/**
+ * Builds the command line arguments, without the program, of the
+ * process ingesting partition *index* of the launcher configured by
+ * *conf*. Every channel is derived with *partition_fqcn*.
+ */
+void partition_args(const w_conf *conf,
+                    int index,
+                    std::vector<std::string> &args);
+
+#endif /* _PARTITION_H */
@@ -0,0 +1,107 @@
+#ifndef _REPLY_H
+#define _REPLY_H
+
+/*
+  Responses to the client(s).
+
+  Any thread may reply. The Response is serialized once, straight into
+  a buffer taken from a pool, and the buffer is queued to
+  *cchan_out_thread* which hands it to zmq as is for publishing on
+  cchan_out. Once zmq is done with the buffer it returns to the pool,
+  see *reply_free*. Responses larger than a pooled buffer, or sent
+  while the pool is exhausted, are allocated on the heap.
+
+  Responses carrying nothing but their requestId and type, e.g.
+  MARKET_STOP_OK, aren't even serialized. They're encoded from a
+  template with the requestId patched in, see codec/pbframe.h.
+
+  The pool and the queue are conc/queue.h mpmcqs, a semaphore wakes up
+  *cchan_out_thread*. Both exist once *reply_init* returned, replying
+  therefore doesn't depend on *cchan_out_thread* having started.
+
+  SHUTDOWN_OK is the last Response, *cchan_out_thread* exits once it
+  has sent it. It is never dropped, neither for a full queue nor for
+  lack of buffers, a buffer is set aside for it. *reply_close* queues a
+  sentinel ending *cchan_out_thread* on paths without SHUTDOWN_OK, e.g.
+  *cchan_in_thread* failing to bind.
+*/
+
+#include "core/wineing.h"
+#include "conc/queue.h"
+
+#include "gen/WineingCtrlProto.pb.h"
+
+#include <stddef.h>
+
+/**
+ * \struct
+ *
+ * A serialized Response. Heap allocated buffers are only as large as
+ * their Response.
+ */
+typedef struct
+{
+  size_t size;                  // of the serialized Response
+  int pooled;                   // 0 if allocated on the heap
+  int last;                     // 1 if SHUTDOWN_OK, nothing follows
+  char data[DEFAULTS_CCHAN_BUFFER_SIZE];
+} reply_buf;
+
+/**
+ * Allocates the pool of *buffers* buffers and the queue of at least
+ * *capacity* pending Responses. Must be invoked before any thread
+ * replies.
+ *
+ * \return 0 if successful, -1 if allocation failed
+ */
+int reply_init(size_t buffers, size_t capacity);
+
+/**
+ * Frees the pool and the queue. Responses still queued are dropped.
+ * Buffers still held by zmq must have been released, i.e. invoke after
+ * *chan_shutdown*.
+ */
+void reply_destroy();
+
+/**
+ * Serializes *res* and queues it. Safe to invoke from several threads.
+ *
+ * \return 0 if successful, -1 if the queue is full in which case the
+ *         Response is dropped
+ */
+int reply_send(const WineingCtrlProto::Response &res);
+
+/**
+ * Queues a Response carrying nothing but *id* and *type*. Safe to
+ * invoke from several threads.
+ *
+ * \return 0 if successful, -1 if the queue is full in which case the
+ *         Response is dropped
+ */
+int reply_send_fixed(long long id, WineingCtrlProto::Response::Type type);
+
+/**
+ * Dequeues the next Response, blocking until there is one. Only
+ * invoked by *cchan_out_thread*. Pass reply_buf.data to *chan_send*
+ * with *reply_free* and the buffer as hint.
+ *
+ * \return The buffer or NULL once the sentinel queued by *reply_close*
+ *         is reached
+ */
+reply_buf* reply_next();
+
+/**
+ * Queues the sentinel ending *cchan_out_thread*, after the Responses
+ * already queued. Like SHUTDOWN_OK it is never dropped, the
+ * *cchan_out_thread* must be running or never have been started.
+ */
+void reply_close();
+
+/**
+ * Returns *hint*, the buffer *data* belongs to, to the pool or frees
+ * it. The signature matches chan_sendFreeFn. Safe to invoke from any
+ * thread, notably zmq's io thread.
+ */
+void reply_free(void *data, void *hint);
+
+#endif /* _REPLY_H */
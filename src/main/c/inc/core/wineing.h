@@ -2,6 +2,8 @@
 #ifndef _WINEING_H
 #define _WINEING_H
 
+#include "conc/credit.h"
+#include "conc/rcu.h"
 #include "net/chan.h"
 
 #include <string.h>
@@ -10,11 +12,33 @@
 #define DEFAULTS_CCHAN_IN_NAME            "tcp://*:9990"
 #define DEFAULTS_CCHAN_OUT_NAME           "tcp://*:9991"
 #define DEFAULTS_MCHAN_NAME               "tcp://*:9992"
-#define DEFAULTS_ICHAN_NAME               "inproc://ctrl.out"
+#define DEFAULTS_LZ4_ICHAN_NAME           "inproc://mchan.lz4"
+#define DEFAULTS_OCHAN_ICHAN_NAME         "inproc://ochan."
 #define DEFAULTS_TAPE_BASE_DIR            "C:\\md\\"
 #define DEFAULTS_SHARED_VERSION_INIT      0
 #define DEFAULTS_SHARED_VERSION_READ_INIT -1
 #define DEFAULTS_CCHAN_BUFFER_SIZE        2048
+#define DEFAULTS_SYMTAB_CAPACITY          65536
+#define DEFAULTS_SYMTAB_DIR_CHUNK         64
+#define DEFAULTS_MCHAN_ENCODING           WINEING_MCHAN_ENCODING_PROTOBUF
+#define DEFAULTS_QDELTA_REFRESH           64
+#define DEFAULTS_LZ4_BATCH_SIZE           16384
+#define DEFAULTS_LZ4_STATS_INTERVAL       1000
+#define DEFAULTS_BAR_INTERVAL             1000
+#define DEFAULTS_JOURNAL_BUFFER_SIZE      262144
+#define DEFAULTS_JOURNAL_FRAME_SIZE       1024
+#define DEFAULTS_JOURNAL_SUFFIX           ".wj"
+#define DEFAULTS_OCHAN_BATCH_SIZE         256
+#define DEFAULTS_OCHAN_BUFFER_SIZE        512
+#define DEFAULTS_URATE_CAPACITY           8192
+#define DEFAULTS_URATE_INTERVAL           1000
+#define DEFAULTS_REPLY_POOL_SIZE          64
+#define DEFAULTS_REPLY_QUEUE_SIZE         1024
+#define DEFAULTS_PARTITION_PORT_STEP      100
+#define DEFAULTS_GREEKS_RATE              0.0
+#define DEFAULTS_GREEKS_EXPIRY_MS         57600000 // 16:00 ET
+#define DEFAULTS_CHECKPOINT_INTERVAL      300000   // ms
+#define DEFAULTS_CHECKPOINT_NAME          "all"
 
 // Values for w_ctrl.cmd
 #define WINEING_CTRL_CMD_INIT             4
@@ -22,10 +46,24 @@
 #define WINEING_CTRL_CMD_MARKET_STOP      2
 #define WINEING_CTRL_CMD_MARKET_INIT      1
 #define WINEING_CTRL_CMD_SHUTDOWN         0
-#define WINEING_CTRL_DEFAULT_DATA_SIZE    1024
+#define WINEING_CTRL_DEFAULT_DATA_SIZE    16384
 
-// The channel response/notification messages
-// are sent to cchan_out_thread
+// Values for w_conf.mchan_encoding
+#define WINEING_MCHAN_ENCODING_PROTOBUF   0
+#define WINEING_MCHAN_ENCODING_DELTA      1
+
+// Maximum number of bar intervals, see w_conf.bar_intervals
+#define WINEING_BARS_MAX_INTERVALS        4
+
+// Maximum number of tapes replayed concurrently, see w_conf.batch_workers
+#define WINEING_BATCH_MAX_WORKERS         64
+
+// Maximum number of option partitions, see w_conf.ochan_fqcns
+#define WINEING_OCHAN_MAX_SHARDS          16
+
+// Maximum number of processes started by --partitions, see
+// w_conf.partitions
+#define WINEING_MAX_PARTITIONS            8
 
 /**
  * \struct
@@ -39,8 +77,55 @@ typedef struct
   const char *cchan_out_fqcn;
   const char *mchan_fqcn;
   const char *tape_basedir;
+  int mchan_encoding;     // one of WINEING_MCHAN_ENCODING_*
+  int mchan_xpub;         // 1 to publish only symbols subscribed to
+  int mchan_seq;          // 1 to number mchan frames, see codec/seqhdr.h
+  unsigned int mchan_trace;     // traces 1 in n mchan frames, 0 to disable
+  const char *mchan_lz4_fqcn;   // NULL if compression is disabled
+  const char *mchan_lz4_dict;   // optional dictionary file
+  const char *bchan_fqcn;       // NULL if bar aggregation is disabled
+  unsigned int bar_intervals[WINEING_BARS_MAX_INTERVALS]; // ms
+  int bar_intervals_size;
+  const char *nchan_fqcn;       // NULL if NBBO consolidation is disabled
+  int batch_workers;            // tapes replayed concurrently by BATCH_START
+  const char *columnar_tape;    // tapes to convert, NULL to run normally
+  const char *columnar_dir;     // directory columnar files are written to
+  const char *ochan_fqcns[WINEING_OCHAN_MAX_SHARDS]; // one per option partition
+  int ochan_size;               // 0 if options are published on mchan
+  int greeks;                   // 1 to compute the greeks of ochan quotes
+  double greeks_rate;           // risk free rate of the greeks
+  const char *checkpoint_dir;   // NULL if checkpoints are disabled
+  unsigned int checkpoint_interval; // ms, see core/checkpoint.h
+  const char *partition;        // partition ingested, NULL for all
+  const char *partitions[WINEING_MAX_PARTITIONS]; // started by the launcher
+  int partitions_size;          // 0 if not a launcher
 } w_conf;
 
+/**
+ * \struct
+ *
+ * The part of the configuration changed at runtime with RECONFIGURE,
+ * published through *g_rconf*. Immutable once published, a change
+ * publishes a modified copy. Copies share the channels, a channel
+ * replaced is closed once no reader holds a configuration referring
+ * to it.
+ */
+typedef struct
+{
+  unsigned int generation;      // incremented by every RECONFIGURE
+  chan *mchan;
+  unsigned long long mchan_hwm; // 0 for no limit
+  chan *bchan;                  // NULL if bar aggregation is disabled
+
+  // Serialized WineingCtrlProto::Filter replacing the one of
+  // MARKET_START if *filter_generation* changed, see nxtape.cc
+  char *filter;
+  size_t filter_size;
+  unsigned int filter_generation;
+
+  int dir_chunk;                // see DEFAULTS_SYMTAB_DIR_CHUNK
+} w_rconf;
+
 /**
  * \struct
  *
@@ -52,6 +137,17 @@ typedef struct
   w_conf *conf;
 } w_ctx;
 
+/**
+ * \struct
+ *
+ * Argument of *ochan_thread*.
+ */
+typedef struct
+{
+  w_ctx *ctx;
+  int shard;              // index into w_conf.ochan_fqcns
+} w_ochan_arg;
+
 // http://www.drdobbs.com/parallel/volatile-vs-volatile/212701484
 // see http://stackoverflow.com/questions/2044565/volatile-struct-semantics
 typedef struct
@@ -59,6 +155,7 @@ typedef struct
   int volatile cmd;       // the command
   char * volatile data;    // data buffer
   size_t volatile size;   // data buffer's size
+  unsigned int volatile flags; // WININF_NXCORE_* flags of MARKET_RUN
 } w_ctrl;
 
 /**
@@ -75,6 +172,22 @@ typedef struct
  */
 extern w_ctrl g_data;
 
+/**
+ * The current w_rconf. Read by the NxCore callback of the live tape
+ * only, the market data thread being its single reader, see
+ * conc/rcu.h. Replaced by *cchan_in_thread* on RECONFIGURE. NULL
+ * until *market_thread* bound its channels.
+ */
+extern rcu g_rconf;
+
+/**
+ * Credits of a paced replay, see Request.credits. Opened by
+ * *cchan_in_thread* on MARKET_START, taken by the NxCore callback of
+ * the live tape, the single producer. Closed, i.e. not pacing,
+ * otherwise.
+ */
+extern credit *g_credit;
+
 /**
  * Initializes Wineing.
  */
@@ -88,6 +201,26 @@ void wineing_init(w_ctx &);
  */
 void wineing_run(w_ctx &);
 
+/**
+ * Converts the tapes matching w_conf.columnar_tape to columnar files
+ * in w_conf.columnar_dir instead of running Wineing, see
+ * *nxtape_columnar*. Must be invoked after *wineing_init*.
+ *
+ * \return 0 if all tapes were converted, -1 otherwise
+ */
+int wineing_columnar(w_ctx &);
+
+/**
+ * Starts one Wineing per w_conf.partitions instead of running Wineing,
+ * see core/partition.h. Serves DIRECTORY and SHUTDOWN on the control
+ * channels until SHUTDOWN, which is forwarded to every partition,
+ * and waits for the partitions to exit. Must be invoked after
+ * *wineing_init*.
+ *
+ * \return 0 if all partitions exited cleanly, -1 otherwise
+ */
+int wineing_launch(w_ctx &);
+
 /**
  * Frees any resources allocated by Wineing and does a clean shutdown.
  */
@@ -96,12 +229,13 @@ void wineing_shutdown(w_ctx &);
 /**
  * Thread listening for incoming control requests. Responses to
  * control Requests are never sent directly to the client but instead
- * send to *cchan_out_thread*.
+ * queued to *cchan_out_thread*, see core/reply.h.
  */
 void* cchan_in_thread(void*);
 
 /**
- * Thread sending Responses to the client(s).
+ * Thread sending Responses to the client(s). Publishes the buffers
+ * queued with *reply_send* on cchan_out without copying them.
  */
 void* cchan_out_thread(void*);
 
@@ -111,6 +245,21 @@ void* cchan_out_thread(void*);
  */
 void* market_thread(void*);
 
+/**
+ * Thread compressing batches of market data handed over by
+ * *market_thread* and publishing them on *mchan_lz4*. Only started if
+ * w_conf.mchan_lz4_fqcn is set.
+ */
+void* mchan_lz4_thread(void*);
+
+/**
+ * Thread publishing the option messages of one partition on its
+ * ochan endpoint, see agg/urate.h. One is started per
+ * w_conf.ochan_fqcns entry.
+ *
+ * \param _arg A w_ochan_arg
+ */
+void* ochan_thread(void *_arg);
 
 inline void _copy_local_to_shared (const void *t, void *g)
 {
@@ -119,6 +268,7 @@ inline void _copy_local_to_shared (const void *t, void *g)
 
   shared->cmd  = local->cmd;
   shared->size = local->size;
+  shared->flags = local->flags;
   if(0 < local->size) {
     memcpy(shared->data, local->data, local->size);
   }
@@ -131,6 +281,7 @@ inline void _copy_shared_to_local(void *t, const void *g)
 
   local->cmd  = shared->cmd;
   local->size = shared->size;
+  local->flags = shared->flags;
   if(0 < shared->size) {
     memcpy(local->data, shared->data, shared->size);
   }
@@ -1,6 +1,7 @@
 #ifndef _CHAN_H
 #define _CHAN_H
 
+#include <string.h>
 #include <zmq.h>
 
 #define CHAN_RECV_BLOCK     0
@@ -14,6 +15,7 @@
 #define CHAN_TYPE_PULL_CONNECT   5
 #define CHAN_TYPE_PUSH_BIND      6
 #define CHAN_TYPE_PUSH_CONNECT   7
+#define CHAN_TYPE_XPUB           8  // PUB receiving subscriptions
 
 
 /**
@@ -25,6 +27,7 @@ typedef struct {
   void *ctx;
   void *sock;
   int type;
+  unsigned long long hwm;       // 0 is zmq's default, no limit
 } chan;
 
 /**
@@ -76,6 +79,15 @@ int chan_bind(chan *c);
  */
 void chan_destroy(chan *c);
 
+/**
+ * Sets the high water mark, the number of messages queued per peer
+ * before sends block or drop (PUB). Applied by *chan_bind* if invoked
+ * before, otherwise to connections established from now on.
+ *
+ * \return 0 if successful, -1 otherwise
+ */
+int chan_set_hwm(chan *c, unsigned long long hwm);
+
 /**
  * Terminates the zmq socket. The use of any sockets associated to the
  * ZMQ context will fail. Usually invoked when the application is
@@ -95,10 +107,15 @@ void chan_shutdown();
  * \param fn    Function invoked to parse the message. The function
  *              is supposed to return -1 in case of error.
  * \param *obj  Pointer to a user provided value, e.g. ptr to a buffer
+ * \param flags CHAN_RECV_NOBLOCK returns -1 instead of blocking if no
+ *              message is available
  * \return      If ZMQ call or message parsing fails -1, otherwise the
  *              number of bytes read
  */
-inline int chan_recv(chan *c, chan_recvFn fn, void *obj)
+inline int chan_recv(chan *c,
+                     chan_recvFn fn,
+                     void *obj,
+                     int flags = CHAN_RECV_BLOCK)
 {
   zmq_msg_t message;
   zmq_msg_init (&message);
@@ -107,7 +124,7 @@ inline int chan_recv(chan *c, chan_recvFn fn, void *obj)
   // code. zmq_recv does not return the number of bytes read. Its
   // return value is either -1 in case of an error or 0 otherwise. In
   // case of success we set it to the number of bytes read.
-  int read = zmq_recv(c->sock, &message, 0);
+  int read = zmq_recv(c->sock, &message, flags);
   if(read == 0) {
     read = zmq_msg_size (&message);
     void * data = zmq_msg_data(&message);
@@ -119,16 +136,72 @@ inline int chan_recv(chan *c, chan_recvFn fn, void *obj)
   return read;
 }
 
+/**
+ * Sends *buffer* without copying it. *freeFn*, if set, is invoked
+ * with *buffer* and *hint* once zmq no longer needs the buffer.
+ */
 inline int chan_send(chan *c,
                      void *buffer,
                      size_t size,
-                     chan_sendFreeFn freeFn = NULL)
+                     chan_sendFreeFn freeFn = NULL,
+                     void *hint = NULL)
 {
   zmq_msg_t out;
-  zmq_msg_init_data(&out, buffer, size, freeFn, NULL);
+  zmq_msg_init_data(&out, buffer, size, freeFn, hint);
   return zmq_send (c->sock, &out, 0);
 }
 
+/**
+ * Sends a message part, the message is complete with the next part
+ * sent with *chan_send*. Parts are delivered atomically. Used to
+ * prefix messages on PUB channels with a topic subscribers filter on.
+ *
+ * \sa http://api.zeromq.org/2-1:zmq-send
+ */
+inline int chan_send_more(chan *c,
+                          void *buffer,
+                          size_t size,
+                          chan_sendFreeFn freeFn = NULL)
+{
+  zmq_msg_t out;
+  zmq_msg_init_data(&out, buffer, size, freeFn, NULL);
+  return zmq_send (c->sock, &out, ZMQ_SNDMORE);
+}
+
+/**
+ * \return 1 if CHAN_TYPE_XPUB channels hand subscriptions to the
+ *         publisher, 0 otherwise. zmq 2.x defines ZMQ_XPUB but never
+ *         passes subscriptions up.
+ */
+/**
+ * Sends a copy of *buffer*, which the caller keeps. Small messages are
+ * stored within the zmq message, copying them allocates nothing. Pass
+ * *more* 1 if another part follows, see *chan_send_more*.
+ */
+inline int chan_send_copy(chan *c,
+                          const void *buffer,
+                          size_t size,
+                          int more = 0)
+{
+  zmq_msg_t out;
+  if(0 > zmq_msg_init_size(&out, size)) {
+    return -1;
+  }
+  memcpy(zmq_msg_data(&out), buffer, size);
+  int rc = zmq_send (c->sock, &out, more ? ZMQ_SNDMORE : 0);
+  zmq_msg_close(&out);
+  return rc;
+}
+
+inline int chan_xpub_supported()
+{
+#if 3 <= ZMQ_VERSION_MAJOR
+  return 1;
+#else
+  return 0;
+#endif
+}
+
 inline const char * chan_error()
 {
   return zmq_strerror(errno);
@@ -1,6 +1,8 @@
 #ifndef _WININF_H
 #define _WININF_H
 
+#include <stddef.h>
+
 struct NxCoreSystem;
 struct NxCoreMessage;
 
@@ -21,14 +23,103 @@ struct NxCoreMessage;
   its behaviour in wininf.win.cc.
  */
 
+// Flags of *wininf_nxcore_run*, NxCore's control flags (NxCF_*).
+// Messages excluded are not even decoded by NxCore.
+#define WININF_NXCORE_EXCLUDE_QUOTES    0x1 // exchange quotes
+#define WININF_NXCORE_EXCLUDE_MM_QUOTES 0x2 // market maker quotes
+#define WININF_NXCORE_EXCLUDE_OPRA      0x4 // equity options
+#define WININF_NXCORE_NO_CRC_CHECK      0x8 // skips the tape's CRC checks
+
 int  wininf_nxcore_load();
 
+/**
+ * Processes *tape* invoking *fn* for each message. Several tapes may
+ * be processed concurrently by different threads.
+ *
+ * \param user_data Passed to *fn* in NxCoreSystem.UserData, allows the
+ *                  callback to tell concurrently processed tapes apart
+ * \param flags     WININF_NXCORE_* flags, 0 to process everything
+ * \return          0 if the whole tape was processed, -1 if it could
+ *                  not be or *fn* stopped it
+ */
 int  wininf_nxcore_run(char *tape,
+                      int user_data,
+                      unsigned int flags,
                       int STDCALL (*fn) (const NxCoreSystem *,
                                          const NxCoreMessage *));
 
 void wininf_nxcore_free();
 
+/**
+ * Converts an NxCore price to a decimal. Must be invoked after
+ * *wininf_nxcore_load*.
+ *
+ * \param price      NxCore integer price
+ * \param price_type Its NxCore price type
+ */
+double wininf_nxcore_price(int price, unsigned char price_type);
+
+/**
+ * Saves NxCore's state to file *path*. Only valid from within the
+ * callback of *wininf_nxcore_run*, the tape it processes continues
+ * from the state when passed to *wininf_nxcore_run* instead of the
+ * tape.
+ *
+ * \param path A path as mapped by *wininf_nxcore_path*
+ * \return     0 if successful, -1 otherwise
+ */
+int  wininf_nxcore_save_state(const char *path);
+
+/**
+ * Maps the Unix path *path* to the one NxCore opens, the DOS path on
+ * Wine.
+ *
+ * \return 0 if successful, -1 if *path* isn't mapped or *out* is too
+ *         small
+ */
+int  wininf_nxcore_path(const char *path, char *out, size_t size);
+
 int  wininf_file_exists(const char *path);
 
+/**
+ * \return The size of file *path* in bytes or -1 if it doesn't exist
+ */
+long long wininf_file_size(const char *path);
+
+/**
+ * Asks the OS to read file *path* into the page cache ahead of being
+ * opened, without waiting for it (POSIX_FADV_WILLNEED). Reading it
+ * later hits the cache rather than the disk.
+ *
+ * \return 0 if successful, -1 otherwise
+ */
+int  wininf_file_prefetch(const char *path);
+
+/**
+ * Invokes *fn* with the path of each file matching *pattern*. Only the
+ * last path component may contain wildcards (* and ?).
+ *
+ * \return The number of matching files
+ */
+int  wininf_file_glob(const char *pattern,
+                      void (*fn) (const char *path, void *obj),
+                      void *obj);
+
+/**
+ * Starts another instance of the running program with the command
+ * line arguments *args*, NULL terminated and without the program.
+ *
+ * \return A handle to be passed to *wininf_wait* or NULL if starting
+ *         the process failed
+ */
+void* wininf_spawn_self(const char *const *args);
+
+/**
+ * Waits for a process started with *wininf_spawn_self* to exit and
+ * frees its handle.
+ *
+ * \return The exit code of the process or -1 if waiting failed
+ */
+int  wininf_wait(void *process);
+
 #endif /* _INXCORE_H */
@@ -2,18 +2,165 @@
 
 #include "nx/nxinf.h"
 
+#include "core/checkpoint.h"
+#include "core/embed.h"
+#include "core/wineing.h"
 #include "net/chan.h"
+#include "sym/symtab.h"
+
+// Price type of NxOptionHdr.strikePrice
+#define NXTAPE_STRIKE_PRICE_TYPE 7
+
+/**
+ * \struct
+ *
+ * An option message handed over to the *ochan_thread* of its
+ * partition. Records are sent in batches of up to
+ * DEFAULTS_OCHAN_BATCH_SIZE, an empty batch terminates the thread.
+ * Serialization is left to the partition's thread, as are the greeks
+ * of quotes if w_conf.greeks is set.
+ */
+typedef struct
+{
+  int type;                     // MarketData.Type
+  unsigned int underlying;      // dense id of the underlying
+  unsigned int clock;           // NxCore clock, ms of day
+  double spot;                  // underlying's last trade, 0 if none
+  int strike;                   // see NXTAPE_STRIKE_PRICE_TYPE
+  int days;                     // from the session date to expiry
+  unsigned int symbol_id;
+  unsigned int timestamp;       // exchange timestamp, ms of day
+  int price;                    // bid price of quotes
+  int ask_price;
+  unsigned int size;            // bid size of quotes
+  unsigned int ask_size;
+  unsigned short exg;           // listed exchange of SYMBOLs
+  unsigned char price_type;
+  unsigned char deleted;        // SYMBOL only
+  unsigned char put;            // 1 for puts
+  char topic[SYMTAB_NAME_SIZE]; // the underlying, e.g. "eAAPL"
+  char symbol[SYMTAB_NAME_SIZE]; // SYMBOL only
+} nxtape_orec;
+
+/**
+ * Must be invoked by the thread running the live tape. Market data
+ * is published on the channels of the w_rconf in *g_rconf*, re-read
+ * with every NxCore message, so that RECONFIGURE applies
+ * without interrupting the tape. Control messages are sent with
+ * *reply_send*, see core/reply.h. Symbols outside w_conf.partition
+ * are ignored by the live tape.
+ *
+ * \param [in] conf      The configuration, e.g. the mchan encoding
+ * \param [in] rslot     The thread's reader slot in *g_rconf*
+ */
+void nxtape_init(const w_conf *conf, int rslot);
+
+/**
+ * Enables batching. Every frame published on mchan is also appended
+ * to a batch. Full batches, and pending ones on each NxCore STATUS
+ * message, are sent through *mchan_batch* to be compressed by
+ * *mchan_lz4_thread*. Must be invoked by the thread invoking
+ * *nxtape_init*.
+ *
+ * \param [in] mchan_batch Not thread safe! inproc channel to
+ *                         *mchan_lz4_thread*
+ */
+void nxtape_batch_init(chan *mchan_batch);
+
+/**
+ * Enables bar aggregation. Trades are aggregated into OHLCV bars of
+ * each interval in w_conf.bar_intervals which are published on
+ * w_rconf.bchan once complete, see agg/bars.h. Must be invoked by the
+ * thread invoking *nxtape_init*.
+ */
+void nxtape_bars_init();
+
+/**
+ * Enables NBBO consolidation. Exchange quotes of the live tape update
+ * the book of their symbol, the NBBO is published on *nchan* whenever
+ * it changes, see agg/nbbo.h. Books are cleared when a tape starts.
+ * Must be invoked by the thread invoking *nxtape_init*.
+ *
+ * \param [in] nchan Not thread safe! The NBBO channel
+ */
+void nxtape_nbbo_init(chan *nchan);
+
+/**
+ * Enables option partitioning. Option quotes and trades, and the
+ * directory entries of options, are no longer published on mchan but
+ * handed to the partition of their underlying instead (see
+ * agg/urate.h), one inproc channel per partition. With w_conf.greeks
+ * quotes carry what their greeks are computed from, the last trade of
+ * the underlying included. Must be invoked by the thread invoking
+ * *nxtape_init*.
+ *
+ * \param [in] ochan Not thread safe! inproc channels to the
+ *                   *ochan_thread*s, indexed by partition
+ * \param [in] size  The number of partitions
+ */
+void nxtape_ochan_init(chan **ochan, int size);
+
+/**
+ * Enables checkpoints of the live tape, see core/checkpoint.h. Once
+ * w_conf.checkpoint_interval passed on the NxCore clock NxCore's state
+ * and the directory are saved with the next STATUS message. Must be
+ * invoked by the thread invoking *nxtape_init*, before each tape.
+ *
+ * \param [in] c The checkpoints or NULL to disable them, e.g. for a
+ *              historical tape
+ */
+void nxtape_checkpoint_init(checkpoint *c);
+
+/**
+ * Restores the directory of the live tape from checkpoint *slot*. The
+ * live tape is then continued from NxCore's state of the same slot.
+ * Must be invoked by the thread invoking *nxtape_init*, before the
+ * first tape.
+ *
+ * \return The NxCore clock of the checkpoint or -1 if restoring
+ *         failed, the directory is empty then
+ */
+long nxtape_checkpoint_restore(checkpoint *c, int slot);
+
+/**
+ * Replays *tape* independently of the live tape, writing the market
+ * data messages it would publish on mchan to the file *journal*.
+ * Blocks until the tape is complete. May be invoked by several threads
+ * at once, up to WINEING_BATCH_MAX_WORKERS. Each replay has its own
+ * symbol directory, the symbol ids of a journal are only valid within
+ * that journal.
+ *
+ * The journal is a sequence of frames, each a varint length followed
+ * by a serialized MarketData message.
+ *
+ * \return The number of messages written or -1 on error, also if the
+ *         replay was stopped before the end of the tape
+ */
+long nxtape_replay(const char *tape, const char *journal);
+
+/**
+ * Replays *tape* like *nxtape_replay* but writes exchange quotes and
+ * trades to columnar tables instead (see store/coltab.h):
+ *
+ *   <base>.trade.*  timestamp, price, size, price_type, exg
+ *   <base>.quote.*  timestamp, bid_price, ask_price, bid_size,
+ *                   ask_size, price_type, exg
+ *
+ * Rows are buffered in memory until the tape is complete.
+ *
+ * \return The number of rows written or -1 on error
+ */
+long nxtape_columnar(const char *tape, const char *base);
 
 /**
- * The thread invoking nxtape_init should own the chan instances,
- * cchan_out, and mchan.
+ * Replays *tape* like *nxtape_replay* but hands trades, quotes, STATUS
+ * messages and directory entries to the handlers of *e* instead of
+ * encoding them, see core/embed.h. Stops once *embed_stop* is invoked.
  *
- * \param [in] cchan_out Not thread safe! Channel to send control
- *                       messages to the client
- * \param [in] mchan     Not thread safe! Channel to send market data
- *                       messages to the client
+ * \param flags WININF_NXCORE_* flags, see nx/nxinf.h
+ * \return      0 if successful, -1 on error
  */
-void nxtape_init(chan *cchan_out, chan *mchan);
+int nxtape_embed(const char *tape, unsigned int flags, embed *e);
 
 int STDCALL nxtape_process(const NxCoreSystem *pNxCoreSys,
                            const NxCoreMessage *pNxCoreMsg);
@@ -0,0 +1,88 @@
+#ifndef _CATALOG_H
+#define _CATALOG_H
+
+/*
+  Catalog of the tapes in the tape root.
+
+  The tape root is scanned once, rather than resolved per request, and
+  each tape indexed by the date, feed and size NxCore tape names and
+  the file system tell, e.g. 20121012.GS.nx2 is the GS feed of
+  2012-10-12. Files not named <YYYYMMDD>.<feed>.<ext>, journals and
+  columnar files among them, are not tapes.
+
+  Tapes are sorted by date, then name, so that the tape following
+  another one of the same feed, the one a client replaying days in a
+  row asks for next, is found without scanning. See LIST_TAPES and
+  *catalog_next*.
+
+  Not thread safe, *cchan_in_thread* owns the catalog.
+*/
+
+#include <stddef.h>
+
+#define CATALOG_NAME_SIZE 64
+#define CATALOG_FEED_SIZE 8
+
+/**
+ * \struct
+ *
+ * A tape of the catalog.
+ */
+typedef struct
+{
+  char name[CATALOG_NAME_SIZE];  // file name, relative to the tape root
+  char feed[CATALOG_FEED_SIZE];  // e.g. GS
+  unsigned int date;             // YYYYMMDD
+  unsigned long long size;       // in bytes
+} catalog_tape;
+
+/**
+ * \struct
+ *
+ * The tapes of a directory, sorted by date and name.
+ */
+typedef struct
+{
+  catalog_tape *tapes;
+  int size;
+  int capacity;
+} catalog;
+
+/**
+ * Allocates an empty catalog.
+ */
+catalog* catalog_init();
+
+/**
+ * Frees the catalog.
+ */
+void catalog_destroy(catalog *c);
+
+/**
+ * Parses the tape file name *name*, without a directory, into the
+ * name, feed and date of *t*.
+ *
+ * \return 0 if successful, -1 if *name* isn't a tape
+ */
+int catalog_parse(const char *name, catalog_tape *t);
+
+/**
+ * Replaces the tapes of *c* with the ones in directory *dir*.
+ *
+ * \param dir Including the trailing path separator
+ * \return    The number of tapes
+ */
+int catalog_scan(catalog *c, const char *dir);
+
+/**
+ * \return The tape named *name* or NULL if there is none
+ */
+const catalog_tape* catalog_find(const catalog *c, const char *name);
+
+/**
+ * \return The first tape of the feed of *t* dated after it or NULL if
+ *         there is none
+ */
+const catalog_tape* catalog_next(const catalog *c, const catalog_tape *t);
+
+#endif /* _CATALOG_H */
@@ -0,0 +1,121 @@
+#ifndef _COLFILE_H
+#define _COLFILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+  Column files. A column file holds a single array of fixed size
+  elements, e.g. the trade prices of one tape. Analytics jobs scan
+  one column without touching others.
+
+  The array is split into blocks of *block_rows* elements, each LZ4
+  compressed independently. Blocks that do not compress are stored
+  as is. Readers mmap the file and decompress only the blocks holding
+  the rows they need, uncompressed blocks are used in place.
+
+  Layout, all integers little endian:
+
+    colfile_header
+    colfile_block[blocks]   block table, offsets relative to the file
+    block data
+
+  Readers are not thread safe but several readers may share a file.
+*/
+
+#define COLFILE_MAGIC          0x4c4f4357   // "WCOL"
+#define COLFILE_VERSION        1
+#define COLFILE_BLOCK_ROWS     65536
+
+// Values for colfile_block.codec
+#define COLFILE_CODEC_NONE     0
+#define COLFILE_CODEC_LZ4      1
+
+/**
+ * \struct
+ *
+ * The file header.
+ */
+typedef struct
+{
+  uint32_t magic;
+  uint32_t version;
+  uint32_t elem_size;     // bytes per element
+  uint32_t block_rows;    // elements per block, the last may have less
+  uint64_t rows;          // total number of elements
+  uint32_t blocks;        // number of entries in the block table
+  uint32_t reserved;
+} colfile_header;
+
+/**
+ * \struct
+ *
+ * An entry of the block table.
+ */
+typedef struct
+{
+  uint64_t offset;        // of the block data
+  uint32_t size;          // bytes of block data
+  uint32_t codec;         // one of COLFILE_CODEC_*
+} colfile_block;
+
+/**
+ * \struct
+ *
+ * A column file opened for reading.
+ */
+typedef struct
+{
+  const char *map;        // the mapped file
+  size_t map_size;
+  const colfile_header *header;
+  const colfile_block *blocks;
+  char *scratch;          // one decompressed block
+  int64_t scratch_block;  // block held by *scratch*, -1 if none
+} colfile;
+
+/**
+ * Writes *rows* elements of *elem_size* bytes to a new column file
+ * *path*. An existing file is replaced.
+ *
+ * \param block_rows Elements per block, COLFILE_BLOCK_ROWS if 0
+ * \return           0 if successful, -1 otherwise
+ */
+int colfile_write(const char *path,
+                  const void *data,
+                  size_t elem_size,
+                  uint64_t rows,
+                  uint32_t block_rows);
+
+/**
+ * Maps column file *path*.
+ *
+ * \return The file or NULL if it does not exist or is malformed
+ */
+colfile* colfile_open(const char *path);
+
+/**
+ * Unmaps the file.
+ */
+void colfile_close(colfile *cf);
+
+/**
+ * Returns the elements of block *i*. The pointer is either into the
+ * mapped file or into a scratch buffer which is overwritten by the
+ * next call.
+ *
+ * \param rows [out] Number of elements in the block
+ * \return     The elements or NULL if the block is malformed
+ */
+const void* colfile_block_data(colfile *cf, uint32_t i, uint32_t *rows);
+
+/**
+ * Copies elements [*row*, *row* + *n*) to *dst*, decompressing the
+ * blocks they span.
+ *
+ * \return 0 if successful, -1 if the range is out of bounds or a block
+ *         is malformed
+ */
+int colfile_read(colfile *cf, uint64_t row, uint64_t n, void *dst);
+
+#endif /* _COLFILE_H */
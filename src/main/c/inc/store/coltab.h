@@ -0,0 +1,128 @@
+#ifndef _COLTAB_H
+#define _COLTAB_H
+
+#include "store/colfile.h"
+#include "sym/symtab.h"
+
+/*
+  Columnar tables. Rows of one message type, e.g. trades, are
+  collected in memory column by column while a tape is processed.
+  Once complete the table is sorted by symbol id and each column is
+  written to a column file of its own (see store/colfile.h):
+
+    <base>.<column>.col   one per column
+    <base>.symbol_id.col  the symbol id of each row
+    <base>.idx            symbol -> row range index
+
+  Sorting is stable, the rows of a symbol remain in tape order. The
+  index maps each symbol with rows to the range [first, first + rows)
+  so that a job interested in a few symbols reads only the blocks
+  holding them.
+
+  Not thread safe.
+*/
+
+#define COLTAB_INDEX_MAGIC     0x58444957   // "WIDX"
+#define COLTAB_INDEX_VERSION   1
+#define COLTAB_MAX_COLUMNS     16
+
+/**
+ * \struct
+ *
+ * Header of the index file.
+ */
+typedef struct
+{
+  uint32_t magic;
+  uint32_t version;
+  uint32_t symbols;       // number of entries following the header
+  uint32_t reserved;
+  uint64_t rows;          // rows of the table
+} coltab_index_header;
+
+/**
+ * \struct
+ *
+ * An index entry, sorted by id.
+ */
+typedef struct
+{
+  uint32_t id;
+  uint16_t exg;           // listed exchange
+  uint16_t flags;         // symtab_entry.flags
+  uint64_t first;         // first row of the symbol
+  uint64_t rows;          // number of rows of the symbol
+  char name[SYMTAB_NAME_SIZE];
+} coltab_index_entry;
+
+/**
+ * \struct
+ *
+ * A column.
+ */
+typedef struct
+{
+  const char *name;       // used in the file name
+  size_t elem_size;
+  char *data;
+} coltab_column;
+
+/**
+ * \struct
+ *
+ * A table.
+ */
+typedef struct
+{
+  coltab_column columns[COLTAB_MAX_COLUMNS];
+  int size;               // number of columns
+  uint32_t *ids;          // symbol id of each row
+  uint64_t rows;
+  uint64_t capacity;
+} coltab;
+
+/**
+ * Allocates an empty table.
+ *
+ * \param names      Column names, not copied
+ * \param elem_sizes Element size of each column
+ * \param size       Number of columns, at most COLTAB_MAX_COLUMNS
+ * \return           The table or NULL if *size* is out of range
+ */
+coltab* coltab_init(const char *const *names,
+                    const size_t *elem_sizes,
+                    int size);
+
+/**
+ * Frees the table.
+ */
+void coltab_destroy(coltab *t);
+
+/**
+ * Appends a row of symbol *id*. The row's values are uninitialized,
+ * set them with *coltab_at*.
+ *
+ * \return The row or -1 if the table could not grow
+ */
+int64_t coltab_append(coltab *t, uint32_t id);
+
+/**
+ * \return The value of column *col* in *row*
+ */
+inline void* coltab_at(coltab *t, int col, int64_t row)
+{
+  coltab_column &c = t->columns[col];
+  return &c.data[row * c.elem_size];
+}
+
+/**
+ * Sorts the table by symbol id and writes the column files and the
+ * index. The table is empty afterwards.
+ *
+ * \param base File name prefix
+ * \param syms The directory the ids were taken from
+ * \return     0 if successful, -1 otherwise
+ */
+int coltab_write(coltab *t, const char *base, const symtab *syms);
+
+#endif /* _COLTAB_H */
@@ -0,0 +1,107 @@
+#ifndef _INTEREST_H
+#define _INTEREST_H
+
+/*
+  Symbols the subscribers of an XPUB mchan are interested in. Messages
+  on such a channel are prefixed with a topic frame holding the NxCore
+  symbol including its NULL byte, the root for options (subscribe to
+  "eAAPL\0"). STATUS messages carry the topic "\0".
+
+  XPUB hands the subscriptions to the publisher, one message each: a
+  byte, 1 to subscribe and 0 to unsubscribe, followed by the topic.
+  zmq 2.x never does, see *chan_xpub_supported*.
+  A topic ending in the NULL byte names a symbol, any other is a
+  prefix ("e" for all equities, "" for everything).
+
+  The topics are compiled into a symfilter (see sym/symfilter.h), a
+  bitmap over symbol ids evaluated once per id. Checking whether
+  anybody wants a message costs a load of the bitmap, messages nobody
+  subscribed to are never encoded.
+
+  Not thread safe.
+*/
+
+#include "sym/symfilter.h"
+#include "sym/symtab.h"
+
+/**
+ * \struct
+ *
+ * A topic somebody subscribed to.
+ */
+typedef struct
+{
+  char name[SYMTAB_NAME_SIZE];  // without the NULL byte of the topic
+  int exact;                    // 1 if a symbol, 0 if a prefix
+  unsigned int refs;            // subscriptions to the topic
+} interest_topic;
+
+/**
+ * \struct
+ *
+ * The subscriptions of a channel.
+ */
+typedef struct
+{
+  interest_topic *topics;
+  unsigned int topics_size;
+  unsigned int topics_capacity;
+  int changed;                  // topics changed since compiled
+  int all;                      // somebody subscribed to everything
+  symfilter *filter;            // compiled topics
+} interest;
+
+/**
+ * \return An instance nobody is subscribed to
+ */
+interest* interest_init();
+
+void interest_destroy(interest *in);
+
+/**
+ * Applies an XPUB subscription message. Takes effect with the next
+ * *interest_compile*.
+ *
+ * \return 0 if successful, -1 if *msg* is no subscription
+ */
+int interest_update(interest *in, const char *msg, size_t size);
+
+/**
+ * Drops all subscriptions, e.g. once the channel was replaced.
+ */
+void interest_clear(interest *in);
+
+/**
+ * Compiles the topics if they changed. Every id is evaluated again.
+ */
+void interest_compile(interest *in);
+
+/**
+ * Evaluates the topics against a symbol and records the result.
+ *
+ * \param name   The NxCore symbol, the root for options
+ * \return       SYMFILTER_PASS or SYMFILTER_DROP
+ */
+int interest_eval(interest *in,
+                  unsigned int id,
+                  const char *name,
+                  unsigned short exg,
+                  int option);
+
+/**
+ * \return SYMFILTER_UNKNOWN if symbol *id* was not evaluated since the
+ *         last compile, SYMFILTER_PASS if somebody subscribed to it,
+ *         SYMFILTER_DROP otherwise
+ */
+inline int interest_get(const interest *in, unsigned int id)
+{
+  if(in->all) {
+    return SYMFILTER_PASS;
+  }
+  if(0 == in->topics_size) {
+    return SYMFILTER_DROP;
+  }
+  return symfilter_get(in->filter, id);
+}
+
+#endif /* _INTEREST_H */
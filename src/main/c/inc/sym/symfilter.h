@@ -0,0 +1,158 @@
+#ifndef _SYMFILTER_H
+#define _SYMFILTER_H
+
+#include <stdint.h>
+
+/*
+  Server side filter of market data as declared by the client with
+  MARKET_START. Messages nobody asked for are dropped before they are
+  encoded.
+
+  The spec (symbols, prefixes, option roots and expiries, listed
+  exchanges, message types) is compiled into
+  - a type mask, one bit per MarketData.Type, and
+  - a bitmap over symbol ids (see sym/symtab.h) holding two bits per
+    id: whether the id was evaluated and whether it passes.
+
+  Evaluating the spec against a symbol is comparatively expensive and
+  done once per id, the first time it is seen after the filter is
+  compiled. From then on checking a message costs a load of the type
+  mask and one of the bitmap.
+
+  A symbol passes if
+  - its listed exchange is one of the exchanges, if any, and
+  - its name is one of the symbols, starts with one of the prefixes,
+    or, for options, is one of the roots, if any of these are given,
+    and
+  - for options, the expiry is within [expiry_from, expiry_to], if
+    given.
+
+  Not thread safe.
+*/
+
+// Values returned by *symfilter_get*
+#define SYMFILTER_UNKNOWN      0
+#define SYMFILTER_DROP         1
+#define SYMFILTER_PASS         3
+
+// Listed exchanges are below
+#define SYMFILTER_MAX_EXG      256
+
+/**
+ * \struct
+ *
+ * A compiled filter.
+ */
+typedef struct
+{
+  char **symbols;               // sorted by *symfilter_compile*
+  unsigned int symbols_size;
+  char **prefixes;
+  unsigned int prefixes_size;
+  char **roots;                 // option roots, sorted
+  unsigned int roots_size;
+  uint32_t exchanges[SYMFILTER_MAX_EXG / 32];
+  int any_exchange;             // 1 if no exchange was added
+  uint32_t types;               // bit per MarketData.Type
+  uint32_t expiry_from;         // YYYYMMDD, 0 if unbounded
+  uint32_t expiry_to;           // YYYYMMDD, 0 if unbounded
+
+  uint32_t *state;              // two bits per symbol id
+  unsigned int capacity;        // ids covered by *state*
+} symfilter;
+
+/**
+ * Allocates a filter passing everything.
+ */
+symfilter* symfilter_init();
+
+/**
+ * Frees the filter.
+ */
+void symfilter_destroy(symfilter *f);
+
+/**
+ * Adds a symbol, e.g. "eAAPL". Names are copied.
+ */
+void symfilter_add_symbol(symfilter *f, const char *name);
+
+/**
+ * Adds a symbol prefix, e.g. "e" for all equities.
+ */
+void symfilter_add_prefix(symfilter *f, const char *prefix);
+
+/**
+ * Adds an option root, e.g. "oAAPL". Matches options only.
+ */
+void symfilter_add_root(symfilter *f, const char *root);
+
+/**
+ * Adds a listed exchange. Exchanges >= SYMFILTER_MAX_EXG are ignored.
+ */
+void symfilter_add_exchange(symfilter *f, unsigned int exg);
+
+/**
+ * Restricts the filter to the given message types. Once a type was
+ * added all others are dropped.
+ *
+ * \param type A MarketData.Type value below 32
+ */
+void symfilter_add_type(symfilter *f, int type);
+
+/**
+ * Restricts options to expiries in [from, to], both YYYYMMDD. 0
+ * leaves the bound open.
+ */
+void symfilter_set_expiry(symfilter *f, uint32_t from, uint32_t to);
+
+/**
+ * Completes the spec. Must be invoked after the last *symfilter_add_**
+ * and before the filter is used.
+ */
+void symfilter_compile(symfilter *f);
+
+/**
+ * Evaluates the spec against a symbol.
+ *
+ * \param option 1 if the symbol is an option
+ * \param expiry YYYYMMDD of the option, ignored otherwise
+ * \return       1 if the symbol passes, 0 otherwise
+ */
+int symfilter_eval(const symfilter *f,
+                   const char *name,
+                   unsigned short exg,
+                   int option,
+                   uint32_t expiry);
+
+/**
+ * Records the result of *symfilter_eval* for symbol *id*.
+ *
+ * \return SYMFILTER_PASS or SYMFILTER_DROP
+ */
+int symfilter_set(symfilter *f, unsigned int id, int pass);
+
+/**
+ * Forgets the results of all ids, e.g. after ids were reused.
+ */
+void symfilter_reset(symfilter *f);
+
+/**
+ * \return One of SYMFILTER_UNKNOWN, SYMFILTER_DROP, SYMFILTER_PASS
+ */
+inline int symfilter_get(const symfilter *f, unsigned int id)
+{
+  if(id >= f->capacity) {
+    return SYMFILTER_UNKNOWN;
+  }
+  return (f->state[id >> 4] >> ((id & 15) << 1)) & 3;
+}
+
+/**
+ * \return Non-zero if messages of *type* pass
+ */
+inline int symfilter_type(const symfilter *f, int type)
+{
+  return f->types & (1u << type);
+}
+
+#endif /* _SYMFILTER_H */
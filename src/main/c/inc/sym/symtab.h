@@ -0,0 +1,144 @@
+#ifndef _SYMTAB_H
+#define _SYMTAB_H
+
+#include <stddef.h>
+
+/*
+  Symbol directory. Maps NxCore symbols to compact integer ids which
+  are published on the wire instead of the symbol string. The string
+  itself is only sent in SYMBOL (directory) messages.
+
+  Ids are dense, that is they are handed out in order starting at 0
+  and are never reused for the lifetime of a table. Per symbol data,
+  e.g. caches, books, or aggregates, can therefore be kept in plain
+  arrays indexed by id.
+
+  A symbol is identified by its name and the listed exchange. Lookup
+  by name is done through an open-addressing hash table using
+  robin-hood probing [1]. The hot path in nxtape_process never hits
+  the hash table because NxCore lets us stash the id in the
+  UserData1 field of the symbol's NxString.
+
+  Not thread safe. The table is owned by the thread running the
+  NxCore callback.
+
+  [1] http://codecapsule.com/2013/11/11/robin-hood-hashing/
+*/
+
+// Maximum length of a symbol name including the terminating NULL
+// byte. Longer names are truncated.
+#define SYMTAB_NAME_SIZE       32
+
+// Marks unused hash slots and failed lookups
+#define SYMTAB_NONE            0xffffffff
+
+// Values for symtab_entry.flags
+#define SYMTAB_FLAG_DELETED    0x1
+
+/**
+ * \struct
+ *
+ * A directory entry. The entry's id is its index in *symtab.entries*.
+ */
+typedef struct
+{
+  char name[SYMTAB_NAME_SIZE];
+  unsigned short exg;
+  unsigned short flags;
+} symtab_entry;
+
+/**
+ * \struct
+ *
+ * A slot in the hash table. *hash* is kept in the slot to avoid
+ * touching the entry while probing.
+ */
+typedef struct
+{
+  unsigned int hash;
+  unsigned int id;
+} symtab_slot;
+
+/**
+ * \struct
+ *
+ * The symbol directory.
+ */
+typedef struct
+{
+  symtab_entry *entries;  // dense array indexed by id
+  unsigned int size;      // number of ids handed out
+  unsigned int capacity;  // capacity of *entries*
+  symtab_slot *slots;     // hash table, twice the size of *entries*
+  unsigned int mask;      // number of slots minus one
+} symtab;
+
+/**
+ * Allocates a new symbol table. The table grows on demand, the
+ * initial *capacity* is rounded up to the next power of two.
+ *
+ * \param capacity Initial number of entries
+ * \return         The table or NULL if allocation failed
+ */
+symtab* symtab_init(unsigned int capacity);
+
+/**
+ * Frees all memory held by the table. Any reference to *t* is invalid
+ * afterwards.
+ */
+void symtab_destroy(symtab *t);
+
+/**
+ * Returns the id of the symbol *name* listed on *exg*. The symbol is
+ * added to the table if not yet known.
+ *
+ * \param t     The table
+ * \param name  NULL terminated symbol name
+ * \param exg   The listed exchange
+ * \param added Optional. Set to 1 if the symbol was added, 0
+ *              otherwise
+ * \return      The id or SYMTAB_NONE if the table could not grow
+ */
+unsigned int symtab_intern(symtab *t,
+                           const char *name,
+                           unsigned short exg,
+                           int *added = NULL);
+
+/**
+ * Looks up the id of symbol *name* listed on *exg*.
+ *
+ * \return The id or SYMTAB_NONE if not found
+ */
+unsigned int symtab_find(const symtab *t,
+                         const char *name,
+                         unsigned short exg);
+
+/**
+ * Renames the symbol with *id*. The id remains the same. Used for
+ * NxCore symbol modifications (NxSS_MOD).
+ *
+ * \return 0 if successful, -1 if *id* is unknown or the new name is
+ *         already taken
+ */
+int symtab_rename(symtab *t,
+                  unsigned int id,
+                  const char *name,
+                  unsigned short exg);
+
+/**
+ * Removes the symbol with *id* from the hash table. The entry is
+ * flagged SYMTAB_FLAG_DELETED and its id is never handed out again.
+ *
+ * \return 0 if successful, -1 if *id* is unknown
+ */
+int symtab_remove(symtab *t, unsigned int id);
+
+/**
+ * \return The entry for *id* or NULL if *id* is out of range
+ */
+inline const symtab_entry* symtab_get(const symtab *t, unsigned int id)
+{
+  return id < t->size ? &t->entries[id] : NULL;
+}
+
+#endif /* _SYMTAB_H */
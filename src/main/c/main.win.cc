@@ -1,11 +1,15 @@
 
 #include <windows.h>
 
+#include "core/partition.h"
 #include "core/wineing.h"
 #include "log/logging.h"
+#include "net/chan.h"
 
+#include <ctype.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 void cmd_parse(int, char**, w_conf &);
 
@@ -22,17 +26,51 @@ int main(int argc, char** argv)
   conf.cchan_out_fqcn = DEFAULTS_CCHAN_OUT_NAME;
   conf.mchan_fqcn     = DEFAULTS_MCHAN_NAME;
   conf.tape_basedir   = DEFAULTS_TAPE_BASE_DIR;
+  conf.mchan_encoding = DEFAULTS_MCHAN_ENCODING;
+  conf.mchan_xpub     = 0;
+  conf.mchan_seq      = 0;
+  conf.mchan_trace    = 0;
+  conf.mchan_lz4_fqcn = NULL;
+  conf.mchan_lz4_dict = NULL;
+  conf.bchan_fqcn     = NULL;
+  conf.nchan_fqcn     = NULL;
+  conf.bar_intervals[0] = DEFAULTS_BAR_INTERVAL;
+  conf.bar_intervals_size = 1;
+  conf.batch_workers  = sysconf(_SC_NPROCESSORS_ONLN);
+  conf.columnar_tape  = NULL;
+  conf.columnar_dir   = NULL;
+  conf.ochan_size     = 0;
+  conf.greeks         = 0;
+  conf.greeks_rate    = DEFAULTS_GREEKS_RATE;
+  conf.checkpoint_dir = NULL;
+  conf.checkpoint_interval = DEFAULTS_CHECKPOINT_INTERVAL;
+  conf.partition      = NULL;
+  conf.partitions_size = 0;
 
   cmd_parse(argc, argv, conf);
 
   log(LOG_INFO, "Starting Wineing");
 
   log(LOG_INFO,
-      "Configuration is [cchan_in: %s, cchan_out: %s, mchan: %s, tape-basedir: %s]",
+      "Configuration is [cchan_in: %s, cchan_out: %s, mchan: %s, tape-basedir: %s, mchan-encoding: %s, mchan-xpub: %s, mchan-seq: %s, mchan-trace: %u, mchan-lz4: %s, mchan-lz4-dict: %s, bchan: %s, nchan: %s, batch-workers: %d, ochan-partitions: %d, greeks: %s, checkpoint-dir: %s, partition: %s, partitions: %d]",
       conf.cchan_in_fqcn,
       conf.cchan_out_fqcn,
       conf.mchan_fqcn,
-      conf.tape_basedir
+      conf.tape_basedir,
+      conf.mchan_encoding == WINEING_MCHAN_ENCODING_DELTA ? "delta" : "protobuf",
+      conf.mchan_xpub ? "enabled" : "disabled",
+      conf.mchan_seq ? "enabled" : "disabled",
+      conf.mchan_trace,
+      conf.mchan_lz4_fqcn ? conf.mchan_lz4_fqcn : "disabled",
+      conf.mchan_lz4_dict ? conf.mchan_lz4_dict : "none",
+      conf.bchan_fqcn ? conf.bchan_fqcn : "disabled",
+      conf.nchan_fqcn ? conf.nchan_fqcn : "disabled",
+      conf.batch_workers,
+      conf.ochan_size,
+      conf.greeks ? "enabled" : "disabled",
+      conf.checkpoint_dir ? conf.checkpoint_dir : "disabled",
+      conf.partition ? conf.partition : "all",
+      conf.partitions_size
       );
 
 
@@ -44,6 +82,16 @@ int main(int argc, char** argv)
   ctx.conf = &conf;
 
   wineing_init(ctx);
+  if(NULL != conf.columnar_tape) {
+    int rc = wineing_columnar(ctx);
+    wineing_shutdown(ctx);
+    return 0 > rc ? 1 : 0;
+  }
+  if(0 < conf.partitions_size) {
+    int rc = wineing_launch(ctx);
+    wineing_shutdown(ctx);
+    return 0 > rc ? 1 : 0;
+  }
   wineing_run(ctx);
   wineing_shutdown(ctx);
 
@@ -56,6 +104,26 @@ void cmd_print_usage()
          "--cchan-in=<fqcn> "
          "--cchan-out=<fqcn> "
          "--mchan=<fqcn> "
+         "[--mchan-encoding=<protobuf|delta>] "
+         "[--mchan-xpub] "
+         "[--mchan-seq] "
+         "[--mchan-trace=<n>] "
+         "[--mchan-lz4=<fqcn>] "
+         "[--mchan-lz4-dict=<file>] "
+         "[--bchan=<fqcn>] "
+         "[--bar-intervals=<ms>[,<ms>...]] "
+         "[--nchan=<fqcn>] "
+         "[--ochan=<fqcn>[,<fqcn>...]] "
+         "[--greeks] "
+         "[--greeks-rate=<rate>] "
+         "[--tape-root=<dir>] "
+         "[--batch-workers=<n>] "
+         "[--checkpoint-dir=<dir>] "
+         "[--checkpoint-interval=<ms>] "
+         "[--partition=<name> | --partitions=<name>[,<name>...]]\n");
+  printf("       wineing.exe "
+         "--columnar=<tape> "
+         "[--columnar-dir=<dir>] "
          "[--tape-root=<dir>]\n\n");
 
   printf("Wineing TBD.\n\n");
@@ -66,10 +134,78 @@ void cmd_print_usage()
   printf("                   ZMQ PUSH socket)\n");
   printf("  --mchan          Market data channel (binds to a ZMQ PUB socket\n");
   printf("                   socket)\n");
+  printf("  [--mchan-encoding] Encoding of quotes on mchan. Either 'protobuf'\n");
+  printf("                   (default) or 'delta' (varint deltas against the\n");
+  printf("                   previous quote of the symbol)\n");
+  printf("  [--mchan-xpub]   Binds mchan to a ZMQ XPUB socket. Messages are\n");
+  printf("                   prefixed with the symbol as topic, only the\n");
+  printf("                   symbols subscribed to are encoded. Requires\n");
+  printf("                   zmq 3 or later\n");
+  printf("  [--mchan-seq]    Prefixes mchan messages with a sequence number.\n");
+  printf("                   Wineings ingesting the same feed number them\n");
+  printf("                   alike, clients may subscribe to two of them and\n");
+  printf("                   keep the first copy of each message. Not with\n");
+  printf("                   --mchan-xpub\n");
+  printf("  [--mchan-trace]  Prefixes 1 in n quotes and trades on mchan with\n");
+  printf("                   the times they passed NxCore, the callback,\n");
+  printf("                   the encoder and zmq_send. Disabled by default\n");
+  printf("  [--mchan-lz4]    Channel publishing LZ4 compressed batches of\n");
+  printf("                   mchan messages (binds to a ZMQ PUB socket)\n");
+  printf("  [--mchan-lz4-dict] Dictionary file used to prime the LZ4\n");
+  printf("                   compressor. Consumers need the same file\n");
+  printf("  [--bchan]        Bar channel publishing OHLCV bars aggregated\n");
+  printf("                   from trades (binds to a ZMQ PUB socket)\n");
+  printf("  [--bar-intervals] Comma separated bar lengths in ms, at most\n");
+  printf("                   %d. Defaults to %d\n",
+         WINEING_BARS_MAX_INTERVALS, DEFAULTS_BAR_INTERVAL);
+  printf("  [--nchan]        NBBO channel publishing the best bid and offer\n");
+  printf("                   over all exchanges whenever it changes (binds\n");
+  printf("                   to a ZMQ PUB socket)\n");
+  printf("  [--ochan]        Comma separated option channels, at most %d.\n",
+         WINEING_OCHAN_MAX_SHARDS);
+  printf("                   Option messages are partitioned by underlying\n");
+  printf("                   and published on these channels instead of\n");
+  printf("                   mchan, one thread per channel (each binds to a\n");
+  printf("                   ZMQ PUB socket). Messages are prefixed with the\n");
+  printf("                   underlying as topic\n");
+  printf("  [--greeks]       Adds the implied volatility, delta, gamma and\n");
+  printf("                   vega to option quotes on ochan. Requires\n");
+  printf("                   --ochan\n");
+  printf("  [--greeks-rate]  Risk free rate of the greeks, continuously\n");
+  printf("                   compounded. Defaults to %g\n",
+         DEFAULTS_GREEKS_RATE);
   printf("NxCore related options:\n");
   printf("  [--tape-root]    The directory from which to serve the tape files\n");
   printf("                   Defaults to 'C:\\md\\'. The path has to end "
                              "in '\\'\n");
+  printf("  [--batch-workers] Number of tapes replayed concurrently by\n");
+  printf("                   BATCH_START requests, at most %d. Defaults to\n",
+         WINEING_BATCH_MAX_WORKERS);
+  printf("                   the number of processors\n");
+  printf("  [--checkpoint-dir] Directory to periodically save NxCore's state\n");
+  printf("                   and the symbol directory of the real-time tape\n");
+  printf("                   to. A restart on the same day continues from\n");
+  printf("                   the latest checkpoint. A Unix path ending in\n");
+  printf("                   '/'. Disabled by default\n");
+  printf("  [--checkpoint-interval] Interval of the checkpoints in ms on the\n");
+  printf("                   NxCore clock. Defaults to %d\n",
+         DEFAULTS_CHECKPOINT_INTERVAL);
+  printf("Partitioning:\n");
+  printf("  [--partition]    Ingests only the symbols of a partition of the\n");
+  printf("                   feed: 'equities', 'options' or 'futures'\n");
+  printf("  [--partitions]   Comma separated partitions, at most %d. Starts\n",
+         WINEING_MAX_PARTITIONS);
+  printf("                   one Wineing per partition instead, their\n");
+  printf("                   channels derived from the ones given (TCP\n");
+  printf("                   ports + %d per partition). The control\n",
+         DEFAULTS_PARTITION_PORT_STEP);
+  printf("                   channels serve DIRECTORY and SHUTDOWN only\n");
+  printf("Conversion:\n");
+  printf("  --columnar       Converts the tape files, relative to the tape\n");
+  printf("                   root and wildcards allowed, to columnar files\n");
+  printf("                   and exits\n");
+  printf("  [--columnar-dir] Directory to write the columnar files to, has to\n");
+  printf("                   end in '\\'. Defaults to the tape root\n");
 }
 
 char * cmd_parse_opt(char *argv)
@@ -78,6 +214,61 @@ char * cmd_parse_opt(char *argv)
   return &argv[eq+1];
 }
 
+/**
+ * Parses a comma separated list of bar intervals.
+ */
+void cmd_parse_intervals(char *opt, w_conf &conf)
+{
+  conf.bar_intervals_size = 0;
+  while(*opt && conf.bar_intervals_size < WINEING_BARS_MAX_INTERVALS) {
+    unsigned int ms = strtoul(opt, &opt, 10);
+    if(0 < ms) {
+      conf.bar_intervals[conf.bar_intervals_size++] = ms;
+    }
+    opt += strspn(opt, ", ");
+    if(*opt && !isdigit(*opt)) {
+      break;
+    }
+  }
+  if(0 == conf.bar_intervals_size) {
+    conf.bar_intervals[conf.bar_intervals_size++] = DEFAULTS_BAR_INTERVAL;
+  }
+}
+
+/**
+ * Splits a comma separated list of option channels in place.
+ */
+void cmd_parse_ochan(char *opt, w_conf &conf)
+{
+  conf.ochan_size = 0;
+  while(*opt && conf.ochan_size < WINEING_OCHAN_MAX_SHARDS) {
+    int len = strcspn(opt, ",");
+    conf.ochan_fqcns[conf.ochan_size++] = opt;
+    if(',' != opt[len]) {
+      break;
+    }
+    opt[len] = '\0';
+    opt += len + 1;
+  }
+}
+
+/**
+ * Splits a comma separated list of partitions in place.
+ */
+void cmd_parse_partitions(char *opt, w_conf &conf)
+{
+  conf.partitions_size = 0;
+  while(*opt && conf.partitions_size < WINEING_MAX_PARTITIONS) {
+    int len = strcspn(opt, ",");
+    conf.partitions[conf.partitions_size++] = opt;
+    if(',' != opt[len]) {
+      break;
+    }
+    opt[len] = '\0';
+    opt += len + 1;
+  }
+}
+
 void cmd_parse(int argc, char** argv, w_conf &conf)
 {
   int allOpts = 0;
@@ -85,7 +276,15 @@ void cmd_parse(int argc, char** argv, w_conf &conf)
     switch(argv[i][2])
       {
       case 'c':
-        if(argv[i][8] == 'i') {
+        if(0 == strncmp(argv[i], "--checkpoint-dir=", 17)) {
+          conf.checkpoint_dir = cmd_parse_opt(argv[i]);
+        } else if(0 == strncmp(argv[i], "--checkpoint-interval=", 22)) {
+          conf.checkpoint_interval = strtoul(cmd_parse_opt(argv[i]), NULL, 10);
+        } else if(0 == strncmp(argv[i], "--columnar-dir=", 15)) {
+          conf.columnar_dir = cmd_parse_opt(argv[i]);
+        } else if(0 == strncmp(argv[i], "--columnar=", 11)) {
+          conf.columnar_tape = cmd_parse_opt(argv[i]);
+        } else if(argv[i][8] == 'i') {
           conf.cchan_in_fqcn = cmd_parse_opt(argv[i]);
           allOpts |= 0x1;
         } else {
@@ -95,17 +294,82 @@ void cmd_parse(int argc, char** argv, w_conf &conf)
         break;
 
       case 'm':
-        conf.mchan_fqcn = cmd_parse_opt(argv[i]);
-        allOpts |= 0x4;
+        if(0 == strncmp(argv[i], "--mchan-lz4-dict=", 17)) {
+          conf.mchan_lz4_dict = cmd_parse_opt(argv[i]);
+        } else if(0 == strncmp(argv[i], "--mchan-lz4=", 12)) {
+          conf.mchan_lz4_fqcn = cmd_parse_opt(argv[i]);
+        } else if(0 == strcmp(argv[i], "--mchan-xpub")) {
+          conf.mchan_xpub = 1;
+        } else if(0 == strcmp(argv[i], "--mchan-seq")) {
+          conf.mchan_seq = 1;
+        } else if(0 == strncmp(argv[i], "--mchan-trace=", 14)) {
+          conf.mchan_trace = strtoul(cmd_parse_opt(argv[i]), NULL, 10);
+        } else if(0 == strncmp(argv[i], "--mchan-encoding=", 17)) {
+          conf.mchan_encoding = strcmp(cmd_parse_opt(argv[i]), "delta") ?
+            WINEING_MCHAN_ENCODING_PROTOBUF :
+            WINEING_MCHAN_ENCODING_DELTA;
+        } else {
+          conf.mchan_fqcn = cmd_parse_opt(argv[i]);
+          allOpts |= 0x4;
+        }
+        break;
+
+      case 'g':
+        if(0 == strncmp(argv[i], "--greeks-rate=", 14)) {
+          conf.greeks_rate = atof(cmd_parse_opt(argv[i]));
+        } else {
+          conf.greeks = 1;
+        }
+        break;
+
+      case 'n':
+        conf.nchan_fqcn = cmd_parse_opt(argv[i]);
+        break;
+
+      case 'o':
+        cmd_parse_ochan(cmd_parse_opt(argv[i]), conf);
+        break;
+
+      case 'p':
+        if(0 == strncmp(argv[i], "--partitions=", 13)) {
+          cmd_parse_partitions(cmd_parse_opt(argv[i]), conf);
+        } else {
+          conf.partition = cmd_parse_opt(argv[i]);
+        }
         break;
 
       case 't':
         conf.tape_basedir = cmd_parse_opt(argv[i]);
         break;
+
+      case 'b':
+        if(0 == strncmp(argv[i], "--bar-intervals=", 16)) {
+          cmd_parse_intervals(cmd_parse_opt(argv[i]), conf);
+        } else if(0 == strncmp(argv[i], "--batch-workers=", 16)) {
+          conf.batch_workers = atoi(cmd_parse_opt(argv[i]));
+        } else {
+          conf.bchan_fqcn = cmd_parse_opt(argv[i]);
+        }
+        break;
       }
   }
 
-  if(allOpts != 7) {
+  // Conversion doesn't open any channels
+  if(NULL != conf.columnar_tape) {
+    if(NULL == conf.columnar_dir) {
+      conf.columnar_dir = conf.tape_basedir;
+    }
+    return;
+  }
+
+  if(allOpts != 7
+     || (NULL != conf.partition && NULL == partition_find(conf.partition))
+     || (conf.greeks && 0 == conf.ochan_size)
+     // Subscribers of one Wineing of a pair would change its numbering
+     || (conf.mchan_seq && conf.mchan_xpub)
+     // Nobody would be interested in anything, nothing published
+     || (conf.mchan_xpub && !chan_xpub_supported())
+     || (NULL != conf.checkpoint_dir && 0 == conf.checkpoint_interval)) {
     cmd_print_usage();
     exit(1);
   }
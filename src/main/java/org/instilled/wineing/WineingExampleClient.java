@@ -1,5 +1,9 @@
 package org.instilled.wineing;
 
+import java.io.ByteArrayOutputStream;
+import java.io.FileInputStream;
+import java.io.IOException;
+import java.io.InputStream;
 import java.util.LinkedList;
 import java.util.List;
 
@@ -11,9 +15,14 @@ import org.apache.commons.cli.OptionBuilder;
 import org.apache.commons.cli.Options;
 import org.apache.commons.cli.ParseException;
 import org.apache.commons.cli.PosixParser;
+import org.instilled.wineing.core.CreditWindow;
+import org.instilled.wineing.core.MarketDataDispatcher;
+import org.instilled.wineing.core.MarketDataHandler;
 import org.instilled.wineing.core.ResponseProcessor;
 import org.instilled.wineing.core.WineingRemoteAPI;
 import org.instilled.wineing.core.Worker;
+import org.instilled.wineing.gen.WineingCtrlProto.Filter;
+import org.instilled.wineing.gen.WineingCtrlProto.Reconfigure;
 import org.instilled.wineing.gen.WineingCtrlProto.Request;
 import org.instilled.wineing.gen.WineingCtrlProto.Request.Builder;
 import org.instilled.wineing.gen.WineingCtrlProto.Request.Type;
@@ -25,8 +34,6 @@ import org.slf4j.LoggerFactory;
  * Issues:
  * <ul>
  * <li>Market data protobuf incomplete</li>
- * <li>Avoid re-allocating a new buffer every time receive is being
- * invoked</li>
  * </ul>
  */
 public class WineingExampleClient
@@ -34,6 +41,8 @@ public class WineingExampleClient
     public static final Logger log = LoggerFactory
             .getLogger(WineingExampleClient.class);
 
+    private static final int DEFAULT_RING_SIZE = 65536;
+
     private WineingClientCtx _ctx;
 
     private WineingRemoteAPI _api;
@@ -58,12 +67,38 @@ public class WineingExampleClient
         String cchan_in = cmd.getOptionValue("cchan-in");
         String cchan_out = cmd.getOptionValue("cchan-out");
         String mchan = cmd.getOptionValue("mchan");
+        String mchanStandby = cmd.getOptionValue("mchan-standby");
+        String symbols = cmd.getOptionValue("symbols");
         String tape = cmd.getOptionValue("tape-file");
+        String mchanLz4 = cmd.getOptionValue("mchan-lz4");
+        String mchanLz4Dict = cmd.getOptionValue("mchan-lz4-dict");
+        String handlers = cmd.getOptionValue("handlers", "0");
+        String credits = cmd.getOptionValue("credits", "0");
+        String waitStrategy = cmd.getOptionValue("wait-strategy",
+                "yielding");
 
         WineingClientCtx ctx = new WineingClientCtx();
         ctx.cchan_in = cchan_in;
         ctx.cchan_out = cchan_out;
         ctx.mchan = mchan;
+        ctx.mchan_standby = mchanStandby;
+        ctx.symbols = symbols == null ? new String[0] : symbols.split(",");
+        ctx.mchan_lz4 = mchanLz4;
+        ctx.handlers = Integer.parseInt(handlers);
+        ctx.credits = Long.parseLong(credits);
+        ctx.wait_strategy = waitStrategy;
+        if (mchanLz4Dict != null)
+        {
+            try
+            {
+                ctx.mchan_lz4_dict = readFile(mchanLz4Dict);
+            } catch (IOException e)
+            {
+                log.error("Failed to read lz4 dictionary " + mchanLz4Dict,
+                        e);
+                System.exit(1);
+            }
+        }
 
         log.debug("Starting "
                 + WineingExampleClient.class.getSimpleName());
@@ -90,8 +125,15 @@ public class WineingExampleClient
                 }
             });
 
-            // Requests tape (use default RequestProcessor)
-            api.start(tape, null);
+            // Requests tape (use default RequestProcessor). A paced
+            // replay is granted credits by WorkerMarket.java
+            if (tape != null && ctx.credits > 0)
+            {
+                api.start(tape, null, ctx.credits, null);
+            } else
+            {
+                api.start(tape, null);
+            }
 
             for (int i = 0; i < 10; i++)
             {
@@ -168,13 +210,56 @@ public class WineingExampleClient
                 "WorkerCtrlOut");
         worker_ctrl_out.start();
 
+        // Handler threads. The market thread only receives and decodes
+        // messages and hands them over to the handlers, see
+        // MarketDataDispatcher.java
+        MarketDataHandler handler = new WorkerMarket.LoggingHandler();
+        if (_ctx.handlers > 0)
+        {
+            MarketDataHandler[] handlers = new MarketDataHandler[_ctx.handlers];
+            for (int i = 0; i < handlers.length; i++)
+            {
+                handlers[i] = new WorkerMarket.LoggingHandler();
+            }
+            MarketDataDispatcher dispatcher = new MarketDataDispatcher(
+                    handlers, DEFAULT_RING_SIZE, _ctx.wait_strategy);
+            Worker[] workers = dispatcher.getWorkers();
+            for (int i = 0; i < workers.length; i++)
+            {
+                _workers.add(workers[i]);
+                new Thread(workers[i], "WorkerHandler-" + i).start();
+            }
+            handler = dispatcher;
+        }
+
         // Market thread
-        WorkerMarket workerMarket = new WorkerMarket(_ctx.mchan);
+        WorkerMarket workerMarket;
+        if (_ctx.mchan_lz4 == null && _ctx.mchan_standby != null)
+        {
+            workerMarket = new WorkerMarket(_ctx.mchan,
+                    _ctx.mchan_standby, handler);
+        } else if (_ctx.mchan_lz4 == null)
+        {
+            workerMarket = new WorkerMarket(_ctx.mchan, handler);
+        } else
+        {
+            workerMarket = new WorkerMarket(_ctx.mchan_lz4,
+                    _ctx.mchan_lz4_dict, handler);
+        }
+        for (String symbol : _ctx.symbols)
+        {
+            workerMarket.subscribe(symbol);
+        }
+
+        _api = new WineingRemoteAPIImpl(workerCtrlOut, workerCtrlIn);
+        if (_ctx.credits > 0)
+        {
+            workerMarket.setCredits(new CreditWindow(_ctx.credits), _api);
+        }
+
         _workers.add(workerMarket);
         Thread worker_market = new Thread(workerMarket, "WorkerMarket");
         worker_market.start();
-
-        _api = new WineingRemoteAPIImpl(workerCtrlOut, workerCtrlIn);
     }
 
     public void shutdown()
@@ -200,6 +285,13 @@ public class WineingExampleClient
         private String cchan_in;
         private String cchan_out;
         private String mchan;
+        private String mchan_standby;
+        private String[] symbols;
+        private String mchan_lz4;
+        private byte[] mchan_lz4_dict;
+        private int handlers;
+        private long credits;
+        private String wait_strategy;
     }
 
     public static class WineingRemoteAPIImpl implements
@@ -229,8 +321,51 @@ public class WineingExampleClient
         @Override
         public void start(String tapeFile, ResponseProcessor p)
         {
-            Request r = build(Type.MARKET_START, tapeFile);
-            put(r, p);
+            start(tapeFile, null, p);
+        }
+
+        @Override
+        public void start(String tapeFile, Filter filter,
+                ResponseProcessor p)
+        {
+            Builder builder = Request.newBuilder();
+            builder.setRequestId(getRequestId());
+            builder.setType(Type.MARKET_START);
+            if (tapeFile != null)
+            {
+                builder.setTapeFile(tapeFile);
+            }
+            if (filter != null)
+            {
+                builder.setFilter(filter);
+            }
+            put(builder.build(), p);
+        }
+
+        @Override
+        public void start(String tapeFile, Filter filter, long credits,
+                ResponseProcessor p)
+        {
+            Builder builder = Request.newBuilder();
+            builder.setRequestId(getRequestId());
+            builder.setType(Type.MARKET_START);
+            builder.setTapeFile(tapeFile);
+            builder.setCredits(credits);
+            if (filter != null)
+            {
+                builder.setFilter(filter);
+            }
+            put(builder.build(), p);
+        }
+
+        @Override
+        public void credit(long credits, ResponseProcessor p)
+        {
+            Builder builder = Request.newBuilder();
+            builder.setRequestId(getRequestId());
+            builder.setType(Type.CREDIT);
+            builder.setCredits(credits);
+            put(builder.build(), p);
         }
 
         @Override
@@ -240,6 +375,58 @@ public class WineingExampleClient
             put(r, p);
         }
 
+        @Override
+        public void reconfigure(Reconfigure reconfigure,
+                ResponseProcessor p)
+        {
+            Builder builder = Request.newBuilder();
+            builder.setRequestId(getRequestId());
+            builder.setType(Type.RECONFIGURE);
+            builder.setReconfigure(reconfigure);
+            put(builder.build(), p);
+        }
+
+        @Override
+        public void directory(ResponseProcessor p)
+        {
+            Request r = build(Type.DIRECTORY);
+            put(r, p);
+        }
+
+        @Override
+        public void listTapes(int dateFrom, int dateTo, boolean rescan,
+                ResponseProcessor p)
+        {
+            Builder builder = Request.newBuilder();
+            builder.setRequestId(getRequestId());
+            builder.setType(Type.LIST_TAPES);
+            if (dateFrom > 0)
+            {
+                builder.setDateFrom(dateFrom);
+            }
+            if (dateTo > 0)
+            {
+                builder.setDateTo(dateTo);
+            }
+            builder.setRescan(rescan);
+            put(builder.build(), p);
+        }
+
+        @Override
+        public void batch(List<String> tapes, String journalDir,
+                ResponseProcessor p)
+        {
+            Builder builder = Request.newBuilder();
+            builder.setRequestId(getRequestId());
+            builder.setType(Type.BATCH_START);
+            builder.addAllTapeFiles(tapes);
+            if (journalDir != null)
+            {
+                builder.setJournalDir(journalDir);
+            }
+            put(builder.build(), p);
+        }
+
         @Override
         public void shutdown(ResponseProcessor p)
         {
@@ -280,6 +467,25 @@ public class WineingExampleClient
         }
     }
 
+    private static byte[] readFile(String path) throws IOException
+    {
+        InputStream in = new FileInputStream(path);
+        try
+        {
+            ByteArrayOutputStream out = new ByteArrayOutputStream();
+            byte[] buffer = new byte[4096];
+            int n;
+            while ((n = in.read(buffer)) > 0)
+            {
+                out.write(buffer, 0, n);
+            }
+            return out.toByteArray();
+        } finally
+        {
+            in.close();
+        }
+    }
+
     private static CommandLine parseCMDLine(String[] args)
     {
         CommandLine line = null;
@@ -347,6 +553,67 @@ public class WineingExampleClient
                                 + "Requests TAPE from Wineing.")
                 .withLongOpt("tape-file").create("t"));
 
+        o.addOption(OptionBuilder
+                .hasArg()
+                .withArgName("fqcn")
+                .withDescription(
+                        "Market data channel of a standby Wineing. Frames of   " //
+                                + "both are arbitrated, the first copy is kept." //
+                                + " Both Wineings run with --mchan-seq.")
+                .withLongOpt("mchan-standby").create("s"));
+
+        o.addOption(OptionBuilder
+                .hasArg()
+                .withArgName("symbols")
+                .withDescription(
+                        "Comma separated NxCore symbols to receive, e.g.      " //
+                                + "eAAPL,eMSFT. Requires Wineing to run with   " //
+                                + "--mchan-xpub. Defaults to all.")
+                .withLongOpt("symbols").create("y"));
+
+        o.addOption(OptionBuilder
+                .hasArg()
+                .withArgName("fqcn")
+                .withDescription(
+                        "Compressed market data channel. If given market data  " //
+                                + "is received as LZ4 compressed batches on    " //
+                                + "this channel instead of on mchan.")
+                .withLongOpt("mchan-lz4").create("z"));
+
+        o.addOption(OptionBuilder
+                .hasArg()
+                .withArgName("file")
+                .withDescription(
+                        "Dictionary Wineing uses to compress mchan-lz4.")
+                .withLongOpt("mchan-lz4-dict").create("d"));
+
+        o.addOption(OptionBuilder
+                .hasArg()
+                .withArgName("n")
+                .withDescription(
+                        "Number of market data handler threads. Messages are   " //
+                                + "partitioned by symbol. Defaults to 0, i.e.  " //
+                                + "market data is handled on the receiving     " //
+                                + "thread.")
+                .withLongOpt("handlers").create("n"));
+
+        o.addOption(OptionBuilder
+                .hasArg()
+                .withArgName("strategy")
+                .withDescription(
+                        "How handler threads wait for market data: busy-spin,  " //
+                                + "yielding (default), sleeping or blocking.")
+                .withLongOpt("wait-strategy").create("w"));
+
+        o.addOption(OptionBuilder
+                .hasArg()
+                .withArgName("n")
+                .withDescription(
+                        "Paces the replay of tape-file: Wineing publishes at   " //
+                                + "most n messages ahead of the ones received. " //
+                                + "Requires all symbols.")
+                .withLongOpt("credits").create("c"));
+
         return o;
     }
 }
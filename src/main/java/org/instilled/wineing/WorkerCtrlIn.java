@@ -56,7 +56,8 @@ public class WorkerCtrlIn implements Worker
     @Override
     public void run()
     {
-        byte[] buffer = new byte[1024];
+        // Lists of tapes or the directory are larger than most Responses
+        byte[] buffer = new byte[65536];
 
         _running = true;
 
@@ -72,6 +73,13 @@ public class WorkerCtrlIn implements Worker
             try
             {
                 int read = _cchan_in.receive(buffer, 0, buffer.length);
+                if (read > buffer.length)
+                {
+                    log.error("Dropped a Response of " + read
+                            + " bytes, the buffer holds " + buffer.length
+                            + ".");
+                    continue;
+                }
                 CodedInputStream is = CodedInputStream.newInstance(
                         buffer, 0, read);
                 res = Response.parseFrom(is);
@@ -94,12 +102,21 @@ public class WorkerCtrlIn implements Worker
     {
         if (_responseProcessors.containsKey(res.getRequestId()))
         {
-            ResponseProcessor responseProcessor = _responseProcessors
-                    .remove(res.getRequestId());
+            // A batch responds several times, keep the processor until
+            // the batch is done
+            ResponseProcessor responseProcessor = isPartial(res)
+                    ? _responseProcessors.get(res.getRequestId())
+                    : _responseProcessors.remove(res.getRequestId());
             responseProcessor.process(res);
         } else if (_defaultResponseProcessor != null)
         {
             _defaultResponseProcessor.process(res);
         }
     }
+
+    private static boolean isPartial(Response res)
+    {
+        return res.getType() == Response.Type.BATCH_START_OK
+                || res.getType() == Response.Type.BATCH_PROGRESS;
+    }
 }
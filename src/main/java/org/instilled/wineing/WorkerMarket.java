@@ -1,31 +1,168 @@
 package org.instilled.wineing;
 
-import java.io.IOException;
+import java.nio.charset.Charset;
+import java.util.concurrent.ConcurrentLinkedQueue;
 
+import org.instilled.wineing.core.CreditWindow;
+import org.instilled.wineing.core.FeedArbiter;
+import org.instilled.wineing.core.LatencyHistogram;
+import org.instilled.wineing.core.LatencyTracer;
+import org.instilled.wineing.core.Lz4BatchDecoder;
+import org.instilled.wineing.core.MarketDataFlyweight;
+import org.instilled.wineing.core.MarketDataHandler;
+import org.instilled.wineing.core.QuoteDeltaDecoder;
+import org.instilled.wineing.core.WineingRemoteAPI;
 import org.instilled.wineing.core.Worker;
 import org.instilled.wineing.core.ZMQChannel;
 import org.instilled.wineing.core.ZMQChannel.ZMQChannelType;
-import org.instilled.wineing.gen.WineingMarketDataProto.MarketData;
 import org.slf4j.Logger;
 import org.slf4j.LoggerFactory;
 import org.zeromq.ZMQException;
 
-import com.google.protobuf.CodedInputStream;
-
+/**
+ * Receives market data and hands it to a {@link MarketDataHandler}.
+ * Once running the worker does not allocate: messages are received into
+ * a reusable buffer and decoded in place by a
+ * {@link MarketDataFlyweight} (or {@link QuoteDeltaDecoder} and
+ * {@link Lz4BatchDecoder}).<br>
+ * <br>
+ * Given a standby channel the worker subscribes to two Wineings
+ * publishing the same feed (A/B) and keeps the copy of each frame
+ * arriving first, see {@link FeedArbiter}. Both have to run with
+ * <em>--mchan-seq</em>.<br>
+ * <br>
+ * Frames traced by Wineing (<em>--mchan-trace</em>) are recorded by a
+ * {@link LatencyTracer}. Its histograms are logged and reset every
+ * {@link #TRACES_PER_REPORT} traces and once the worker stops.<br>
+ * <br>
+ * If Wineing runs with <em>--mchan-xpub</em> messages are prefixed
+ * with a topic part which is skipped. The worker receives all messages
+ * unless subscribed to single symbols, see {@link #subscribe(String)}.<br>
+ * <br>
+ * A replay paced by the consumer is granted credits as the worker
+ * consumes its messages, see
+ * {@link #setCredits(CreditWindow, WineingRemoteAPI)}.
+ */
 public class WorkerMarket implements Worker
 {
     public static final Logger log = LoggerFactory
             .getLogger(WorkerMarket.class);
 
+    public static final int TRACES_PER_REPORT = 10000;
+
+    /**
+     * The largest frame received: a MarketData message, all well below
+     * 1024 bytes, preceded by the sequence and trace headers (see
+     * <em>--mchan-seq</em> and <em>--mchan-trace</em>). Larger ones are
+     * dropped and logged.
+     */
+    public static final int FRAME_SIZE = 1024 + FeedArbiter.HEADER_SIZE
+            + LatencyTracer.HEADER_SIZE;
+
+    /**
+     * The largest compressed batch received.
+     */
+    public static final int BATCH_SIZE = 65536;
+
+    private static final Charset ASCII = Charset.forName("US-ASCII");
+
+    private static final byte[] TOPIC_ALL = new byte[0];
+
+    /**
+     * The topic of STATUS messages on an XPUB mchan.
+     */
+    private static final byte[] TOPIC_STATUS = new byte[1];
+
     private String _mchan;
 
+    /**
+     * Non-null if arbitrating between two Wineings.
+     */
+    private String _standby;
+
     volatile boolean _running;
 
     private ZMQChannel _market;
 
+    private MarketDataHandler _handler;
+
+    private MarketDataFlyweight _marketData = new MarketDataFlyweight();
+
+    private QuoteDeltaDecoder _quoteDecoder = new QuoteDeltaDecoder(65536);
+
+    /**
+     * Non-null if subscribed to the compressed channel (see Wineing's
+     * <em>--mchan-lz4</em> option).
+     */
+    private Lz4BatchDecoder _batchDecoder;
+
+    private FeedArbiter _arbiter;
+
+    private LatencyTracer _tracer = new LatencyTracer();
+
+    private long _count;
+
+    /**
+     * Non-null if pacing a replay.
+     */
+    private CreditWindow _credits;
+
+    private WineingRemoteAPI _api;
+
+    /**
+     * Requested by any thread, applied by the worker's since ZMQ sockets
+     * are not thread-safe.
+     */
+    private final ConcurrentLinkedQueue<Subscription> _subscriptions =
+            new ConcurrentLinkedQueue<Subscription>();
+
+    /**
+     * <code>true</code> once subscribed to single symbols rather than
+     * all messages.
+     */
+    private boolean _bySymbol;
+
     public WorkerMarket(String mchan)
+    {
+        this(mchan, new LoggingHandler());
+    }
+
+    public WorkerMarket(String mchan, MarketDataHandler handler)
     {
         _mchan = mchan;
+        _handler = handler;
+    }
+
+    /**
+     * Subscribes to two Wineings publishing the same feed.
+     *
+     * @param mchan
+     *            The primary's channel
+     * @param standby
+     *            The standby's channel
+     */
+    public WorkerMarket(String mchan, String standby,
+            MarketDataHandler handler)
+    {
+        this(mchan, handler);
+        _standby = standby;
+        _arbiter = new FeedArbiter(FeedArbiter.DEFAULT_WINDOW);
+    }
+
+    /**
+     * Subscribes to the compressed channel.
+     *
+     * @param mchanLz4
+     *            The compressed channel
+     * @param lz4Dict
+     *            The dictionary Wineing was started with or
+     *            <code>null</code>
+     */
+    public WorkerMarket(String mchanLz4, byte[] lz4Dict,
+            MarketDataHandler handler)
+    {
+        this(mchanLz4, handler);
+        _batchDecoder = new Lz4BatchDecoder(lz4Dict);
     }
 
     public void shutdown()
@@ -33,45 +170,295 @@ public class WorkerMarket implements Worker
         _running = false;
     }
 
+    /**
+     * Grants credits through <em>api</em> as messages are consumed. The
+     * replay has to be started with {@link CreditWindow#getWindow()}
+     * credits. Must be called before the worker runs. Not supported
+     * with a standby channel, <em>api</em> talks to one Wineing only.
+     */
+    public void setCredits(CreditWindow credits, WineingRemoteAPI api)
+    {
+        if (_arbiter != null)
+        {
+            throw new IllegalStateException(
+                    "Credits are granted to a single Wineing");
+        }
+        _credits = credits;
+        _api = api;
+    }
+
+    /**
+     * Subscribes to the messages of <em>symbol</em>, e.g. "eAAPL" or the
+     * root of options, if Wineing runs with <em>--mchan-xpub</em>. The
+     * first subscription ends the one to all messages, STATUS messages
+     * are received regardless.<br>
+     * <br>
+     * May be called from any thread. Applied by the worker before it
+     * starts or once the next message arrives, STATUS messages arrive
+     * every NxCore clock interval.
+     */
+    public void subscribe(String symbol)
+    {
+        _subscriptions.add(new Subscription(topic(symbol), true));
+    }
+
+    /**
+     * Undoes {@link #subscribe(String)}.
+     */
+    public void unsubscribe(String symbol)
+    {
+        _subscriptions.add(new Subscription(topic(symbol), false));
+    }
+
+    /**
+     * @return The topic of <em>symbol</em>'s messages on an XPUB mchan:
+     *         the NxCore symbol including its NULL byte.
+     */
+    public static byte[] topic(String symbol)
+    {
+        byte[] name = symbol.getBytes(ASCII);
+        byte[] topic = new byte[name.length + 1];
+        System.arraycopy(name, 0, topic, 0, name.length);
+        return topic;
+    }
+
     @Override
     public void run()
     {
-        byte[] buffer = new byte[1024];
+        // Compressed batches are much larger than single messages
+        byte[] buffer = new byte[_batchDecoder == null ? FRAME_SIZE
+                : BATCH_SIZE];
 
         _running = true;
 
         _market = new ZMQChannel(_mchan, ZMQChannelType.SUB);
         _market.bind();
+        if (_standby != null)
+        {
+            _market.connect(_standby);
+        }
+        applySubscriptions();
 
-        long count = 0;
+        _count = 0;
         while (_running)
         {
 
             try
             {
                 int read = _market.receive(buffer, 0, buffer.length);
-                CodedInputStream is = CodedInputStream.newInstance(
-                        buffer, 0, read);
-                MarketData marketData = MarketData.parseFrom(is);
+                if (_market.hasReceiveMore())
+                {
+                    // The topic, the message follows
+                    read = _market.receive(buffer, 0, buffer.length);
+                }
+                if (!_subscriptions.isEmpty())
+                {
+                    applySubscriptions();
+                }
+                if (read > buffer.length)
+                {
+                    log.error("Dropped a message of " + read
+                            + " bytes, the buffer holds " + buffer.length
+                            + ".");
+                    continue;
+                }
 
-                if (count % 1000 == 0)
+                if (_batchDecoder == null)
                 {
-                    log.debug(String
-                            .format("Message received (printing every 1000) [%s]",
-                                    marketData.getType()));
+                    process(buffer, 0, read);
+                    continue;
                 }
 
-                count++;
-            } catch (IOException e)
-            {
-                log.error("Failed to process MarketData message.", e);
+                if (_batchDecoder.decompress(buffer, 0, read) < 0)
+                {
+                    log.error("Failed to decompress batch.");
+                    continue;
+                }
+                while (_batchDecoder.next())
+                {
+                    process(_batchDecoder.getBuffer(),
+                            _batchDecoder.getFrameOffset(),
+                            _batchDecoder.getFrameLength());
+                }
             } catch (ZMQException e)
             {
                 // Ignore. We expect an exception when shutting down
             }
         }
-        log.debug("Received " + count + " messages");
+        if (_arbiter == null)
+        {
+            log.debug("Received " + _count + " messages");
+        } else
+        {
+            log.debug("Received " + _count + " messages, dropped "
+                    + _arbiter.getDuplicates() + " duplicates and "
+                    + _arbiter.getLate() + " late");
+        }
+        if (_tracer.getHistogram(LatencyTracer.HOP_TOTAL).getCount() > 0)
+        {
+            log.info(_tracer.toString());
+        }
 
         _market.close();
     }
+
+    private void applySubscriptions()
+    {
+        Subscription s;
+        while ((s = _subscriptions.poll()) != null)
+        {
+            if (!_bySymbol)
+            {
+                _market.unsubscribe(TOPIC_ALL);
+                _market.subscribe(TOPIC_STATUS);
+                _bySymbol = true;
+            }
+            if (s.subscribe)
+            {
+                _market.subscribe(s.topic);
+            } else
+            {
+                _market.unsubscribe(s.topic);
+            }
+        }
+    }
+
+    private void process(byte[] buffer, int offset, int len)
+    {
+        // A credit was taken for each message Wineing published
+        if (_credits != null)
+        {
+            long granted = _credits.consume();
+            if (granted > 0)
+            {
+                _api.credit(granted, null);
+            }
+        }
+
+        // Frames are numbered if Wineing runs with --mchan-seq
+        if (FeedArbiter.isSequenced(buffer, offset, len))
+        {
+            if (_arbiter != null
+                    && !_arbiter.accept(FeedArbiter.getSeq(buffer, offset)))
+            {
+                return;
+            }
+            offset += FeedArbiter.HEADER_SIZE;
+            len -= FeedArbiter.HEADER_SIZE;
+        }
+
+        // Sampled if Wineing runs with --mchan-trace
+        if (LatencyTracer.isTraced(buffer, offset, len))
+        {
+            _tracer.record(buffer, offset);
+            LatencyHistogram total = _tracer
+                    .getHistogram(LatencyTracer.HOP_TOTAL);
+            if (total.getCount() == TRACES_PER_REPORT)
+            {
+                log.info(_tracer.toString());
+                _tracer.reset();
+            }
+            offset += LatencyTracer.HEADER_SIZE;
+            len -= LatencyTracer.HEADER_SIZE;
+        }
+
+        _count++;
+
+        // Quotes are sent as delta frames if Wineing runs with
+        // --mchan-encoding=delta
+        if (QuoteDeltaDecoder.isFrame(buffer, offset, len))
+        {
+            QuoteDeltaDecoder q = _quoteDecoder;
+            if (q.decode(buffer, offset, len) == QuoteDeltaDecoder.DECODE_OK)
+            {
+                _handler.onQuote(q.getSymbolId(), q.getTimestamp(),
+                        q.getBidPrice(), q.getAskPrice(), q.getBidSize(),
+                        q.getAskSize(), q.getExg(), q.getPriceType());
+            }
+            return;
+        }
+
+        MarketDataFlyweight m = _marketData;
+        if (!m.wrap(buffer, offset, len))
+        {
+            log.error("Failed to process MarketData message.");
+            return;
+        }
+
+        switch (m.getType())
+        {
+        case MarketDataFlyweight.TYPE_STATUS:
+            _handler.onStatus(m.getTimestamp());
+            break;
+        case MarketDataFlyweight.TYPE_SYMBOL:
+            _handler.onSymbol(m.getSymbolId(), m.getBuffer(),
+                    m.getSymbolOffset(), m.getSymbolLength(),
+                    m.getListedExg(), m.isDeleted());
+            break;
+        case MarketDataFlyweight.TYPE_QUOTE_EX:
+            _handler.onQuote(m.getSymbolId(), m.getTimestamp(),
+                    m.getBidPrice(), m.getAskPrice(), m.getBidSize(),
+                    m.getAskSize(), m.getReportingExg(), m.getPriceType());
+            break;
+        case MarketDataFlyweight.TYPE_TRADE:
+            _handler.onTrade(m.getSymbolId(), m.getTimestamp(),
+                    m.getPrice(), m.getSize(), m.getReportingExg(),
+                    m.getPriceType());
+            break;
+        default:
+            break;
+        }
+    }
+
+    private static class Subscription
+    {
+        final byte[] topic;
+        final boolean subscribe;
+
+        Subscription(byte[] topic, boolean subscribe)
+        {
+            this.topic = topic;
+            this.subscribe = subscribe;
+        }
+    }
+
+    /**
+     * Default handler. Counts messages and logs every 1000th quote.
+     */
+    public static class LoggingHandler implements MarketDataHandler
+    {
+        private long _quotes;
+        private long _trades;
+
+        @Override
+        public void onStatus(int timestamp)
+        {
+        }
+
+        @Override
+        public void onSymbol(int symbolId, byte[] symbol, int offset,
+                int len, int listedExg, boolean deleted)
+        {
+        }
+
+        @Override
+        public void onQuote(int symbolId, int timestamp, int bidPrice,
+                int askPrice, int bidSize, int askSize, int exg,
+                int priceType)
+        {
+            if (++_quotes % 1000 == 0 && log.isDebugEnabled())
+            {
+                log.debug(String
+                        .format("Quote received (printing every 1000) [symbol id: %d, bid: %d, ask: %d, trades: %d]",
+                                symbolId, bidPrice, askPrice, _trades));
+            }
+        }
+
+        @Override
+        public void onTrade(int symbolId, int timestamp, int price,
+                int size, int exg, int priceType)
+        {
+            _trades++;
+        }
+    }
 }
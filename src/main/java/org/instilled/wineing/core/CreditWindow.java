@@ -0,0 +1,56 @@
+package org.instilled.wineing.core;
+
+/**
+ * Paces a replay started with credits, see {@link WineingRemoteAPI},
+ * by granting credits as messages are consumed. The replay starts with
+ * the whole window, once half of it is consumed that half is granted
+ * again. At most one window of messages is in flight, Wineing blocks
+ * rather than the consumer falling behind.<br>
+ * <br>
+ * Wineing takes a credit per message published on mchan. All of them
+ * have to be consumed, i.e. the consumer must not subscribe to single
+ * symbols, or the replay stalls.<br>
+ * <br>
+ * <b>Note</b>: This class is not thread-safe.
+ */
+public class CreditWindow
+{
+    private final long _window;
+    private final long _batch;
+
+    private long _consumed;
+
+    /**
+     * @param window
+     *            The credits the replay is started with, at least 1
+     */
+    public CreditWindow(long window)
+    {
+        if (window < 1)
+        {
+            throw new IllegalArgumentException("window < 1");
+        }
+        _window = window;
+        _batch = Math.max(1, window / 2);
+    }
+
+    public long getWindow()
+    {
+        return _window;
+    }
+
+    /**
+     * Counts a message consumed.
+     *
+     * @return The credits to grant now, 0 if none
+     */
+    public long consume()
+    {
+        if (++_consumed < _batch)
+        {
+            return 0;
+        }
+        _consumed = 0;
+        return _batch;
+    }
+}
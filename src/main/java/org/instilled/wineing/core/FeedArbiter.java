@@ -0,0 +1,164 @@
+package org.instilled.wineing.core;
+
+import java.util.Arrays;
+
+/**
+ * Arbitrates between two Wineings publishing the same feed (A/B), e.g.
+ * a primary and a hot standby on separate boxes both started with
+ * <em>--mchan-seq</em>. Each frame carries a sequence number, see
+ * <em>codec/seqhdr.h</em> for the header layout. Both Wineings number
+ * a frame alike, the copy arriving first is kept and the other one
+ * dropped. If one Wineing fails the other one's frames simply keep
+ * arriving first.<br>
+ * <br>
+ * Sequence numbers seen recently are tracked in a sliding window
+ * bitmap above the highest sequence number accepted. Frames older than
+ * the window can't be told apart from duplicates and are dropped as
+ * well, they come from a Wineing lagging far behind the other.<br>
+ * <br>
+ * <b>Note</b>: This class is not thread-safe.
+ */
+public class FeedArbiter
+{
+    public static final int HEADER_MARKER = 0x01;
+    public static final int HEADER_SIZE = 9;
+
+    /**
+     * Sequence numbers tracked by default. Two Wineings rarely drift
+     * apart by more than a few hundred frames.
+     */
+    public static final int DEFAULT_WINDOW = 65536;
+
+    private final long[] _bits;
+    private final int _window;
+
+    private boolean _started;
+    private long _head;
+
+    private long _accepted;
+    private long _duplicates;
+    private long _late;
+
+    /**
+     * @param window
+     *            Sequence numbers tracked, rounded up to the next
+     *            power of two of at least 64
+     */
+    public FeedArbiter(int window)
+    {
+        int words = 1;
+        while (words << 6 < window)
+        {
+            words <<= 1;
+        }
+        _bits = new long[words];
+        _window = words << 6;
+    }
+
+    /**
+     * @return <code>true</code> if the frame starting at
+     *         <em>buffer[offset]</em> starts with a sequence number.
+     */
+    public static boolean isSequenced(byte[] buffer, int offset, int len)
+    {
+        return len >= HEADER_SIZE && buffer[offset] == HEADER_MARKER;
+    }
+
+    /**
+     * @return The sequence number of the frame starting at
+     *         <em>buffer[offset]</em>, see
+     *         {@link #isSequenced(byte[], int, int)}.
+     */
+    public static long getSeq(byte[] buffer, int offset)
+    {
+        long seq = 0;
+        for (int i = HEADER_SIZE - 1; i > 0; i--)
+        {
+            seq = (seq << 8) | (buffer[offset + i] & 0xff);
+        }
+        return seq;
+    }
+
+    /**
+     * @return <code>true</code> if the frame numbered <em>seq</em> is
+     *         seen the first time and is to be processed,
+     *         <code>false</code> if it is a duplicate or too old.
+     */
+    public boolean accept(long seq)
+    {
+        if (!_started || seq - _head >= _window)
+        {
+            // The first frame or one far ahead, e.g. of the next day
+            Arrays.fill(_bits, 0);
+            _started = true;
+            _head = seq;
+            set(seq);
+            _accepted++;
+            return true;
+        }
+
+        if (seq > _head)
+        {
+            for (long s = _head + 1; s < seq; s++)
+            {
+                clear(s);
+            }
+            _head = seq;
+            set(seq);
+            _accepted++;
+            return true;
+        }
+
+        if (_head - seq >= _window)
+        {
+            _late++;
+            return false;
+        }
+        if (isSet(seq))
+        {
+            _duplicates++;
+            return false;
+        }
+        set(seq);
+        _accepted++;
+        return true;
+    }
+
+    public long getAccepted()
+    {
+        return _accepted;
+    }
+
+    public long getDuplicates()
+    {
+        return _duplicates;
+    }
+
+    /**
+     * @return Frames dropped because they were older than the window.
+     */
+    public long getLate()
+    {
+        return _late;
+    }
+
+    private int word(long seq)
+    {
+        return (int) (seq >>> 6) & (_bits.length - 1);
+    }
+
+    private void set(long seq)
+    {
+        _bits[word(seq)] |= 1L << seq;
+    }
+
+    private void clear(long seq)
+    {
+        _bits[word(seq)] &= ~(1L << seq);
+    }
+
+    private boolean isSet(long seq)
+    {
+        return (_bits[word(seq)] & (1L << seq)) != 0;
+    }
+}
@@ -0,0 +1,101 @@
+package org.instilled.wineing.core;
+
+import java.util.Arrays;
+
+/**
+ * Counts latencies in buckets of powers of two microseconds. Recording
+ * does not allocate, percentiles are as coarse as the buckets: the
+ * upper bound of the bucket a percentile falls into is reported, at
+ * most the maximum recorded.<br>
+ * <br>
+ * Bucket 0 counts latencies of zero or less, those of hops between
+ * hosts whose clocks are off.<br>
+ * <br>
+ * <b>Note</b>: This class is not thread-safe.
+ */
+public class LatencyHistogram
+{
+    public static final int BUCKETS = 64;
+
+    private final long[] _buckets = new long[BUCKETS];
+
+    private long _count;
+    private long _sum;
+    private long _max;
+
+    public void record(long micros)
+    {
+        int bucket = micros > 0 ? 64 - Long.numberOfLeadingZeros(micros)
+                : 0;
+        _buckets[Math.min(bucket, BUCKETS - 1)]++;
+        _count++;
+        _sum += micros;
+        if (_count == 1 || micros > _max)
+        {
+            _max = micros;
+        }
+    }
+
+    public long getCount()
+    {
+        return _count;
+    }
+
+    /**
+     * @return The number of latencies in <em>bucket</em>, i.e. of
+     *         2^(bucket-1) to 2^bucket-1 microseconds.
+     */
+    public long getBucket(int bucket)
+    {
+        return _buckets[bucket];
+    }
+
+    public long getMax()
+    {
+        return _max;
+    }
+
+    public long getMean()
+    {
+        return _count == 0 ? 0 : _sum / _count;
+    }
+
+    /**
+     * @param percentile
+     *            0 to 100
+     * @return The latency in microseconds <em>percentile</em> percent
+     *         of the ones recorded do not exceed, 0 if none were
+     *         recorded.
+     */
+    public long getPercentile(double percentile)
+    {
+        long rank = (long) Math.ceil(percentile / 100 * _count);
+        long seen = 0;
+        for (int i = 0; i < BUCKETS && _count > 0; i++)
+        {
+            seen += _buckets[i];
+            if (seen >= rank && seen > 0)
+            {
+                return Math.min(i == 0 ? 0 : (1L << i) - 1, _max);
+            }
+        }
+        return _max;
+    }
+
+    public void reset()
+    {
+        Arrays.fill(_buckets, 0);
+        _count = 0;
+        _sum = 0;
+        _max = 0;
+    }
+
+    @Override
+    public String toString()
+    {
+        return String.format(
+                "[count: %d, mean: %d, p50: %d, p99: %d, p99.9: %d, max: %d]",
+                _count, getMean(), getPercentile(50), getPercentile(99),
+                getPercentile(99.9), _max);
+    }
+}
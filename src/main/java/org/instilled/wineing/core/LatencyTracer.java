@@ -0,0 +1,143 @@
+package org.instilled.wineing.core;
+
+/**
+ * Aggregates the traces Wineing prefixes sampled frames with if run
+ * with <em>--mchan-trace</em> into a {@link LatencyHistogram} per hop.
+ * See <em>codec/tracehdr.h</em> for the header layout. The time a frame
+ * is received is taken by the tracer from the wall clock, calibrated
+ * once against {@link System#nanoTime()} for microsecond resolution.
+ * <br>
+ * <br>
+ * Hops ending on this host are only as accurate as its clock is in
+ * sync with Wineing's, those between NxCore and Wineing as NxCore's
+ * time zone. Compressed batches are received as a whole, the last hop
+ * includes the time a frame waited for its batch.<br>
+ * <br>
+ * <b>Note</b>: This class is not thread-safe.
+ */
+public class LatencyTracer
+{
+    public static final int HEADER_MARKER = 0x02;
+    public static final int HEADER_SIZE = 33;
+
+    /** NxCore's time to Wineing's callback: NxCore and Wine. */
+    public static final int HOP_NXCORE = 0;
+    /** Callback to encoded: filters, the directory and the encoder. */
+    public static final int HOP_CALLBACK = 1;
+    /** Encoded to zmq_send: pacing and the compressed batch. */
+    public static final int HOP_ENCODE = 2;
+    /** zmq_send to received: zmq, the network and the consumer. */
+    public static final int HOP_SEND = 3;
+    /** NxCore's time to received. */
+    public static final int HOP_TOTAL = 4;
+    public static final int HOPS = 5;
+
+    private static final String[] HOP_NAMES = { "nxcore", "callback",
+            "encode", "send", "total" };
+
+    private final LatencyHistogram[] _hops = new LatencyHistogram[HOPS];
+
+    private final long _epochMicros;
+    private final long _epochNanos;
+
+    public LatencyTracer()
+    {
+        for (int i = 0; i < HOPS; i++)
+        {
+            _hops[i] = new LatencyHistogram();
+        }
+        _epochMicros = System.currentTimeMillis() * 1000;
+        _epochNanos = System.nanoTime();
+    }
+
+    /**
+     * @return <code>true</code> if the frame starting at
+     *         <em>buffer[offset]</em> starts with a trace.
+     */
+    public static boolean isTraced(byte[] buffer, int offset, int len)
+    {
+        return len >= HEADER_SIZE && buffer[offset] == HEADER_MARKER;
+    }
+
+    /**
+     * @param hop
+     *            One of HOP_NXCORE to HOP_SEND
+     * @return The time in microseconds since the epoch the traced frame
+     *         starting at <em>buffer[offset]</em> entered <em>hop</em>,
+     *         see {@link #isTraced(byte[], int, int)}.
+     */
+    public static long getTime(byte[] buffer, int offset, int hop)
+    {
+        long time = 0;
+        int start = offset + 1 + (hop << 3);
+        for (int i = 7; i >= 0; i--)
+        {
+            time = (time << 8) | (buffer[start + i] & 0xff);
+        }
+        return time;
+    }
+
+    /**
+     * @return The current time in microseconds since the epoch.
+     */
+    public long currentTimeMicros()
+    {
+        return _epochMicros + (System.nanoTime() - _epochNanos) / 1000;
+    }
+
+    /**
+     * Records the trace of the frame starting at
+     * <em>buffer[offset]</em>, received just now.
+     */
+    public void record(byte[] buffer, int offset)
+    {
+        record(buffer, offset, currentTimeMicros());
+    }
+
+    /**
+     * Records the trace of the frame starting at
+     * <em>buffer[offset]</em>, received at <em>received</em>
+     * microseconds since the epoch.
+     */
+    public void record(byte[] buffer, int offset, long received)
+    {
+        long nxcore = getTime(buffer, offset, HOP_NXCORE);
+        long callback = getTime(buffer, offset, HOP_CALLBACK);
+        long encode = getTime(buffer, offset, HOP_ENCODE);
+        long send = getTime(buffer, offset, HOP_SEND);
+
+        _hops[HOP_NXCORE].record(callback - nxcore);
+        _hops[HOP_CALLBACK].record(encode - callback);
+        _hops[HOP_ENCODE].record(send - encode);
+        _hops[HOP_SEND].record(received - send);
+        _hops[HOP_TOTAL].record(received - nxcore);
+    }
+
+    /**
+     * @param hop
+     *            One of HOP_*
+     */
+    public LatencyHistogram getHistogram(int hop)
+    {
+        return _hops[hop];
+    }
+
+    public void reset()
+    {
+        for (LatencyHistogram h : _hops)
+        {
+            h.reset();
+        }
+    }
+
+    @Override
+    public String toString()
+    {
+        StringBuilder sb = new StringBuilder("Latencies in us");
+        for (int i = 0; i < HOPS; i++)
+        {
+            sb.append(String.format("%n  %-8s %s", HOP_NAMES[i], _hops[i]));
+        }
+        return sb.toString();
+    }
+}
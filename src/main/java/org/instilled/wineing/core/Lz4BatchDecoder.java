@@ -0,0 +1,236 @@
+package org.instilled.wineing.core;
+
+/**
+ * Decompresses batches published by Wineing if started with
+ * <em>--mchan-lz4</em> and iterates the frames they contain. See
+ * <em>codec/lz4batch.h</em> for the message and batch layout.<br>
+ * <br>
+ * The decoder holds a single buffer with the dictionary in front of the
+ * decompressed batch, thus LZ4 matches reaching back into the
+ * dictionary are resolved by plain copies. The buffer only grows if a
+ * batch larger than any previous one is received.<br>
+ * <br>
+ * Typical use:
+ *
+ * <pre>
+ * if (decoder.decompress(msg, 0, len) &gt;= 0)
+ * {
+ *     while (decoder.next())
+ *     {
+ *         process(decoder.getBuffer(), decoder.getFrameOffset(),
+ *                 decoder.getFrameLength());
+ *     }
+ * }
+ * </pre>
+ *
+ * <b>Note</b>: This class is not thread-safe.
+ */
+public class Lz4BatchDecoder
+{
+    /**
+     * LZ4 only ever looks 64KB back.
+     */
+    public static final int MAX_DICT_SIZE = 65536;
+
+    private static final int MIN_MATCH = 4;
+
+    private byte[] _buffer;
+    private int _dictSize;
+    private int _end;
+
+    private int _pos;
+    private int _frameOffset;
+    private int _frameLength;
+
+    /**
+     * @param dict
+     *            The dictionary Wineing was started with
+     *            (<em>--mchan-lz4-dict</em>) or <code>null</code>.
+     */
+    public Lz4BatchDecoder(byte[] dict)
+    {
+        int dictLength = dict == null ? 0 : dict.length;
+        _dictSize = Math.min(dictLength, MAX_DICT_SIZE);
+        _buffer = new byte[_dictSize + 16384];
+        if (_dictSize > 0)
+        {
+            System.arraycopy(dict, dictLength - _dictSize, _buffer, 0,
+                    _dictSize);
+        }
+    }
+
+    /**
+     * Decompresses a message and resets the frame iterator.
+     *
+     * @return The size of the decompressed batch or -1 if the message
+     *         is malformed.
+     */
+    public int decompress(byte[] src, int offset, int len)
+    {
+        int end = offset + len;
+        _pos = _end = _dictSize;
+
+        // Uncompressed size
+        int raw = 0;
+        int shift = 0;
+        byte b;
+        do
+        {
+            if (offset >= end || shift > 28)
+            {
+                return -1;
+            }
+            b = src[offset++];
+            raw |= (b & 0x7f) << shift;
+            shift += 7;
+        } while ((b & 0x80) != 0);
+
+        if (raw < 0)
+        {
+            return -1;
+        }
+        reserve(_dictSize + raw);
+
+        int limit = _dictSize + raw;
+        int op = _dictSize;
+        byte[] dst = _buffer;
+        while (offset < end)
+        {
+            int token = src[offset++] & 0xff;
+
+            // Literals
+            int n = token >>> 4;
+            if (n == 15)
+            {
+                do
+                {
+                    if (offset >= end)
+                    {
+                        return -1;
+                    }
+                    b = src[offset++];
+                    n += b & 0xff;
+                } while (b == (byte) 0xff);
+            }
+            if (n > end - offset || n > limit - op)
+            {
+                return -1;
+            }
+            System.arraycopy(src, offset, dst, op, n);
+            offset += n;
+            op += n;
+
+            // The last sequence has no match
+            if (offset == end)
+            {
+                break;
+            }
+
+            // Match
+            if (end - offset < 2)
+            {
+                return -1;
+            }
+            int distance = (src[offset] & 0xff)
+                    | ((src[offset + 1] & 0xff) << 8);
+            offset += 2;
+            n = token & 0x0f;
+            if (n == 15)
+            {
+                do
+                {
+                    if (offset >= end)
+                    {
+                        return -1;
+                    }
+                    b = src[offset++];
+                    n += b & 0xff;
+                } while (b == (byte) 0xff);
+            }
+            n += MIN_MATCH;
+
+            int from = op - distance;
+            if (distance == 0 || from < 0 || n > limit - op)
+            {
+                return -1;
+            }
+            // Matches may overlap the output, copy byte by byte
+            for (int i = 0; i < n; i++)
+            {
+                dst[op++] = dst[from++];
+            }
+        }
+
+        if (op != limit)
+        {
+            return -1;
+        }
+        _end = op;
+        return raw;
+    }
+
+    /**
+     * Advances to the next frame of the last decompressed batch.
+     *
+     * @return <code>false</code> at the end of the batch or if the
+     *         batch is malformed.
+     */
+    public boolean next()
+    {
+        int size = 0;
+        int shift = 0;
+        byte b;
+        do
+        {
+            if (_pos >= _end || shift > 28)
+            {
+                return false;
+            }
+            b = _buffer[_pos++];
+            size |= (b & 0x7f) << shift;
+            shift += 7;
+        } while ((b & 0x80) != 0);
+
+        if (size < 0 || size > _end - _pos)
+        {
+            _pos = _end;
+            return false;
+        }
+
+        _frameOffset = _pos;
+        _frameLength = size;
+        _pos += size;
+        return true;
+    }
+
+    /**
+     * @return The buffer holding the current frame. Valid until the next
+     *         call to {@link #decompress(byte[], int, int)}.
+     */
+    public byte[] getBuffer()
+    {
+        return _buffer;
+    }
+
+    public int getFrameOffset()
+    {
+        return _frameOffset;
+    }
+
+    public int getFrameLength()
+    {
+        return _frameLength;
+    }
+
+    private void reserve(int size)
+    {
+        if (size <= _buffer.length)
+        {
+            return;
+        }
+
+        byte[] buffer = new byte[size];
+        System.arraycopy(_buffer, 0, buffer, 0, _dictSize);
+        _buffer = buffer;
+    }
+}
@@ -0,0 +1,219 @@
+package org.instilled.wineing.core;
+
+/**
+ * Fans market data out to N handler threads. The dispatcher is itself a
+ * {@link MarketDataHandler} invoked on the thread receiving market data
+ * (e.g. <em>WorkerMarket</em>). It copies each message into the
+ * {@link MarketDataRing} of the handler selected by the symbol id,
+ * thus all messages of a symbol are handled by the same thread in the
+ * order they were received. STATUS messages are sent to every
+ * handler.<br>
+ * <br>
+ * Each handler runs on the thread executing the corresponding
+ * {@link Worker} returned by {@link #getWorkers()}. Handler threads wait
+ * for messages using the given {@link WaitStrategy}. If a ring is full
+ * the receiving thread spins until the handler catches up
+ * (backpressure).
+ */
+public class MarketDataDispatcher implements MarketDataHandler
+{
+    private final MarketDataRing[] _rings;
+    private final HandlerWorker[] _workers;
+
+    /**
+     * @param handlers
+     *            One handler per thread. Each handler is only ever
+     *            invoked from its own thread.
+     * @param ringSize
+     *            Number of messages buffered per handler
+     * @param waitStrategyName
+     *            See {@link WaitStrategies#byName(String)}
+     */
+    public MarketDataDispatcher(MarketDataHandler[] handlers,
+            int ringSize, String waitStrategyName)
+    {
+        _rings = new MarketDataRing[handlers.length];
+        _workers = new HandlerWorker[handlers.length];
+        for (int i = 0; i < handlers.length; i++)
+        {
+            WaitStrategy wait = WaitStrategies.byName(waitStrategyName);
+            if (wait == null)
+            {
+                throw new IllegalArgumentException(
+                        "Unknown wait strategy " + waitStrategyName);
+            }
+            _rings[i] = new MarketDataRing(ringSize);
+            _workers[i] = new HandlerWorker(_rings[i], wait, handlers[i]);
+        }
+    }
+
+    /**
+     * @return The workers to be run on a thread each.
+     */
+    public Worker[] getWorkers()
+    {
+        return _workers;
+    }
+
+    @Override
+    public void onStatus(int timestamp)
+    {
+        for (int i = 0; i < _rings.length; i++)
+        {
+            MarketDataRing.Event e = claim(i);
+            e.type = MarketDataFlyweight.TYPE_STATUS;
+            e.timestamp = timestamp;
+            publish(i);
+        }
+    }
+
+    @Override
+    public void onSymbol(int symbolId, byte[] symbol, int offset,
+            int len, int listedExg, boolean deleted)
+    {
+        int i = partition(symbolId);
+        MarketDataRing.Event e = claim(i);
+        e.type = MarketDataFlyweight.TYPE_SYMBOL;
+        e.symbolId = symbolId;
+        e.symbolLength = Math.min(len, MarketDataRing.Event.MAX_SYMBOL_SIZE);
+        System.arraycopy(symbol, offset, e.symbol, 0, e.symbolLength);
+        e.exg = listedExg;
+        e.deleted = deleted;
+        publish(i);
+    }
+
+    @Override
+    public void onQuote(int symbolId, int timestamp, int bidPrice,
+            int askPrice, int bidSize, int askSize, int exg,
+            int priceType)
+    {
+        int i = partition(symbolId);
+        MarketDataRing.Event e = claim(i);
+        e.type = MarketDataFlyweight.TYPE_QUOTE_EX;
+        e.symbolId = symbolId;
+        e.timestamp = timestamp;
+        e.bidPrice = bidPrice;
+        e.askPrice = askPrice;
+        e.bidSize = bidSize;
+        e.askSize = askSize;
+        e.exg = exg;
+        e.priceType = priceType;
+        publish(i);
+    }
+
+    @Override
+    public void onTrade(int symbolId, int timestamp, int price, int size,
+            int exg, int priceType)
+    {
+        int i = partition(symbolId);
+        MarketDataRing.Event e = claim(i);
+        e.type = MarketDataFlyweight.TYPE_TRADE;
+        e.symbolId = symbolId;
+        e.timestamp = timestamp;
+        e.price = price;
+        e.size = size;
+        e.exg = exg;
+        e.priceType = priceType;
+        publish(i);
+    }
+
+    /**
+     * Symbol ids are dense, mixing the bits spreads consecutive ids
+     * (e.g. the options of an underlying) evenly.
+     */
+    private int partition(int symbolId)
+    {
+        int h = symbolId * 0x9e3779b9;
+        return ((h ^ (h >>> 16)) & 0x7fffffff) % _rings.length;
+    }
+
+    private MarketDataRing.Event claim(int i)
+    {
+        MarketDataRing.Event e;
+        while ((e = _rings[i].claim()) == null)
+        {
+            Thread.yield();
+        }
+        return e;
+    }
+
+    private void publish(int i)
+    {
+        _rings[i].publish();
+        _workers[i]._wait.signal();
+    }
+
+    /**
+     * Drains a ring into a handler.
+     */
+    private static class HandlerWorker implements Worker
+    {
+        private final MarketDataRing _ring;
+        private final WaitStrategy _wait;
+        private final MarketDataHandler _handler;
+
+        private volatile boolean _running;
+
+        HandlerWorker(MarketDataRing ring, WaitStrategy wait,
+                MarketDataHandler handler)
+        {
+            _ring = ring;
+            _wait = wait;
+            _handler = handler;
+            _running = true;
+        }
+
+        @Override
+        public void shutdown()
+        {
+            _running = false;
+        }
+
+        @Override
+        public void run()
+        {
+            int counter = 0;
+            while (_running)
+            {
+                int n = _ring.available();
+                if (n == 0)
+                {
+                    counter = _wait.idle(counter);
+                    continue;
+                }
+
+                for (int i = 0; i < n; i++)
+                {
+                    dispatch(_ring.get(i));
+                }
+                _ring.release(n);
+                counter = 0;
+            }
+        }
+
+        private void dispatch(MarketDataRing.Event e)
+        {
+            switch (e.type)
+            {
+            case MarketDataFlyweight.TYPE_STATUS:
+                _handler.onStatus(e.timestamp);
+                break;
+            case MarketDataFlyweight.TYPE_SYMBOL:
+                _handler.onSymbol(e.symbolId, e.symbol, 0, e.symbolLength,
+                        e.exg, e.deleted);
+                break;
+            case MarketDataFlyweight.TYPE_QUOTE_EX:
+                _handler.onQuote(e.symbolId, e.timestamp, e.bidPrice,
+                        e.askPrice, e.bidSize, e.askSize, e.exg,
+                        e.priceType);
+                break;
+            case MarketDataFlyweight.TYPE_TRADE:
+                _handler.onTrade(e.symbolId, e.timestamp, e.price, e.size,
+                        e.exg, e.priceType);
+                break;
+            default:
+                break;
+            }
+        }
+    }
+}
@@ -0,0 +1,406 @@
+package org.instilled.wineing.core;
+
+/**
+ * Reads <em>MarketData</em> messages (see
+ * <em>WineingMarketDataProto.proto</em>) straight off the receive
+ * buffer. Unlike <em>MarketData.parseFrom</em> the flyweight neither
+ * copies the message nor allocates, it decodes the protobuf wire
+ * format [1] into primitive fields which are overwritten by the next
+ * call to {@link #wrap(byte[], int, int)}. The symbol is not decoded
+ * into a {@link String}, it is available as a range of the wrapped
+ * buffer.<br>
+ * <br>
+ * Fields missing in a message read as 0. Unknown fields are skipped.<br>
+ * <br>
+ * [1] https://developers.google.com/protocol-buffers/docs/encoding<br>
+ * <br>
+ * <b>Note</b>: This class is not thread-safe.
+ */
+public class MarketDataFlyweight
+{
+    // MarketData.Type
+    public static final int TYPE_STATUS = 0;
+    public static final int TYPE_QUOTE_EX = 1;
+    public static final int TYPE_QUOTE_MM = 3;
+    public static final int TYPE_TRADE = 4;
+    public static final int TYPE_CATEGORY = 5;
+    public static final int TYPE_SYMBOL = 6;
+    public static final int TYPE_BAR = 7;
+    public static final int TYPE_UNDERLYING_STATS = 8;
+
+    private static final int WIRE_VARINT = 0;
+    private static final int WIRE_FIXED64 = 1;
+    private static final int WIRE_LENGTH_DELIMITED = 2;
+    private static final int WIRE_FIXED32 = 5;
+
+    private byte[] _buffer;
+    private int _pos;
+    private int _end;
+
+    private int _type;
+    private int _symbolId;
+    private int _symbolOffset;
+    private int _symbolLength;
+    private int _listedExg;
+    private boolean _deleted;
+    private int _timestamp;
+    private int _priceType;
+    private int _reportingExg;
+    private int _price;
+    private int _size;
+    private int _bidPrice;
+    private int _askPrice;
+    private int _bidSize;
+    private int _askSize;
+    private int _interval;
+    private int _open;
+    private int _high;
+    private int _low;
+    private int _close;
+    private long _volume;
+    private double _vwap;
+    private int _trades;
+    private int _messages;
+
+    /**
+     * Decodes the message in <em>buffer[offset, offset + len)</em>. The
+     * buffer must not be modified while the fields are in use.
+     *
+     * @return <code>false</code> if the message is malformed.
+     */
+    public boolean wrap(byte[] buffer, int offset, int len)
+    {
+        _buffer = buffer;
+        _pos = offset;
+        _end = offset + len;
+
+        _type = -1;
+        _symbolId = 0;
+        _symbolOffset = 0;
+        _symbolLength = 0;
+        _listedExg = 0;
+        _deleted = false;
+        _timestamp = 0;
+        _priceType = 0;
+        _reportingExg = 0;
+        _price = 0;
+        _size = 0;
+        _bidPrice = 0;
+        _askPrice = 0;
+        _bidSize = 0;
+        _askSize = 0;
+        _interval = 0;
+        _open = 0;
+        _high = 0;
+        _low = 0;
+        _close = 0;
+        _volume = 0;
+        _vwap = 0;
+        _trades = 0;
+        _messages = 0;
+
+        while (_pos < _end)
+        {
+            int tag = (int) readVarint();
+            if (_pos < 0)
+            {
+                return false;
+            }
+
+            int wire = tag & 0x07;
+            if (wire == WIRE_VARINT)
+            {
+                long v = readVarint();
+                if (_pos < 0)
+                {
+                    return false;
+                }
+                setField(tag >>> 3, v);
+            } else if (wire == WIRE_LENGTH_DELIMITED)
+            {
+                int n = (int) readVarint();
+                if (_pos < 0 || n < 0 || n > _end - _pos)
+                {
+                    return false;
+                }
+                if ((tag >>> 3) == 3)
+                {
+                    _symbolOffset = _pos;
+                    _symbolLength = n;
+                }
+                _pos += n;
+            } else if (wire == WIRE_FIXED64)
+            {
+                if (_end - _pos < 8)
+                {
+                    return false;
+                }
+                if ((tag >>> 3) == 21)
+                {
+                    _vwap = Double.longBitsToDouble(readFixed64());
+                } else
+                {
+                    _pos += 8;
+                }
+            } else if (wire == WIRE_FIXED32)
+            {
+                _pos += 4;
+            } else
+            {
+                return false;
+            }
+        }
+
+        // type is required
+        return _pos == _end && _type >= 0;
+    }
+
+    private void setField(int field, long l)
+    {
+        int v = (int) l;
+        switch (field)
+        {
+        case 1:
+            _type = v;
+            break;
+        case 2:
+            _symbolId = v;
+            break;
+        case 4:
+            _listedExg = v;
+            break;
+        case 5:
+            _deleted = v != 0;
+            break;
+        case 6:
+            _timestamp = v;
+            break;
+        case 7:
+            _priceType = v;
+            break;
+        case 8:
+            _reportingExg = v;
+            break;
+        case 9:
+            _price = unzigzag(v);
+            break;
+        case 10:
+            _size = v;
+            break;
+        case 11:
+            _bidPrice = unzigzag(v);
+            break;
+        case 12:
+            _askPrice = unzigzag(v);
+            break;
+        case 13:
+            _bidSize = v;
+            break;
+        case 14:
+            _askSize = v;
+            break;
+        case 15:
+            _interval = v;
+            break;
+        case 16:
+            _open = unzigzag(v);
+            break;
+        case 17:
+            _high = unzigzag(v);
+            break;
+        case 18:
+            _low = unzigzag(v);
+            break;
+        case 19:
+            _close = unzigzag(v);
+            break;
+        case 20:
+            _volume = l;
+            break;
+        case 22:
+            _trades = v;
+            break;
+        case 23:
+            _messages = v;
+            break;
+        default:
+            // Unknown field
+            break;
+        }
+    }
+
+    private static int unzigzag(int v)
+    {
+        return (v >>> 1) ^ -(v & 1);
+    }
+
+    /**
+     * Reads a varint at {@link #_pos}. Sets {@link #_pos} to -1 if the
+     * varint is truncated.
+     */
+    private long readVarint()
+    {
+        long r = 0;
+        for (int shift = 0; _pos < _end && shift < 64; shift += 7)
+        {
+            byte b = _buffer[_pos++];
+            r |= (long) (b & 0x7f) << shift;
+            if ((b & 0x80) == 0)
+            {
+                return r;
+            }
+        }
+        _pos = -1;
+        return -1;
+    }
+
+    private long readFixed64()
+    {
+        long r = 0;
+        for (int i = 0; i < 8; i++)
+        {
+            r |= (long) (_buffer[_pos++] & 0xff) << (i * 8);
+        }
+        return r;
+    }
+
+    public int getType()
+    {
+        return _type;
+    }
+
+    public int getSymbolId()
+    {
+        return _symbolId;
+    }
+
+    /**
+     * @return The wrapped buffer holding the symbol, see
+     *         {@link #getSymbolOffset()}.
+     */
+    public byte[] getBuffer()
+    {
+        return _buffer;
+    }
+
+    public int getSymbolOffset()
+    {
+        return _symbolOffset;
+    }
+
+    /**
+     * @return Length of the UTF-8 encoded symbol, 0 if not set.
+     */
+    public int getSymbolLength()
+    {
+        return _symbolLength;
+    }
+
+    public int getListedExg()
+    {
+        return _listedExg;
+    }
+
+    public boolean isDeleted()
+    {
+        return _deleted;
+    }
+
+    public int getTimestamp()
+    {
+        return _timestamp;
+    }
+
+    public int getPriceType()
+    {
+        return _priceType;
+    }
+
+    public int getReportingExg()
+    {
+        return _reportingExg;
+    }
+
+    public int getPrice()
+    {
+        return _price;
+    }
+
+    public int getSize()
+    {
+        return _size;
+    }
+
+    public int getBidPrice()
+    {
+        return _bidPrice;
+    }
+
+    public int getAskPrice()
+    {
+        return _askPrice;
+    }
+
+    public int getBidSize()
+    {
+        return _bidSize;
+    }
+
+    public int getAskSize()
+    {
+        return _askSize;
+    }
+
+    /**
+     * @return Bar length in ms. The start of the bar is
+     *         {@link #getTimestamp()}.
+     */
+    public int getInterval()
+    {
+        return _interval;
+    }
+
+    public int getOpen()
+    {
+        return _open;
+    }
+
+    public int getHigh()
+    {
+        return _high;
+    }
+
+    public int getLow()
+    {
+        return _low;
+    }
+
+    public int getClose()
+    {
+        return _close;
+    }
+
+    public long getVolume()
+    {
+        return _volume;
+    }
+
+    public double getVwap()
+    {
+        return _vwap;
+    }
+
+    public int getTrades()
+    {
+        return _trades;
+    }
+
+    /**
+     * @return Option messages of the underlying in the window
+     *         {@link #getTimestamp()}, {@link #getInterval()}.
+     */
+    public int getMessages()
+    {
+        return _messages;
+    }
+}
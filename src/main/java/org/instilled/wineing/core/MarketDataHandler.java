@@ -0,0 +1,27 @@
+package org.instilled.wineing.core;
+
+/**
+ * Receives market data as primitive fields. Invoked on the thread
+ * receiving market data, implementations should neither block nor
+ * allocate. Prices are NxCore integers to be converted using
+ * <em>priceType</em>.
+ */
+public interface MarketDataHandler
+{
+    void onStatus(int timestamp);
+
+    /**
+     * @param symbol
+     *            Buffer holding the UTF-8 encoded symbol. Only valid
+     *            for the duration of the call.
+     */
+    void onSymbol(int symbolId, byte[] symbol, int offset, int len,
+            int listedExg, boolean deleted);
+
+    void onQuote(int symbolId, int timestamp, int bidPrice,
+            int askPrice, int bidSize, int askSize, int exg,
+            int priceType);
+
+    void onTrade(int symbolId, int timestamp, int price, int size,
+            int exg, int priceType);
+}
@@ -0,0 +1,152 @@
+package org.instilled.wineing.core;
+
+import java.util.concurrent.atomic.AtomicLong;
+
+/**
+ * Single producer, single consumer ring of preallocated
+ * {@link MarketDataRing.Event}s. The producer claims an event, fills in
+ * its fields and publishes it. The consumer reads all available events
+ * in a batch and releases them at once. Neither side allocates or
+ * locks, sequences are published with ordered writes
+ * ({@link AtomicLong#lazySet(long)}) and each side caches the other
+ * side's sequence to avoid touching its cache line on every event.<br>
+ * <br>
+ * <b>Note</b>: Exactly one thread may produce and exactly one thread may
+ * consume.
+ */
+public class MarketDataRing
+{
+    /**
+     * A market data message as primitive fields. Which fields are set
+     * depends on {@link #type}, see {@link MarketDataHandler}.
+     */
+    public static final class Event
+    {
+        public static final int MAX_SYMBOL_SIZE = 64;
+
+        public int type;
+        public int symbolId;
+        public int timestamp;
+        public int price;
+        public int size;
+        public int bidPrice;
+        public int askPrice;
+        public int bidSize;
+        public int askSize;
+        public int exg;
+        public int priceType;
+        public boolean deleted;
+        public final byte[] symbol = new byte[MAX_SYMBOL_SIZE];
+        public int symbolLength;
+    }
+
+    /**
+     * Keeps a sequence on its own cache line.
+     */
+    @SuppressWarnings("serial")
+    private static final class Sequence extends AtomicLong
+    {
+        // Public to keep the JIT from eliminating them
+        public volatile long p1, p2, p3, p4, p5, p6, p7;
+    }
+
+    private final Event[] _events;
+    private final int _mask;
+
+    // Written by the producer
+    private final Sequence _head = new Sequence();
+    // Written by the consumer
+    private final Sequence _tail = new Sequence();
+
+    private long _cachedTail;
+    private long _cachedHead;
+
+    /**
+     * @param capacity
+     *            Number of events, rounded up to a power of 2
+     */
+    public MarketDataRing(int capacity)
+    {
+        int size = 1;
+        while (size < capacity)
+        {
+            size <<= 1;
+        }
+
+        _events = new Event[size];
+        for (int i = 0; i < size; i++)
+        {
+            _events[i] = new Event();
+        }
+        _mask = size - 1;
+    }
+
+    public int capacity()
+    {
+        return _events.length;
+    }
+
+    /**
+     * Producer. Returns the next free event. The event is not visible to
+     * the consumer until {@link #publish()} is invoked.
+     *
+     * @return The event or <code>null</code> if the ring is full.
+     */
+    public Event claim()
+    {
+        long head = _head.get();
+        if (head - _cachedTail >= _events.length)
+        {
+            _cachedTail = _tail.get();
+            if (head - _cachedTail >= _events.length)
+            {
+                return null;
+            }
+        }
+        return _events[(int) head & _mask];
+    }
+
+    /**
+     * Producer. Publishes the event returned by {@link #claim()}.
+     */
+    public void publish()
+    {
+        _head.lazySet(_head.get() + 1);
+    }
+
+    /**
+     * Consumer.
+     *
+     * @return Number of events that may be read with
+     *         {@link #get(int)}.
+     */
+    public int available()
+    {
+        long tail = _tail.get();
+        if (tail >= _cachedHead)
+        {
+            _cachedHead = _head.get();
+        }
+        return (int) (_cachedHead - tail);
+    }
+
+    /**
+     * Consumer.
+     *
+     * @param i
+     *            Index relative to the oldest unreleased event,
+     *            <em>i &lt; {@link #available()}</em>
+     */
+    public Event get(int i)
+    {
+        return _events[(int) (_tail.get() + i) & _mask];
+    }
+
+    /**
+     * Consumer. Hands <em>n</em> events back to the producer.
+     */
+    public void release(int n)
+    {
+        _tail.lazySet(_tail.get() + n);
+    }
+}
@@ -0,0 +1,209 @@
+package org.instilled.wineing.core;
+
+/**
+ * Decodes quote delta frames as sent by Wineing if started with
+ * <em>--mchan-encoding=delta</em>. See <em>codec/qdelta.h</em> for the
+ * frame layout.<br>
+ * <br>
+ * The decoder keeps the last quote per symbol id in flat arrays. The
+ * fields of the last successfully decoded frame are available through
+ * the getters. Decoding does not allocate unless a symbol id beyond the
+ * current capacity is seen.<br>
+ * <br>
+ * <b>Note</b>: This class is not thread-safe.
+ */
+public class QuoteDeltaDecoder
+{
+    public static final int FRAME_MARKER = 0x80;
+    public static final int FLAG_FULL = 0x01;
+
+    public static final int FIELD_TIMESTAMP = 0x01;
+    public static final int FIELD_BID_PRICE = 0x02;
+    public static final int FIELD_ASK_PRICE = 0x04;
+    public static final int FIELD_BID_SIZE = 0x08;
+    public static final int FIELD_ASK_SIZE = 0x10;
+    public static final int FIELD_EXG = 0x20;
+    public static final int FIELD_PRICE_TYPE = 0x40;
+
+    /**
+     * Number of fields per symbol in {@link #_state}.
+     */
+    private static final int FIELDS = 7;
+
+    public static final int DECODE_OK = 0;
+    public static final int DECODE_GAP = 1;
+    public static final int DECODE_ERR = -1;
+
+    private int[] _state;
+    private int[] _seq;
+    private boolean[] _valid;
+
+    private int _pos;
+    private int _symbolId;
+    private int _base;
+
+    public QuoteDeltaDecoder(int capacity)
+    {
+        capacity = Math.max(capacity, 1);
+        _state = new int[capacity * FIELDS];
+        _seq = new int[capacity];
+        _valid = new boolean[capacity];
+    }
+
+    /**
+     * @return <code>true</code> if the frame starting at
+     *         <em>buffer[offset]</em> is a delta frame and not a
+     *         protobuf message.
+     */
+    public static boolean isFrame(byte[] buffer, int offset, int len)
+    {
+        return len > 0 && (buffer[offset] & FRAME_MARKER) != 0;
+    }
+
+    /**
+     * Decodes a frame.
+     *
+     * @return {@link #DECODE_OK} if the getters return the decoded
+     *         quote, {@link #DECODE_GAP} if the symbol waits for a full
+     *         frame after a lost frame and {@link #DECODE_ERR} if the
+     *         frame is malformed.
+     */
+    public int decode(byte[] buffer, int offset, int len)
+    {
+        int end = offset + len;
+        if (len < 4 || !isFrame(buffer, offset, len))
+        {
+            return DECODE_ERR;
+        }
+
+        boolean full = (buffer[offset] & FLAG_FULL) != 0;
+        _pos = offset + 1;
+        int id = readVarint(buffer, end);
+        if (id < 0 || end - _pos < 2)
+        {
+            return DECODE_ERR;
+        }
+        reserve(id);
+
+        int seq = buffer[_pos++] & 0xff;
+        int mask = buffer[_pos++] & 0xff;
+
+        // A missing frame invalidates the state until the next full
+        // frame
+        if (!full && (!_valid[id] || seq != ((_seq[id] + 1) & 0xff)))
+        {
+            _valid[id] = false;
+            _seq[id] = seq;
+            return DECODE_GAP;
+        }
+
+        int base = id * FIELDS;
+        for (int f = 0; f < FIELDS; f++)
+        {
+            if ((mask & (1 << f)) != 0)
+            {
+                int v = readVarint(buffer, end);
+                if (_pos < 0)
+                {
+                    return DECODE_ERR;
+                }
+                int d = (v >>> 1) ^ -(v & 1);
+                _state[base + f] = full ? d : _state[base + f] + d;
+            } else if (full)
+            {
+                _state[base + f] = 0;
+            }
+        }
+
+        _seq[id] = seq;
+        _valid[id] = true;
+        _symbolId = id;
+        _base = base;
+        return DECODE_OK;
+    }
+
+    public int getSymbolId()
+    {
+        return _symbolId;
+    }
+
+    public int getTimestamp()
+    {
+        return _state[_base];
+    }
+
+    public int getBidPrice()
+    {
+        return _state[_base + 1];
+    }
+
+    public int getAskPrice()
+    {
+        return _state[_base + 2];
+    }
+
+    public int getBidSize()
+    {
+        return _state[_base + 3];
+    }
+
+    public int getAskSize()
+    {
+        return _state[_base + 4];
+    }
+
+    public int getExg()
+    {
+        return _state[_base + 5];
+    }
+
+    public int getPriceType()
+    {
+        return _state[_base + 6];
+    }
+
+    /**
+     * Reads a varint at {@link #_pos}. Sets {@link #_pos} to -1 if the
+     * varint is truncated.
+     */
+    private int readVarint(byte[] buffer, int end)
+    {
+        int r = 0;
+        for (int shift = 0; _pos < end && shift < 35; shift += 7)
+        {
+            byte b = buffer[_pos++];
+            r |= (b & 0x7f) << shift;
+            if ((b & 0x80) == 0)
+            {
+                return r;
+            }
+        }
+        _pos = -1;
+        return -1;
+    }
+
+    private void reserve(int id)
+    {
+        if (id < _seq.length)
+        {
+            return;
+        }
+
+        int capacity = _seq.length;
+        while (capacity <= id)
+        {
+            capacity <<= 1;
+        }
+
+        int[] state = new int[capacity * FIELDS];
+        System.arraycopy(_state, 0, state, 0, _state.length);
+        int[] seq = new int[capacity];
+        System.arraycopy(_seq, 0, seq, 0, _seq.length);
+        boolean[] valid = new boolean[capacity];
+        System.arraycopy(_valid, 0, valid, 0, _valid.length);
+
+        _state = state;
+        _seq = seq;
+        _valid = valid;
+    }
+}
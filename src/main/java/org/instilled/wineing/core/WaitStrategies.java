@@ -0,0 +1,153 @@
+package org.instilled.wineing.core;
+
+import java.util.concurrent.TimeUnit;
+import java.util.concurrent.atomic.AtomicInteger;
+import java.util.concurrent.locks.Condition;
+import java.util.concurrent.locks.LockSupport;
+import java.util.concurrent.locks.ReentrantLock;
+
+/**
+ * The available {@link WaitStrategy}s, from lowest latency to lowest
+ * CPU usage:
+ * <ul>
+ * <li><em>busy-spin</em>: burns a core per consumer</li>
+ * <li><em>yielding</em>: spins, then yields the CPU</li>
+ * <li><em>sleeping</em>: spins, yields, then parks for a microsecond</li>
+ * <li><em>blocking</em>: waits on a condition signaled by the
+ * producer</li>
+ * </ul>
+ */
+public final class WaitStrategies
+{
+    private static final int SPIN_TRIES = 100;
+    private static final int YIELD_TRIES = 100;
+
+    private WaitStrategies()
+    {
+    }
+
+    /**
+     * @return A new strategy or <code>null</code> if <em>name</em> is
+     *         unknown.
+     */
+    public static WaitStrategy byName(String name)
+    {
+        if ("busy-spin".equals(name))
+        {
+            return new BusySpin();
+        } else if ("yielding".equals(name))
+        {
+            return new Yielding();
+        } else if ("sleeping".equals(name))
+        {
+            return new Sleeping();
+        } else if ("blocking".equals(name))
+        {
+            return new Blocking();
+        }
+        return null;
+    }
+
+    public static class BusySpin implements WaitStrategy
+    {
+        @Override
+        public int idle(int counter)
+        {
+            return counter;
+        }
+
+        @Override
+        public void signal()
+        {
+        }
+    }
+
+    public static class Yielding implements WaitStrategy
+    {
+        @Override
+        public int idle(int counter)
+        {
+            if (counter < SPIN_TRIES)
+            {
+                return counter + 1;
+            }
+            Thread.yield();
+            return counter;
+        }
+
+        @Override
+        public void signal()
+        {
+        }
+    }
+
+    public static class Sleeping implements WaitStrategy
+    {
+        @Override
+        public int idle(int counter)
+        {
+            if (counter < SPIN_TRIES)
+            {
+                return counter + 1;
+            } else if (counter < SPIN_TRIES + YIELD_TRIES)
+            {
+                Thread.yield();
+                return counter + 1;
+            }
+            LockSupport.parkNanos(1000);
+            return counter;
+        }
+
+        @Override
+        public void signal()
+        {
+        }
+    }
+
+    /**
+     * The producer only takes the lock if a consumer is waiting. A
+     * consumer re-checks the ring at least every millisecond, a missed
+     * signal therefore delays but never stalls it.
+     */
+    public static class Blocking implements WaitStrategy
+    {
+        private final ReentrantLock _lock = new ReentrantLock();
+        private final Condition _available = _lock.newCondition();
+        private final AtomicInteger _waiting = new AtomicInteger();
+
+        @Override
+        public int idle(int counter)
+        {
+            _lock.lock();
+            try
+            {
+                _waiting.incrementAndGet();
+                _available.await(1, TimeUnit.MILLISECONDS);
+            } catch (InterruptedException e)
+            {
+                Thread.currentThread().interrupt();
+            } finally
+            {
+                _waiting.decrementAndGet();
+                _lock.unlock();
+            }
+            return counter;
+        }
+
+        @Override
+        public void signal()
+        {
+            if (_waiting.get() > 0)
+            {
+                _lock.lock();
+                try
+                {
+                    _available.signalAll();
+                } finally
+                {
+                    _lock.unlock();
+                }
+            }
+        }
+    }
+}
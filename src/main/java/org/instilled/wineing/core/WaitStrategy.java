@@ -0,0 +1,24 @@
+package org.instilled.wineing.core;
+
+/**
+ * How a consumer waits for a {@link MarketDataRing} to fill up. Trades
+ * latency for CPU usage, see {@link WaitStrategies}.
+ */
+public interface WaitStrategy
+{
+    /**
+     * Invoked by the consumer while no event is available.
+     *
+     * @param counter
+     *            0 on the first invocation after an event was consumed,
+     *            otherwise the value returned by the previous
+     *            invocation.
+     * @return The counter for the next invocation.
+     */
+    int idle(int counter);
+
+    /**
+     * Invoked by the producer after publishing an event.
+     */
+    void signal();
+}
@@ -1,13 +1,106 @@
 package org.instilled.wineing.core;
 
+import java.util.List;
+
+import org.instilled.wineing.gen.WineingCtrlProto.Filter;
+import org.instilled.wineing.gen.WineingCtrlProto.Reconfigure;
+
 public interface WineingRemoteAPI
 {
     void start(ResponseProcessor p);
 
     void start(String tape, ResponseProcessor p);
 
+    /**
+     * Starts streaming only the market data matching <em>filter</em>.
+     * Everything else is dropped by Wineing before it is encoded.
+     * 
+     * @param tape
+     *            The tape file or <code>null</code> for real-time data
+     * @param filter
+     *            The filter or <code>null</code> for all market data
+     * @param p
+     */
+    void start(String tape, Filter filter, ResponseProcessor p);
+
+    /**
+     * Starts replaying <em>tape</em> paced by the consumer: Wineing
+     * takes one credit per message published and blocks once they are
+     * used up, see {@link #credit(long, ResponseProcessor)} and
+     * {@link CreditWindow}.
+     * 
+     * @param tape
+     *            The tape file, real-time data is never paced
+     * @param filter
+     *            The filter or <code>null</code> for all market data
+     * @param credits
+     *            The initial credits
+     * @param p
+     */
+    void start(String tape, Filter filter, long credits,
+            ResponseProcessor p);
+
+    /**
+     * Grants <em>credits</em> more to a paced replay.
+     * 
+     * @param credits
+     * @param p
+     */
+    void credit(long credits, ResponseProcessor p);
+
     void stop(ResponseProcessor p);
 
+    /**
+     * Changes channels, the filter or tuning of the running Wineing
+     * without interrupting the stream. Fields not set are left as they
+     * are.
+     * 
+     * @param reconfigure
+     * @param p
+     */
+    void reconfigure(Reconfigure reconfigure, ResponseProcessor p);
+
+    /**
+     * Lists the endpoints of each partition. <em>p</em> receives them
+     * with the DIRECTORY_OK response.
+     * 
+     * @param p
+     */
+    void directory(ResponseProcessor p);
+
+    /**
+     * Lists the tapes in the tape base directory dated within
+     * [<em>dateFrom</em>, <em>dateTo</em>]. <em>p</em> receives them
+     * with the LIST_TAPES_OK response, sorted by date.
+     * 
+     * @param dateFrom
+     *            YYYYMMDD, 0 for no lower bound
+     * @param dateTo
+     *            YYYYMMDD, 0 for no upper bound
+     * @param rescan
+     *            <code>true</code> to scan the directory again rather
+     *            than list the tapes found when Wineing started
+     * @param p
+     */
+    void listTapes(int dateFrom, int dateTo, boolean rescan,
+            ResponseProcessor p);
+
+    /**
+     * Replays historical tapes to journal files in the background while
+     * live streaming continues. <em>p</em> receives the BATCH_START_OK
+     * response followed by one BATCH_PROGRESS per tape and a final
+     * BATCH_DONE, or a single error response.
+     * 
+     * @param tapes
+     *            Tape files relative to the tape root, may contain
+     *            wildcards (* and ?)
+     * @param journalDir
+     *            Directory to write journals to, <code>null</code> for
+     *            the tape root
+     * @param p
+     */
+    void batch(List<String> tapes, String journalDir, ResponseProcessor p);
+
     /**
      * Once the shutdown message was sent and the response processed it
      * is no longer possible to interact with {@link WineingRemoteAPI}.
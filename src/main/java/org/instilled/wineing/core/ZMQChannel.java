@@ -78,6 +78,49 @@ public class ZMQChannel
         }
     }
 
+    /**
+     * Connects to one more endpoint after {@link #bind()}, e.g. to a
+     * second publisher of a {@link ZMQChannelType#SUB} channel.
+     * Messages of all endpoints are received interleaved.
+     * 
+     * @param fqcn
+     */
+    public void connect(String fqcn)
+    {
+        _sock.connect(fqcn);
+    }
+
+    /**
+     * Subscribes a {@link ZMQChannelType#SUB} channel to the messages
+     * whose first part starts with <em>topic</em>.
+     * 
+     * @param topic
+     */
+    public void subscribe(byte[] topic)
+    {
+        _sock.subscribe(topic);
+    }
+
+    /**
+     * Undoes {@link #subscribe(byte[])}, including the subscription to
+     * all messages made by {@link #bind()} if <em>topic</em> is empty.
+     * 
+     * @param topic
+     */
+    public void unsubscribe(byte[] topic)
+    {
+        _sock.unsubscribe(topic);
+    }
+
+    /**
+     * @return <code>true</code> if the message part received last is
+     *         followed by another part of the same message.
+     */
+    public boolean hasReceiveMore()
+    {
+        return _sock.hasReceiveMore();
+    }
+
     public String getFqcn()
     {
         return _fqcn;
@@ -117,25 +160,22 @@ public class ZMQChannel
      */
     public byte[] receiveNoblock()
     {
-        // TODO use _sock.recv(buffer, ..., ..., ...) instead of
-        // allocating a data buffer with each call
         return _sock.recv(ZMQ.NOBLOCK);
     }
 
     /**
-     * See {@link #receiveNoblock()}.
+     * See {@link #receiveNoblock()} and
+     * {@link #receive(byte[], int, int)}.
      * 
      * @param buffer
      * @param offset
      * @param len
-     * @return
+     * @return Size of the message, see
+     *         {@link #receive(byte[], int, int)}.
      */
     public int receiveNoblock(byte[] buffer, int offset, int len)
     {
-        // TODO use _sock.recv(buffer, ..., ..., ...) instead of
-        // allocating a data buffer with each call
-        // return _sock.recv(buffer, 0, len, ZMQ.NOBLOCK);
-        throw new IllegalStateException("Method not implemented.");
+        return _sock.recv(buffer, offset, len, ZMQ.NOBLOCK);
     }
 
     /**
@@ -151,30 +191,25 @@ public class ZMQChannel
      */
     public byte[] receive()
     {
-        // TODO use _sock.recv(buffer, ..., ..., ...) instead of
-        // allocating a data buffer with each call
-
-        // Somehow this dosen't work
-        // return _sock.recv(buffer, offset, len, 0);
+        // Allocates a new array per message. Use
+        // receive(byte[], int, int) on hot paths.
         return _sock.recv(0);
     }
 
     /**
-     * See {@link #receive()}.
+     * See {@link #receive()}. Receives into a buffer provided by the
+     * caller thus does not allocate.
      * 
      * @param buffer
      * @param offset
      * @param len
-     * @return
+     * @return Size of the message. Messages larger than <em>len</em>
+     *         are truncated to <em>len</em> bytes, the caller detects
+     *         this by the size exceeding <em>len</em>.
      */
     public int receive(byte[] buffer, int offset, int len)
     {
-        // TODO use _sock.recv(buffer, ..., ..., ...) instead of
-        // allocating a data buffer with each call
-
-        // Some how this dosen't work
-        // return _sock.recv(buffer, offset, len, 0);
-        throw new IllegalStateException("Method not implemented.");
+        return _sock.recv(buffer, offset, len, 0);
     }
 
     /**
@@ -0,0 +1,120 @@
+
+#include <check.h>
+
+#include "agg/bars.h"
+
+typedef struct
+{
+  unsigned int ids[8];
+  bar bars[8];
+  int size;
+} _emitted;
+
+static void _emit(unsigned int id, const bar *b, void *obj)
+{
+  _emitted *e = (_emitted*)obj;
+  e->ids[e->size] = id;
+  e->bars[e->size++] = *b;
+}
+
+START_TEST (test_Ohlcv)
+{
+  bars *b = bars_init(4, 1000);
+  _emitted e = { { 0 }, { { 0 } }, 0 };
+
+  fail_unless (0 == bars_roll(b, 34200000, _emit, &e), NULL);
+  bars_add(b, 1, 100, 10, 7, _emit, &e);
+  bars_add(b, 1, 105, 20, 7, _emit, &e);
+  bars_add(b, 1, 98, 10, 7, _emit, &e);
+  bars_add(b, 1, 101, 60, 7, _emit, &e);
+
+  // Same interval
+  fail_unless (0 == bars_roll(b, 34200999, _emit, &e), NULL);
+  fail_unless (1 == bars_roll(b, 34201000, _emit, &e), NULL);
+
+  const bar &r = e.bars[0];
+  fail_unless (1 == e.ids[0], NULL);
+  fail_unless (34200000 == r.start, NULL);
+  fail_unless (1000 == r.interval, NULL);
+  fail_unless (100 == r.open && 105 == r.high && 98 == r.low && 101 == r.close, NULL);
+  fail_unless (100 == r.volume, NULL);
+  fail_unless (4 == r.trades, NULL);
+  fail_unless (7 == r.price_type, NULL);
+  // (1000 + 2100 + 980 + 6060) / 100
+  fail_unless (101.4 - 1e-9 < r.vwap && r.vwap < 101.4 + 1e-9, NULL);
+
+  // Nothing traded in the next interval
+  fail_unless (0 == bars_roll(b, 34202000, _emit, &e), NULL);
+
+  bars_destroy(b);
+}
+END_TEST
+
+START_TEST (test_OnlyTradedSymbolsGrow)
+{
+  bars *b = bars_init(1, 60000);
+  _emitted e = { { 0 }, { { 0 } }, 0 };
+
+  bars_roll(b, 0, _emit, &e);
+  bars_add(b, 1000, 50, 1, 0, _emit, &e);
+  bars_add(b, 3, 60, 1, 0, _emit, &e);
+  fail_unless (1000 < b->capacity, NULL);
+
+  fail_unless (2 == bars_roll(b, 60000, _emit, &e), NULL);
+  fail_unless (1000 == e.ids[0] && 50 == e.bars[0].open, NULL);
+  fail_unless (3 == e.ids[1] && 60 == e.bars[1].open, NULL);
+
+  // A new bar starts from scratch
+  bars_add(b, 3, 70, 2, 0, _emit, &e);
+  fail_unless (1 == bars_roll(b, 120000, _emit, &e), NULL);
+  fail_unless (70 == e.bars[2].open && 70 == e.bars[2].low, NULL);
+  fail_unless (2 == e.bars[2].volume && 1 == e.bars[2].trades, NULL);
+
+  bars_destroy(b);
+}
+END_TEST
+
+START_TEST (test_PriceTypeChange)
+{
+  bars *b = bars_init(4, 1000);
+  _emitted e = { { 0 }, { { 0 } }, 0 };
+
+  bars_roll(b, 0, _emit, &e);
+  bars_add(b, 2, 1000, 10, 2, _emit, &e);
+  bars_add(b, 2, 1010, 10, 2, _emit, &e);
+
+  // 99.5 in another price type, the bar so far is completed
+  bars_add(b, 2, 9950, 5, 3, _emit, &e);
+  fail_unless (1 == e.size, NULL);
+  fail_unless (2 == e.ids[0] && 0 == e.bars[0].start, NULL);
+  fail_unless (1000 == e.bars[0].open && 1010 == e.bars[0].high, NULL);
+  fail_unless (1000 == e.bars[0].low && 1010 == e.bars[0].close, NULL);
+  fail_unless (20 == e.bars[0].volume && 2 == e.bars[0].trades, NULL);
+  fail_unless (2 == e.bars[0].price_type, NULL);
+
+  // The next one, same interval, is emitted once with the roll
+  bars_add(b, 2, 9980, 5, 3, _emit, &e);
+  fail_unless (1 == bars_roll(b, 1000, _emit, &e), NULL);
+  fail_unless (2 == e.size, NULL);
+  fail_unless (2 == e.ids[1] && 0 == e.bars[1].start, NULL);
+  fail_unless (9950 == e.bars[1].open && 9980 == e.bars[1].high, NULL);
+  fail_unless (9950 == e.bars[1].low && 9980 == e.bars[1].close, NULL);
+  fail_unless (10 == e.bars[1].volume && 2 == e.bars[1].trades, NULL);
+  fail_unless (3 == e.bars[1].price_type, NULL);
+
+  bars_destroy(b);
+}
+END_TEST
+
+Suite * bars_suite (void)
+{
+  Suite *s = suite_create ("Bars");
+
+  TCase *tc_core = tcase_create ("core");
+  tcase_add_test (tc_core, test_Ohlcv);
+  tcase_add_test (tc_core, test_OnlyTradedSymbolsGrow);
+  tcase_add_test (tc_core, test_PriceTypeChange);
+  suite_add_tcase (s, tc_core);
+
+  return s;
+}
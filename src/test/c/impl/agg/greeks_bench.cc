@@ -0,0 +1,77 @@
+/*
+ * Micro-benchmark of the implied volatility and greeks kernels in
+ * agg/greeks.h. Run with 'make perf'.
+ *
+ * Each case computes GREEKS_BENCH_QUOTES option quotes in batches on
+ * a single thread and reports the throughput, i.e. quotes per second
+ * per core, for every instruction set the CPU supports. Batches of
+ * DEFAULTS_OCHAN_BATCH_SIZE are what an ochan_thread computes at
+ * once.
+ */
+
+#include "agg/greeks.h"
+#include "core/wineing.h"
+
+#include <stdio.h>
+#include <time.h>
+
+#define GREEKS_BENCH_QUOTES 10000000
+
+static const char *g_isa_names[] = { "scalar", "avx2", "avx512" };
+
+static double _now()
+{
+  timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+/**
+ * Fills *g* with quotes around the money of a 20% volatility.
+ */
+static void _fill(greeks *g, size_t batch)
+{
+  unsigned int x = 2463534242u;
+  greeks_clear(g);
+  for(size_t i = 0; i < batch; i++) {
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    double k = 80 + (x % 4000) / 100.0;
+    double t = 0.05 + ((x >> 12) % 1000) / 500.0;
+    int put = x & 1;
+    double intrinsic = put ? k - 100 : 100 - k;
+    greeks_add(g, 100, k, t,
+               (0 < intrinsic ? intrinsic : 0) + 8 * t + 0.5, put);
+  }
+}
+
+static void _run(int isa, size_t batch)
+{
+  greeks *g = greeks_init(batch, 0.03);
+  _fill(g, batch);
+
+  size_t batches = GREEKS_BENCH_QUOTES / batch;
+  double start = _now();
+  for(size_t i = 0; i < batches; i++) {
+    greeks_compute_isa(g, isa);
+  }
+  double seconds = _now() - start;
+
+  size_t quotes = batches * batch;
+  printf("%-8s batch %-6lu %10.2f M quotes/s %8.1f ns/quote\n",
+         g_isa_names[isa],
+         (unsigned long)batch,
+         quotes / seconds / 1e6,
+         seconds * 1e9 / quotes);
+  greeks_destroy(g);
+}
+
+int main(int argc, char **argv)
+{
+  for(int isa = GREEKS_ISA_SCALAR; isa <= greeks_isa(); isa++) {
+    _run(isa, DEFAULTS_OCHAN_BATCH_SIZE);
+    _run(isa, 4096);
+  }
+  return 0;
+}
@@ -0,0 +1,108 @@
+#include <check.h>
+#include <math.h>
+#include <string.h>
+
+#include "agg/greeks.h"
+
+/**
+ * \return The Black-Scholes price, computed with libm
+ */
+static double _greeks_price(double s, double k, double t, double r,
+                            double sigma, int put)
+{
+  double vt = sigma * sqrt(t);
+  double d1 = (log(s / k) + r * t) / vt + vt / 2;
+  double d2 = d1 - vt;
+  double w = put ? -1 : 1;
+  return w * (s * 0.5 * erfc(-w * d1 / M_SQRT2)
+              - k * exp(-r * t) * 0.5 * erfc(-w * d2 / M_SQRT2));
+}
+
+START_TEST (test_GreeksKnown)
+{
+  greeks *g = greeks_init(8, 0.05);
+
+  // Hull, S = K = 100, T = 1, r = 5%, sigma = 20%
+  fail_unless (0 == greeks_add(g, 100, 100, 1, 10.450583572185565, 0), NULL);
+  fail_unless (1 == greeks_add(g, 100, 100, 1, 5.573526022256971, 1), NULL);
+  // Below the intrinsic value, above the spot, expired, no quote
+  greeks_add(g, 120, 100, 1, 19, 0);
+  greeks_add(g, 100, 100, 1, 101, 0);
+  greeks_add(g, 100, 100, 0, 5, 1);
+  greeks_add(g, 100, 100, 1, 0, 1);
+  greeks_compute(g);
+
+  fail_unless (fabs(g->iv[0] - 0.2) < 1e-5, NULL);
+  fail_unless (fabs(g->delta[0] - 0.636831) < 1e-5, NULL);
+  fail_unless (fabs(g->gamma[0] - 0.018762) < 1e-5, NULL);
+  fail_unless (fabs(g->vega[0] - 37.524) < 1e-3, NULL);
+
+  fail_unless (fabs(g->iv[1] - 0.2) < 1e-5, NULL);
+  fail_unless (fabs(g->delta[1] + 0.363169) < 1e-5, NULL);
+  fail_unless (fabs(g->gamma[1] - g->gamma[0]) < 1e-9, NULL);
+
+  for(int i = 2; i < 6; i++) {
+    fail_unless (isnan(g->iv[i]) && isnan(g->delta[i]), NULL);
+  }
+
+  greeks_clear(g);
+  fail_unless (0 == g->size, NULL);
+  greeks_destroy(g);
+}
+END_TEST
+
+START_TEST (test_GreeksIsa)
+{
+  // Sizes not a multiple of the lanes
+  const size_t size = 1001;
+  greeks *g = greeks_init(size, 0.03);
+  double sigmas[1001];
+  unsigned int x = 2463534242u;
+
+  for(size_t i = 0; i < size; i++) {
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    double s = 100;
+    double k = 80 + (x % 4000) / 100.0;
+    double t = 0.05 + ((x >> 12) % 1000) / 500.0;
+    sigmas[i] = 0.1 + ((x >> 22) % 700) / 1000.0;
+    int put = x & 1;
+    greeks_add(g, s, k, t, _greeks_price(s, k, t, 0.03, sigmas[i], put), put);
+  }
+  fail_unless (-1 == greeks_add(g, 100, 100, 1, 10, 0), NULL);
+
+  greeks_compute_isa(g, GREEKS_ISA_SCALAR);
+  double iv[1001];
+  double delta[1001];
+  for(size_t i = 0; i < size; i++) {
+    fail_unless (fabs(g->iv[i] - sigmas[i]) < 1e-3, NULL);
+    iv[i] = g->iv[i];
+    delta[i] = g->delta[i];
+  }
+
+  for(int isa = GREEKS_ISA_AVX2; isa <= greeks_isa(); isa++) {
+    memset(g->iv, 0, size * sizeof(double));
+    fail_unless (0 == greeks_compute_isa(g, isa), NULL);
+    for(size_t i = 0; i < size; i++) {
+      fail_unless (fabs(g->iv[i] - iv[i]) < 1e-9, NULL);
+      fail_unless (fabs(g->delta[i] - delta[i]) < 1e-9, NULL);
+    }
+  }
+  fail_unless (-1 == greeks_compute_isa(g, GREEKS_ISA_AVX512 + 1), NULL);
+
+  greeks_destroy(g);
+}
+END_TEST
+
+Suite * greeks_suite (void)
+{
+  Suite *s = suite_create ("Greeks");
+
+  TCase *tc_core = tcase_create ("core");
+  tcase_add_test (tc_core, test_GreeksKnown);
+  tcase_add_test (tc_core, test_GreeksIsa);
+  suite_add_tcase (s, tc_core);
+
+  return s;
+}
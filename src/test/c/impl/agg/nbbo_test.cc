@@ -0,0 +1,192 @@
+#include <check.h>
+
+#include "agg/nbbo.h"
+
+START_TEST (test_NbboBest)
+{
+  nbbo *n = nbbo_init(4);
+
+  fail_unless (1 == nbbo_update(n, 2, 5, 100, 10, 102, 20, 7), NULL);
+  const nbbo_quote *q = nbbo_get(n, 2);
+  fail_unless (100 == q->bid && 10 == q->bid_size && 5 == q->bid_exg, NULL);
+  fail_unless (102 == q->ask && 20 == q->ask_size && 5 == q->ask_exg, NULL);
+  fail_unless (7 == q->price_type, NULL);
+
+  // Worse on both sides
+  fail_unless (0 == nbbo_update(n, 2, 9, 99, 10, 103, 10, 7), NULL);
+
+  // Same prices, sizes add up, the lowest venue is reported
+  fail_unless (1 == nbbo_update(n, 2, 1, 100, 5, 102, 5, 7), NULL);
+  q = nbbo_get(n, 2);
+  fail_unless (15 == q->bid_size && 1 == q->bid_exg, NULL);
+  fail_unless (25 == q->ask_size && 1 == q->ask_exg, NULL);
+
+  // Improving takes over the side
+  fail_unless (1 == nbbo_update(n, 2, 9, 101, 3, 103, 10, 7), NULL);
+  q = nbbo_get(n, 2);
+  fail_unless (101 == q->bid && 3 == q->bid_size && 9 == q->bid_exg, NULL);
+  fail_unless (102 == q->ask && 25 == q->ask_size, NULL);
+
+  // The best venue backs off, the next best takes over
+  fail_unless (1 == nbbo_update(n, 2, 9, 98, 3, 103, 10, 7), NULL);
+  q = nbbo_get(n, 2);
+  fail_unless (100 == q->bid && 15 == q->bid_size && 1 == q->bid_exg, NULL);
+
+  // Withdrawn quotes leave the side empty
+  nbbo_update(n, 2, 1, 0, 0, 0, 0, 7);
+  nbbo_update(n, 2, 5, 0, 0, 0, 0, 7);
+  nbbo_update(n, 2, 9, 0, 0, 104, 1, 7);
+  q = nbbo_get(n, 2);
+  fail_unless (0 == q->bid && 0 == q->bid_size, NULL);
+  fail_unless (104 == q->ask && 1 == q->ask_size && 9 == q->ask_exg, NULL);
+
+  // Symbols beyond the capacity grow the tables
+  fail_unless (1 == nbbo_update(n, 100, 4, -5, 1, -4, 1, 7), NULL);
+  q = nbbo_get(n, 100);
+  fail_unless (-5 == q->bid && 4 == q->bid_exg, NULL);
+
+  nbbo_clear(n);
+  q = nbbo_get(n, 100);
+  fail_unless (0 == q->bid && 0 == q->ask_size, NULL);
+  fail_unless (1 == nbbo_update(n, 100, 3, 10, 1, 0, 0, 7), NULL);
+  fail_unless (10 == nbbo_get(n, 100)->bid, NULL);
+  fail_unless (0 == nbbo_get(n, 100)->ask_size, NULL);
+
+  nbbo_destroy(n);
+}
+END_TEST
+
+START_TEST (test_NbboVenues)
+{
+  nbbo *n = nbbo_init(4);
+
+  // Exchange codes at and above the number of lanes get lanes
+  fail_unless (1 == nbbo_update(n, 0, NBBO_VENUES, 100, 1, 102, 1, 0), NULL);
+  fail_unless (1 == nbbo_update(n, 0, NBBO_VENUES + 1, 101, 1, 0, 0, 0),
+               NULL);
+  fail_unless (1 == nbbo_update(n, 0, 300, 101, 2, 102, 2, 0), NULL);
+  const nbbo_quote *q = nbbo_get(n, 0);
+  fail_unless (101 == q->bid && 3 == q->bid_size
+               && NBBO_VENUES + 1 == q->bid_exg, NULL);
+  fail_unless (102 == q->ask && 3 == q->ask_size
+               && NBBO_VENUES == q->ask_exg, NULL);
+
+  // Lower exchange codes quoting later are still reported first
+  fail_unless (1 == nbbo_update(n, 0, 2, 101, 1, 102, 1, 0), NULL);
+  q = nbbo_get(n, 0);
+  fail_unless (2 == q->bid_exg && 2 == q->ask_exg, NULL);
+  fail_unless (0 == n->dropped, NULL);
+
+  // Once all lanes are assigned further venues are dropped
+  for(unsigned int i = n->venue_count; i < NBBO_VENUES; i++) {
+    nbbo_update(n, 1, 1000 + i, 50, 1, 60, 1, 0);
+  }
+  fail_unless (NBBO_VENUES == n->venue_count && 0 == n->dropped, NULL);
+  fail_unless (0 == nbbo_update(n, 0, 3, 200, 1, 201, 1, 0), NULL);
+  fail_unless (0 == nbbo_update(n, 0, NBBO_EXCHANGES, 200, 1, 201, 1, 0),
+               NULL);
+  fail_unless (2 == n->dropped && 101 == nbbo_get(n, 0)->bid, NULL);
+
+  // Lanes stay assigned
+  nbbo_clear(n);
+  fail_unless (1 == nbbo_update(n, 0, 300, 90, 1, 91, 1, 0), NULL);
+  fail_unless (300 == nbbo_get(n, 0)->bid_exg, NULL);
+
+  nbbo_destroy(n);
+}
+END_TEST
+
+/**
+ * \return The next value of a xorshift generator
+ */
+static inline unsigned int _nbbo_rand(unsigned int *x)
+{
+  *x ^= *x << 13;
+  *x ^= *x >> 17;
+  *x ^= *x << 5;
+  return *x;
+}
+
+START_TEST (test_NbboReference)
+{
+  // The last quote of each venue of a few symbols, recomputed
+  // naively after every update. Venues are indexed by lane, their
+  // exchange codes spread beyond the lanes.
+  int bids[4][NBBO_VENUES] = { { 0 } };
+  int asks[4][NBBO_VENUES] = { { 0 } };
+  unsigned int bid_sizes[4][NBBO_VENUES] = { { 0 } };
+  unsigned int ask_sizes[4][NBBO_VENUES] = { { 0 } };
+  unsigned int x = 88172645;
+  nbbo *n = nbbo_init(4);
+
+  for(int i = 0; i < 20000; i++) {
+    unsigned int r = _nbbo_rand(&x);
+    unsigned int id = r & 3;
+    unsigned int exg = (r >> 2) % NBBO_VENUES;
+    // Few distinct prices to have ties, size 0 withdraws
+    int bid = 95 + (int)((r >> 8) % 6);
+    int ask = bid + 1 + (int)((r >> 12) % 3);
+    unsigned int bid_size = (r >> 16) % 4;
+    unsigned int ask_size = (r >> 20) % 4;
+
+    nbbo_quote before = n->best[id];
+    int changed = nbbo_update(n, id, 40 + 7 * exg,
+                              bid, bid_size, ask, ask_size, 0);
+    bids[id][exg] = 0 < bid_size ? bid : 0;
+    asks[id][exg] = 0 < ask_size ? ask : 0;
+    bid_sizes[id][exg] = bid_size;
+    ask_sizes[id][exg] = ask_size;
+
+    nbbo_quote e = { 0, 0, 0, 0, 0, 0, 0 };
+    for(int v = 0; v < NBBO_VENUES; v++) {
+      if(0 < bid_sizes[id][v]) {
+        if(0 == e.bid_size || bids[id][v] > e.bid) {
+          e.bid = bids[id][v];
+          e.bid_size = 0;
+          e.bid_exg = 40 + 7 * v;
+        }
+        if(bids[id][v] == e.bid) {
+          e.bid_size += bid_sizes[id][v];
+        }
+      }
+      if(0 < ask_sizes[id][v]) {
+        if(0 == e.ask_size || asks[id][v] < e.ask) {
+          e.ask = asks[id][v];
+          e.ask_size = 0;
+          e.ask_exg = 40 + 7 * v;
+        }
+        if(asks[id][v] == e.ask) {
+          e.ask_size += ask_sizes[id][v];
+        }
+      }
+    }
+
+    const nbbo_quote *q = nbbo_get(n, id);
+    fail_unless (e.bid == q->bid && e.bid_size == q->bid_size
+                 && e.bid_exg == q->bid_exg, NULL);
+    fail_unless (e.ask == q->ask && e.ask_size == q->ask_size
+                 && e.ask_exg == q->ask_exg, NULL);
+    fail_unless (changed == (before.bid != q->bid
+                             || before.ask != q->ask
+                             || before.bid_size != q->bid_size
+                             || before.ask_size != q->ask_size
+                             || before.bid_exg != q->bid_exg
+                             || before.ask_exg != q->ask_exg), NULL);
+  }
+
+  nbbo_destroy(n);
+}
+END_TEST
+
+Suite * nbbo_suite (void)
+{
+  Suite *s = suite_create ("Nbbo");
+
+  TCase *tc_core = tcase_create ("core");
+  tcase_add_test (tc_core, test_NbboBest);
+  tcase_add_test (tc_core, test_NbboVenues);
+  tcase_add_test (tc_core, test_NbboReference);
+  suite_add_tcase (s, tc_core);
+
+  return s;
+}
@@ -0,0 +1,97 @@
+
+#include <check.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "agg/urate.h"
+
+typedef struct
+{
+  unsigned int ids[8];
+  char names[8][SYMTAB_NAME_SIZE];
+  unsigned int starts[8];
+  unsigned int messages[8];
+  unsigned long long totals[8];
+  int size;
+} _rates;
+
+static void _rate(unsigned int id,
+                  const char *name,
+                  unsigned int start,
+                  unsigned int messages,
+                  unsigned long long total,
+                  void *obj)
+{
+  _rates *e = (_rates*)obj;
+  e->ids[e->size] = id;
+  strcpy(e->names[e->size], name);
+  e->starts[e->size] = start;
+  e->messages[e->size] = messages;
+  e->totals[e->size++] = total;
+}
+
+START_TEST (test_Rates)
+{
+  urate *r = urate_init(2, 1000);
+  _rates e;
+  memset(&e, 0, sizeof(e));
+
+  urate_roll(r, 34200000, _rate, &e);
+  urate_add(r, 0, "eAAPL");
+  urate_add(r, 0, "eAAPL");
+  urate_add(r, 5, "eSPY");
+  fail_unless (5 < r->capacity, NULL);
+
+  fail_unless (0 == urate_roll(r, 34200999, _rate, &e), NULL);
+  fail_unless (2 == urate_roll(r, 34201000, _rate, &e), NULL);
+  fail_unless (0 == e.ids[0] && 0 == strcmp("eAAPL", e.names[0]), NULL);
+  fail_unless (34200000 == e.starts[0], NULL);
+  fail_unless (2 == e.messages[0] && 2 == e.totals[0], NULL);
+  fail_unless (5 == e.ids[1] && 0 == strcmp("eSPY", e.names[1]), NULL);
+  fail_unless (1 == e.messages[1], NULL);
+
+  // Quiet underlyings are not emitted, totals carry over
+  urate_add(r, 0, "eAAPL");
+  fail_unless (1 == urate_roll(r, 34203000, _rate, &e), NULL);
+  fail_unless (0 == e.ids[2] && 1 == e.messages[2] && 3 == e.totals[2], NULL);
+  fail_unless (34201000 == e.starts[2], NULL);
+
+  urate_destroy(r);
+}
+END_TEST
+
+START_TEST (test_Shard)
+{
+  // Stable and within range
+  fail_unless (urate_shard("eAAPL", 4) == urate_shard("eAAPL", 4), NULL);
+  fail_unless (4 > urate_shard("eSPY", 4), NULL);
+  fail_unless (0 == urate_shard("eSPY", 1), NULL);
+  fail_unless (0 == urate_shard("eSPY", 0), NULL);
+
+  // FNV-1a of the empty string is the offset basis
+  fail_unless (2166136261u % 7 == urate_shard("", 7), NULL);
+
+  // Spreads underlyings over the shards
+  int counts[4] = { 0 };
+  char name[SYMTAB_NAME_SIZE];
+  for(int i = 0; i < 400; i++) {
+    snprintf(name, sizeof(name), "e%c%c%c", 'A' + i % 26, 'A' + i / 26 % 26, 'A' + i % 7);
+    counts[urate_shard(name, 4)]++;
+  }
+  for(int i = 0; i < 4; i++) {
+    fail_unless (50 < counts[i], NULL);
+  }
+}
+END_TEST
+
+Suite * urate_suite (void)
+{
+  Suite *s = suite_create ("URate");
+
+  TCase *tc_core = tcase_create ("core");
+  tcase_add_test (tc_core, test_Rates);
+  tcase_add_test (tc_core, test_Shard);
+  suite_add_tcase (s, tc_core);
+
+  return s;
+}
@@ -0,0 +1,135 @@
+
+#include <check.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "codec/lz4batch.h"
+
+/**
+ * Fills *b* with frames resembling MarketData messages.
+ */
+static void _fill(lz4batch *b, int count)
+{
+  char frame[32];
+  for(int i = 0; i < count; i++) {
+    int n = snprintf(frame, sizeof(frame), "QUOTE sym=%d bid=%d", i % 7, 1000 + i);
+    fail_unless (0 == lz4batch_append(b, frame, n), NULL);
+  }
+}
+
+START_TEST (test_BatchIterate)
+{
+  lz4batch *b = lz4batch_init(1024);
+  size_t size, pos = 0, frame_size;
+  const char *frame;
+  int count = 0;
+
+  fail_unless (NULL == lz4batch_take(b, &size), NULL);
+  _fill(b, 10);
+  char *data = lz4batch_take(b, &size);
+  fail_unless (NULL != data, NULL);
+  fail_unless (0 == b->size, NULL);
+
+  while(1 == lz4batch_next(data, size, &pos, &frame, &frame_size)) {
+    fail_unless (0 == strncmp(frame, "QUOTE sym=", 10), NULL);
+    count++;
+  }
+  fail_unless (10 == count, NULL);
+  fail_unless (pos == size, NULL);
+
+  // Truncated batch
+  pos = 0;
+  fail_unless (1 == lz4batch_next(data, size - 1, &pos, &frame, &frame_size), NULL);
+  pos = size - frame_size;
+  fail_unless (-1 == lz4batch_next(data, size - 1, &pos, &frame, &frame_size), NULL);
+
+  delete [] data;
+  lz4batch_destroy(b);
+}
+END_TEST
+
+START_TEST (test_BatchFull)
+{
+  lz4batch *b = lz4batch_init(20);
+  char frame[12] = { 0 };
+
+  fail_unless (0 == lz4batch_append(b, frame, sizeof(frame)), NULL);
+  fail_unless (-1 == lz4batch_append(b, frame, sizeof(frame)), NULL);
+  fail_unless (13 == b->size, NULL);
+
+  lz4batch_destroy(b);
+}
+END_TEST
+
+START_TEST (test_CompressRoundTrip)
+{
+  lz4batch *b = lz4batch_init(16384);
+  lz4comp *c = lz4comp_init(NULL, 0);
+  size_t size;
+
+  _fill(b, 500);
+  char *data = lz4batch_take(b, &size);
+
+  char *comp = new char[lz4comp_bound(size)];
+  char *raw = new char[size];
+  int n = lz4comp_compress(c, data, size, comp, lz4comp_bound(size));
+  fail_unless (0 < n && (size_t)n < size, NULL);
+  fail_unless ((int)size == lz4comp_decompress(c, comp, n, raw, size), NULL);
+  fail_unless (0 == memcmp(data, raw, size), NULL);
+
+  fail_unless (1 == c->stats.batches, NULL);
+  fail_unless (size == c->stats.bytes_in, NULL);
+  fail_unless ((unsigned long)n == c->stats.bytes_out, NULL);
+
+  // Destination too small
+  fail_unless (-1 == lz4comp_decompress(c, comp, n, raw, size - 1), NULL);
+
+  delete [] comp;
+  delete [] raw;
+  delete [] data;
+  lz4comp_destroy(c);
+  lz4batch_destroy(b);
+}
+END_TEST
+
+START_TEST (test_CompressDictionary)
+{
+  lz4batch *b = lz4batch_init(1024);
+  size_t size, dict_size;
+
+  _fill(b, 20);
+  char *dict = lz4batch_take(b, &dict_size);
+  _fill(b, 3);
+  char *data = lz4batch_take(b, &size);
+
+  lz4comp *plain = lz4comp_init(NULL, 0);
+  lz4comp *primed = lz4comp_init(dict, dict_size);
+  char comp[1024], raw[1024];
+
+  int n = lz4comp_compress(plain, data, size, comp, sizeof(comp));
+  int m = lz4comp_compress(primed, data, size, comp, sizeof(comp));
+  fail_unless (0 < m && m < n, NULL);
+  fail_unless ((int)size == lz4comp_decompress(primed, comp, m, raw, sizeof(raw)), NULL);
+  fail_unless (0 == memcmp(data, raw, size), NULL);
+
+  delete [] dict;
+  delete [] data;
+  lz4comp_destroy(plain);
+  lz4comp_destroy(primed);
+  lz4batch_destroy(b);
+}
+END_TEST
+
+Suite * lz4batch_suite (void)
+{
+  Suite *s = suite_create ("Lz4Batch");
+
+  TCase *tc_core = tcase_create ("core");
+  tcase_add_test (tc_core, test_BatchIterate);
+  tcase_add_test (tc_core, test_BatchFull);
+  tcase_add_test (tc_core, test_CompressRoundTrip);
+  tcase_add_test (tc_core, test_CompressDictionary);
+  suite_add_tcase (s, tc_core);
+
+  return s;
+}
@@ -0,0 +1,98 @@
+#include <check.h>
+#include <string.h>
+#include <string>
+
+#include "codec/pbframe.h"
+
+#include "gen/WineingCtrlProto.pb.h"
+#include "gen/WineingMarketDataProto.pb.h"
+
+/**
+ * \return 1 if *f* encodes *m* exactly as protobuf does
+ */
+static int _same(const pbframe *f,
+                 unsigned long long v,
+                 const google::protobuf::Message &m)
+{
+  char out[PBFRAME_MAX_SIZE + VARINT_MAX_SIZE64];
+  size_t n = pbframe_encode(f, v, out);
+  std::string expected = m.SerializeAsString();
+  return n <= pbframe_max_size(f)
+    && expected.size() == n
+    && 0 == memcmp(expected.data(), out, n);
+}
+
+START_TEST (test_FirstField)
+{
+  using namespace WineingCtrlProto;
+
+  Response res;
+  res.set_type(Response::MARKET_STOP_OK);
+  pbframe f;
+  fail_unless (0 == pbframe_init(&f, res, 1), NULL);
+
+  // One to ten byte varints, negative int64 take ten
+  const long long ids[] = { 0, 1, 127, 128, 300, 1LL << 40, -1 };
+  for(size_t i = 0; i < sizeof(ids) / sizeof(ids[0]); i++) {
+    res.set_requestid(ids[i]);
+    fail_unless (_same(&f, (unsigned long long)ids[i], res), NULL);
+  }
+}
+END_TEST
+
+START_TEST (test_MiddleField)
+{
+  using namespace WineingMarketDataProto;
+
+  MarketData m;
+  m.set_type(MarketData::BAR);
+  m.set_symbol_id(42);
+  m.set_timestamp(999);         // ignored, field 6 varies
+  m.set_interval(1000);
+  m.set_open(-5);
+  m.set_vwap(1.5);
+  pbframe f;
+  fail_unless (0 == pbframe_init(&f, m, 6), NULL);
+
+  for(unsigned int ts = 0; ts < 100000000; ts = ts * 7 + 1) {
+    m.set_timestamp(ts);
+    fail_unless (_same(&f, ts, m), NULL);
+  }
+
+  // Zig-zag encoded, strings and doubles can't vary
+  fail_unless (-1 == pbframe_init(&f, m, 16), NULL);
+  fail_unless (-1 == pbframe_init(&f, m, 3), NULL);
+  fail_unless (-1 == pbframe_init(&f, m, 21), NULL);
+  fail_unless (-1 == pbframe_init(&f, m, 99), NULL);
+}
+END_TEST
+
+START_TEST (test_Fixed)
+{
+  using namespace WineingMarketDataProto;
+
+  MarketData m;
+  m.set_type(MarketData::STATUS);
+  pbframe f;
+  fail_unless (0 == pbframe_init(&f, m, PBFRAME_NONE), NULL);
+  fail_unless (f.size == pbframe_max_size(&f), NULL);
+  fail_unless (_same(&f, 12345, m), NULL);
+
+  // Too large
+  m.set_symbol(std::string(PBFRAME_MAX_SIZE, 'x'));
+  fail_unless (-1 == pbframe_init(&f, m, PBFRAME_NONE), NULL);
+}
+END_TEST
+
+Suite * pbframe_suite (void)
+{
+  Suite *s = suite_create ("PbFrame");
+
+  TCase *tc_core = tcase_create ("core");
+  tcase_add_test (tc_core, test_FirstField);
+  tcase_add_test (tc_core, test_MiddleField);
+  tcase_add_test (tc_core, test_Fixed);
+  suite_add_tcase (s, tc_core);
+
+  return s;
+}
@@ -0,0 +1,104 @@
+
+#include <check.h>
+#include <string.h>
+
+#include "codec/qdelta.h"
+
+static qdelta_quote _quote(int ts, int bid, int ask)
+{
+  qdelta_quote q = { ts, bid, ask, 100, 200, 12, 7 };
+  return q;
+}
+
+START_TEST (test_RoundTrip)
+{
+  qdelta *enc = qdelta_init(4, 64);
+  qdelta *dec = qdelta_init(4, 64);
+  char buf[QDELTA_MAX_FRAME_SIZE];
+  unsigned int id;
+  qdelta_quote in, out;
+
+  for(int i = 0; i < 200; i++) {
+    in = _quote(34200000 + i * 3, 10000 + (i % 3), 10002 - (i % 2));
+    int n = qdelta_encode(enc, 1000, &in, buf);
+
+    fail_unless (qdelta_is_frame(buf, n), NULL);
+    fail_unless (QDELTA_DECODE_OK == qdelta_decode(dec, buf, n, &id, &out), NULL);
+    fail_unless (1000 == id, NULL);
+    fail_unless (0 == memcmp(&in, &out, sizeof(in)), NULL);
+  }
+
+  qdelta_destroy(enc);
+  qdelta_destroy(dec);
+}
+END_TEST
+
+START_TEST (test_DeltaIsSmall)
+{
+  qdelta *enc = qdelta_init(4, 64);
+  char buf[QDELTA_MAX_FRAME_SIZE];
+  qdelta_quote q = _quote(34200000, 10000, 10002);
+
+  int full = qdelta_encode(enc, 1, &q, buf);
+  q.bid_price += 1;
+  q.timestamp += 5;
+  int delta = qdelta_encode(enc, 1, &q, buf);
+
+  fail_unless (buf[0] == (char)QDELTA_FRAME_MARKER, NULL);
+  // header, id, sequence, mask, two single byte fields
+  fail_unless (6 == delta, NULL);
+  fail_unless (delta < full, NULL);
+
+  qdelta_destroy(enc);
+}
+END_TEST
+
+START_TEST (test_GapResyncsOnFullFrame)
+{
+  qdelta *enc = qdelta_init(4, 4);
+  qdelta *dec = qdelta_init(4, 4);
+  char buf[QDELTA_MAX_FRAME_SIZE];
+  unsigned int id;
+  qdelta_quote in, out;
+  int n;
+
+  in = _quote(1, 100, 101);
+  n = qdelta_encode(enc, 3, &in, buf);
+  fail_unless (QDELTA_DECODE_OK == qdelta_decode(dec, buf, n, &id, &out), NULL);
+
+  // Lose one frame
+  in = _quote(2, 101, 102);
+  qdelta_encode(enc, 3, &in, buf);
+
+  in = _quote(3, 102, 103);
+  n = qdelta_encode(enc, 3, &in, buf);
+  fail_unless (QDELTA_DECODE_GAP == qdelta_decode(dec, buf, n, &id, &out), NULL);
+
+  // refresh is 4 thus the fifth quote is a full frame
+  in = _quote(4, 103, 104);
+  n = qdelta_encode(enc, 3, &in, buf);
+  fail_unless (QDELTA_DECODE_GAP == qdelta_decode(dec, buf, n, &id, &out), NULL);
+
+  in = _quote(5, 104, 105);
+  n = qdelta_encode(enc, 3, &in, buf);
+  fail_unless (buf[0] & QDELTA_FLAG_FULL, NULL);
+  fail_unless (QDELTA_DECODE_OK == qdelta_decode(dec, buf, n, &id, &out), NULL);
+  fail_unless (0 == memcmp(&in, &out, sizeof(in)), NULL);
+
+  qdelta_destroy(enc);
+  qdelta_destroy(dec);
+}
+END_TEST
+
+Suite * qdelta_suite (void)
+{
+  Suite *s = suite_create ("QDelta");
+
+  TCase *tc_core = tcase_create ("core");
+  tcase_add_test (tc_core, test_RoundTrip);
+  tcase_add_test (tc_core, test_DeltaIsSmall);
+  tcase_add_test (tc_core, test_GapResyncsOnFullFrame);
+  suite_add_tcase (s, tc_core);
+
+  return s;
+}
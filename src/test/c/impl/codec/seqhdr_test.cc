@@ -0,0 +1,60 @@
+#include <check.h>
+#include <string.h>
+
+#include "codec/qdelta.h"
+#include "codec/seqhdr.h"
+#include "gen/WineingMarketDataProto.pb.h"
+
+START_TEST (test_SeqhdrRoundTrip)
+{
+  char buf[SEQHDR_SIZE + 1];
+  uint64_t seqs[] = { 0, 1, 0xff, 0x0102030405060708ULL, ~0ULL };
+
+  for(int i = 0; i < 5; i++) {
+    buf[SEQHDR_SIZE] = 'x';
+    fail_unless (buf + SEQHDR_SIZE == seqhdr_put(buf, seqs[i]), NULL);
+    fail_unless (seqhdr_is_frame(buf, sizeof(buf)), NULL);
+    fail_unless (seqs[i] == seqhdr_get(buf), NULL);
+    fail_unless ('x' == buf[SEQHDR_SIZE], NULL);
+  }
+  fail_unless (!seqhdr_is_frame(buf, SEQHDR_SIZE - 1), NULL);
+
+  // Days order sequence numbers
+  fail_unless (seqhdr_day(41194) + 1000000000 < seqhdr_day(41195), NULL);
+}
+END_TEST
+
+START_TEST (test_SeqhdrFrameKinds)
+{
+  // Neither protobuf messages nor delta frames look like a header
+  WineingMarketDataProto::MarketData m;
+  m.set_type(WineingMarketDataProto::MarketData::STATUS);
+  std::string pb = m.SerializeAsString();
+  fail_unless (!seqhdr_is_frame(pb.data(), pb.size() + SEQHDR_SIZE), NULL);
+
+  qdelta *enc = qdelta_init(4, 64);
+  qdelta_quote q = { 34200000, 10000, 10002, 100, 200, 12, 7 };
+  char buf[SEQHDR_SIZE + QDELTA_MAX_FRAME_SIZE];
+  int n = qdelta_encode(enc, 7, &q, buf);
+  fail_unless (!seqhdr_is_frame(buf, n + SEQHDR_SIZE), NULL);
+
+  // Nor does a header look like a delta frame
+  char *frame = seqhdr_put(buf, seqhdr_day(41194));
+  qdelta_encode(enc, 7, &q, frame);
+  fail_unless (!qdelta_is_frame(buf, n + SEQHDR_SIZE), NULL);
+  fail_unless (qdelta_is_frame(frame, n), NULL);
+  qdelta_destroy(enc);
+}
+END_TEST
+
+Suite * seqhdr_suite (void)
+{
+  Suite *s = suite_create ("Seqhdr");
+
+  TCase *tc_core = tcase_create ("core");
+  tcase_add_test (tc_core, test_SeqhdrRoundTrip);
+  tcase_add_test (tc_core, test_SeqhdrFrameKinds);
+  suite_add_tcase (s, tc_core);
+
+  return s;
+}
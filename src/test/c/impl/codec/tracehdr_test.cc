@@ -0,0 +1,59 @@
+#include <check.h>
+#include <string.h>
+
+#include "codec/qdelta.h"
+#include "codec/seqhdr.h"
+#include "codec/tracehdr.h"
+
+START_TEST (test_TracehdrRoundTrip)
+{
+  char buf[TRACEHDR_SIZE + 1];
+  tracehdr t = { 1350653400000000LL, 1350653400000123LL, -1, 0x0102030405060708LL };
+  tracehdr out;
+
+  buf[TRACEHDR_SIZE] = 'x';
+  fail_unless (buf + TRACEHDR_SIZE == tracehdr_put(buf, &t), NULL);
+  fail_unless (tracehdr_is_frame(buf, sizeof(buf)), NULL);
+  fail_unless (!tracehdr_is_frame(buf, TRACEHDR_SIZE - 1), NULL);
+  tracehdr_get(buf, &out);
+  fail_unless (0 == memcmp(&t, &out, sizeof(t)), NULL);
+  fail_unless ('x' == buf[TRACEHDR_SIZE], NULL);
+
+  // Neither a sequence header nor a delta frame
+  fail_unless (!seqhdr_is_frame(buf, sizeof(buf)), NULL);
+  fail_unless (!qdelta_is_frame(buf, sizeof(buf)), NULL);
+  char seq[SEQHDR_SIZE];
+  seqhdr_put(seq, 1);
+  fail_unless (!tracehdr_is_frame(seq, TRACEHDR_SIZE), NULL);
+}
+END_TEST
+
+START_TEST (test_TracehdrTime)
+{
+  fail_unless (0 == tracehdr_time(1970, 1, 1, 0, 0), NULL);
+  fail_unless (-86400000000LL == tracehdr_time(1969, 12, 31, 0, 0), NULL);
+  fail_unless (11016LL * 86400000000LL == tracehdr_time(2000, 2, 29, 0, 0), NULL);
+
+  // The open, 09:30 EDT
+  fail_unless (1350653400000000LL
+               == tracehdr_time(2012, 10, 19, 34200000, -4), NULL);
+  fail_unless (1350653400001000LL
+               == tracehdr_time(2012, 10, 19, 34200001, -4), NULL);
+
+  int64_t now = tracehdr_now();
+  fail_unless (1350653400000000LL < now, NULL);
+  fail_unless (now <= tracehdr_now(), NULL);
+}
+END_TEST
+
+Suite * tracehdr_suite (void)
+{
+  Suite *s = suite_create ("Tracehdr");
+
+  TCase *tc_core = tcase_create ("core");
+  tcase_add_test (tc_core, test_TracehdrRoundTrip);
+  tcase_add_test (tc_core, test_TracehdrTime);
+  suite_add_tcase (s, tc_core);
+
+  return s;
+}
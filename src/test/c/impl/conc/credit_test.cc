@@ -0,0 +1,116 @@
+
+#include <check.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "conc/credit.h"
+
+START_TEST (test_TakeGrant)
+{
+  credit *c = credit_init();
+
+  // Closed counters don't limit
+  fail_unless (CREDIT_CLOSED == credit_take(c), NULL);
+
+  credit_open(c, 2);
+  fail_unless (CREDIT_TAKEN == credit_take(c), NULL);
+  fail_unless (CREDIT_TAKEN == credit_take(c), NULL);
+  fail_unless (CREDIT_EMPTY == credit_take(c), NULL);
+
+  credit_grant(c, 1);
+  fail_unless (CREDIT_TAKEN == credit_wait(c), NULL);
+  fail_unless (CREDIT_EMPTY == credit_take(c), NULL);
+
+  credit_close(c);
+  fail_unless (CREDIT_CLOSED == credit_wait(c), NULL);
+
+  credit_destroy(c);
+}
+END_TEST
+
+#define CREDIT_STRESS_MESSAGES 100000
+#define CREDIT_STRESS_GRANT    7
+
+typedef struct
+{
+  credit *c;
+  long sent;                    // messages sent by the producer
+  int waited;
+} _credit_stress;
+
+static void* _credit_produce(void *obj)
+{
+  _credit_stress *s = (_credit_stress*)obj;
+
+  for(int i = 0; i < CREDIT_STRESS_MESSAGES; i++) {
+    if(CREDIT_EMPTY == credit_take(s->c)) {
+      __atomic_add_fetch(&s->waited, 1, __ATOMIC_SEQ_CST);
+      if(CREDIT_CLOSED == credit_wait(s->c)) {
+        break;
+      }
+    }
+    __atomic_add_fetch(&s->sent, 1, __ATOMIC_SEQ_CST);
+  }
+  return NULL;
+}
+
+START_TEST (test_Paced)
+{
+  _credit_stress s = { credit_init(), 0, 0 };
+  credit_open(s.c, 0);
+
+  pthread_t t;
+  pthread_create(&t, NULL, _credit_produce, &s);
+
+  // The producer never gets ahead of the credits granted
+  long granted = 0;
+  while(granted < CREDIT_STRESS_MESSAGES) {
+    fail_unless (__atomic_load_n(&s.sent, __ATOMIC_SEQ_CST) <= granted, NULL);
+    credit_grant(s.c, CREDIT_STRESS_GRANT);
+    granted += CREDIT_STRESS_GRANT;
+    while(__atomic_load_n(&s.sent, __ATOMIC_SEQ_CST) < granted - 32
+          && __atomic_load_n(&s.sent, __ATOMIC_SEQ_CST)
+             < CREDIT_STRESS_MESSAGES) {
+      sched_yield();
+    }
+  }
+  pthread_join(t, NULL);
+  fail_unless (CREDIT_STRESS_MESSAGES == s.sent, NULL);
+  fail_unless (0 < s.waited, NULL);
+
+  credit_destroy(s.c);
+}
+END_TEST
+
+START_TEST (test_CloseWakes)
+{
+  _credit_stress s = { credit_init(), 0, 0 };
+  credit_open(s.c, 10);
+
+  pthread_t t;
+  pthread_create(&t, NULL, _credit_produce, &s);
+  while(0 == __atomic_load_n(&s.waited, __ATOMIC_SEQ_CST)) {
+    sched_yield();
+  }
+
+  // Stops right after the credits are used up
+  credit_close(s.c);
+  pthread_join(t, NULL);
+  fail_unless (10 == s.sent, NULL);
+
+  credit_destroy(s.c);
+}
+END_TEST
+
+Suite * credit_suite (void)
+{
+  Suite *s = suite_create ("Credit");
+
+  TCase *tc_core = tcase_create ("core");
+  tcase_add_test (tc_core, test_TakeGrant);
+  tcase_add_test (tc_core, test_Paced);
+  tcase_add_test (tc_core, test_CloseWakes);
+  suite_add_tcase (s, tc_core);
+
+  return s;
+}
@@ -0,0 +1,192 @@
+/*
+ * Micro-benchmark of the queues in conc/queue.h against a ZMQ inproc
+ * PUSH/PULL pair, the hop the threads of Wineing use today. Run with
+ * 'make perf'.
+ *
+ * Each case hands QUEUE_BENCH_ELEMENTS pointers from producer to
+ * consumer threads and reports the throughput and the wall time per
+ * element. Numbers depend heavily on whether the threads share a
+ * core, pin them with taskset for stable results.
+ */
+
+#include "conc/queue.h"
+#include "net/chan.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define QUEUE_BENCH_ELEMENTS  10000000
+#define QUEUE_BENCH_CAPACITY  4096
+#define QUEUE_BENCH_ZMQ_NAME  "inproc://queue.bench"
+
+typedef struct
+{
+  spscq *spsc;
+  mpmcq *mpmc;
+  chan *zmq;
+  size_t batch;
+  uintptr_t count;        // elements pushed or popped by the thread
+} _bench;
+
+static double _now()
+{
+  timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+static void* _produce(void *obj)
+{
+  _bench *b = (_bench*)obj;
+  void *e[64];
+  uintptr_t next = 1;
+
+  while(next <= b->count) {
+    size_t n = 0;
+    while(n < b->batch && next + n <= b->count) {
+      e[n] = (void*)(next + n);
+      n++;
+    }
+    size_t pushed = NULL != b->spsc ?
+      spscq_push_n(b->spsc, e, n) : mpmcq_push_n(b->mpmc, e, n);
+    if(0 == pushed) {
+      sched_yield();
+    }
+    next += pushed;
+  }
+  return NULL;
+}
+
+static void* _consume(void *obj)
+{
+  _bench *b = (_bench*)obj;
+  void *e[64];
+  uintptr_t popped = 0;
+
+  while(popped < b->count) {
+    size_t n = NULL != b->spsc ?
+      spscq_pop_n(b->spsc, e, b->batch) : mpmcq_pop_n(b->mpmc, e, b->batch);
+    if(0 == n) {
+      sched_yield();
+    }
+    popped += n;
+  }
+  return NULL;
+}
+
+static void* _zmq_produce(void *obj)
+{
+  _bench *b = (_bench*)obj;
+  for(uintptr_t i = 0; i < b->count; i++) {
+    void *e = (void*)(i + 1);
+    zmq_msg_t m;
+    zmq_msg_init_size(&m, sizeof(e));
+    *(void**)zmq_msg_data(&m) = e;
+    zmq_send(b->zmq->sock, &m, 0);
+    zmq_msg_close(&m);
+  }
+  return NULL;
+}
+
+static int _zmq_recv(void *data, size_t size, void *obj)
+{
+  return 0;
+}
+
+static void* _zmq_consume(void *obj)
+{
+  _bench *b = (_bench*)obj;
+  for(uintptr_t i = 0; i < b->count; i++) {
+    chan_recv(b->zmq, _zmq_recv, NULL);
+  }
+  return NULL;
+}
+
+static void _report(const char *name, double seconds, uintptr_t elements)
+{
+  printf("%-28s %10.2f M/s %8.1f ns/element\n",
+         name,
+         elements / seconds / 1e6,
+         seconds * 1e9 / elements);
+}
+
+/**
+ * Runs *producers* and *consumers* threads on a fresh queue. The
+ * element count is split evenly among them.
+ */
+static void _run(const char *name,
+                 int mpmc,
+                 int producers,
+                 int consumers,
+                 size_t batch)
+{
+  spscq *spsc = mpmc ? NULL : spscq_init(QUEUE_BENCH_CAPACITY);
+  mpmcq *q = mpmc ? mpmcq_init(QUEUE_BENCH_CAPACITY) : NULL;
+  _bench p = { spsc, q, NULL, batch,
+               (uintptr_t)QUEUE_BENCH_ELEMENTS / producers };
+  _bench c = { spsc, q, NULL, batch,
+               p.count * producers / consumers };
+  pthread_t t[16];
+
+  double start = _now();
+  for(int i = 0; i < consumers; i++) {
+    pthread_create(&t[i], NULL, _consume, &c);
+  }
+  for(int i = 0; i < producers; i++) {
+    pthread_create(&t[consumers + i], NULL, _produce, &p);
+  }
+  for(int i = 0; i < consumers + producers; i++) {
+    pthread_join(t[i], NULL);
+  }
+  _report(name, _now() - start, p.count * producers);
+
+  if(NULL != spsc) {
+    spscq_destroy(spsc);
+  }
+  if(NULL != q) {
+    mpmcq_destroy(q);
+  }
+}
+
+static void _run_zmq()
+{
+  _bench c = { NULL, NULL, chan_init(QUEUE_BENCH_ZMQ_NAME, CHAN_TYPE_PULL_BIND),
+               1, QUEUE_BENCH_ELEMENTS / 10 };
+  _bench p = c;
+  p.zmq = chan_init(QUEUE_BENCH_ZMQ_NAME, CHAN_TYPE_PUSH_CONNECT);
+  pthread_t pt, ct;
+
+  if(0 > chan_bind(c.zmq) || 0 > chan_bind(p.zmq)) {
+    printf("Failed binding %s. Error [%s]\n",
+           QUEUE_BENCH_ZMQ_NAME,
+           chan_error());
+    return;
+  }
+
+  double start = _now();
+  pthread_create(&ct, NULL, _zmq_consume, &c);
+  pthread_create(&pt, NULL, _zmq_produce, &p);
+  pthread_join(pt, NULL);
+  pthread_join(ct, NULL);
+  _report("zmq inproc push/pull", _now() - start, c.count);
+
+  chan_destroy(p.zmq);
+  chan_destroy(c.zmq);
+}
+
+int main(int argc, char **argv)
+{
+  _run("spsc", 0, 1, 1, 1);
+  _run("spsc batch 32", 0, 1, 1, 32);
+  _run("mpmc 1p/1c", 1, 1, 1, 1);
+  _run("mpmc 1p/1c batch 32", 1, 1, 1, 32);
+  _run("mpmc 4p/1c", 1, 4, 1, 1);
+  _run("mpmc 4p/4c", 1, 4, 4, 1);
+  _run("mpmc 4p/4c batch 32", 1, 4, 4, 32);
+  _run_zmq();
+  return 0;
+}
@@ -0,0 +1,237 @@
+
+#include <check.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+
+#include "conc/queue.h"
+
+START_TEST (test_SpscFifo)
+{
+  spscq *q = spscq_init(3);
+  fail_unless (4 == spscq_capacity(q), NULL);
+  fail_unless (NULL == spscq_pop(q), NULL);
+
+  for(uintptr_t i = 1; i <= 4; i++) {
+    fail_unless (0 == spscq_push(q, (void*)i), NULL);
+  }
+  fail_unless (-1 == spscq_push(q, (void*)5), NULL);
+
+  fail_unless ((void*)1 == spscq_pop(q), NULL);
+  fail_unless (0 == spscq_push(q, (void*)5), NULL);
+  for(uintptr_t i = 2; i <= 5; i++) {
+    fail_unless ((void*)i == spscq_pop(q), NULL);
+  }
+  fail_unless (NULL == spscq_pop(q), NULL);
+
+  spscq_destroy(q);
+}
+END_TEST
+
+START_TEST (test_SpscBatch)
+{
+  spscq *q = spscq_init(8);
+  void *in[12];
+  void *out[12];
+  for(uintptr_t i = 0; i < 12; i++) {
+    in[i] = (void*)(i + 1);
+  }
+
+  // Partial push if the batch doesn't fit
+  fail_unless (5 == spscq_push_n(q, in, 5), NULL);
+  fail_unless (3 == spscq_push_n(q, &in[5], 7), NULL);
+  fail_unless (0 == spscq_push_n(q, &in[8], 4), NULL);
+
+  fail_unless (6 == spscq_pop_n(q, out, 6), NULL);
+  fail_unless (2 == spscq_pop_n(q, &out[6], 6), NULL);
+  fail_unless (0 == spscq_pop_n(q, out, 1), NULL);
+  for(int i = 0; i < 8; i++) {
+    fail_unless (in[i] == out[i], NULL);
+  }
+
+  // Wraps around
+  fail_unless (4 == spscq_push_n(q, &in[8], 4), NULL);
+  fail_unless (4 == spscq_pop_n(q, out, 8), NULL);
+  fail_unless (in[11] == out[3], NULL);
+
+  spscq_destroy(q);
+}
+END_TEST
+
+START_TEST (test_MpmcFifo)
+{
+  mpmcq *q = mpmcq_init(4);
+  void *in[6] = { (void*)1, (void*)2, (void*)3, (void*)4, (void*)5, (void*)6 };
+  void *out[6];
+
+  fail_unless (NULL == mpmcq_pop(q), NULL);
+  fail_unless (3 == mpmcq_push_n(q, in, 3), NULL);
+  fail_unless (1 == mpmcq_push_n(q, &in[3], 3), NULL);
+  fail_unless (-1 == mpmcq_push(q, in[4]), NULL);
+
+  fail_unless (2 == mpmcq_pop_n(q, out, 2), NULL);
+  fail_unless (2 == mpmcq_push_n(q, &in[4], 2), NULL);
+  fail_unless (4 == mpmcq_pop_n(q, &out[2], 6), NULL);
+  for(int i = 0; i < 6; i++) {
+    fail_unless (in[i] == out[i], NULL);
+  }
+  fail_unless (NULL == mpmcq_pop(q), NULL);
+
+  mpmcq_destroy(q);
+}
+END_TEST
+
+#define QUEUE_STRESS_THREADS   4
+#define QUEUE_STRESS_ELEMENTS  200000
+#define QUEUE_STRESS_BATCH     7
+
+typedef struct
+{
+  spscq *spsc;
+  mpmcq *mpmc;
+  uintptr_t first;            // producers push [first, first + count)
+  uintptr_t count;
+  unsigned long long sum;     // consumers: sum of popped elements
+  uintptr_t popped;
+  volatile int *done;         // set once all producers completed
+  int ordered;                // 1 if elements must arrive in order
+} _stress;
+
+static void* _stress_produce(void *obj)
+{
+  _stress *s = (_stress*)obj;
+  void *batch[QUEUE_STRESS_BATCH];
+  uintptr_t next = s->first;
+  uintptr_t end = s->first + s->count;
+
+  while(next < end) {
+    size_t n = 0;
+    while(n < QUEUE_STRESS_BATCH && next + n < end) {
+      batch[n] = (void*)(next + n);
+      n++;
+    }
+    size_t pushed = NULL != s->spsc ?
+      spscq_push_n(s->spsc, batch, n) :
+      mpmcq_push_n(s->mpmc, batch, n);
+    next += pushed;
+    if(0 == pushed) {
+      sched_yield();
+    }
+  }
+  return NULL;
+}
+
+static void* _stress_consume(void *obj)
+{
+  _stress *s = (_stress*)obj;
+  void *batch[QUEUE_STRESS_BATCH];
+  uintptr_t last = 0;
+
+  for(;;) {
+    int done = __atomic_load_n(s->done, __ATOMIC_ACQUIRE);
+    size_t n = NULL != s->spsc ?
+      spscq_pop_n(s->spsc, batch, QUEUE_STRESS_BATCH) :
+      mpmcq_pop_n(s->mpmc, batch, QUEUE_STRESS_BATCH);
+    if(0 == n) {
+      if(done) {
+        break;
+      }
+      sched_yield();
+      continue;
+    }
+    for(size_t i = 0; i < n; i++) {
+      uintptr_t e = (uintptr_t)batch[i];
+      if(s->ordered && e != last + 1) {
+        s->ordered = -1;
+      }
+      last = e;
+      s->sum += e;
+    }
+    s->popped += n;
+  }
+  return NULL;
+}
+
+START_TEST (test_SpscStress)
+{
+  volatile int done = 0;
+  _stress p = { spscq_init(64), NULL, 1, QUEUE_STRESS_ELEMENTS, 0, 0, &done, 0 };
+  _stress c = p;
+  c.ordered = 1;
+  pthread_t pt, ct;
+
+  pthread_create(&ct, NULL, _stress_consume, &c);
+  pthread_create(&pt, NULL, _stress_produce, &p);
+  pthread_join(pt, NULL);
+  __atomic_store_n(&done, 1, __ATOMIC_RELEASE);
+  pthread_join(ct, NULL);
+
+  unsigned long long n = QUEUE_STRESS_ELEMENTS;
+  fail_unless (1 == c.ordered, NULL);
+  fail_unless (n == c.popped, NULL);
+  fail_unless (n * (n + 1) / 2 == c.sum, NULL);
+
+  spscq_destroy(p.spsc);
+}
+END_TEST
+
+START_TEST (test_MpmcStress)
+{
+  volatile int done = 0;
+  mpmcq *q = mpmcq_init(64);
+  _stress p[QUEUE_STRESS_THREADS];
+  _stress c[QUEUE_STRESS_THREADS];
+  pthread_t pt[QUEUE_STRESS_THREADS];
+  pthread_t ct[QUEUE_STRESS_THREADS];
+
+  for(int i = 0; i < QUEUE_STRESS_THREADS; i++) {
+    _stress s = { NULL, q, 1 + (uintptr_t)i * QUEUE_STRESS_ELEMENTS,
+                  QUEUE_STRESS_ELEMENTS, 0, 0, &done, 0 };
+    p[i] = s;
+    c[i] = s;
+    pthread_create(&ct[i], NULL, _stress_consume, &c[i]);
+  }
+  for(int i = 0; i < QUEUE_STRESS_THREADS; i++) {
+    pthread_create(&pt[i], NULL, _stress_produce, &p[i]);
+  }
+  for(int i = 0; i < QUEUE_STRESS_THREADS; i++) {
+    pthread_join(pt[i], NULL);
+  }
+  __atomic_store_n(&done, 1, __ATOMIC_RELEASE);
+
+  unsigned long long popped = 0;
+  unsigned long long sum = 0;
+  for(int i = 0; i < QUEUE_STRESS_THREADS; i++) {
+    pthread_join(ct[i], NULL);
+    popped += c[i].popped;
+    sum += c[i].sum;
+  }
+
+  // Every element exactly once
+  unsigned long long n = (unsigned long long)QUEUE_STRESS_THREADS
+    * QUEUE_STRESS_ELEMENTS;
+  fail_unless (n == popped, NULL);
+  fail_unless (n * (n + 1) / 2 == sum, NULL);
+
+  mpmcq_destroy(q);
+}
+END_TEST
+
+Suite * queue_suite (void)
+{
+  Suite *s = suite_create ("Queue");
+
+  TCase *tc_core = tcase_create ("core");
+  tcase_add_test (tc_core, test_SpscFifo);
+  tcase_add_test (tc_core, test_SpscBatch);
+  tcase_add_test (tc_core, test_MpmcFifo);
+  suite_add_tcase (s, tc_core);
+
+  TCase *tc_stress = tcase_create ("stress");
+  tcase_set_timeout (tc_stress, 60);
+  tcase_add_test (tc_stress, test_SpscStress);
+  tcase_add_test (tc_stress, test_MpmcStress);
+  suite_add_tcase (s, tc_stress);
+
+  return s;
+}
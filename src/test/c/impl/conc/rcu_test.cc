@@ -0,0 +1,126 @@
+
+#include <check.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "conc/rcu.h"
+
+START_TEST (test_Publish)
+{
+  rcu r;
+  int a = 1;
+  int b = 2;
+  rcu_init(&r, &a);
+
+  int slot = rcu_register(&r);
+  fail_unless (0 == slot, NULL);
+  fail_unless (&a == rcu_deref(&r), NULL);
+
+  // Offline readers are not waited for
+  rcu_offline(&r, slot);
+  fail_unless (&a == rcu_publish(&r, &b), NULL);
+  rcu_synchronize(&r);
+
+  rcu_online(&r, slot);
+  fail_unless (&b == rcu_deref(&r), NULL);
+  rcu_quiescent(&r, slot);
+  fail_unless (&b == rcu_deref(&r), NULL);
+}
+END_TEST
+
+START_TEST (test_Register)
+{
+  rcu r;
+  rcu_init(&r, NULL);
+
+  for(int i = 0; i < RCU_MAX_READERS; i++) {
+    fail_unless (i == rcu_register(&r), NULL);
+  }
+  fail_unless (-1 == rcu_register(&r), NULL);
+}
+END_TEST
+
+#define RCU_STRESS_VERSIONS 1024
+
+/**
+ * \struct
+ *
+ * Data published by the stress test. *valid* is cleared before it is
+ * reused.
+ */
+typedef struct
+{
+  int valid;
+  int version;
+} _rcu_data;
+
+typedef struct
+{
+  rcu *r;
+  int done;
+  int failed;
+} _rcu_stress;
+
+static void* _rcu_read(void *obj)
+{
+  _rcu_stress *s = (_rcu_stress*)obj;
+  int slot = rcu_register(s->r);
+  int last = 0;
+
+  while(!__atomic_load_n(&s->done, __ATOMIC_ACQUIRE)) {
+    rcu_quiescent(s->r, slot);
+    const _rcu_data *d = (const _rcu_data*)rcu_deref(s->r);
+    if(1 != d->valid || d->version < last) {
+      s->failed++;
+    }
+    last = d->version;
+    sched_yield();
+  }
+  rcu_offline(s->r, slot);
+  return NULL;
+}
+
+START_TEST (test_Stress)
+{
+  rcu r;
+  _rcu_data data[2] = { { 1, 0 }, { 0, 0 } };
+  _rcu_stress s[2] = { { &r, 0, 0 }, { &r, 0, 0 } };
+  rcu_init(&r, &data[0]);
+
+  pthread_t t[2];
+  for(int i = 0; i < 2; i++) {
+    pthread_create(&t[i], NULL, _rcu_read, &s[i]);
+  }
+
+  // Two buffers only, a reader still holding the old one would see it
+  // invalidated
+  for(int v = 1; v <= RCU_STRESS_VERSIONS; v++) {
+    _rcu_data *next = &data[v % 2];
+    next->version = v;
+    __atomic_store_n(&next->valid, 1, __ATOMIC_RELEASE);
+
+    _rcu_data *old = (_rcu_data*)rcu_publish(&r, next);
+    rcu_synchronize(&r);
+    old->valid = 0;
+  }
+
+  for(int i = 0; i < 2; i++) {
+    __atomic_store_n(&s[i].done, 1, __ATOMIC_RELEASE);
+    pthread_join(t[i], NULL);
+    fail_unless (0 == s[i].failed, NULL);
+  }
+}
+END_TEST
+
+Suite * rcu_suite (void)
+{
+  Suite *s = suite_create ("Rcu");
+
+  TCase *tc_core = tcase_create ("core");
+  tcase_add_test (tc_core, test_Publish);
+  tcase_add_test (tc_core, test_Register);
+  tcase_add_test (tc_core, test_Stress);
+  suite_add_tcase (s, tc_core);
+
+  return s;
+}
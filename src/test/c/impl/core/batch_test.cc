@@ -0,0 +1,89 @@
+#include <check.h>
+
+#include "core/batch.h"
+#include "core/reply.h"
+
+START_TEST (test_AddNext)
+{
+  w_batch *b = batch_init(1, "C:\\journal\\", 4);
+  char name[16];
+
+  // Grows past the initial capacity
+  for(int i = 0; i < 40; i++) {
+    snprintf(name, sizeof(name), "tape%d", i);
+    batch_add(name, b);
+  }
+  fail_unless (40 == b->size, NULL);
+  fail_unless (0 == strcmp("tape39", b->tapes[39]), NULL);
+
+  for(int i = 0; i < 40; i++) {
+    fail_unless (i == batch_next(b), NULL);
+  }
+  fail_unless (-1 == batch_next(b), NULL);
+  fail_unless (-1 == batch_next(b), NULL);
+
+  batch_destroy(b);
+}
+END_TEST
+
+START_TEST (test_JournalPath)
+{
+  w_batch *b = batch_init(1, "C:\\journal\\", 0);
+  char path[32];
+
+  fail_unless (1 == b->workers, NULL);
+
+  batch_add("C:\\md\\20121012.GS.nx2", b);
+  batch_add("20121015.GS.nx2", b);
+
+  fail_unless (0 == batch_journal_path(b, 0, path, sizeof(path)), NULL);
+  fail_unless (0 == strcmp("C:\\journal\\20121012.GS.nx2.wj", path), NULL);
+  fail_unless (0 == batch_journal_path(b, 1, path, sizeof(path)), NULL);
+  fail_unless (0 == strcmp("C:\\journal\\20121015.GS.nx2.wj", path), NULL);
+
+  // Too small, including the NULL byte
+  fail_unless (-1 == batch_journal_path(b, 0, path, 29), NULL);
+  fail_unless (0 == batch_journal_path(b, 0, path, 30), NULL);
+
+  batch_destroy(b);
+}
+END_TEST
+
+START_TEST (test_StartStop)
+{
+  fail_unless (0 == reply_init(4, 64), NULL);
+
+  w_batch *b = batch_init(1, "/tmp/", 2);
+  batch_add("tape0", b);
+  batch_add("tape1", b);
+  fail_unless (0 == batch_start(b), NULL);
+  batch_stop();
+
+  // Joined, the next batch starts
+  b = batch_init(2, "/tmp/", 2);
+  batch_add("tape0", b);
+  fail_unless (0 == batch_start(b), NULL);
+  batch_stop();
+
+  // Stopped, nothing is claimed
+  b = batch_init(3, "/tmp/", 1);
+  batch_add("tape0", b);
+  fail_unless (-1 == batch_next(b), NULL);
+  batch_destroy(b);
+
+  reply_destroy();
+}
+END_TEST
+
+Suite * batch_suite (void)
+{
+  Suite *s = suite_create ("Batch");
+
+  TCase *tc_core = tcase_create ("core");
+  tcase_add_test (tc_core, test_AddNext);
+  tcase_add_test (tc_core, test_JournalPath);
+  tcase_add_test (tc_core, test_StartStop);
+  suite_add_tcase (s, tc_core);
+
+  return s;
+}
@@ -0,0 +1,207 @@
+#include <check.h>
+
+#include "core/checkpoint.h"
+#include "core/embed.h"
+#include "sym/symtab.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define CHECKPOINT_TEST_SYMBOLS  64
+#define CHECKPOINT_TEST_MESSAGES 5000
+
+/**
+ * \struct
+ *
+ * The live directory the synthetic feed is interned into.
+ */
+typedef struct
+{
+  symtab *syms;
+  unsigned long added;
+  unsigned long mismatched;     // ids differing from the feed's
+} _ckpt_feed;
+
+static void _ckpt_symbol(const embed_symbol *s, void *obj)
+{
+  _ckpt_feed *f = (_ckpt_feed*)obj;
+  int added = 0;
+  unsigned int id = symtab_intern(f->syms, s->name, s->exg, &added);
+  f->added += added;
+  f->mismatched += id != s->symbol_id;
+}
+
+static void _ckpt_feed_run(_ckpt_feed *f)
+{
+  embed_handlers h;
+  memset(&h, 0, sizeof(h));
+  h.symbol = _ckpt_symbol;
+  h.obj = f;
+  embed *e = embed_init(&h, EMBED_DIRECT, 0);
+  fail_unless (NULL != e, NULL);
+  embed_synthetic(e, CHECKPOINT_TEST_SYMBOLS, CHECKPOINT_TEST_MESSAGES);
+  embed_destroy(e);
+}
+
+/**
+ * Takes a checkpoint of *syms* the way the live tape does, NxCore's
+ * state being a file written in its place.
+ */
+static int _ckpt_take(checkpoint *c, const symtab *syms, uint32_t clock)
+{
+  char path[CHECKPOINT_PATH_SIZE];
+  int slot = checkpoint_begin(c);
+  fail_unless (0 <= slot, NULL);
+  fail_unless (0 == checkpoint_path(c, slot, CHECKPOINT_NXCORE_SUFFIX,
+                                    path, sizeof(path)), NULL);
+  FILE *f = fopen(path, "wb");
+  fail_unless (NULL != f, NULL);
+  fwrite("state", 1, 5, f);
+  fclose(f);
+  fail_unless (0 == checkpoint_submit(c, slot, syms, clock, clock + 1), NULL);
+  return slot;
+}
+
+static void _ckpt_dir(char *dir, size_t size)
+{
+  snprintf(dir, size, "/tmp/wineing_checkpoint_%d/", getpid());
+  mkdir(dir, 0700);
+}
+
+static void _ckpt_clean(const char *dir)
+{
+  char path[CHECKPOINT_PATH_SIZE];
+  const char *suffixes[] = { CHECKPOINT_NXCORE_SUFFIX, CHECKPOINT_SYMS_SUFFIX };
+  for(int slot = 0; slot < CHECKPOINT_SLOTS; slot++) {
+    for(int i = 0; i < 2; i++) {
+      snprintf(path, sizeof(path), "%stest.%d%s", dir, slot, suffixes[i]);
+      unlink(path);
+    }
+  }
+  snprintf(path, sizeof(path), "%stest.ckpt", dir);
+  unlink(path);
+  rmdir(dir);
+}
+
+START_TEST (test_CheckpointRestart)
+{
+  char dir[64];
+  _ckpt_dir(dir, sizeof(dir));
+
+  // The first run of the day
+  _ckpt_feed live = { symtab_init(16), 0, 0 };
+  _ckpt_feed_run(&live);
+  fail_unless (CHECKPOINT_TEST_SYMBOLS == live.added, NULL);
+  fail_unless (0 == symtab_remove(live.syms, 5), NULL);
+
+  checkpoint *c = checkpoint_init(dir, "test");
+  fail_unless (NULL != c, NULL);
+  fail_unless (-1 == c->slot, NULL);
+  fail_unless (-1 == checkpoint_latest(c, time(NULL)), NULL);
+  fail_unless (0 == _ckpt_take(c, live.syms, 34200000), NULL);
+  checkpoint_destroy(c);
+  symtab_destroy(live.syms);
+
+  // The restart finds and restores it
+  c = checkpoint_init(dir, "test");
+  fail_unless (0 == c->slot, NULL);
+  fail_unless (0 == checkpoint_latest(c, time(NULL)), NULL);
+
+  _ckpt_feed restarted = { symtab_init(16), 0, 0 };
+  uint64_t seq = 0;
+  fail_unless (34200000 == checkpoint_restore(c, 0, restarted.syms, &seq), NULL);
+  fail_unless (34200001 == seq, NULL);
+  fail_unless (CHECKPOINT_TEST_SYMBOLS == restarted.syms->size, NULL);
+  fail_unless (SYMTAB_FLAG_DELETED & symtab_get(restarted.syms, 5)->flags, NULL);
+  fail_unless (SYMTAB_NONE == symtab_find(restarted.syms, "eSYN5", 1), NULL);
+  fail_unless (4 == symtab_find(restarted.syms, "eSYN4", 1), NULL);
+
+  // Not into a table in use
+  fail_unless (-1 == checkpoint_restore(c, 0, restarted.syms, &seq), NULL);
+
+  // The feed continues with the ids it had, only the deleted symbol is
+  // new
+  _ckpt_feed_run(&restarted);
+  fail_unless (1 == restarted.added, NULL);
+  fail_unless (1 == restarted.mismatched, NULL);
+
+  // Tapes are per day
+  fail_unless (-1 == checkpoint_latest(c, time(NULL) + 86400), NULL);
+
+  checkpoint_destroy(c);
+  symtab_destroy(restarted.syms);
+  _ckpt_clean(dir);
+}
+END_TEST
+
+START_TEST (test_CheckpointSlots)
+{
+  char dir[64], path[CHECKPOINT_PATH_SIZE];
+  _ckpt_dir(dir, sizeof(dir));
+
+  symtab *syms = symtab_init(16);
+  symtab_intern(syms, "eSYN0", 1);
+
+  checkpoint *c = checkpoint_init(dir, "test");
+  fail_unless (0 == _ckpt_take(c, syms, 1000), NULL);
+  checkpoint_destroy(c);
+
+  // Alternating, the latest one is never overwritten
+  c = checkpoint_init(dir, "test");
+  fail_unless (1 == _ckpt_take(c, syms, 2000), NULL);
+  checkpoint_destroy(c);
+  c = checkpoint_init(dir, "test");
+  fail_unless (1 == c->slot, NULL);
+  fail_unless (0 == _ckpt_take(c, syms, 3000), NULL);
+  checkpoint_destroy(c);
+
+  // NxCore's state missing, the manifest keeps the previous slot
+  c = checkpoint_init(dir, "test");
+  fail_unless (1 == checkpoint_begin(c), NULL);
+  fail_unless (0 == checkpoint_path(c, 1, CHECKPOINT_NXCORE_SUFFIX,
+                                    path, sizeof(path)), NULL);
+  unlink(path);
+  fail_unless (0 == checkpoint_submit(c, 1, syms, 4000, 4001), NULL);
+  checkpoint_destroy(c);
+  c = checkpoint_init(dir, "test");
+  fail_unless (0 == checkpoint_latest(c, time(NULL)), NULL);
+
+  // A truncated directory fails to restore
+  uint64_t seq = 0;
+  fail_unless (0 == checkpoint_path(c, 0, CHECKPOINT_SYMS_SUFFIX,
+                                    path, sizeof(path)), NULL);
+  fail_unless (0 == truncate(path, sizeof(checkpoint_header) + 1), NULL);
+  symtab *restored = symtab_init(16);
+  fail_unless (-1 == checkpoint_restore(c, 0, restored, &seq), NULL);
+  symtab_destroy(restored);
+
+  // As does one of another slot
+  fail_unless (0 == checkpoint_path(c, 1, CHECKPOINT_SYMS_SUFFIX,
+                                    path, sizeof(path)), NULL);
+  char other[CHECKPOINT_PATH_SIZE];
+  fail_unless (0 == checkpoint_path(c, 0, CHECKPOINT_SYMS_SUFFIX,
+                                    other, sizeof(other)), NULL);
+  fail_unless (0 == rename(path, other), NULL);
+  restored = symtab_init(16);
+  fail_unless (-1 == checkpoint_restore(c, 0, restored, &seq), NULL);
+  symtab_destroy(restored);
+
+  checkpoint_destroy(c);
+  symtab_destroy(syms);
+  _ckpt_clean(dir);
+}
+END_TEST
+
+Suite * checkpoint_suite (void)
+{
+  Suite *s = suite_create ("Checkpoint");
+
+  TCase *tc_core = tcase_create ("core");
+  tcase_add_test (tc_core, test_CheckpointRestart);
+  tcase_add_test (tc_core, test_CheckpointSlots);
+  suite_add_tcase (s, tc_core);
+
+  return s;
+}
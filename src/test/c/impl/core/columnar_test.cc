@@ -0,0 +1,62 @@
+#include <check.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "core/wineing.h"
+#include "store/coltab.h"
+
+START_TEST (test_ColumnarDirectory)
+{
+  char dir[64], path[128];
+  snprintf(dir, sizeof(dir), "/tmp/wineing_columnar_%d/", getpid());
+  fail_unless (0 == mkdir(dir, 0700), NULL);
+  snprintf(path, sizeof(path), "%s20121019.GS.nx2", dir);
+  FILE *f = fopen(path, "wb");
+  fail_unless (NULL != f, NULL);
+  fclose(f);
+
+  // Nothing but the tape and columnar directories, the market data
+  // thread never ran
+  w_conf conf;
+  memset(&conf, 0, sizeof(conf));
+  conf.tape_basedir = dir;
+  conf.columnar_dir = dir;
+  conf.columnar_tape = "*.nx2";
+  w_ctx ctx;
+  memset(&ctx, 0, sizeof(ctx));
+  ctx.conf = &conf;
+  fail_unless (0 == wineing_columnar(ctx), NULL);
+
+  // The stub's symbol is in the index
+  snprintf(path, sizeof(path), "%s20121019.GS.nx2.trade.idx", dir);
+  f = fopen(path, "rb");
+  fail_unless (NULL != f, NULL);
+  coltab_index_header h;
+  coltab_index_entry e;
+  fail_unless (1 == fread(&h, sizeof(h), 1, f), NULL);
+  fail_unless (1 == fread(&e, sizeof(e), 1, f), NULL);
+  fclose(f);
+  fail_unless (1 == h.symbols && 1 == h.rows, NULL);
+  fail_unless (0 == strcmp("eSYN", e.name) && 1 == e.rows, NULL);
+
+  conf.columnar_tape = "missing.nx2";
+  fail_unless (-1 == wineing_columnar(ctx), NULL);
+
+  char cmd[96];
+  snprintf(cmd, sizeof(cmd), "rm -rf %s", dir);
+  fail_unless (0 == system(cmd), NULL);
+}
+END_TEST
+
+Suite * columnar_suite (void)
+{
+  Suite *s = suite_create ("Columnar");
+
+  TCase *tc_core = tcase_create ("core");
+  tcase_add_test (tc_core, test_ColumnarDirectory);
+  suite_add_tcase (s, tc_core);
+
+  return s;
+}
@@ -0,0 +1,347 @@
+/*
+ * Load generator for the control channel. Run with 'make perf' or
+ * directly:
+ *
+ *   ctrl.bench [-c clients] [-n requests] [-p depth] [-x]
+ *              [-i cchan_in] [-o cchan_out]
+ *
+ * Each of the *clients* threads pushes *requests* Requests on
+ * cchan_in, alternating MARKET_START and MARKET_STOP, keeping up to
+ * *depth* of them outstanding. A single thread subscribed to cchan_out
+ * matches the Responses to their Requests by id and records the round
+ * trip. Reports the throughput and the latency distribution.
+ *
+ * By default Wineing runs in-process with the Linux stubs of NxCore,
+ * i.e. the whole control path (cchan_in_thread, core/reply.h,
+ * cchan_out_thread) and a market_thread spinning on the stubbed tape
+ * are exercised. With -x the Requests go to an external instance, by
+ * default the one on localhost's default ports. Responses lost (e.g.
+ * dropped by the PUB socket) are counted rather than waited for.
+ */
+
+#include "core/wineing.h"
+#include "log/logging.h"
+#include "net/chan.h"
+
+#include "gen/WineingCtrlProto.pb.h"
+
+#include <algorithm>
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#define CTRL_BENCH_CLIENTS       8
+#define CTRL_BENCH_REQUESTS      10000
+#define CTRL_BENCH_DEPTH         16
+#define CTRL_BENCH_CCHAN_IN      "tcp://127.0.0.1:19990"
+#define CTRL_BENCH_CCHAN_OUT     "tcp://127.0.0.1:19991"
+#define CTRL_BENCH_MCHAN         "tcp://127.0.0.1:19992"
+#define CTRL_BENCH_EXT_CCHAN_IN  "tcp://127.0.0.1:9990"
+#define CTRL_BENCH_EXT_CCHAN_OUT "tcp://127.0.0.1:9991"
+#define CTRL_BENCH_PROBE_MS      100   // interval of the readiness probes
+#define CTRL_BENCH_READY_MS      10000 // give up if Wineing doesn't respond
+#define CTRL_BENCH_IDLE_MS       5000  // count the rest lost if idle
+
+/**
+ * \struct
+ *
+ * State of a client thread. Request ids are the client's index in the
+ * upper and the sequence number in the lower 32 bits.
+ */
+typedef struct
+{
+  const char *fqcn;
+  unsigned long long client;
+  unsigned int requests;
+  unsigned int depth;
+  uint64_t *sent;               // ns, indexed by sequence number
+  uint64_t *latency;            // ns, 0 until the Response arrived
+  unsigned int volatile received;
+} _client;
+
+static uint64_t _now()
+{
+  timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (uint64_t)t.tv_sec * 1000000000 + t.tv_nsec;
+}
+
+static inline void _send_free(void *buffer, void *hint)
+{
+  delete [] (char*)buffer;
+}
+
+/**
+ * Serializes and sends a Request.
+ */
+static int _send(chan *c, long long id, WineingCtrlProto::Request::Type type)
+{
+  WineingCtrlProto::Request req;
+  req.set_requestid(id);
+  req.set_type(type);
+
+  int size = req.ByteSize();
+  char *buffer = new char[size];
+  req.SerializeWithCachedSizesToArray((google::protobuf::uint8*)buffer);
+  return chan_send(c, buffer, size, _send_free);
+}
+
+/**
+ * Used by *chan_recv*, extracts the request id of a Response.
+ */
+static int _recv_id(void *data, size_t size, void *obj)
+{
+  WineingCtrlProto::Response res;
+  if(!res.ParseFromArray(data, size)) {
+    return -1;
+  }
+  *(long long*)obj = res.requestid();
+  return 0;
+}
+
+/**
+ * \return 1 if a message is ready on *c* within *ms*, 0 otherwise
+ */
+static int _poll(chan *c, long ms)
+{
+  zmq_pollitem_t item = { c->sock, 0, ZMQ_POLLIN, 0 };
+  // zmq 2.x takes microseconds
+  return 0 < zmq_poll(&item, 1, ms * 1000) ? 1 : 0;
+}
+
+static void* _client_thread(void *obj)
+{
+  using namespace WineingCtrlProto;
+
+  _client *c = (_client*)obj;
+  chan *cchan_in = chan_init(c->fqcn, CHAN_TYPE_PUSH_CONNECT);
+  if(0 > chan_bind(cchan_in)) {
+    printf("Failed connecting %s. Error [%s]\n", c->fqcn, chan_error());
+    return NULL;
+  }
+
+  for(unsigned int seq = 0; seq < c->requests; seq++) {
+    while(seq - __atomic_load_n(&c->received, __ATOMIC_ACQUIRE) >= c->depth) {
+      sched_yield();
+    }
+    __atomic_store_n(&c->sent[seq], _now(), __ATOMIC_RELEASE);
+    _send(cchan_in,
+          (long long)(c->client << 32 | seq),
+          0 == seq % 2 ? Request::MARKET_START : Request::MARKET_STOP);
+  }
+
+  chan_destroy(cchan_in);
+  return NULL;
+}
+
+/**
+ * Sends a MARKET_STOP every CTRL_BENCH_PROBE_MS until a Response
+ * shows up on *cchan_out*. PUB/SUB drops messages until the
+ * subscription is established.
+ *
+ * \return 0 if Wineing responded, -1 otherwise
+ */
+static int _ready(chan *cchan_in, chan *cchan_out, unsigned long long probe)
+{
+  long long id;
+  for(int ms = 0; ms < CTRL_BENCH_READY_MS; ms += CTRL_BENCH_PROBE_MS) {
+    _send(cchan_in, (long long)(probe << 32),
+          WineingCtrlProto::Request::MARKET_STOP);
+    if(_poll(cchan_out, CTRL_BENCH_PROBE_MS)) {
+      chan_recv(cchan_out, _recv_id, &id);
+      return 0;
+    }
+  }
+  return -1;
+}
+
+/**
+ * Matches Responses to the clients' Requests until all arrived or
+ * none did for CTRL_BENCH_IDLE_MS.
+ *
+ * \return The number of Responses received
+ */
+static unsigned long long _receive(chan *cchan_out,
+                                   _client *clients,
+                                   unsigned int size)
+{
+  unsigned long long total = (unsigned long long)size * clients[0].requests;
+  unsigned long long received = 0;
+  long long id;
+
+  while(received < total && _poll(cchan_out, CTRL_BENCH_IDLE_MS)) {
+    if(0 > chan_recv(cchan_out, _recv_id, &id)) {
+      continue;
+    }
+    uint64_t now = _now();
+    unsigned long long client = (unsigned long long)id >> 32;
+    unsigned int seq = (unsigned int)id;
+    if(client >= size || seq >= clients[client].requests
+       || 0 != clients[client].latency[seq]) {
+      // A probe or a duplicate
+      continue;
+    }
+
+    _client *c = &clients[client];
+    c->latency[seq] = now - __atomic_load_n(&c->sent[seq], __ATOMIC_ACQUIRE);
+    __atomic_add_fetch(&c->received, 1, __ATOMIC_RELEASE);
+    received++;
+  }
+  return received;
+}
+
+static void _report(_client *clients,
+                    unsigned int size,
+                    unsigned long long received,
+                    double seconds)
+{
+  unsigned long long total = (unsigned long long)size * clients[0].requests;
+  uint64_t *all = new uint64_t[received > 0 ? received : 1];
+  unsigned long long n = 0;
+  for(unsigned int i = 0; i < size; i++) {
+    for(unsigned int seq = 0; seq < clients[i].requests; seq++) {
+      if(0 != clients[i].latency[seq]) {
+        all[n++] = clients[i].latency[seq];
+      }
+    }
+  }
+  std::sort(all, all + n);
+
+  printf("%u clients, %u requests each, depth %u\n",
+         size, clients[0].requests, clients[0].depth);
+  printf("%-12s %llu of %llu (%llu lost)\n", "responses", n, total, total - n);
+  printf("%-12s %.0f req/s\n", "throughput", n / seconds);
+  if(0 < n) {
+    const double p[] = { 0.5, 0.9, 0.99, 0.999 };
+    const char *name[] = { "p50", "p90", "p99", "p99.9" };
+    for(int i = 0; i < 4; i++) {
+      printf("%-12s %.1f us\n", name[i], all[(size_t)(p[i] * (n - 1))] / 1e3);
+    }
+    printf("%-12s %.1f us\n", "max", all[n - 1] / 1e3);
+  }
+  delete [] all;
+}
+
+static void* _wineing_thread(void *_ctx)
+{
+  wineing_run(*(w_ctx*)_ctx);
+  return NULL;
+}
+
+int main(int argc, char **argv)
+{
+  unsigned int size = CTRL_BENCH_CLIENTS;
+  unsigned int requests = CTRL_BENCH_REQUESTS;
+  unsigned int depth = CTRL_BENCH_DEPTH;
+  int external = 0;
+  const char *cchan_in_fqcn = NULL;
+  const char *cchan_out_fqcn = NULL;
+  int opt;
+
+  while(-1 != (opt = getopt(argc, argv, "c:n:p:xi:o:"))) {
+    switch(opt)
+      {
+      case 'c': size = atoi(optarg); break;
+      case 'n': requests = atoi(optarg); break;
+      case 'p': depth = atoi(optarg); break;
+      case 'x': external = 1; break;
+      case 'i': cchan_in_fqcn = optarg; break;
+      case 'o': cchan_out_fqcn = optarg; break;
+      default:
+        printf("Usage: %s [-c clients] [-n requests] [-p depth] [-x] "
+               "[-i cchan_in] [-o cchan_out]\n", argv[0]);
+        return 1;
+      }
+  }
+  if(0 == size || 0 == requests || 0 == depth) {
+    printf("clients, requests and depth must be positive\n");
+    return 1;
+  }
+  if(NULL == cchan_in_fqcn) {
+    cchan_in_fqcn = external ? CTRL_BENCH_EXT_CCHAN_IN : CTRL_BENCH_CCHAN_IN;
+  }
+  if(NULL == cchan_out_fqcn) {
+    cchan_out_fqcn = external ? CTRL_BENCH_EXT_CCHAN_OUT : CTRL_BENCH_CCHAN_OUT;
+  }
+
+  // Wineing binds the same endpoints the clients connect to
+  w_conf conf;
+  memset(&conf, 0, sizeof(conf));
+  conf.cchan_in_fqcn  = cchan_in_fqcn;
+  conf.cchan_out_fqcn = cchan_out_fqcn;
+  conf.mchan_fqcn     = CTRL_BENCH_MCHAN;
+  conf.tape_basedir   = "";
+  conf.mchan_encoding = DEFAULTS_MCHAN_ENCODING;
+  conf.batch_workers  = 1;
+  w_ctx ctx;
+  ctx.conf = &conf;
+  pthread_t wineing_t;
+
+  if(!external) {
+    wineing_init(ctx);
+    pthread_create(&wineing_t, NULL, _wineing_thread, &ctx);
+  }
+
+  chan *cchan_in = chan_init(cchan_in_fqcn, CHAN_TYPE_PUSH_CONNECT);
+  chan *cchan_out = chan_init(cchan_out_fqcn, CHAN_TYPE_SUB);
+  if(0 > chan_bind(cchan_in) || 0 > chan_bind(cchan_out)) {
+    printf("Failed connecting. Error [%s]\n", chan_error());
+    return 1;
+  }
+
+  if(0 > _ready(cchan_in, cchan_out, size)) {
+    // Wineing can't be told to shut down, exit takes its threads along
+    printf("No response from %s within %d ms\n",
+           cchan_in_fqcn,
+           CTRL_BENCH_READY_MS);
+    return 1;
+  }
+
+  {
+    _client *clients = new _client[size];
+    pthread_t *t = new pthread_t[size];
+    for(unsigned int i = 0; i < size; i++) {
+      _client c = { cchan_in_fqcn, i, requests, depth,
+                    new uint64_t[requests], new uint64_t[requests](), 0 };
+      clients[i] = c;
+    }
+
+    uint64_t start = _now();
+    for(unsigned int i = 0; i < size; i++) {
+      pthread_create(&t[i], NULL, _client_thread, &clients[i]);
+    }
+    unsigned long long received = _receive(cchan_out, clients, size);
+    double seconds = (_now() - start) / 1e9;
+
+    // Lost Responses leave clients waiting, release them
+    for(unsigned int i = 0; i < size; i++) {
+      __atomic_store_n(&clients[i].received, requests, __ATOMIC_RELEASE);
+      pthread_join(t[i], NULL);
+    }
+    _report(clients, size, received, seconds);
+
+    for(unsigned int i = 0; i < size; i++) {
+      delete [] clients[i].sent;
+      delete [] clients[i].latency;
+    }
+    delete [] clients;
+    delete [] t;
+  }
+
+  if(!external) {
+    _send(cchan_in, (long long)((unsigned long long)size << 32),
+          WineingCtrlProto::Request::SHUTDOWN);
+  }
+  chan_destroy(cchan_in);
+  chan_destroy(cchan_out);
+
+  if(!external) {
+    pthread_join(wineing_t, NULL);
+    wineing_shutdown(ctx);
+  }
+  return 0;
+}
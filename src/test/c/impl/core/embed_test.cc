@@ -0,0 +1,207 @@
+#include <check.h>
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+
+#include "core/embed.h"
+
+#define EMBED_TEST_SYMBOLS  16
+#define EMBED_TEST_MESSAGES 20000
+
+/**
+ * \struct
+ *
+ * Collects what the handlers saw.
+ */
+typedef struct
+{
+  unsigned long status;
+  unsigned long symbols;
+  unsigned long quotes;
+  unsigned long trades;
+  unsigned long unknown;        // trades and quotes of unseen symbols
+  unsigned long long hash;      // FNV-1a over the events in order
+  unsigned long stop_after;     // trades, 0 to never stop
+  embed *e;
+  char seen[EMBED_TEST_SYMBOLS];
+} _embed_seen;
+
+static inline void _embed_hash(_embed_seen *s, unsigned int v)
+{
+  s->hash = (s->hash ^ v) * 1099511628211ULL;
+}
+
+static void _embed_status(const embed_status *st, void *obj)
+{
+  _embed_seen *s = (_embed_seen*)obj;
+  s->status++;
+  _embed_hash(s, st->clock);
+}
+
+static void _embed_symbol(const embed_symbol *sym, void *obj)
+{
+  _embed_seen *s = (_embed_seen*)obj;
+  s->symbols++;
+  if(sym->symbol_id < EMBED_TEST_SYMBOLS
+     && 0 == strncmp("eSYN", sym->name, 4)) {
+    s->seen[sym->symbol_id] = 1;
+  }
+}
+
+static void _embed_quote(const embed_quote *q, void *obj)
+{
+  _embed_seen *s = (_embed_seen*)obj;
+  s->quotes++;
+  s->unknown += !s->seen[q->symbol_id];
+  _embed_hash(s, q->symbol_id);
+  _embed_hash(s, q->bid_price);
+  _embed_hash(s, q->ask_size);
+}
+
+static void _embed_trade(const embed_trade *t, void *obj)
+{
+  _embed_seen *s = (_embed_seen*)obj;
+  s->trades++;
+  s->unknown += !s->seen[t->symbol_id];
+  _embed_hash(s, t->symbol_id);
+  _embed_hash(s, t->price);
+  if(s->trades == s->stop_after) {
+    embed_stop(s->e);
+  }
+}
+
+static embed* _embed_init(_embed_seen *s, int mode, size_t capacity)
+{
+  memset(s, 0, sizeof(_embed_seen));
+  s->hash = 14695981039346656037ULL;
+  embed_handlers h = {
+    _embed_status, _embed_symbol, _embed_quote, _embed_trade, s
+  };
+  s->e = embed_init(&h, mode, capacity);
+  return s->e;
+}
+
+START_TEST (test_EmbedDirect)
+{
+  _embed_seen s;
+  embed *e = _embed_init(&s, EMBED_DIRECT, 0);
+
+  long n = embed_synthetic(e, EMBED_TEST_SYMBOLS, EMBED_TEST_MESSAGES);
+  fail_unless (EMBED_TEST_SYMBOLS == s.symbols, NULL);
+  fail_unless (EMBED_TEST_MESSAGES / EMBED_SYNTHETIC_STATUS_INTERVAL
+               == s.status, NULL);
+  fail_unless (EMBED_TEST_MESSAGES == s.quotes + s.trades, NULL);
+  fail_unless (0 < s.trades && s.trades < s.quotes, NULL);
+  fail_unless (0 == s.unknown, NULL);
+  fail_unless ((long)(s.symbols + s.status + s.quotes + s.trades) == n, NULL);
+
+  // Without NxCore there's nothing to run
+  fail_unless (0 == embed_run(e, "", 0), NULL);
+
+  embed_destroy(e);
+}
+END_TEST
+
+START_TEST (test_EmbedSkip)
+{
+  _embed_seen s;
+  memset(&s, 0, sizeof(s));
+  embed_handlers h = { NULL, NULL, NULL, _embed_trade, &s };
+  embed *e = embed_init(&h, EMBED_RING, 8);
+
+  fail_unless (!embed_wants(e, EMBED_QUOTE), NULL);
+  embed_event scratch;
+  fail_unless (NULL == embed_claim(e, EMBED_QUOTE, &scratch), NULL);
+
+  // Only trades are queued, the ring holds them all
+  long n = embed_synthetic(e, 4, 20);
+  fail_unless (0 < n && n <= 8, NULL);
+  fail_unless (n == (long)embed_poll(e, 100), NULL);
+  fail_unless (n == (long)s.trades, NULL);
+  fail_unless (0 == s.quotes && 0 == s.symbols && 0 == s.status, NULL);
+
+  embed_destroy(e);
+}
+END_TEST
+
+static void* _embed_produce(void *obj)
+{
+  embed *e = (embed*)obj;
+  embed_synthetic(e, EMBED_TEST_SYMBOLS, EMBED_TEST_MESSAGES);
+  return NULL;
+}
+
+START_TEST (test_EmbedRing)
+{
+  _embed_seen direct;
+  embed *e = _embed_init(&direct, EMBED_DIRECT, 0);
+  embed_synthetic(e, EMBED_TEST_SYMBOLS, EMBED_TEST_MESSAGES);
+  embed_destroy(e);
+
+  // A small ring blocks the producer over and over
+  _embed_seen ring;
+  e = _embed_init(&ring, EMBED_RING, 16);
+  pthread_t t;
+  pthread_create(&t, NULL, _embed_produce, e);
+  unsigned long total = EMBED_TEST_SYMBOLS
+    + EMBED_TEST_MESSAGES / EMBED_SYNTHETIC_STATUS_INTERVAL
+    + EMBED_TEST_MESSAGES;
+  unsigned long polled = 0;
+  while(polled < total) {
+    size_t n = embed_poll(e, 7);
+    if(0 == n) {
+      sched_yield();
+    }
+    polled += n;
+  }
+  pthread_join(t, NULL);
+
+  fail_unless (0 == embed_poll(e, 100), NULL);
+  fail_unless (direct.hash == ring.hash, NULL);
+  fail_unless (direct.quotes == ring.quotes, NULL);
+  fail_unless (0 == ring.unknown, NULL);
+
+  embed_destroy(e);
+}
+END_TEST
+
+START_TEST (test_EmbedStop)
+{
+  _embed_seen s;
+  embed *e = _embed_init(&s, EMBED_DIRECT, 0);
+  s.stop_after = 10;
+
+  embed_synthetic(e, EMBED_TEST_SYMBOLS, EMBED_TEST_MESSAGES);
+  fail_unless (10 == s.trades, NULL);
+  fail_unless (s.quotes + s.trades < EMBED_TEST_MESSAGES, NULL);
+
+  // A producer blocked on a full ring stops as well
+  embed_destroy(e);
+  e = _embed_init(&s, EMBED_RING, 4);
+  pthread_t t;
+  pthread_create(&t, NULL, _embed_produce, e);
+  while(spscq_capacity(e->ring)
+        != __atomic_load_n(&e->events, __ATOMIC_ACQUIRE)) {
+    sched_yield();
+  }
+  embed_stop(e);
+  pthread_join(t, NULL);
+  fail_unless (4 == e->events, NULL);
+
+  embed_destroy(e);
+}
+END_TEST
+
+Suite * embed_suite (void)
+{
+  Suite *s = suite_create ("Embed");
+
+  TCase *tc_core = tcase_create ("core");
+  tcase_add_test (tc_core, test_EmbedDirect);
+  tcase_add_test (tc_core, test_EmbedSkip);
+  tcase_add_test (tc_core, test_EmbedRing);
+  tcase_add_test (tc_core, test_EmbedStop);
+  suite_add_tcase (s, tc_core);
+
+  return s;
+}
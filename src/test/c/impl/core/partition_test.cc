@@ -0,0 +1,110 @@
+#include <check.h>
+#include <string.h>
+
+#include "core/partition.h"
+#include "nx/nxinf.h"
+
+START_TEST (test_PartitionFind)
+{
+  const w_partition *p = partition_find("equities");
+  fail_unless (NULL != p, NULL);
+  fail_unless (0 == strcmp("e", p->prefix), NULL);
+  fail_unless (0 != (p->nxcore_flags & WININF_NXCORE_EXCLUDE_OPRA), NULL);
+
+  p = partition_find("options");
+  fail_unless (NULL != p, NULL);
+  fail_unless (0 == (p->nxcore_flags & WININF_NXCORE_EXCLUDE_OPRA), NULL);
+
+  fail_unless (NULL == partition_find("bonds"), NULL);
+}
+END_TEST
+
+START_TEST (test_PartitionFqcn)
+{
+  char out[64];
+
+  fail_unless (0 == partition_fqcn("tcp://*:9992", 0, out, sizeof(out)), NULL);
+  fail_unless (0 == strcmp("tcp://*:10092", out), NULL);
+  fail_unless (0 == partition_fqcn("tcp://host:9990", 2, out, sizeof(out)),
+               NULL);
+  fail_unless (0 == strcmp("tcp://host:10290", out), NULL);
+  fail_unless (0 == partition_fqcn("ipc:///tmp/mchan", 1, out, sizeof(out)),
+               NULL);
+  fail_unless (0 == strcmp("ipc:///tmp/mchan.1", out), NULL);
+
+  fail_unless (-1 == partition_fqcn("tcp://*:9992", 0, out, 8), NULL);
+
+  fail_unless (0 == partition_local_fqcn("tcp://*:10090", out, sizeof(out)),
+               NULL);
+  fail_unless (0 == strcmp("tcp://127.0.0.1:10090", out), NULL);
+  fail_unless (0 == partition_local_fqcn("tcp://host:1", out, sizeof(out)),
+               NULL);
+  fail_unless (0 == strcmp("tcp://host:1", out), NULL);
+}
+END_TEST
+
+START_TEST (test_PartitionArgs)
+{
+  char ochan[] = "tcp://*:9000";
+  w_conf conf;
+  memset(&conf, 0, sizeof(conf));
+  conf.cchan_in_fqcn  = "tcp://*:9990";
+  conf.cchan_out_fqcn = "tcp://*:9991";
+  conf.mchan_fqcn     = "tcp://*:9992";
+  conf.tape_basedir   = "C:\\md\\";
+  conf.mchan_encoding = WINEING_MCHAN_ENCODING_DELTA;
+  conf.mchan_seq      = 1;
+  conf.mchan_trace    = 1000;
+  conf.bar_intervals[0] = 1000;
+  conf.bar_intervals[1] = 60000;
+  conf.bar_intervals_size = 2;
+  conf.batch_workers  = 4;
+  conf.ochan_fqcns[0] = ochan;
+  conf.ochan_size     = 1;
+  conf.greeks         = 1;
+  conf.greeks_rate    = 0.05;
+  conf.checkpoint_dir = "/var/lib/wineing/";
+  conf.checkpoint_interval = 60000;
+  conf.partitions[0]  = "equities";
+  conf.partitions[1]  = "options";
+  conf.partitions_size = 2;
+
+  std::vector<std::string> args;
+  partition_args(&conf, 1, args);
+
+  const char *expected[] = {
+    "--partition=options",
+    "--cchan-in=tcp://*:10190",
+    "--cchan-out=tcp://*:10191",
+    "--mchan=tcp://*:10192",
+    "--mchan-encoding=delta",
+    "--mchan-seq",
+    "--mchan-trace=1000",
+    "--bar-intervals=1000,60000",
+    "--ochan=tcp://*:9200",
+    "--greeks",
+    "--greeks-rate=0.05",
+    "--checkpoint-dir=/var/lib/wineing/",
+    "--checkpoint-interval=60000",
+    "--tape-root=C:\\md\\",
+    "--batch-workers=4"
+  };
+  fail_unless (sizeof(expected) / sizeof(char*) == args.size(), NULL);
+  for(size_t i = 0; i < args.size(); i++) {
+    fail_unless (0 == strcmp(expected[i], args[i].c_str()), args[i].c_str());
+  }
+}
+END_TEST
+
+Suite * partition_suite (void)
+{
+  Suite *s = suite_create ("Partition");
+
+  TCase *tc_core = tcase_create ("core");
+  tcase_add_test (tc_core, test_PartitionFind);
+  tcase_add_test (tc_core, test_PartitionFqcn);
+  tcase_add_test (tc_core, test_PartitionArgs);
+  suite_add_tcase (s, tc_core);
+
+  return s;
+}
@@ -0,0 +1,132 @@
+
+#include <check.h>
+#include <string>
+
+#include "core/reply.h"
+
+START_TEST (test_SendNext)
+{
+  using namespace WineingCtrlProto;
+
+  fail_unless (0 == reply_init(2, 4), NULL);
+
+  Response res;
+  Response out;
+  for(int i = 1; i <= 4; i++) {
+    res.set_requestid(i);
+    res.set_type(Response::MARKET_START_OK);
+    fail_unless (0 == reply_send(res), NULL);
+  }
+  // The queue is full
+  fail_unless (-1 == reply_send(res), NULL);
+
+  // In order, the first two pooled, the others on the heap
+  for(int i = 1; i <= 4; i++) {
+    reply_buf *b = reply_next();
+    fail_unless (out.ParseFromArray(b->data, b->size), NULL);
+    fail_unless (i == out.requestid(), NULL);
+    fail_unless ((i <= 2) == b->pooled, NULL);
+    reply_free(b->data, b);
+  }
+
+  // Freed buffers are reused
+  fail_unless (0 == reply_send(res), NULL);
+  reply_buf *b = reply_next();
+  fail_unless (1 == b->pooled, NULL);
+  reply_free(b->data, b);
+
+  reply_destroy();
+}
+END_TEST
+
+START_TEST (test_Large)
+{
+  using namespace WineingCtrlProto;
+
+  fail_unless (0 == reply_init(2, 4), NULL);
+
+  Response res;
+  Response out;
+  std::string text (DEFAULTS_CCHAN_BUFFER_SIZE, 'x');
+  res.set_requestid(1);
+  res.set_type(Response::ERR);
+  res.set_err_text(text);
+  fail_unless (0 == reply_send(res), NULL);
+
+  reply_buf *b = reply_next();
+  fail_unless (0 == b->pooled, NULL);
+  fail_unless (DEFAULTS_CCHAN_BUFFER_SIZE < b->size, NULL);
+  fail_unless (out.ParseFromArray(b->data, b->size), NULL);
+  fail_unless (text == out.err_text(), NULL);
+  reply_free(b->data, b);
+
+  reply_destroy();
+}
+END_TEST
+
+START_TEST (test_SendFixed)
+{
+  using namespace WineingCtrlProto;
+
+  fail_unless (0 == reply_init(2, 4), NULL);
+
+  Response out;
+  fail_unless (0 == reply_send_fixed(7, Response::MARKET_STOP_OK), NULL);
+  fail_unless (0 == reply_send_fixed(-1, Response::SHUTDOWN_OK), NULL);
+
+  reply_buf *b = reply_next();
+  fail_unless (out.ParseFromArray(b->data, b->size), NULL);
+  fail_unless (7 == out.requestid(), NULL);
+  fail_unless (Response::MARKET_STOP_OK == out.type(), NULL);
+  fail_unless (0 == b->last, NULL);
+  reply_free(b->data, b);
+
+  b = reply_next();
+  fail_unless (out.ParseFromArray(b->data, b->size), NULL);
+  fail_unless (-1 == out.requestid(), NULL);
+  fail_unless (Response::SHUTDOWN_OK == out.type(), NULL);
+  fail_unless (1 == b->last, NULL);
+  reply_free(b->data, b);
+
+  reply_destroy();
+}
+END_TEST
+
+START_TEST (test_Close)
+{
+  using namespace WineingCtrlProto;
+
+  fail_unless (0 == reply_init(2, 4), NULL);
+
+  // The sentinel follows the Responses queued ahead
+  fail_unless (0 == reply_send_fixed(7, Response::MARKET_STOP_OK), NULL);
+  reply_close();
+  reply_buf *b = reply_next();
+  fail_unless (NULL != b && 0 == b->last, NULL);
+  reply_free(b->data, b);
+  fail_unless (NULL == reply_next(), NULL);
+
+  // Left queued if SHUTDOWN_OK came first
+  fail_unless (0 == reply_send_fixed(8, Response::SHUTDOWN_OK), NULL);
+  reply_close();
+  b = reply_next();
+  fail_unless (NULL != b && 1 == b->last, NULL);
+  reply_free(b->data, b);
+
+  reply_destroy();
+}
+END_TEST
+
+Suite * reply_suite (void)
+{
+  Suite *s = suite_create ("Reply");
+
+  TCase *tc_core = tcase_create ("core");
+  tcase_add_test (tc_core, test_SendNext);
+  tcase_add_test (tc_core, test_Large);
+  tcase_add_test (tc_core, test_SendFixed);
+  tcase_add_test (tc_core, test_Close);
+  suite_add_tcase (s, tc_core);
+
+  return s;
+}
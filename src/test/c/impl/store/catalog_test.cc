@@ -0,0 +1,99 @@
+#include <check.h>
+
+#include "store/catalog.h"
+#include "nx/nxinf.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+START_TEST (test_CatalogParse)
+{
+  catalog_tape t;
+
+  fail_unless (0 == catalog_parse("20121012.GS.nx2", &t), NULL);
+  fail_unless (20121012 == t.date, NULL);
+  fail_unless (0 == strcmp("GS", t.feed), NULL);
+  fail_unless (0 == strcmp("20121012.GS.nx2", t.name), NULL);
+
+  // Journals, columnar files and anything else
+  fail_unless (-1 == catalog_parse("20121012.GS.nx2.wj", &t), NULL);
+  fail_unless (-1 == catalog_parse("20121012.GS.nx2.trade.idx", &t), NULL);
+  fail_unless (-1 == catalog_parse("2012101.GS.nx2", &t), NULL);
+  fail_unless (-1 == catalog_parse("2012x012.GS.nx2", &t), NULL);
+  fail_unless (-1 == catalog_parse("20121012..nx2", &t), NULL);
+  fail_unless (-1 == catalog_parse("20121012.GS.", &t), NULL);
+  fail_unless (-1 == catalog_parse("20121012.TOOLONGFEED.nx2", &t), NULL);
+  fail_unless (-1 == catalog_parse("README", &t), NULL);
+}
+END_TEST
+
+START_TEST (test_CatalogScan)
+{
+  char dir[64], path[128];
+  snprintf(dir, sizeof(dir), "/tmp/wineing_catalog_%d/", getpid());
+  mkdir(dir, 0700);
+
+  // Out of order, two feeds, a journal
+  const char *names[] = {
+    "20121015.GS.nx2",
+    "20121012.GS.nx2",
+    "20121012.XA.nx2",
+    "20121016.XA.nx2",
+    "20121012.GS.nx2.wj"
+  };
+  for(int i = 0; i < 5; i++) {
+    snprintf(path, sizeof(path), "%s%s", dir, names[i]);
+    FILE *f = fopen(path, "w");
+    fwrite("tape", 1, i + 1, f);
+    fclose(f);
+  }
+
+  catalog *c = catalog_init();
+  fail_unless (4 == catalog_scan(c, dir), NULL);
+  fail_unless (0 == strcmp("20121012.GS.nx2", c->tapes[0].name), NULL);
+  fail_unless (0 == strcmp("20121012.XA.nx2", c->tapes[1].name), NULL);
+  fail_unless (0 == strcmp("20121015.GS.nx2", c->tapes[2].name), NULL);
+  fail_unless (0 == strcmp("20121016.XA.nx2", c->tapes[3].name), NULL);
+  fail_unless (2 == c->tapes[0].size && 1 == c->tapes[2].size, NULL);
+
+  const catalog_tape *t = catalog_find(c, "20121012.XA.nx2");
+  fail_unless (&c->tapes[1] == t, NULL);
+  fail_unless (NULL == catalog_find(c, "20121013.XA.nx2"), NULL);
+  fail_unless (NULL == catalog_find(c, "20121012.GS.nx2.wj"), NULL);
+
+  // The next day of the same feed, skipping other feeds
+  fail_unless (&c->tapes[3] == catalog_next(c, t), NULL);
+  fail_unless (&c->tapes[2] == catalog_next(c, &c->tapes[0]), NULL);
+  fail_unless (NULL == catalog_next(c, &c->tapes[3]), NULL);
+
+  // The tapes found are readable ahead
+  fail_unless (0 == wininf_file_prefetch(path), NULL);
+
+  // Rescanning replaces the tapes
+  for(int i = 0; i < 5; i++) {
+    snprintf(path, sizeof(path), "%s%s", dir, names[i]);
+    unlink(path);
+  }
+  rmdir(dir);
+  fail_unless (0 == catalog_scan(c, dir), NULL);
+  fail_unless (NULL == catalog_find(c, "20121012.XA.nx2"), NULL);
+  fail_unless (-1 == wininf_file_prefetch(path), NULL);
+  fail_unless (-1 == wininf_file_size(path), NULL);
+
+  catalog_destroy(c);
+}
+END_TEST
+
+Suite * catalog_suite (void)
+{
+  Suite *s = suite_create ("Catalog");
+
+  TCase *tc_core = tcase_create ("core");
+  tcase_add_test (tc_core, test_CatalogParse);
+  tcase_add_test (tc_core, test_CatalogScan);
+  suite_add_tcase (s, tc_core);
+
+  return s;
+}
@@ -0,0 +1,114 @@
+#include <check.h>
+
+#include "store/colfile.h"
+#include "store/coltab.h"
+
+#include <stdio.h>
+#include <unistd.h>
+
+START_TEST (test_ColfileRoundTrip)
+{
+  char path[64];
+  snprintf(path, sizeof(path), "/tmp/wineing_colfile_%d.col", getpid());
+
+  // Compressible and incompressible blocks, the last one partial
+  uint32_t data[2500];
+  for(int i = 0; i < 2500; i++) {
+    data[i] = i < 1000 ? 34200000 + i / 100 : (uint32_t)i * 2654435761u;
+  }
+  fail_unless (0 == colfile_write(path, data, sizeof(uint32_t), 2500, 1000), NULL);
+
+  colfile *cf = colfile_open(path);
+  fail_unless (NULL != cf, NULL);
+  fail_unless (3 == cf->header->blocks, NULL);
+  fail_unless (COLFILE_CODEC_LZ4 == cf->blocks[0].codec, NULL);
+
+  uint32_t rows;
+  const uint32_t *b = (const uint32_t*)colfile_block_data(cf, 2, &rows);
+  fail_unless (500 == rows && data[2000] == b[0], NULL);
+
+  // Spans all blocks
+  uint32_t out[2500];
+  fail_unless (0 == colfile_read(cf, 999, 1501, out), NULL);
+  fail_unless (0 == memcmp(&data[999], out, 1501 * sizeof(uint32_t)), NULL);
+  fail_unless (-1 == colfile_read(cf, 2000, 501, out), NULL);
+
+  colfile_close(cf);
+  unlink(path);
+}
+END_TEST
+
+START_TEST (test_ColtabSortsBySymbol)
+{
+  char base[64], path[96];
+  snprintf(base, sizeof(base), "/tmp/wineing_coltab_%d", getpid());
+
+  symtab *syms = symtab_init(4);
+  int added;
+  symtab_intern(syms, "eAAPL", 14, &added);
+  symtab_intern(syms, "eIBM", 14, &added);
+  symtab_intern(syms, "eMSFT", 12, &added);
+
+  const char *names[] = { "price" };
+  const size_t sizes[] = { sizeof(int32_t) };
+  coltab *t = coltab_init(names, sizes, 1);
+
+  // Symbol 1 never trades
+  unsigned int ids[] = { 2, 0, 2, 0, 2 };
+  for(int i = 0; i < 5; i++) {
+    int64_t row = coltab_append(t, ids[i]);
+    fail_unless (i == row, NULL);
+    *(int32_t*)coltab_at(t, 0, row) = i;
+  }
+  fail_unless (0 == coltab_write(t, base, syms), NULL);
+  fail_unless (0 == t->rows, NULL);
+
+  // Stable, rows of a symbol remain in order
+  int32_t prices[5];
+  uint32_t sym_ids[5];
+  snprintf(path, sizeof(path), "%s.price.col", base);
+  colfile *cf = colfile_open(path);
+  fail_unless (0 == colfile_read(cf, 0, 5, prices), NULL);
+  colfile_close(cf);
+  unlink(path);
+  fail_unless (1 == prices[0] && 3 == prices[1], NULL);
+  fail_unless (0 == prices[2] && 2 == prices[3] && 4 == prices[4], NULL);
+
+  snprintf(path, sizeof(path), "%s.symbol_id.col", base);
+  cf = colfile_open(path);
+  fail_unless (0 == colfile_read(cf, 0, 5, sym_ids), NULL);
+  colfile_close(cf);
+  unlink(path);
+  fail_unless (0 == sym_ids[1] && 2 == sym_ids[2], NULL);
+
+  snprintf(path, sizeof(path), "%s.idx", base);
+  FILE *f = fopen(path, "rb");
+  coltab_index_header h;
+  coltab_index_entry e[2];
+  fail_unless (1 == fread(&h, sizeof(h), 1, f), NULL);
+  fail_unless (COLTAB_INDEX_MAGIC == h.magic && 2 == h.symbols, NULL);
+  fail_unless (5 == h.rows, NULL);
+  fail_unless (2 == fread(e, sizeof(coltab_index_entry), 2, f), NULL);
+  fclose(f);
+  unlink(path);
+  fail_unless (0 == e[0].id && 0 == e[0].first && 2 == e[0].rows, NULL);
+  fail_unless (0 == strcmp("eAAPL", e[0].name) && 14 == e[0].exg, NULL);
+  fail_unless (2 == e[1].id && 2 == e[1].first && 3 == e[1].rows, NULL);
+  fail_unless (0 == strcmp("eMSFT", e[1].name), NULL);
+
+  coltab_destroy(t);
+  symtab_destroy(syms);
+}
+END_TEST
+
+Suite * coltab_suite (void)
+{
+  Suite *s = suite_create ("Coltab");
+
+  TCase *tc_core = tcase_create ("core");
+  tcase_add_test (tc_core, test_ColfileRoundTrip);
+  tcase_add_test (tc_core, test_ColtabSortsBySymbol);
+  suite_add_tcase (s, tc_core);
+
+  return s;
+}
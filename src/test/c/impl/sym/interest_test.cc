@@ -0,0 +1,99 @@
+#include <check.h>
+#include <string.h>
+
+#include "sym/interest.h"
+
+/**
+ * Applies the subscription of *topic*, *size* including a NULL byte
+ * if any.
+ */
+static int _subscribe(interest *in, int on, const char *topic, size_t size)
+{
+  char msg[SYMTAB_NAME_SIZE + 1];
+  msg[0] = on;
+  memcpy(&msg[1], topic, size);
+  return interest_update(in, msg, size + 1);
+}
+
+START_TEST (test_NobodySubscribed)
+{
+  interest *in = interest_init();
+  interest_compile(in);
+
+  fail_unless (SYMFILTER_DROP == interest_get(in, 0), NULL);
+
+  // Topic frames of STATUS only
+  fail_unless (0 == _subscribe(in, 1, "", 1), NULL);
+  interest_compile(in);
+  fail_unless (SYMFILTER_UNKNOWN == interest_get(in, 0), NULL);
+  fail_unless (SYMFILTER_DROP == interest_eval(in, 0, "eAAPL", 14, 0), NULL);
+
+  interest_destroy(in);
+}
+END_TEST
+
+START_TEST (test_SymbolsAndPrefixes)
+{
+  interest *in = interest_init();
+  fail_unless (0 == _subscribe(in, 1, "eAAPL", 6), NULL);
+  fail_unless (0 == _subscribe(in, 1, "oSP", 3), NULL);
+  interest_compile(in);
+
+  fail_unless (SYMFILTER_PASS == interest_eval(in, 1, "eAAPL", 14, 0), NULL);
+  fail_unless (SYMFILTER_DROP == interest_eval(in, 2, "eAAPLX", 14, 0), NULL);
+  fail_unless (SYMFILTER_PASS == interest_eval(in, 3, "oSPX", 3, 1), NULL);
+  fail_unless (SYMFILTER_PASS == interest_get(in, 1), NULL);
+  fail_unless (SYMFILTER_DROP == interest_get(in, 2), NULL);
+
+  // Everything
+  fail_unless (0 == _subscribe(in, 1, "", 0), NULL);
+  interest_compile(in);
+  fail_unless (SYMFILTER_PASS == interest_get(in, 2), NULL);
+
+  // Not a subscription
+  fail_unless (-1 == interest_update(in, "\x02" "eIBM", 5), NULL);
+  fail_unless (-1 == interest_update(in, "", 0), NULL);
+
+  interest_destroy(in);
+}
+END_TEST
+
+START_TEST (test_Unsubscribe)
+{
+  interest *in = interest_init();
+  fail_unless (0 == _subscribe(in, 1, "eAAPL", 6), NULL);
+  fail_unless (0 == _subscribe(in, 1, "eAAPL", 6), NULL);
+  fail_unless (0 == _subscribe(in, 1, "eMSFT", 6), NULL);
+  interest_compile(in);
+  fail_unless (SYMFILTER_PASS == interest_eval(in, 1, "eAAPL", 14, 0), NULL);
+
+  // Until the last subscriber is gone, nothing changed
+  fail_unless (0 == _subscribe(in, 0, "eAAPL", 6), NULL);
+  interest_compile(in);
+  fail_unless (SYMFILTER_PASS == interest_get(in, 1), NULL);
+
+  fail_unless (0 == _subscribe(in, 0, "eAAPL", 6), NULL);
+  interest_compile(in);
+  fail_unless (SYMFILTER_DROP == interest_eval(in, 1, "eAAPL", 14, 0), NULL);
+  fail_unless (SYMFILTER_PASS == interest_eval(in, 2, "eMSFT", 14, 0), NULL);
+
+  interest_clear(in);
+  interest_compile(in);
+  fail_unless (SYMFILTER_DROP == interest_get(in, 2), NULL);
+
+  interest_destroy(in);
+}
+END_TEST
+
+Suite * interest_suite (void)
+{
+  Suite *s = suite_create ("Interest");
+
+  TCase *tc_core = tcase_create ("core");
+  tcase_add_test (tc_core, test_NobodySubscribed);
+  tcase_add_test (tc_core, test_SymbolsAndPrefixes);
+  tcase_add_test (tc_core, test_Unsubscribe);
+  suite_add_tcase (s, tc_core);
+
+  return s;
+}
@@ -0,0 +1,91 @@
+#include <check.h>
+
+#include "sym/symfilter.h"
+
+START_TEST (test_EmptyPassesEverything)
+{
+  symfilter *f = symfilter_init();
+  symfilter_compile(f);
+
+  fail_unless (1 == symfilter_eval(f, "eAAPL", 14, 0, 0), NULL);
+  fail_unless (1 == symfilter_eval(f, "oAAPL", 3, 1, 20131018), NULL);
+  fail_unless (symfilter_type(f, 1) && symfilter_type(f, 7), NULL);
+
+  symfilter_destroy(f);
+}
+END_TEST
+
+START_TEST (test_Spec)
+{
+  symfilter *f = symfilter_init();
+  symfilter_add_symbol(f, "eMSFT");
+  symfilter_add_symbol(f, "eAAPL");
+  symfilter_add_prefix(f, "fES");
+  symfilter_add_root(f, "oSPX");
+  symfilter_add_exchange(f, 14);
+  symfilter_add_exchange(f, 3);
+  symfilter_set_expiry(f, 20131001, 20131031);
+  symfilter_add_type(f, 4);
+  symfilter_compile(f);
+
+  fail_unless (1 == symfilter_eval(f, "eAAPL", 14, 0, 0), NULL);
+  fail_unless (1 == symfilter_eval(f, "eMSFT", 14, 0, 0), NULL);
+  fail_unless (0 == symfilter_eval(f, "eIBM", 14, 0, 0), NULL);
+  // Wrong exchange
+  fail_unless (0 == symfilter_eval(f, "eAAPL", 12, 0, 0), NULL);
+  fail_unless (1 == symfilter_eval(f, "fESZ13", 3, 0, 0), NULL);
+
+  // Roots match options only, within the expiry range
+  fail_unless (0 == symfilter_eval(f, "oSPX", 3, 0, 0), NULL);
+  fail_unless (1 == symfilter_eval(f, "oSPX", 3, 1, 20131018), NULL);
+  fail_unless (0 == symfilter_eval(f, "oSPX", 3, 1, 20131116), NULL);
+
+  // Only trades
+  fail_unless (0 == symfilter_type(f, 1), NULL);
+  fail_unless (0 != symfilter_type(f, 4), NULL);
+
+  symfilter_destroy(f);
+}
+END_TEST
+
+START_TEST (test_State)
+{
+  symfilter *f = symfilter_init();
+  symfilter_compile(f);
+
+  fail_unless (SYMFILTER_UNKNOWN == symfilter_get(f, 0), NULL);
+  fail_unless (SYMFILTER_PASS == symfilter_set(f, 0, 1), NULL);
+  fail_unless (SYMFILTER_DROP == symfilter_set(f, 1, 0), NULL);
+  // Grows
+  fail_unless (SYMFILTER_PASS == symfilter_set(f, 100000, 1), NULL);
+
+  fail_unless (SYMFILTER_PASS == symfilter_get(f, 0), NULL);
+  fail_unless (SYMFILTER_DROP == symfilter_get(f, 1), NULL);
+  fail_unless (SYMFILTER_UNKNOWN == symfilter_get(f, 2), NULL);
+  fail_unless (SYMFILTER_PASS == symfilter_get(f, 100000), NULL);
+  fail_unless (SYMFILTER_UNKNOWN == symfilter_get(f, 1 << 30), NULL);
+
+  // Overwrites
+  fail_unless (SYMFILTER_DROP == symfilter_set(f, 0, 0), NULL);
+  fail_unless (SYMFILTER_DROP == symfilter_get(f, 0), NULL);
+
+  symfilter_reset(f);
+  fail_unless (SYMFILTER_UNKNOWN == symfilter_get(f, 1), NULL);
+  fail_unless (SYMFILTER_UNKNOWN == symfilter_get(f, 100000), NULL);
+
+  symfilter_destroy(f);
+}
+END_TEST
+
+Suite * symfilter_suite (void)
+{
+  Suite *s = suite_create ("Symfilter");
+
+  TCase *tc_core = tcase_create ("core");
+  tcase_add_test (tc_core, test_EmptyPassesEverything);
+  tcase_add_test (tc_core, test_Spec);
+  tcase_add_test (tc_core, test_State);
+  suite_add_tcase (s, tc_core);
+
+  return s;
+}
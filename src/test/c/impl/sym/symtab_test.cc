@@ -0,0 +1,98 @@
+
+#include <check.h>
+#include <stdio.h>
+
+#include "sym/symtab.h"
+
+START_TEST (test_InternAssignsDenseIds)
+{
+  symtab *t = symtab_init(4);
+
+  fail_unless (0 == symtab_intern(t, "eIBM", 1), NULL);
+  fail_unless (1 == symtab_intern(t, "eMSFT", 1), NULL);
+  fail_unless (2 == symtab_intern(t, "eIBM", 2), NULL);
+  fail_unless (0 == symtab_intern(t, "eIBM", 1), NULL);
+  fail_unless (3 == t->size, NULL);
+
+  symtab_destroy(t);
+}
+END_TEST
+
+START_TEST (test_FindSurvivesGrowth)
+{
+  symtab *t = symtab_init(16);
+  char name[SYMTAB_NAME_SIZE];
+  int added;
+
+  for(unsigned int i = 0; i < 10000; i++) {
+    snprintf(name, SYMTAB_NAME_SIZE, "e%u", i);
+    fail_unless (i == symtab_intern(t, name, 0, &added), NULL);
+    fail_unless (1 == added, NULL);
+  }
+  for(unsigned int i = 0; i < 10000; i++) {
+    snprintf(name, SYMTAB_NAME_SIZE, "e%u", i);
+    fail_unless (i == symtab_find(t, name, 0), NULL);
+  }
+  fail_unless (SYMTAB_NONE == symtab_find(t, "e10000", 0), NULL);
+
+  symtab_destroy(t);
+}
+END_TEST
+
+START_TEST (test_RemoveNeverReusesId)
+{
+  symtab *t = symtab_init(16);
+  char name[SYMTAB_NAME_SIZE];
+
+  for(unsigned int i = 0; i < 100; i++) {
+    snprintf(name, SYMTAB_NAME_SIZE, "e%u", i);
+    symtab_intern(t, name, 0);
+  }
+
+  fail_unless (0 == symtab_remove(t, 42), NULL);
+  fail_unless (-1 == symtab_remove(t, 42), NULL);
+  fail_unless (SYMTAB_NONE == symtab_find(t, "e42", 0), NULL);
+  fail_unless (symtab_get(t, 42)->flags & SYMTAB_FLAG_DELETED, NULL);
+
+  // Every other symbol must still be reachable after the backward
+  // shift deletion
+  for(unsigned int i = 0; i < 100; i++) {
+    snprintf(name, SYMTAB_NAME_SIZE, "e%u", i);
+    fail_unless (i == 42 || i == symtab_find(t, name, 0), NULL);
+  }
+
+  fail_unless (100 == symtab_intern(t, "e42", 0), NULL);
+
+  symtab_destroy(t);
+}
+END_TEST
+
+START_TEST (test_RenameKeepsId)
+{
+  symtab *t = symtab_init(16);
+
+  unsigned int id = symtab_intern(t, "eFB", 1);
+  symtab_intern(t, "eGOOG", 1);
+
+  fail_unless (-1 == symtab_rename(t, id, "eGOOG", 1), NULL);
+  fail_unless (0 == symtab_rename(t, id, "eMETA", 1), NULL);
+  fail_unless (id == symtab_find(t, "eMETA", 1), NULL);
+  fail_unless (SYMTAB_NONE == symtab_find(t, "eFB", 1), NULL);
+
+  symtab_destroy(t);
+}
+END_TEST
+
+Suite * symtab_suite (void)
+{
+  Suite *s = suite_create ("Symtab");
+
+  TCase *tc_core = tcase_create ("core");
+  tcase_add_test (tc_core, test_InternAssignsDenseIds);
+  tcase_add_test (tc_core, test_FindSurvivesGrowth);
+  tcase_add_test (tc_core, test_RemoveNeverReusesId);
+  tcase_add_test (tc_core, test_RenameKeepsId);
+  suite_add_tcase (s, tc_core);
+
+  return s;
+}
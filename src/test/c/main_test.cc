@@ -3,6 +3,29 @@
 #include <check.h>
 
 #include "impl/conc/conc_test.cc"
+#include "impl/conc/queue_test.cc"
+#include "impl/conc/rcu_test.cc"
+#include "impl/conc/credit_test.cc"
+#include "impl/sym/symtab_test.cc"
+#include "impl/sym/symfilter_test.cc"
+#include "impl/sym/interest_test.cc"
+#include "impl/codec/qdelta_test.cc"
+#include "impl/codec/lz4batch_test.cc"
+#include "impl/codec/pbframe_test.cc"
+#include "impl/codec/seqhdr_test.cc"
+#include "impl/codec/tracehdr_test.cc"
+#include "impl/agg/bars_test.cc"
+#include "impl/agg/urate_test.cc"
+#include "impl/agg/nbbo_test.cc"
+#include "impl/agg/greeks_test.cc"
+#include "impl/core/batch_test.cc"
+#include "impl/core/partition_test.cc"
+#include "impl/core/embed_test.cc"
+#include "impl/core/reply_test.cc"
+#include "impl/core/checkpoint_test.cc"
+#include "impl/core/columnar_test.cc"
+#include "impl/store/coltab_test.cc"
+#include "impl/store/catalog_test.cc"
 
 /*
    gcc -I ../../main/c/ -I . -Wall -lcheck -ftest-coverage -std=c++11 \
@@ -17,6 +40,29 @@ int main(int argc, char **argv)
 
   Suite *s = lazy_suite();
   SRunner *sr = srunner_create (s);
+  srunner_add_suite (sr, queue_suite ());
+  srunner_add_suite (sr, rcu_suite ());
+  srunner_add_suite (sr, credit_suite ());
+  srunner_add_suite (sr, symtab_suite ());
+  srunner_add_suite (sr, symfilter_suite ());
+  srunner_add_suite (sr, interest_suite ());
+  srunner_add_suite (sr, qdelta_suite ());
+  srunner_add_suite (sr, lz4batch_suite ());
+  srunner_add_suite (sr, pbframe_suite ());
+  srunner_add_suite (sr, seqhdr_suite ());
+  srunner_add_suite (sr, tracehdr_suite ());
+  srunner_add_suite (sr, bars_suite ());
+  srunner_add_suite (sr, urate_suite ());
+  srunner_add_suite (sr, nbbo_suite ());
+  srunner_add_suite (sr, greeks_suite ());
+  srunner_add_suite (sr, batch_suite ());
+  srunner_add_suite (sr, partition_suite ());
+  srunner_add_suite (sr, embed_suite ());
+  srunner_add_suite (sr, reply_suite ());
+  srunner_add_suite (sr, checkpoint_suite ());
+  srunner_add_suite (sr, columnar_suite ());
+  srunner_add_suite (sr, coltab_suite ());
+  srunner_add_suite (sr, catalog_suite ());
 
   srunner_run_all (sr, CK_NORMAL);
   number_failed = srunner_ntests_failed (sr);
@@ -0,0 +1,41 @@
+package org.instilled.wineing.test;
+
+import junit.framework.TestCase;
+
+import org.instilled.wineing.core.CreditWindow;
+
+public class TestCreditWindow extends TestCase
+{
+    public void testGrantOnConsume()
+    {
+        CreditWindow w = new CreditWindow(10);
+        assertEquals(10, w.getWindow());
+
+        // Half the window is granted once consumed
+        for (int i = 0; i < 4; i++)
+        {
+            assertEquals(0, w.consume());
+        }
+        assertEquals(5, w.consume());
+        for (int i = 0; i < 4; i++)
+        {
+            assertEquals(0, w.consume());
+        }
+        assertEquals(5, w.consume());
+    }
+
+    public void testSmallWindow()
+    {
+        CreditWindow w = new CreditWindow(1);
+        assertEquals(1, w.consume());
+        assertEquals(1, w.consume());
+
+        try
+        {
+            new CreditWindow(0);
+            fail();
+        } catch (IllegalArgumentException e)
+        {
+        }
+    }
+}
@@ -0,0 +1,92 @@
+package org.instilled.wineing.test;
+
+import junit.framework.TestCase;
+
+import org.instilled.wineing.core.FeedArbiter;
+
+public class TestFeedArbiter extends TestCase
+{
+    private static final long DAY = 41194L << 40;
+
+    public void testHeader()
+    {
+        // Laid out as by seqhdr_put, at an offset
+        byte[] buffer = new byte[3 + FeedArbiter.HEADER_SIZE + 1];
+        long seq = 0x0102030405060708L;
+        buffer[3] = (byte) FeedArbiter.HEADER_MARKER;
+        for (int i = 0; i < 8; i++)
+        {
+            buffer[4 + i] = (byte) (seq >>> (i << 3));
+        }
+
+        assertTrue(FeedArbiter.isSequenced(buffer, 3, buffer.length - 3));
+        assertEquals(seq, FeedArbiter.getSeq(buffer, 3));
+        assertFalse(FeedArbiter.isSequenced(buffer, 3,
+                FeedArbiter.HEADER_SIZE - 1));
+        assertFalse(FeedArbiter.isSequenced(buffer, 0, buffer.length));
+    }
+
+    public void testDuplicates()
+    {
+        FeedArbiter a = new FeedArbiter(128);
+
+        // Both feeds deliver every frame, B a little behind
+        for (long s = DAY; s < DAY + 1000; s++)
+        {
+            assertTrue(a.accept(s));
+            if (s >= DAY + 3)
+            {
+                assertFalse(a.accept(s - 3));
+            }
+        }
+        assertEquals(1000, a.getAccepted());
+        assertEquals(997, a.getDuplicates());
+        assertEquals(0, a.getLate());
+    }
+
+    public void testGaps()
+    {
+        FeedArbiter a = new FeedArbiter(128);
+        assertTrue(a.accept(DAY));
+
+        // A dropped frames B delivers later
+        assertTrue(a.accept(DAY + 5));
+        assertTrue(a.accept(DAY + 2));
+        assertFalse(a.accept(DAY + 2));
+        assertTrue(a.accept(DAY + 1));
+        assertFalse(a.accept(DAY + 5));
+
+        // Bits of the previous lap are cleared moving ahead
+        assertTrue(a.accept(DAY + 130));
+        assertTrue(a.accept(DAY + 129));
+        assertTrue(a.accept(DAY + 3));
+        assertEquals(2, a.getDuplicates());
+    }
+
+    public void testLate()
+    {
+        FeedArbiter a = new FeedArbiter(100);
+        assertTrue(a.accept(DAY + 1000));
+        assertTrue(a.accept(DAY + 1127));
+
+        // Rounded up to 128
+        assertFalse(a.accept(DAY + 999));
+        assertTrue(a.accept(DAY + 1000 + 64));
+        assertEquals(1, a.getLate());
+    }
+
+    public void testNextDay()
+    {
+        FeedArbiter a = new FeedArbiter(128);
+        assertTrue(a.accept(DAY + 7));
+
+        long next = DAY + (1L << 40);
+        assertTrue(a.accept(next));
+        assertFalse(a.accept(next));
+        assertTrue(a.accept(next + 1));
+
+        // The previous day's frames are late
+        assertFalse(a.accept(DAY + 8));
+        assertEquals(1, a.getLate());
+    }
+}
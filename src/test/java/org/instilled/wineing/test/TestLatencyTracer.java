@@ -0,0 +1,91 @@
+package org.instilled.wineing.test;
+
+import junit.framework.TestCase;
+
+import org.instilled.wineing.core.LatencyHistogram;
+import org.instilled.wineing.core.LatencyTracer;
+
+public class TestLatencyTracer extends TestCase
+{
+    private static final long OPEN = 1350653400000000L;
+
+    /**
+     * Lays out a trace as tracehdr_put does, at <em>offset</em>.
+     */
+    private static byte[] trace(int offset, long... times)
+    {
+        byte[] buffer = new byte[offset + LatencyTracer.HEADER_SIZE + 1];
+        buffer[offset] = (byte) LatencyTracer.HEADER_MARKER;
+        for (int i = 0; i < times.length; i++)
+        {
+            int start = offset + 1 + (i << 3);
+            for (int j = 0; j < 8; j++)
+            {
+                buffer[start + j] = (byte) (times[i] >>> (j << 3));
+            }
+        }
+        return buffer;
+    }
+
+    public void testHeader()
+    {
+        byte[] buffer = trace(3, OPEN, OPEN + 1, -1, 0x0102030405060708L);
+
+        assertTrue(LatencyTracer.isTraced(buffer, 3, buffer.length - 3));
+        assertFalse(LatencyTracer.isTraced(buffer, 3,
+                LatencyTracer.HEADER_SIZE - 1));
+        assertFalse(LatencyTracer.isTraced(buffer, 0, buffer.length));
+        assertEquals(OPEN,
+                LatencyTracer.getTime(buffer, 3, LatencyTracer.HOP_NXCORE));
+        assertEquals(OPEN + 1,
+                LatencyTracer.getTime(buffer, 3, LatencyTracer.HOP_CALLBACK));
+        assertEquals(-1,
+                LatencyTracer.getTime(buffer, 3, LatencyTracer.HOP_ENCODE));
+        assertEquals(0x0102030405060708L,
+                LatencyTracer.getTime(buffer, 3, LatencyTracer.HOP_SEND));
+    }
+
+    public void testHops()
+    {
+        LatencyTracer t = new LatencyTracer();
+        t.record(trace(0, OPEN, OPEN + 900, OPEN + 905, OPEN + 925), 0,
+                OPEN + 1025);
+
+        assertEquals(900, t.getHistogram(LatencyTracer.HOP_NXCORE).getMax());
+        assertEquals(5, t.getHistogram(LatencyTracer.HOP_CALLBACK).getMax());
+        assertEquals(20, t.getHistogram(LatencyTracer.HOP_ENCODE).getMax());
+        assertEquals(100, t.getHistogram(LatencyTracer.HOP_SEND).getMax());
+        assertEquals(1025, t.getHistogram(LatencyTracer.HOP_TOTAL).getMax());
+
+        t.reset();
+        assertEquals(0, t.getHistogram(LatencyTracer.HOP_TOTAL).getCount());
+
+        // The clock is the wall clock
+        long now = System.currentTimeMillis() * 1000;
+        assertTrue(Math.abs(t.currentTimeMicros() - now) < 1000000);
+    }
+
+    public void testHistogram()
+    {
+        LatencyHistogram h = new LatencyHistogram();
+        assertEquals(0, h.getPercentile(50));
+
+        for (int i = 0; i < 98; i++)
+        {
+            h.record(10);
+        }
+        h.record(-3);
+        h.record(5000);
+
+        assertEquals(100, h.getCount());
+        assertEquals(5000, h.getMax());
+        assertEquals(1, h.getBucket(0));
+        assertEquals(98, h.getBucket(4));
+
+        // Upper bounds of the buckets
+        assertEquals(0, h.getPercentile(1));
+        assertEquals(15, h.getPercentile(50));
+        assertEquals(15, h.getPercentile(99));
+        assertEquals(5000, h.getPercentile(100));
+    }
+}
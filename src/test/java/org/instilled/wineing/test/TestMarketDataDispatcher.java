@@ -0,0 +1,126 @@
+package org.instilled.wineing.test;
+
+import java.util.Arrays;
+
+import junit.framework.TestCase;
+
+import org.instilled.wineing.core.MarketDataDispatcher;
+import org.instilled.wineing.core.MarketDataHandler;
+import org.instilled.wineing.core.MarketDataRing;
+import org.instilled.wineing.core.Worker;
+
+public class TestMarketDataDispatcher extends TestCase
+{
+    private static final int SYMBOLS = 64;
+    private static final int QUOTES = 100000;
+
+    public void testRingWrapsAround()
+    {
+        MarketDataRing ring = new MarketDataRing(3);
+        assertEquals(4, ring.capacity());
+
+        for (int i = 0; i < 10; i++)
+        {
+            for (int j = 0; j < 4; j++)
+            {
+                MarketDataRing.Event e = ring.claim();
+                assertNotNull(e);
+                e.symbolId = i * 4 + j;
+                ring.publish();
+            }
+            assertNull(ring.claim());
+            assertEquals(4, ring.available());
+            for (int j = 0; j < 4; j++)
+            {
+                assertEquals(i * 4 + j, ring.get(j).symbolId);
+            }
+            ring.release(4);
+            assertEquals(0, ring.available());
+        }
+    }
+
+    public void testPerSymbolOrder() throws InterruptedException
+    {
+        for (String wait : new String[] { "busy-spin", "yielding",
+                "sleeping", "blocking" })
+        {
+            OrderCheckingHandler[] handlers = new OrderCheckingHandler[4];
+            for (int i = 0; i < handlers.length; i++)
+            {
+                handlers[i] = new OrderCheckingHandler();
+            }
+            MarketDataDispatcher d = new MarketDataDispatcher(handlers,
+                    1024, wait);
+
+            Worker[] workers = d.getWorkers();
+            Thread[] threads = new Thread[workers.length];
+            for (int i = 0; i < workers.length; i++)
+            {
+                threads[i] = new Thread(workers[i]);
+                threads[i].start();
+            }
+
+            for (int q = 0; q < QUOTES; q++)
+            {
+                d.onQuote(q % SYMBOLS, q / SYMBOLS, 0, 0, 0, 0, 0, 0);
+            }
+            // STATUS reaches every handler after all quotes
+            d.onStatus(-1);
+
+            int total = 0;
+            for (int i = 0; i < workers.length; i++)
+            {
+                while (!handlers[i].done)
+                {
+                    Thread.sleep(1);
+                }
+                workers[i].shutdown();
+                threads[i].join();
+                assertFalse(wait, handlers[i].outOfOrder);
+                total += handlers[i].quotes;
+            }
+            assertEquals(wait, QUOTES, total);
+        }
+    }
+
+    private static class OrderCheckingHandler implements MarketDataHandler
+    {
+        private final int[] _last = new int[SYMBOLS];
+        int quotes;
+        boolean outOfOrder;
+        volatile boolean done;
+
+        OrderCheckingHandler()
+        {
+            Arrays.fill(_last, -1);
+        }
+
+        @Override
+        public void onStatus(int timestamp)
+        {
+            done = true;
+        }
+
+        @Override
+        public void onSymbol(int symbolId, byte[] symbol, int offset,
+                int len, int listedExg, boolean deleted)
+        {
+        }
+
+        @Override
+        public void onQuote(int symbolId, int timestamp, int bidPrice,
+                int askPrice, int bidSize, int askSize, int exg,
+                int priceType)
+        {
+            outOfOrder |= timestamp != _last[symbolId] + 1;
+            _last[symbolId] = timestamp;
+            quotes++;
+        }
+
+        @Override
+        public void onTrade(int symbolId, int timestamp, int price,
+                int size, int exg, int priceType)
+        {
+        }
+    }
+}
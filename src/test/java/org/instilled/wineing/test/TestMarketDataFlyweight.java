@@ -0,0 +1,106 @@
+package org.instilled.wineing.test;
+
+import junit.framework.TestCase;
+
+import org.instilled.wineing.core.MarketDataFlyweight;
+import org.instilled.wineing.gen.WineingMarketDataProto.MarketData;
+
+public class TestMarketDataFlyweight extends TestCase
+{
+    public void testQuote()
+    {
+        byte[] msg = MarketData.newBuilder()
+                .setType(MarketData.Type.QUOTE_EX).setSymbolId(4711)
+                .setTimestamp(34200000).setPriceType(7)
+                .setReportingExg(12).setBidPrice(-10001)
+                .setAskPrice(10002).setBidSize(100).setAskSize(200)
+                .build().toByteArray();
+
+        // Decode at an offset to make sure it's honored
+        byte[] buffer = new byte[msg.length + 3];
+        System.arraycopy(msg, 0, buffer, 3, msg.length);
+
+        MarketDataFlyweight m = new MarketDataFlyweight();
+        assertTrue(m.wrap(buffer, 3, msg.length));
+        assertEquals(MarketDataFlyweight.TYPE_QUOTE_EX, m.getType());
+        assertEquals(4711, m.getSymbolId());
+        assertEquals(34200000, m.getTimestamp());
+        assertEquals(7, m.getPriceType());
+        assertEquals(12, m.getReportingExg());
+        assertEquals(-10001, m.getBidPrice());
+        assertEquals(10002, m.getAskPrice());
+        assertEquals(100, m.getBidSize());
+        assertEquals(200, m.getAskSize());
+        assertEquals(0, m.getSymbolLength());
+    }
+
+    public void testSymbol()
+    {
+        byte[] msg = MarketData.newBuilder()
+                .setType(MarketData.Type.SYMBOL).setSymbolId(1)
+                .setSymbol("eAAPL").setListedExg(17).setDeleted(true)
+                .build().toByteArray();
+
+        MarketDataFlyweight m = new MarketDataFlyweight();
+        assertTrue(m.wrap(msg, 0, msg.length));
+        assertEquals(MarketDataFlyweight.TYPE_SYMBOL, m.getType());
+        assertEquals("eAAPL", new String(m.getBuffer(),
+                m.getSymbolOffset(), m.getSymbolLength()));
+        assertEquals(17, m.getListedExg());
+        assertTrue(m.isDeleted());
+
+        // Fields of the previous message must not leak
+        byte[] status = MarketData.newBuilder()
+                .setType(MarketData.Type.STATUS).build().toByteArray();
+        assertTrue(m.wrap(status, 0, status.length));
+        assertEquals(0, m.getSymbolLength());
+        assertFalse(m.isDeleted());
+    }
+
+    public void testBar()
+    {
+        byte[] msg = MarketData.newBuilder()
+                .setType(MarketData.Type.BAR).setSymbolId(3)
+                .setTimestamp(34200000).setInterval(60000).setOpen(100)
+                .setHigh(105).setLow(-2).setClose(101)
+                .setVolume(5000000000L).setVwap(101.25).setTrades(42)
+                .build().toByteArray();
+
+        MarketDataFlyweight m = new MarketDataFlyweight();
+        assertTrue(m.wrap(msg, 0, msg.length));
+        assertEquals(MarketDataFlyweight.TYPE_BAR, m.getType());
+        assertEquals(60000, m.getInterval());
+        assertEquals(100, m.getOpen());
+        assertEquals(105, m.getHigh());
+        assertEquals(-2, m.getLow());
+        assertEquals(101, m.getClose());
+        assertEquals(5000000000L, m.getVolume());
+        assertEquals(101.25, m.getVwap(), 0);
+        assertEquals(42, m.getTrades());
+    }
+
+    public void testUnderlyingStats()
+    {
+        byte[] msg = MarketData.newBuilder()
+                .setType(MarketData.Type.UNDERLYING_STATS).setSymbol("eAAPL")
+                .setTimestamp(34200000).setInterval(1000).setMessages(1234)
+                .build().toByteArray();
+
+        MarketDataFlyweight m = new MarketDataFlyweight();
+        assertTrue(m.wrap(msg, 0, msg.length));
+        assertEquals(MarketDataFlyweight.TYPE_UNDERLYING_STATS, m.getType());
+        assertEquals(5, m.getSymbolLength());
+        assertEquals(1000, m.getInterval());
+        assertEquals(1234, m.getMessages());
+    }
+
+    public void testTruncated()
+    {
+        byte[] msg = MarketData.newBuilder()
+                .setType(MarketData.Type.SYMBOL).setSymbol("eAAPL")
+                .build().toByteArray();
+
+        MarketDataFlyweight m = new MarketDataFlyweight();
+        assertFalse(m.wrap(msg, 0, msg.length - 1));
+    }
+}
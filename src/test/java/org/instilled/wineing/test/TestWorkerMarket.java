@@ -0,0 +1,18 @@
+package org.instilled.wineing.test;
+
+import java.util.Arrays;
+
+import junit.framework.TestCase;
+
+import org.instilled.wineing.WorkerMarket;
+
+public class TestWorkerMarket extends TestCase
+{
+    public void testTopic()
+    {
+        // As published on an XPUB mchan, see sym/interest.h
+        assertTrue(Arrays.equals(new byte[] { 'e', 'A', 'A', 'P', 'L', 0 },
+                WorkerMarket.topic("eAAPL")));
+        assertTrue(Arrays.equals(new byte[] { 0 }, WorkerMarket.topic("")));
+    }
+}